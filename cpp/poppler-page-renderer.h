@@ -23,10 +23,13 @@
 #include "poppler-global.h"
 #include "poppler-image.h"
 
+#include <functional>
+
 namespace poppler {
 
 using argb = unsigned int;
 
+class document;
 class page;
 class page_renderer_private;
 
@@ -63,8 +66,14 @@ public:
     line_mode_enum line_mode() const;
     void set_line_mode(line_mode_enum mode);
 
+    unsigned int page_threads() const;
+    void set_page_threads(unsigned int threads);
+
     image render_page(const page *p, double xres = 72.0, double yres = 72.0, int x = -1, int y = -1, int w = -1, int h = -1, rotation_enum rotate = rotate_0) const;
 
+    using page_callback = std::function<void(int index, const image &img)>;
+    bool render_pages(const document *doc, int first_index, int last_index, const page_callback &callback, double xres = 72.0, double yres = 72.0, rotation_enum rotate = rotate_0, unsigned int threads = 0) const;
+
     static bool can_render();
 
 private:
@@ -0,0 +1,127 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Checks page_renderer::render_pages(), including a callback that throws.
+
+#include <poppler-document.h>
+#include <poppler-image.h>
+#include <poppler-page-renderer.h>
+
+#include "test-utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int num_pages = 12;
+
+// A document with num_pages pages, each filled with a gray rectangle
+static std::vector<char> build_document()
+{
+    std::vector<std::string> objects = { "<< /Type /Catalog /Pages 2 0 R >>" };
+    std::string kids;
+    for (int i = 0; i < num_pages; ++i) {
+        kids += std::to_string(3 + 2 * i) + " 0 R ";
+    }
+    objects.push_back("<< /Type /Pages /Kids [" + kids + "] /Count " + std::to_string(num_pages) + " >>");
+    for (int i = 0; i < num_pages; ++i) {
+        objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 100] /Contents " + std::to_string(4 + 2 * i) + " 0 R >>");
+        objects.push_back(testStreamObject("", "0.5 g 10 10 80 80 re f"));
+    }
+    return buildTestPdf(objects);
+}
+
+int main()
+{
+    const std::vector<char> data = build_document();
+    const std::unique_ptr<poppler::document> doc(poppler::document::load_from_raw_data(data.data(), static_cast<int>(data.size())));
+    if (!doc || doc->pages() != num_pages) {
+        check(false, "test document loaded");
+        return testExitCode("poppler-render-pages");
+    }
+
+    poppler::page_renderer renderer;
+
+    for (unsigned int threads : { 1U, 4U }) {
+        // every page rendered once
+        std::mutex mutex;
+        std::vector<int> rendered(num_pages, 0);
+        bool images_ok = true;
+        const bool ok = renderer.render_pages(
+                doc.get(), 0, num_pages - 1,
+                [&](int index, const poppler::image &img) {
+                    const std::scoped_lock lock(mutex);
+                    ++rendered[index];
+                    images_ok = images_ok && img.is_valid() && img.width() == 100 && img.height() == 100;
+                },
+                72.0, 72.0, poppler::rotate_0, threads);
+        check(ok, "render_pages succeeds");
+        check(images_ok, "rendered images have the page size");
+        bool all_once = true;
+        for (int count : rendered) {
+            all_once = all_once && count == 1;
+        }
+        check(all_once, "every page rendered exactly once");
+
+        // a throwing callback reaches the caller once the threads are done:
+        // no callback runs after that, no page is rendered twice, and a
+        // single thread stops at the throwing page
+        std::mutex calls_mutex;
+        std::vector<int> calls(num_pages, 0);
+        std::atomic<bool> returned = false;
+        std::atomic<bool> called_after_return = false;
+        bool caught = false;
+        try {
+            renderer.render_pages(
+                    doc.get(), 0, num_pages - 1,
+                    [&](int index, const poppler::image &) {
+                        called_after_return = called_after_return || returned;
+                        {
+                            const std::scoped_lock lock(calls_mutex);
+                            ++calls[index];
+                        }
+                        if (index == 2) {
+                            throw std::runtime_error("page 2");
+                        }
+                    },
+                    72.0, 72.0, poppler::rotate_0, threads);
+        } catch (const std::runtime_error &e) {
+            caught = std::string(e.what()) == "page 2";
+        }
+        returned = true;
+        check(caught, "exception from the callback rethrown");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        check(!called_after_return, "no callback after render_pages returned");
+        check(calls[2] == 1, "throwing page rendered once");
+        bool at_most_once = true;
+        for (int count : calls) {
+            at_most_once = at_most_once && count <= 1;
+        }
+        check(at_most_once, "no page rendered twice after the exception");
+        if (threads == 1) {
+            check(calls[3] == 0 && calls[num_pages - 1] == 0, "pages after the exception skipped");
+        }
+    }
+
+    check(!renderer.render_pages(doc.get(), 3, num_pages, [](int, const poppler::image &) { }), "invalid range rejected");
+
+    return testExitCode("poppler-render-pages");
+}
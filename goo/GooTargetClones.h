@@ -0,0 +1,32 @@
+//========================================================================
+//
+// GooTargetClones.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef GOOTARGETCLONES_H
+#define GOOTARGETCLONES_H
+
+// Functions marked GOO_TARGET_CLONES are also built for AVX2, and the
+// version for the CPU is picked when the library is loaded.  This needs
+// ifunc support, so it is only done on x86-64 with glibc, and only by
+// GCC, the compiler the vectorization of the cloned loops is checked
+// with (with -fopt-info-vec).  Elsewhere the functions are built once,
+// for the baseline instruction set.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__GLIBC__)
+#    define GOO_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#    define GOO_TARGET_CLONES
+#endif
+
+// Functions marked GOO_FLATTEN get all their calls inlined, so that the
+// loops calling small helpers can be vectorized.
+#if defined(__GNUC__)
+#    define GOO_FLATTEN __attribute__((flatten))
+#else
+#    define GOO_FLATTEN
+#endif
+
+#endif
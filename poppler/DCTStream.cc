@@ -67,6 +67,7 @@ static void str_term_source(j_decompress_ptr /*cinfo*/) { }
 DCTStream::DCTStream(std::unique_ptr<Stream> strA, int colorXformA, Dict *dict, int recursion) : OwnedFilterStream(std::move(strA))
 {
     colorXform = colorXformA;
+    scaleDenom = 1;
     if (dict != nullptr) {
         Object obj = dict->lookup("Width", recursion);
         err.width = (obj.isInt() && obj.getInt() <= JPEG_MAX_DIMENSION) ? obj.getInt() : 0;
@@ -130,6 +131,33 @@ bool DCTStream::rewind()
         init();
     }
 
+    if (!findStart()) {
+        return false;
+    }
+
+    if (readHeader()) {
+        if (!setjmp(err.setjmp_buffer)) {
+            cinfo.scale_num = 1;
+            cinfo.scale_denom = scaleDenom;
+
+            jpeg_start_decompress(&cinfo);
+
+            row_stride = cinfo.output_width * cinfo.output_components;
+            row_buffer = cinfo.mem->alloc_sarray(reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE, row_stride, 1);
+        }
+    }
+
+    return success;
+}
+
+void DCTStream::close()
+{
+    restoreFullResolution();
+    OwnedFilterStream::close();
+}
+
+bool DCTStream::findStart()
+{
     // JPEG data has to start with 0xFF 0xD8
     // but some pdf like the one on
     // https://bugs.freedesktop.org/show_bug.cgi?id=3299
@@ -157,7 +185,11 @@ bool DCTStream::rewind()
             }
         }
     }
+    return true;
+}
 
+bool DCTStream::readHeader()
+{
     if (!setjmp(err.setjmp_buffer)) {
         if (jpeg_read_header(&cinfo, TRUE) != JPEG_SUSPENDED) {
             // figure out color transform
@@ -186,15 +218,45 @@ bool DCTStream::rewind()
                 cinfo.jpeg_color_space = colorXform ? JCS_YCCK : JCS_CMYK;
                 break;
             }
+            return true;
+        }
+    }
+    return false;
+}
 
-            jpeg_start_decompress(&cinfo);
+bool DCTStream::reduceResolution(int *width, int *height, int targetWidth, int targetHeight, std::array<int, 4> *area)
+{
+    int denom = 8;
+    while (denom > 1 && (*width / denom < targetWidth || *height / denom < targetHeight)) {
+        denom /= 2;
+    }
+    if (denom == 1) {
+        return false;
+    }
 
-            row_stride = cinfo.output_width * cinfo.output_components;
-            row_buffer = cinfo.mem->alloc_sarray(reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE, row_stride, 1);
-        }
+    // The caller expects the size from the image dictionary, only scale
+    // if it matches the one in the JPEG header, otherwise we wouldn't
+    // know for sure what size libjpeg will output
+    if (row_buffer) {
+        jpeg_destroy_decompress(&cinfo);
+        init();
+    }
+    bool sizeMatches = false;
+    if (str->rewind() && findStart() && readHeader()) {
+        sizeMatches = static_cast<int>(cinfo.image_width) == *width && static_cast<int>(cinfo.image_height) == *height;
+    }
+    jpeg_destroy_decompress(&cinfo);
+    init();
+    if (!sizeMatches) {
+        return false;
     }
 
-    return success;
+    // libjpeg rounds the scaled size up
+    scaleDenom = denom;
+    *area = { 0, 0, *width, *height };
+    *width = (*width + denom - 1) / denom;
+    *height = (*height + denom - 1) / denom;
+    return true;
 }
 
 bool DCTStream::readLine()
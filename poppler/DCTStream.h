@@ -52,19 +52,25 @@ public:
     ~DCTStream() override;
     StreamKind getKind() const override { return strDCT; }
     [[nodiscard]] bool rewind() override;
+    void close() override;
     int getChar() override;
     int lookChar() override;
     std::optional<std::string> getPSFilter(int psLevel, const char *indent) override;
     bool isBinary(bool last = true) const override;
+    bool reduceResolution(int *width, int *height, int targetWidth, int targetHeight, std::array<int, 4> *area) override;
+    void restoreFullResolution() override { scaleDenom = 1; }
 
 private:
     void init();
+    bool findStart();
+    bool readHeader();
 
     bool hasGetChars() override { return true; }
     bool readLine();
     int getChars(int nChars, unsigned char *buffer) override;
 
     int colorXform;
+    int scaleDenom; // libjpeg IDCT scaling, 1, 2, 4 or 8
     JSAMPLE *current;
     JSAMPLE *limit;
     struct jpeg_decompress_struct cinfo;
@@ -49,9 +49,9 @@ constexpr int SORT_LENGTH_LOWER_LIMIT = 32;
 
 struct Dict::CmpDictEntry
 {
-    bool operator()(const DictEntry &lhs, const DictEntry &rhs) const { return lhs.first < rhs.first; }
-    bool operator()(const DictEntry &lhs, std::string_view rhs) const { return lhs.first < rhs; }
-    bool operator()(std::string_view lhs, const DictEntry &rhs) const { return lhs < rhs.first; }
+    bool operator()(const DictEntry &lhs, const DictEntry &rhs) const { return lhs.first.str() < rhs.first.str(); }
+    bool operator()(const DictEntry &lhs, std::string_view rhs) const { return lhs.first.str() < rhs; }
+    bool operator()(std::string_view lhs, const DictEntry &rhs) const { return lhs < rhs.first.str(); }
 };
 
 Dict::Dict(XRef *xrefA)
@@ -75,8 +75,11 @@ Dict::Dict(const Dict *dictA, PrivateTag /*unused*/)
 
 std::unique_ptr<Dict> Dict::copy(XRef *xrefA) const
 {
-    dictLocker();
-    auto dictA = std::make_unique<Dict>(this);
+    std::unique_ptr<Dict> dictA;
+    {
+        dictLocker();
+        dictA = std::make_unique<Dict>(this);
+    }
     dictA->xref = xrefA;
     for (auto &entry : dictA->entries) {
         if (entry.second.getType() == objDict) {
@@ -88,39 +91,62 @@ std::unique_ptr<Dict> Dict::copy(XRef *xrefA) const
 
 std::unique_ptr<Dict> Dict::deepCopy() const
 {
-    dictLocker();
-    auto dictA = std::make_unique<Dict>(xref);
-
-    dictA->entries.reserve(entries.size());
-    for (const auto &entry : entries) {
-        dictA->entries.emplace_back(entry.first, entry.second.deepCopy());
+    std::unique_ptr<Dict> dictA;
+    {
+        dictLocker();
+        dictA = std::make_unique<Dict>(this);
+    }
+    for (auto &entry : dictA->entries) {
+        entry.second = entry.second.deepCopy();
     }
     return dictA;
 }
 
+void Dict::sortEntries()
+{
+    if (entries.size() >= SORT_LENGTH_LOWER_LIMIT && !sorted) {
+        dictLocker();
+        if (!sorted) {
+            std::ranges::sort(entries, CmpDictEntry {});
+            sorted = true;
+        }
+    }
+}
+
 void Dict::add(std::string_view key, Object &&val)
+{
+    add(NameAtom { key }, std::move(val));
+}
+
+void Dict::add(NameAtom key, Object &&val)
 {
     dictLocker();
-    entries.emplace_back(key, std::move(val));
-    sorted = false;
+    if (sorted) {
+        // keep it sorted, lookups never sort
+        const auto pos = std::ranges::upper_bound(entries, key.str(), std::less<> {}, [](const DictEntry &entry) -> const std::string & { return entry.first.str(); });
+        entries.emplace(pos, std::move(key), std::move(val));
+    } else {
+        entries.emplace_back(std::move(key), std::move(val));
+    }
 }
 
-inline const Dict::DictEntry *Dict::find(std::string_view key) const
+static std::string_view keyString(std::string_view key)
 {
-    if (entries.size() >= SORT_LENGTH_LOWER_LIMIT) {
-        if (!sorted) {
-            dictLocker();
-            if (!sorted) {
-                Dict *that = const_cast<Dict *>(this);
+    return key;
+}
 
-                std::ranges::sort(that->entries, CmpDictEntry {});
-                that->sorted = true;
-            }
-        }
-    }
+static std::string_view keyString(const NameAtom &key)
+{
+    return key.str();
+}
 
+// Key is either a std::string_view, compared as a string, or a NameAtom,
+// compared as a pointer when it is a well-known name
+template<typename Key>
+inline const Dict::DictEntry *Dict::findEntry(const Key &key) const
+{
     if (sorted) {
-        const auto pos = std::ranges::lower_bound(entries, key, std::less<> {}, &DictEntry::first);
+        const auto pos = std::ranges::lower_bound(entries, keyString(key), std::less<> {}, [](const DictEntry &entry) -> const std::string & { return entry.first.str(); });
         if (pos != entries.end() && pos->first == key) {
             return &*pos;
         }
@@ -133,9 +159,19 @@ inline const Dict::DictEntry *Dict::find(std::string_view key) const
     return nullptr;
 }
 
+inline const Dict::DictEntry *Dict::find(std::string_view key) const
+{
+    return findEntry(key);
+}
+
+inline const Dict::DictEntry *Dict::find(const NameAtom &key) const
+{
+    return findEntry(key);
+}
+
 inline Dict::DictEntry *Dict::find(std::string_view key)
 {
-    return const_cast<DictEntry *>(const_cast<const Dict *>(this)->find(key));
+    return const_cast<DictEntry *>(findEntry(key));
 }
 
 void Dict::remove(std::string_view key)
@@ -168,7 +204,7 @@ void Dict::set(std::string_view key, Object &&val)
 
 bool Dict::is(std::string_view type) const
 {
-    if (const auto *entry = find("Type")) {
+    if (const auto *entry = find(NameAtoms::Type)) {
         return entry->second.isName(type);
     }
     return false;
@@ -182,6 +218,14 @@ Object Dict::lookup(std::string_view key, int recursion) const
     return Object::null();
 }
 
+Object Dict::lookup(const NameAtom &key, int recursion) const
+{
+    if (const auto *entry = find(key)) {
+        return entry->second.fetch(xref, recursion);
+    }
+    return Object::null();
+}
+
 Object Dict::lookup(std::string_view key, Ref *returnRef, int recursion) const
 {
     if (const auto *entry = find(key)) {
@@ -221,6 +265,15 @@ const Object &Dict::lookupNF(std::string_view key) const
     return nullObj;
 }
 
+const Object &Dict::lookupNF(const NameAtom &key) const
+{
+    if (const auto *entry = find(key)) {
+        return entry->second;
+    }
+    static Object nullObj = Object::null();
+    return nullObj;
+}
+
 bool Dict::lookupInt(std::string_view key, std::optional<std::string_view> alt_key, int *value) const
 {
     auto obj1 = lookup(key);
@@ -68,6 +68,7 @@ public:
 
     // Add an entry. (Moves key into Dict.)
     void add(std::string_view key, Object &&val);
+    void add(NameAtom key, Object &&val);
 
     // Update the value of an existing entry, otherwise create it
     void set(std::string_view key, Object &&val);
@@ -80,16 +81,20 @@ public:
     // Look up an entry and return the value.  Returns a null object
     // if <key> is not in the dictionary.
     Object lookup(std::string_view key, int recursion = 0) const;
+    // Same as above but comparing atoms instead of strings
+    Object lookup(const NameAtom &key, int recursion = 0) const;
     // Same as above but if the returned object is a fetched Ref returns such Ref in returnRef, otherwise returnRef is Ref::INVALID()
     Object lookup(std::string_view key, Ref *returnRef, int recursion = 0) const;
     // Look up an entry and return the value.  Returns a null object
     // if <key> is not in the dictionary or if it is a ref to a non encrypted object in a partially encrypted document
     Object lookupEnsureEncryptedIfNeeded(std::string_view key) const;
     const Object &lookupNF(std::string_view key) const;
+    const Object &lookupNF(const NameAtom &key) const;
     bool lookupInt(std::string_view key, std::optional<std::string_view> alt_key, int *value) const;
 
     // Iterative accessors.
     const char *getKey(int i) const { return entries[i].first.c_str(); }
+    NameAtom getKeyAtom(int i) const { return entries[i].first; }
     Object getVal(int i) const { return entries[i].second.fetch(xref); }
     // Same as above but if the returned object is a fetched Ref returns such Ref in returnRef, otherwise returnRef is Ref::INVALID()
     Object getVal(int i, Ref *returnRef) const;
@@ -104,13 +109,20 @@ public:
 
     bool hasKey(std::string_view key) const;
 
+    // Sorts the entries if there are enough of them to be worth a binary
+    // search. The parser calls it once a dictionary is complete; once
+    // sorted, entries added later are inserted in order. Lookups never
+    // sort, so they don't need to lock, and dictionaries that were never
+    // sorted are searched linearly.
+    void sortEntries();
+
     // Returns a key name that is not in the dictionary
     // It will be suggestedKey itself if available
     // otherwise it will start adding 0, 1, 2, 3, etc. to suggestedKey until there's one available
     std::string findAvailableKey(std::string_view suggestedKey);
 
 private:
-    using DictEntry = std::pair<std::string, Object>;
+    using DictEntry = std::pair<NameAtom, Object>;
     struct CmpDictEntry;
 
     XRef *xref; // the xref table for this PDF file
@@ -118,7 +130,10 @@ private:
     std::atomic_bool sorted;
     mutable std::recursive_mutex mutex;
 
+    template<typename Key>
+    const DictEntry *findEntry(const Key &key) const;
     const DictEntry *find(std::string_view key) const;
+    const DictEntry *find(const NameAtom &key) const;
     DictEntry *find(std::string_view key);
 };
 
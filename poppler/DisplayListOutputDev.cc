@@ -0,0 +1,1433 @@
+//========================================================================
+//
+// DisplayListOutputDev.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <algorithm>
+#include <climits>
+#include "Dict.h"
+#include "Error.h"
+#include "Function.h"
+#include "Page.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "DisplayListOutputDev.h"
+
+namespace {
+
+// The parts of the graphics state OutputDevs are told about with the
+// update* calls.
+enum StateChange : unsigned
+{
+    ctmChange = 1 << 0,
+    lineDashChange = 1 << 1,
+    flatnessChange = 1 << 2,
+    lineJoinChange = 1 << 3,
+    lineCapChange = 1 << 4,
+    miterLimitChange = 1 << 5,
+    lineWidthChange = 1 << 6,
+    strokeAdjustChange = 1 << 7,
+    alphaIsShapeChange = 1 << 8,
+    textKnockoutChange = 1 << 9,
+    fillColorSpaceChange = 1 << 10,
+    strokeColorSpaceChange = 1 << 11,
+    fillColorChange = 1 << 12,
+    strokeColorChange = 1 << 13,
+    blendModeChange = 1 << 14,
+    fillOpacityChange = 1 << 15,
+    strokeOpacityChange = 1 << 16,
+    fillOverprintChange = 1 << 17,
+    strokeOverprintChange = 1 << 18,
+    overprintModeChange = 1 << 19,
+    transferChange = 1 << 20,
+    fontChange = 1 << 21,
+    textMatChange = 1 << 22,
+    charSpaceChange = 1 << 23,
+    renderChange = 1 << 24,
+    riseChange = 1 << 25,
+    wordSpaceChange = 1 << 26,
+    horizScalingChange = 1 << 27,
+    allChanges = (1u << 28) - 1
+};
+
+// The changes recorded by ops of their own rather than by UpdateStateOp.
+constexpr unsigned objectChanges = lineDashChange | fillColorSpaceChange | strokeColorSpaceChange | transferChange | fontChange;
+
+// Returns the transform <a> followed by <b>.
+std::array<double, 6> multiply(const std::array<double, 6> &a, const std::array<double, 6> &b)
+{
+    return { a[0] * b[0] + a[1] * b[2], a[0] * b[1] + a[1] * b[3], a[2] * b[0] + a[3] * b[2], a[2] * b[1] + a[3] * b[3], a[4] * b[0] + a[5] * b[2] + b[4], a[4] * b[1] + a[5] * b[3] + b[5] };
+}
+
+}
+
+//------------------------------------------------------------------------
+// DisplayListPlayer
+//------------------------------------------------------------------------
+
+// State of one playback of a DisplayList.  The ops update the graphics
+// state of the playback the way Gfx updated the one of the recording.
+class DisplayListPlayer
+{
+public:
+    DisplayListPlayer(OutputDev *outA, XRef *xrefA, GfxState *stateA, const std::array<double, 6> &toDeviceA) : out(outA), xref(xrefA), state(stateA), toDevice(toDeviceA) { }
+
+    ~DisplayListPlayer()
+    {
+        while (state->hasSaves()) {
+            state = state->restore();
+        }
+    }
+
+    DisplayListPlayer(const DisplayListPlayer &) = delete;
+    DisplayListPlayer &operator=(const DisplayListPlayer &) = delete;
+
+    GfxState *getState() const { return state; }
+
+    // Return the state with <path> as the current path.
+    GfxState *getState(const GfxPath &path)
+    {
+        state->clearPath();
+        for (int i = 0; i < path.getNumSubpaths(); ++i) {
+            const GfxSubpath *subpath = path.getSubpath(i);
+            const int n = subpath->getNumPoints();
+            state->moveTo(subpath->getX(0), subpath->getY(0));
+            for (int j = 1; j < n; ++j) {
+                if (subpath->getCurve(j) && j + 2 < n) {
+                    state->curveTo(subpath->getX(j), subpath->getY(j), subpath->getX(j + 1), subpath->getY(j + 1), subpath->getX(j + 2), subpath->getY(j + 2));
+                    j += 2;
+                } else {
+                    state->lineTo(subpath->getX(j), subpath->getY(j));
+                }
+            }
+            if (subpath->isClosed()) {
+                state->closePath();
+            }
+        }
+        return state;
+    }
+
+    void saveState() { state = state->save(); }
+
+    void restoreState()
+    {
+        if (state->hasSaves()) {
+            state = state->restore();
+        }
+    }
+
+    // The CTM <ctm> of the recording, in the device space of the playback.
+    std::array<double, 6> toPlayback(const std::array<double, 6> &ctm) const
+    {
+        std::array<double, 6> m = multiply(ctm, toDevice);
+        for (const auto &g : groupTransforms) {
+            m = multiply(m, g);
+        }
+        return m;
+    }
+
+    // OutputDevs may move the device space inside transparency groups
+    // (SplashOutputDev draws them into bitmaps of their own), which has
+    // to be applied to the CTMs set inside the group.
+    void pushGroupTransform(const std::array<double, 6> &m) { groupTransforms.push_back(m); }
+    void popGroupTransform()
+    {
+        if (!groupTransforms.empty()) {
+            groupTransforms.pop_back();
+        }
+    }
+
+    // A stream reading recorded image data.
+    std::unique_ptr<Stream> makeStream(const std::vector<unsigned char> &data) const { return std::make_unique<MemStream>(reinterpret_cast<const char *>(data.data()), 0, data.size(), Object(std::make_unique<Dict>(xref))); }
+
+    // OutputDevs keep the blending color space of a transparency group
+    // until it is painted, so it has to live as long as the playback.
+    GfxColorSpace *keep(std::unique_ptr<GfxColorSpace> colorSpace)
+    {
+        colorSpaces.push_back(std::move(colorSpace));
+        return colorSpaces.back().get();
+    }
+
+    // Continue the playback with op <idx>, unless it is behind.
+    void skipTo(size_t idx) { next = std::max(next, idx); }
+
+    OutputDev *const out;
+    std::array<double, 6> softMaskBaseMatrix = {};
+    size_t next = 0; // index of the next op to play
+
+private:
+    XRef *const xref;
+    GfxState *state;
+    const std::array<double, 6> toDevice;
+    std::vector<std::array<double, 6>> groupTransforms;
+    std::vector<std::unique_ptr<GfxColorSpace>> colorSpaces;
+};
+
+//------------------------------------------------------------------------
+// DisplayListOp
+//------------------------------------------------------------------------
+
+class DisplayListOp
+{
+public:
+    DisplayListOp() = default;
+    virtual ~DisplayListOp();
+
+    DisplayListOp(const DisplayListOp &) = delete;
+    DisplayListOp &operator=(const DisplayListOp &) = delete;
+
+    virtual void play(DisplayListPlayer *player) const = 0;
+};
+
+DisplayListOp::~DisplayListOp() = default;
+
+namespace {
+
+// Reads the <len> bytes of decoded image data from <str>.
+std::vector<unsigned char> readImageData(Stream *str, size_t len)
+{
+    std::vector<unsigned char> data(len, 0);
+    if (!str->rewind()) {
+        error(errSyntaxError, -1, "Invalid image stream");
+        return data;
+    }
+    size_t pos = 0;
+    while (pos < len) {
+        const int n = str->doGetChars(static_cast<int>(std::min<size_t>(len - pos, INT_MAX)), data.data() + pos);
+        if (n <= 0) {
+            break;
+        }
+        pos += n;
+    }
+    str->close();
+    return data;
+}
+
+size_t imageMaskDataSize(int width, int height)
+{
+    return static_cast<size_t>(height) * ((static_cast<size_t>(width) + 7) / 8);
+}
+
+size_t imageDataSize(int width, int height, const GfxImageColorMap *colorMap)
+{
+    return static_cast<size_t>(height) * ((static_cast<size_t>(width) * colorMap->getNumPixelComps() * colorMap->getBits() + 7) / 8);
+}
+
+// State operations without parameters.
+class StateOp : public DisplayListOp
+{
+public:
+    enum Kind
+    {
+        saveState,
+        restoreState,
+        endString,
+        beginTextObject,
+        endTextObject,
+        endActualText,
+        endTransparencyGroup,
+        clearSoftMask,
+        unsetSoftMaskFromImageMask,
+        endType3Char
+    };
+
+    explicit StateOp(Kind kindA) : kind(kindA) { }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        OutputDev *out = player->out;
+        GfxState *s = player->getState();
+        switch (kind) {
+        case saveState:
+            out->saveState(s);
+            player->saveState();
+            break;
+        case restoreState:
+            player->restoreState();
+            out->restoreState(player->getState());
+            break;
+        case endString:
+            out->endString(s);
+            break;
+        case beginTextObject:
+            out->beginTextObject(s);
+            break;
+        case endTextObject:
+            out->endTextObject(s);
+            break;
+        case endActualText:
+            out->endActualText(s);
+            break;
+        case endTransparencyGroup:
+            out->endTransparencyGroup(s);
+            player->popGroupTransform();
+            break;
+        case clearSoftMask:
+            out->clearSoftMask(s);
+            break;
+        case unsetSoftMaskFromImageMask:
+            out->unsetSoftMaskFromImageMask(s, player->softMaskBaseMatrix);
+            break;
+        case endType3Char:
+            out->endType3Char(s);
+            break;
+        }
+    }
+
+private:
+    const Kind kind;
+};
+
+// Path painting and clipping.
+class PathOp : public DisplayListOp
+{
+public:
+    enum Kind
+    {
+        stroke,
+        fill,
+        eoFill,
+        clip,
+        eoClip,
+        clipToStrokePath
+    };
+
+    PathOp(Kind kindA, const GfxPath *pathA) : kind(kindA), path(pathA->copy()) { }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        OutputDev *out = player->out;
+        GfxState *s = player->getState(*path);
+        switch (kind) {
+        case stroke:
+            out->stroke(s);
+            break;
+        case fill:
+            out->fill(s);
+            break;
+        case eoFill:
+            out->eoFill(s);
+            break;
+        case clip:
+            s->clip();
+            out->clip(s);
+            break;
+        case eoClip:
+            s->clip();
+            out->eoClip(s);
+            break;
+        case clipToStrokePath:
+            s->clipToStrokePath();
+            out->clipToStrokePath(s);
+            break;
+        }
+    }
+
+private:
+    const Kind kind;
+    const std::unique_ptr<GfxPath> path;
+};
+
+// beginString and beginActualText.
+class TextOp : public DisplayListOp
+{
+public:
+    TextOp(bool actualTextA, const std::string &textA) : actualText(actualTextA), text(textA) { }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        if (actualText) {
+            player->out->beginActualText(s, text);
+        } else {
+            player->out->beginString(s, text);
+        }
+    }
+
+private:
+    const bool actualText;
+    const std::string text;
+};
+
+class DrawCharOp : public DisplayListOp
+{
+public:
+    DrawCharOp(double xA, double yA, double dxA, double dyA, double originXA, double originYA, CharCode codeA, int nBytesA, const Unicode *uA, int uLen)
+        : x(xA), y(yA), dx(dxA), dy(dyA), originX(originXA), originY(originYA), code(codeA), nBytes(nBytesA), u(uA, uA + (uA ? uLen : 0))
+    {
+    }
+
+    void play(DisplayListPlayer *player) const override { player->out->drawChar(player->getState(), x, y, dx, dy, originX, originY, code, nBytes, u.empty() ? nullptr : u.data(), u.size()); }
+
+private:
+    const double x, y, dx, dy, originX, originY;
+    const CharCode code;
+    const int nBytes;
+    const std::vector<Unicode> u;
+};
+
+// drawImageMask and setSoftMaskFromImageMask.
+class ImageMaskOp : public DisplayListOp
+{
+public:
+    ImageMaskOp(bool softMaskA, Object *refA, Stream *str, int widthA, int heightA, bool invertA, bool interpolateA, bool inlineImgA)
+        : softMask(softMaskA),
+          ref(refA ? refA->copy() : Object()),
+          data(readImageData(str, imageMaskDataSize(widthA, heightA))),
+          width(widthA),
+          height(heightA),
+          invert(invertA),
+          interpolate(interpolateA),
+          inlineImg(inlineImgA)
+    {
+    }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        std::unique_ptr<Stream> str = player->makeStream(data);
+        Object refA = ref.copy();
+        if (softMask) {
+            player->out->setSoftMaskFromImageMask(s, refA.isNone() ? nullptr : &refA, str.get(), width, height, invert, inlineImg, player->softMaskBaseMatrix);
+        } else {
+            player->out->drawImageMask(s, refA.isNone() ? nullptr : &refA, str.get(), width, height, invert, interpolate, inlineImg);
+        }
+    }
+
+private:
+    const bool softMask;
+    const Object ref;
+    const std::vector<unsigned char> data;
+    const int width, height;
+    const bool invert, interpolate, inlineImg;
+};
+
+// drawImage, drawMaskedImage and drawSoftMaskedImage.
+class ImageOp : public DisplayListOp
+{
+public:
+    ImageOp(Object *refA, Stream *str, int widthA, int heightA, GfxImageColorMap *colorMapA, bool interpolateA, const int *maskColorsA, bool inlineImgA)
+        : ref(refA ? refA->copy() : Object()),
+          data(readImageData(str, imageDataSize(widthA, heightA, colorMapA))),
+          width(widthA),
+          height(heightA),
+          colorMap(colorMapA->copy()),
+          interpolate(interpolateA),
+          inlineImg(inlineImgA)
+    {
+        if (maskColorsA) {
+            maskColors.assign(maskColorsA, maskColorsA + 2 * colorMapA->getNumPixelComps());
+        }
+    }
+
+    // Add the explicit mask of drawMaskedImage.
+    void setMask(Stream *maskStr, int maskWidthA, int maskHeightA, bool maskInvertA, bool maskInterpolateA)
+    {
+        hasMask = true;
+        maskData = readImageData(maskStr, imageMaskDataSize(maskWidthA, maskHeightA));
+        maskWidth = maskWidthA;
+        maskHeight = maskHeightA;
+        maskInvert = maskInvertA;
+        maskInterpolate = maskInterpolateA;
+    }
+
+    // Add the soft mask of drawSoftMaskedImage.
+    void setSoftMask(Stream *maskStr, int maskWidthA, int maskHeightA, GfxImageColorMap *maskColorMapA, bool maskInterpolateA)
+    {
+        hasMask = true;
+        maskData = readImageData(maskStr, imageDataSize(maskWidthA, maskHeightA, maskColorMapA));
+        maskWidth = maskWidthA;
+        maskHeight = maskHeightA;
+        maskColorMap.reset(maskColorMapA->copy());
+        maskInterpolate = maskInterpolateA;
+    }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        std::unique_ptr<Stream> str = player->makeStream(data);
+        Object refA = ref.copy();
+        Object *refPtr = refA.isNone() ? nullptr : &refA;
+        // the OutputDev may modify the color maps
+        std::unique_ptr<GfxImageColorMap> colorMapA(colorMap->copy());
+        if (!hasMask) {
+            player->out->drawImage(s, refPtr, str.get(), width, height, colorMapA.get(), interpolate, maskColors.empty() ? nullptr : maskColors.data(), inlineImg);
+            return;
+        }
+        std::unique_ptr<Stream> maskStr = player->makeStream(maskData);
+        if (maskColorMap) {
+            std::unique_ptr<GfxImageColorMap> maskColorMapA(maskColorMap->copy());
+            player->out->drawSoftMaskedImage(s, refPtr, str.get(), width, height, colorMapA.get(), interpolate, maskStr.get(), maskWidth, maskHeight, maskColorMapA.get(), maskInterpolate);
+        } else {
+            player->out->drawMaskedImage(s, refPtr, str.get(), width, height, colorMapA.get(), interpolate, maskStr.get(), maskWidth, maskHeight, maskInvert, maskInterpolate);
+        }
+    }
+
+private:
+    const Object ref;
+    const std::vector<unsigned char> data;
+    const int width, height;
+    const std::unique_ptr<GfxImageColorMap> colorMap;
+    const bool interpolate, inlineImg;
+    std::vector<int> maskColors;
+
+    bool hasMask = false;
+    std::vector<unsigned char> maskData;
+    int maskWidth = 0, maskHeight = 0;
+    std::unique_ptr<GfxImageColorMap> maskColorMap;
+    bool maskInvert = false, maskInterpolate = false;
+};
+
+class BeginTransparencyGroupOp : public DisplayListOp
+{
+public:
+    BeginTransparencyGroupOp(const std::array<double, 4> &bboxA, GfxColorSpace *blendingColorSpaceA, bool isolatedA, bool knockoutA, bool forSoftMaskA)
+        : bbox(bboxA), blendingColorSpace(blendingColorSpaceA ? blendingColorSpaceA->copy() : nullptr), isolated(isolatedA), knockout(knockoutA), forSoftMask(forSoftMaskA)
+    {
+    }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        Matrix before, beforeInv;
+        s->getCTM(&before);
+        GfxColorSpace *cs = blendingColorSpace ? player->keep(blendingColorSpace->copy()) : nullptr;
+        player->out->beginTransparencyGroup(s, bbox, cs, isolated, knockout, forSoftMask);
+
+        // device space transform applied by the OutputDev, if any
+        std::array<double, 6> m = { 1, 0, 0, 1, 0, 0 };
+        const std::array<double, 6> &after = s->getCTM();
+        if (after != before.m && before.invertTo(&beforeInv)) {
+            m = multiply(beforeInv.m, after);
+        }
+        player->pushGroupTransform(m);
+    }
+
+private:
+    const std::array<double, 4> bbox;
+    const std::unique_ptr<GfxColorSpace> blendingColorSpace;
+    const bool isolated, knockout, forSoftMask;
+};
+
+class PaintTransparencyGroupOp : public DisplayListOp
+{
+public:
+    explicit PaintTransparencyGroupOp(const std::array<double, 4> &bboxA) : bbox(bboxA) { }
+
+    void play(DisplayListPlayer *player) const override { player->out->paintTransparencyGroup(player->getState(), bbox); }
+
+private:
+    const std::array<double, 4> bbox;
+};
+
+class SetSoftMaskOp : public DisplayListOp
+{
+public:
+    SetSoftMaskOp(const std::array<double, 4> &bboxA, bool alphaA, Function *transferFuncA, const GfxColor *backdropColorA)
+        : bbox(bboxA), alpha(alphaA), transferFunc(transferFuncA ? transferFuncA->copy() : nullptr), backdropColor(*backdropColorA)
+    {
+    }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxColor backdropColorA = backdropColor;
+        player->out->setSoftMask(player->getState(), bbox, alpha, transferFunc.get(), &backdropColorA);
+    }
+
+private:
+    const std::array<double, 4> bbox;
+    const bool alpha;
+    const std::unique_ptr<Function> transferFunc;
+    const GfxColor backdropColor;
+};
+
+// A parameter of the graphics state that fits in a double.
+struct ScalarField
+{
+    StateChange change;
+    double (*get)(const GfxState *state);
+    void (*set)(GfxState *state, double value);
+    void (OutputDev::*update)(GfxState *state);
+};
+
+const ScalarField scalarFields[] = {
+    { flatnessChange, [](const GfxState *s) -> double { return s->getFlatness(); }, [](GfxState *s, double v) { s->setFlatness(static_cast<int>(v)); }, &OutputDev::updateFlatness },
+    { lineJoinChange, [](const GfxState *s) -> double { return s->getLineJoin(); }, [](GfxState *s, double v) { s->setLineJoin(static_cast<GfxState::LineJoinStyle>(v)); }, &OutputDev::updateLineJoin },
+    { lineCapChange, [](const GfxState *s) -> double { return s->getLineCap(); }, [](GfxState *s, double v) { s->setLineCap(static_cast<GfxState::LineCapStyle>(v)); }, &OutputDev::updateLineCap },
+    { miterLimitChange, [](const GfxState *s) { return s->getMiterLimit(); }, [](GfxState *s, double v) { s->setMiterLimit(v); }, &OutputDev::updateMiterLimit },
+    { lineWidthChange, [](const GfxState *s) { return s->getLineWidth(); }, [](GfxState *s, double v) { s->setLineWidth(v); }, &OutputDev::updateLineWidth },
+    { strokeAdjustChange, [](const GfxState *s) -> double { return s->getStrokeAdjust(); }, [](GfxState *s, double v) { s->setStrokeAdjust(v != 0); }, &OutputDev::updateStrokeAdjust },
+    { alphaIsShapeChange, [](const GfxState *s) -> double { return s->getAlphaIsShape(); }, [](GfxState *s, double v) { s->setAlphaIsShape(v != 0); }, &OutputDev::updateAlphaIsShape },
+    { textKnockoutChange, [](const GfxState *s) -> double { return s->getTextKnockout(); }, [](GfxState *s, double v) { s->setTextKnockout(v != 0); }, &OutputDev::updateTextKnockout },
+    { blendModeChange, [](const GfxState *s) -> double { return static_cast<int>(s->getBlendMode()); }, [](GfxState *s, double v) { s->setBlendMode(static_cast<GfxBlendMode>(v)); }, &OutputDev::updateBlendMode },
+    { fillOpacityChange, [](const GfxState *s) { return s->getFillOpacity(); }, [](GfxState *s, double v) { s->setFillOpacity(v); }, &OutputDev::updateFillOpacity },
+    { strokeOpacityChange, [](const GfxState *s) { return s->getStrokeOpacity(); }, [](GfxState *s, double v) { s->setStrokeOpacity(v); }, &OutputDev::updateStrokeOpacity },
+    { fillOverprintChange, [](const GfxState *s) -> double { return s->getFillOverprint(); }, [](GfxState *s, double v) { s->setFillOverprint(v != 0); }, &OutputDev::updateFillOverprint },
+    { strokeOverprintChange, [](const GfxState *s) -> double { return s->getStrokeOverprint(); }, [](GfxState *s, double v) { s->setStrokeOverprint(v != 0); }, &OutputDev::updateStrokeOverprint },
+    { overprintModeChange, [](const GfxState *s) -> double { return s->getOverprintMode(); }, [](GfxState *s, double v) { s->setOverprintMode(static_cast<int>(v)); }, &OutputDev::updateOverprintMode },
+    { charSpaceChange, [](const GfxState *s) { return s->getCharSpace(); }, [](GfxState *s, double v) { s->setCharSpace(v); }, &OutputDev::updateCharSpace },
+    { renderChange, [](const GfxState *s) -> double { return s->getRender(); }, [](GfxState *s, double v) { s->setRender(static_cast<int>(v)); }, &OutputDev::updateRender },
+    { riseChange, [](const GfxState *s) { return s->getRise(); }, [](GfxState *s, double v) { s->setRise(v); }, &OutputDev::updateRise },
+    { wordSpaceChange, [](const GfxState *s) { return s->getWordSpace(); }, [](GfxState *s, double v) { s->setWordSpace(v); }, &OutputDev::updateWordSpace },
+    { horizScalingChange, [](const GfxState *s) { return s->getHorizScaling(); }, [](GfxState *s, double v) { s->setHorizScaling(100 * v); }, &OutputDev::updateHorizScaling },
+};
+
+// The numeric parts of the graphics state that changed: the CTM, the
+// text matrix, the colors and the scalar fields, stored in that order.
+class UpdateStateOp : public DisplayListOp
+{
+public:
+    UpdateStateOp(unsigned changesA, GfxState *state) : changes(changesA)
+    {
+        if (changes & ctmChange) {
+            values.insert(values.end(), state->getCTM().begin(), state->getCTM().end());
+        }
+        if (changes & textMatChange) {
+            values.insert(values.end(), state->getTextMat().begin(), state->getTextMat().end());
+        }
+        if (changes & fillColorChange) {
+            addColor(state->getFillColor(), state->getFillColorSpace()->getNComps());
+        }
+        if (changes & strokeColorChange) {
+            addColor(state->getStrokeColor(), state->getStrokeColorSpace()->getNComps());
+        }
+        for (const ScalarField &field : scalarFields) {
+            if (changes & field.change) {
+                values.push_back(field.get(state));
+            }
+        }
+    }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        OutputDev *out = player->out;
+        GfxState *s = player->getState();
+        auto v = values.begin();
+        if (changes & ctmChange) {
+            std::array<double, 6> m;
+            std::copy(v, v + 6, m.begin());
+            v += 6;
+            m = player->toPlayback(m);
+            s->setCTM(m[0], m[1], m[2], m[3], m[4], m[5]);
+        }
+        if (changes & textMatChange) {
+            s->setTextMat(v[0], v[1], v[2], v[3], v[4], v[5]);
+            v += 6;
+        }
+        GfxColor color;
+        if (changes & fillColorChange) {
+            v = getColor(v, &color);
+            s->setFillColor(&color);
+        }
+        if (changes & strokeColorChange) {
+            v = getColor(v, &color);
+            s->setStrokeColor(&color);
+        }
+        for (const ScalarField &field : scalarFields) {
+            if (changes & field.change) {
+                field.set(s, *v++);
+            }
+        }
+
+        // the OutputDev is told once the whole state is up to date
+        if (changes & ctmChange) {
+            const std::array<double, 6> &ctm = s->getCTM();
+            out->updateCTM(s, ctm[0], ctm[1], ctm[2], ctm[3], ctm[4], ctm[5]);
+        }
+        if (changes & textMatChange) {
+            out->updateTextMat(s);
+        }
+        if (changes & fillColorChange) {
+            out->updateFillColor(s);
+        }
+        if (changes & strokeColorChange) {
+            out->updateStrokeColor(s);
+        }
+        for (const ScalarField &field : scalarFields) {
+            if (changes & field.change) {
+                (out->*field.update)(s);
+            }
+        }
+    }
+
+private:
+    void addColor(const GfxColor *color, int nComps)
+    {
+        nComps = std::clamp(nComps, 0, gfxColorMaxComps);
+        values.push_back(nComps);
+        values.insert(values.end(), color->c, color->c + nComps);
+    }
+
+    static std::vector<double>::const_iterator getColor(std::vector<double>::const_iterator v, GfxColor *color)
+    {
+        const int nComps = static_cast<int>(*v++);
+        for (int i = 0; i < gfxColorMaxComps; ++i) {
+            color->c[i] = i < nComps ? static_cast<GfxColorComp>(v[i]) : 0;
+        }
+        return v + nComps;
+    }
+
+    const unsigned changes;
+    std::vector<double> values;
+};
+
+// A fill or stroke color space change.
+class UpdateColorSpaceOp : public DisplayListOp
+{
+public:
+    UpdateColorSpaceOp(bool strokeA, GfxColorSpace *colorSpaceA) : stroke(strokeA), colorSpace(colorSpaceA ? colorSpaceA->copy() : nullptr) { }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        if (stroke) {
+            s->setStrokeColorSpace(colorSpace ? colorSpace->copy() : nullptr);
+            player->out->updateStrokeColorSpace(s);
+        } else {
+            s->setFillColorSpace(colorSpace ? colorSpace->copy() : nullptr);
+            player->out->updateFillColorSpace(s);
+        }
+    }
+
+private:
+    const bool stroke;
+    const std::unique_ptr<GfxColorSpace> colorSpace;
+};
+
+class UpdateLineDashOp : public DisplayListOp
+{
+public:
+    explicit UpdateLineDashOp(GfxState *state) : dash(state->getLineDash(&start)) { }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        s->setLineDash(std::vector<double>(dash), start);
+        player->out->updateLineDash(s);
+    }
+
+private:
+    double start;
+    const std::vector<double> dash;
+};
+
+class UpdateTransferOp : public DisplayListOp
+{
+public:
+    explicit UpdateTransferOp(GfxState *state)
+    {
+        for (const auto &func : state->getTransfer()) {
+            funcs.push_back(func ? func->copy() : nullptr);
+        }
+    }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        std::vector<std::unique_ptr<Function>> funcsA;
+        for (const auto &func : funcs) {
+            funcsA.push_back(func ? func->copy() : nullptr);
+        }
+        s->setTransfer(std::move(funcsA));
+        player->out->updateTransfer(s);
+    }
+
+private:
+    std::vector<std::unique_ptr<Function>> funcs;
+};
+
+class UpdateFontOp : public DisplayListOp
+{
+public:
+    explicit UpdateFontOp(const GfxState *state) : font(state->getFont()), fontSize(state->getFontSize()) { }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        GfxState *s = player->getState();
+        s->setFont(font, fontSize);
+        player->out->updateFont(s);
+    }
+
+private:
+    const std::shared_ptr<GfxFont> font;
+    const double fontSize;
+};
+
+// OutputDevs aren't told about rendering intent changes, they read it
+// from the state.
+class SetRenderingIntentOp : public DisplayListOp
+{
+public:
+    explicit SetRenderingIntentOp(const std::string &intentA) : intent(intentA) { }
+
+    void play(DisplayListPlayer *player) const override { player->getState()->setRenderingIntent(intent.c_str()); }
+
+private:
+    const std::string intent;
+};
+
+// beginType3Char; the ops up to the matching endType3Char draw the glyph.
+// OutputDevs that don't interpret Type 3 glyphs get a drawChar instead.
+class Type3CharOp : public DisplayListOp
+{
+public:
+    Type3CharOp(GfxState *state, const std::array<double, 6> &textCTMA, double xA, double yA, double dxA, double dyA, CharCode codeA, const Unicode *uA, int uLen)
+        : textCTM(textCTMA), x(xA), y(yA), dx(dxA), dy(dyA), code(codeA), u(uA, uA + (uA ? uLen : 0))
+    {
+        // Gfx passes the advance through the glyph CTM to beginType3Char
+        // but through the text matrix to drawChar
+        const std::array<double, 6> &ctm = state->getCTM();
+        const double det = ctm[0] * ctm[3] - ctm[1] * ctm[2];
+        if (det != 0) {
+            state->textTransformDelta((ctm[3] * dx - ctm[2] * dy) / det, (ctm[0] * dy - ctm[1] * dx) / det, &tdx, &tdy);
+        }
+    }
+
+    // Set the index of the matching endType3Char op.
+    void setEnd(size_t endA) { end = endA; }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        OutputDev *out = player->out;
+        GfxState *s = player->getState();
+        if (out->interpretType3Chars()) {
+            if (out->beginType3Char(s, x, y, dx, dy, code, u.empty() ? nullptr : u.data(), u.size())) {
+                // the glyph was drawn from a cache
+                player->skipTo(end + 1);
+            }
+            return;
+        }
+        if (out->useDrawChar()) {
+            // Gfx saved the state of the text before setting the glyph
+            // CTM, and restores it after the glyph
+            const std::array<double, 6> m = player->toPlayback(textCTM);
+            s->setCTM(m[0], m[1], m[2], m[3], m[4], m[5]);
+            out->updateCTM(s, m[0], m[1], m[2], m[3], m[4], m[5]);
+            out->drawChar(s, x, y, tdx, tdy, 0, 0, code, 1, u.empty() ? nullptr : u.data(), u.size());
+        }
+        player->skipTo(end + 1);
+    }
+
+private:
+    const std::array<double, 6> textCTM;
+    const double x, y, dx, dy;
+    double tdx = 0, tdy = 0;
+    const CharCode code;
+    const std::vector<Unicode> u;
+    size_t end = 0;
+};
+
+// type3D0 and type3D1.
+class Type3MetricsOp : public DisplayListOp
+{
+public:
+    Type3MetricsOp(bool d1A, double wxA, double wyA, double llxA, double llyA, double urxA, double uryA) : d1(d1A), wx(wxA), wy(wyA), llx(llxA), lly(llyA), urx(urxA), ury(uryA) { }
+
+    void play(DisplayListPlayer *player) const override
+    {
+        if (d1) {
+            player->out->type3D1(player->getState(), wx, wy, llx, lly, urx, ury);
+        } else {
+            player->out->type3D0(player->getState(), wx, wy);
+        }
+    }
+
+private:
+    const bool d1;
+    const double wx, wy, llx, lly, urx, ury;
+};
+
+}
+
+//------------------------------------------------------------------------
+// DisplayList
+//------------------------------------------------------------------------
+
+DisplayList::DisplayList(Page *pageA, int pageNumA, XRef *xrefA, const std::array<double, 6> &baseCTMA) : page(pageA), pageNum(pageNumA), xref(xrefA), baseCTM(baseCTMA) { }
+
+DisplayList::~DisplayList() = default;
+
+std::unique_ptr<XRef> DisplayList::copyXRef() const
+{
+    return std::unique_ptr<XRef>(xref->copy());
+}
+
+void DisplayList::displaySlice(OutputDev *out, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, int sliceX, int sliceY, int sliceW, int sliceH, bool printing, bool (*abortCheckCbk)(void *data), void *abortCheckCbkData,
+                               XRef *xrefA) const
+{
+    if (!out->checkPageSlice(page, hDPI, vDPI, rotate, useMediaBox, crop, sliceX, sliceY, sliceW, sliceH, printing, abortCheckCbk, abortCheckCbkData)) {
+        return;
+    }
+    XRef *localXRef = xrefA ? xrefA : xref;
+
+    // set up the page like Page::createGfx and the Gfx constructor do
+    rotate += page->getRotate();
+    if (rotate >= 360) {
+        rotate -= 360;
+    } else if (rotate < 0) {
+        rotate += 360;
+    }
+    PDFRectangle box;
+    page->makeBox(hDPI, vDPI, rotate, useMediaBox, out->upsideDown(), sliceX, sliceY, sliceW, sliceH, &box, &crop);
+    GfxState state(hDPI, vDPI, &box, rotate, out->upsideDown());
+    out->initGfxState(&state);
+    out->startPage(pageNum, &state, localXRef);
+    out->setDefaultCTM(state.getCTM());
+    out->updateAll(&state);
+    if (crop) {
+        const PDFRectangle *cropBox = page->getCropBox();
+        state.moveTo(cropBox->x1, cropBox->y1);
+        state.lineTo(cropBox->x2, cropBox->y1);
+        state.lineTo(cropBox->x2, cropBox->y2);
+        state.lineTo(cropBox->x1, cropBox->y2);
+        state.closePath();
+        state.clip();
+        out->clip(&state);
+        state.clearPath();
+    }
+
+    // the transform from the device space of the recording to ours
+    Matrix base, baseInv;
+    base.m = baseCTM;
+    if (!base.invertTo(&baseInv)) {
+        error(errInternal, -1, "Display list has a singular default CTM");
+        out->endPage();
+        return;
+    }
+    DisplayListPlayer player(out, localXRef, &state, multiply(baseInv.m, state.getCTM()));
+    for (size_t n = 0; player.next < ops.size(); ++n) {
+        if (abortCheckCbk && (n & 255) == 0 && (*abortCheckCbk)(abortCheckCbkData)) {
+            break;
+        }
+        ops[player.next++]->play(&player);
+    }
+
+    out->endPage();
+}
+
+//------------------------------------------------------------------------
+// DisplayListOutputDev
+//------------------------------------------------------------------------
+
+DisplayListOutputDev::DisplayListOutputDev() = default;
+
+DisplayListOutputDev::~DisplayListOutputDev() = default;
+
+std::unique_ptr<DisplayList> DisplayListOutputDev::takeDisplayList()
+{
+    return std::move(list);
+}
+
+bool DisplayListOutputDev::checkPageSlice(Page *pageA, double /*hDPI*/, double /*vDPI*/, int /*rotate*/, bool /*useMediaBox*/, bool /*crop*/, int /*sliceX*/, int /*sliceY*/, int /*sliceW*/, int /*sliceH*/, bool /*printing*/,
+                                          bool (* /*abortCheckCbk*/)(void *data), void * /*abortCheckCbkData*/, bool (* /*annotDisplayDecideCbk*/)(Annot *annot, void *user_data), void * /*annotDisplayDecideCbkData*/)
+{
+    page = pageA;
+    return true;
+}
+
+// Patterns and shadings are left to Gfx, which decomposes them into
+// fills, since playing them back needs a Gfx.
+bool DisplayListOutputDev::useTilingPatternFill()
+{
+    if (list) {
+        list->flattenedPatterns = true;
+    }
+    return false;
+}
+
+bool DisplayListOutputDev::useShadedFills(int /*type*/)
+{
+    if (list) {
+        list->flattenedPatterns = true;
+    }
+    return false;
+}
+
+void DisplayListOutputDev::startPage(int pageNum, GfxState *state, XRef * /*xref*/)
+{
+    list.reset();
+    if (!page) {
+        error(errInternal, -1, "DisplayListOutputDev needs the page to be displayed through Page::displaySlice");
+        return;
+    }
+    // Page::displaySlice may pass a temporary copy of the XRef
+    list.reset(new DisplayList(page, pageNum, page->getDoc()->getXRef(), state->getCTM()));
+    page = nullptr;
+    changes = allChanges;
+    renderingIntent = state->getRenderingIntent();
+    savedStates.clear();
+    openType3Chars.clear();
+}
+
+void DisplayListOutputDev::recordState(GfxState *state)
+{
+    if (renderingIntent != state->getRenderingIntent()) {
+        renderingIntent = state->getRenderingIntent();
+        addOp(std::make_unique<SetRenderingIntentOp>(renderingIntent));
+    }
+    if (changes & fontChange) {
+        addOp(std::make_unique<UpdateFontOp>(state));
+    }
+    if (changes & lineDashChange) {
+        addOp(std::make_unique<UpdateLineDashOp>(state));
+    }
+    if (changes & transferChange) {
+        addOp(std::make_unique<UpdateTransferOp>(state));
+    }
+    if (changes & fillColorSpaceChange) {
+        addOp(std::make_unique<UpdateColorSpaceOp>(false, state->getFillColorSpace()));
+    }
+    if (changes & strokeColorSpaceChange) {
+        addOp(std::make_unique<UpdateColorSpaceOp>(true, state->getStrokeColorSpace()));
+    }
+    if (changes & ~objectChanges) {
+        addOp(std::make_unique<UpdateStateOp>(changes & ~objectChanges, state));
+    }
+    changes = 0;
+}
+
+void DisplayListOutputDev::addOp(std::unique_ptr<DisplayListOp> op)
+{
+    list->ops.push_back(std::move(op));
+}
+
+//----- save/restore graphics state
+
+void DisplayListOutputDev::saveState(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::saveState));
+        savedStates.push_back({ state->getCTM(), renderingIntent });
+    }
+}
+
+// The changes not recorded yet were made to the state that was dropped.
+void DisplayListOutputDev::restoreState(GfxState * /*state*/)
+{
+    if (list) {
+        changes = 0;
+        if (!savedStates.empty()) {
+            renderingIntent = savedStates.back().renderingIntent;
+            savedStates.pop_back();
+        }
+        addOp(std::make_unique<StateOp>(StateOp::restoreState));
+    }
+}
+
+//----- update graphics state
+
+// Updates are only noted; the fields that changed are recorded with their
+// values when the next op uses the state.  Text position updates aren't
+// recorded, since drawChar gets the position explicitly.
+void DisplayListOutputDev::updateAll(GfxState * /*state*/)
+{
+    changes |= allChanges;
+}
+
+void DisplayListOutputDev::updateCTM(GfxState * /*state*/, double /*m11*/, double /*m12*/, double /*m21*/, double /*m22*/, double /*m31*/, double /*m32*/)
+{
+    changes |= ctmChange;
+}
+
+void DisplayListOutputDev::updateLineDash(GfxState * /*state*/)
+{
+    changes |= lineDashChange;
+}
+
+void DisplayListOutputDev::updateFlatness(GfxState * /*state*/)
+{
+    changes |= flatnessChange;
+}
+
+void DisplayListOutputDev::updateLineJoin(GfxState * /*state*/)
+{
+    changes |= lineJoinChange;
+}
+
+void DisplayListOutputDev::updateLineCap(GfxState * /*state*/)
+{
+    changes |= lineCapChange;
+}
+
+void DisplayListOutputDev::updateMiterLimit(GfxState * /*state*/)
+{
+    changes |= miterLimitChange;
+}
+
+void DisplayListOutputDev::updateLineWidth(GfxState * /*state*/)
+{
+    changes |= lineWidthChange;
+}
+
+void DisplayListOutputDev::updateStrokeAdjust(GfxState * /*state*/)
+{
+    changes |= strokeAdjustChange;
+}
+
+void DisplayListOutputDev::updateAlphaIsShape(GfxState * /*state*/)
+{
+    changes |= alphaIsShapeChange;
+}
+
+void DisplayListOutputDev::updateTextKnockout(GfxState * /*state*/)
+{
+    changes |= textKnockoutChange;
+}
+
+void DisplayListOutputDev::updateFillColorSpace(GfxState * /*state*/)
+{
+    changes |= fillColorSpaceChange;
+}
+
+void DisplayListOutputDev::updateStrokeColorSpace(GfxState * /*state*/)
+{
+    changes |= strokeColorSpaceChange;
+}
+
+void DisplayListOutputDev::updateFillColor(GfxState * /*state*/)
+{
+    changes |= fillColorChange;
+}
+
+void DisplayListOutputDev::updateStrokeColor(GfxState * /*state*/)
+{
+    changes |= strokeColorChange;
+}
+
+void DisplayListOutputDev::updateBlendMode(GfxState * /*state*/)
+{
+    changes |= blendModeChange;
+}
+
+void DisplayListOutputDev::updateFillOpacity(GfxState * /*state*/)
+{
+    changes |= fillOpacityChange;
+}
+
+void DisplayListOutputDev::updateStrokeOpacity(GfxState * /*state*/)
+{
+    changes |= strokeOpacityChange;
+}
+
+void DisplayListOutputDev::updateFillOverprint(GfxState * /*state*/)
+{
+    changes |= fillOverprintChange;
+}
+
+void DisplayListOutputDev::updateStrokeOverprint(GfxState * /*state*/)
+{
+    changes |= strokeOverprintChange;
+}
+
+void DisplayListOutputDev::updateOverprintMode(GfxState * /*state*/)
+{
+    changes |= overprintModeChange;
+}
+
+void DisplayListOutputDev::updateTransfer(GfxState * /*state*/)
+{
+    changes |= transferChange;
+}
+
+void DisplayListOutputDev::updateFont(GfxState * /*state*/)
+{
+    changes |= fontChange;
+}
+
+void DisplayListOutputDev::updateTextMat(GfxState * /*state*/)
+{
+    changes |= textMatChange;
+}
+
+void DisplayListOutputDev::updateCharSpace(GfxState * /*state*/)
+{
+    changes |= charSpaceChange;
+}
+
+void DisplayListOutputDev::updateRender(GfxState * /*state*/)
+{
+    changes |= renderChange;
+}
+
+void DisplayListOutputDev::updateRise(GfxState * /*state*/)
+{
+    changes |= riseChange;
+}
+
+void DisplayListOutputDev::updateWordSpace(GfxState * /*state*/)
+{
+    changes |= wordSpaceChange;
+}
+
+void DisplayListOutputDev::updateHorizScaling(GfxState * /*state*/)
+{
+    changes |= horizScalingChange;
+}
+
+//----- path painting
+
+void DisplayListOutputDev::stroke(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<PathOp>(PathOp::stroke, state->getPath()));
+    }
+}
+
+void DisplayListOutputDev::fill(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<PathOp>(PathOp::fill, state->getPath()));
+    }
+}
+
+void DisplayListOutputDev::eoFill(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<PathOp>(PathOp::eoFill, state->getPath()));
+    }
+}
+
+//----- path clipping
+
+// The clip ops apply the clip to the state of the playback as well.
+
+void DisplayListOutputDev::clip(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<PathOp>(PathOp::clip, state->getPath()));
+    }
+}
+
+void DisplayListOutputDev::eoClip(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<PathOp>(PathOp::eoClip, state->getPath()));
+    }
+}
+
+void DisplayListOutputDev::clipToStrokePath(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<PathOp>(PathOp::clipToStrokePath, state->getPath()));
+    }
+}
+
+//----- text drawing
+
+void DisplayListOutputDev::beginString(GfxState *state, const std::string &s)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<TextOp>(false, s));
+    }
+}
+
+void DisplayListOutputDev::endString(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::endString));
+    }
+}
+
+void DisplayListOutputDev::drawChar(GfxState *state, double x, double y, double dx, double dy, double originX, double originY, CharCode code, int nBytes, const Unicode *u, int uLen)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<DrawCharOp>(x, y, dx, dy, originX, originY, code, nBytes, u, uLen));
+    }
+}
+
+void DisplayListOutputDev::beginTextObject(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::beginTextObject));
+    }
+}
+
+void DisplayListOutputDev::endTextObject(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::endTextObject));
+    }
+}
+
+void DisplayListOutputDev::beginActualText(GfxState *state, const std::string &text)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<TextOp>(true, text));
+    }
+}
+
+void DisplayListOutputDev::endActualText(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::endActualText));
+    }
+}
+
+// The glyph is recorded as the drawing ops of its char proc, which Gfx
+// runs since this returns false.
+bool DisplayListOutputDev::beginType3Char(GfxState *state, double x, double y, double dx, double dy, CharCode code, const Unicode *u, int uLen)
+{
+    if (list) {
+        recordState(state);
+        const std::array<double, 6> &textCTM = savedStates.empty() ? state->getCTM() : savedStates.back().ctm;
+        auto op = std::make_unique<Type3CharOp>(state, textCTM, x, y, dx, dy, code, u, uLen);
+        openType3Chars.push_back(op.get());
+        addOp(std::move(op));
+    }
+    return false;
+}
+
+void DisplayListOutputDev::endType3Char(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        if (!openType3Chars.empty()) {
+            static_cast<Type3CharOp *>(openType3Chars.back())->setEnd(list->ops.size());
+            openType3Chars.pop_back();
+        }
+        addOp(std::make_unique<StateOp>(StateOp::endType3Char));
+    }
+}
+
+void DisplayListOutputDev::type3D0(GfxState *state, double wx, double wy)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<Type3MetricsOp>(false, wx, wy, 0, 0, 0, 0));
+    }
+}
+
+void DisplayListOutputDev::type3D1(GfxState *state, double wx, double wy, double llx, double lly, double urx, double ury)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<Type3MetricsOp>(true, wx, wy, llx, lly, urx, ury));
+    }
+}
+
+//----- image drawing
+
+void DisplayListOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str, int width, int height, bool invert, bool interpolate, bool inlineImg)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<ImageMaskOp>(false, ref, str, width, height, invert, interpolate, inlineImg));
+    } else {
+        OutputDev::drawImageMask(state, ref, str, width, height, invert, interpolate, inlineImg);
+    }
+}
+
+void DisplayListOutputDev::setSoftMaskFromImageMask(GfxState *state, Object *ref, Stream *str, int width, int height, bool invert, bool inlineImg, std::array<double, 6> &baseMatrix)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<ImageMaskOp>(true, ref, str, width, height, invert, false, inlineImg));
+    } else {
+        OutputDev::setSoftMaskFromImageMask(state, ref, str, width, height, invert, inlineImg, baseMatrix);
+    }
+}
+
+void DisplayListOutputDev::unsetSoftMaskFromImageMask(GfxState *state, std::array<double, 6> & /*baseMatrix*/)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::unsetSoftMaskFromImageMask));
+    }
+}
+
+void DisplayListOutputDev::drawImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, const int *maskColors, bool inlineImg)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<ImageOp>(ref, str, width, height, colorMap, interpolate, maskColors, inlineImg));
+    } else {
+        OutputDev::drawImage(state, ref, str, width, height, colorMap, interpolate, maskColors, inlineImg);
+    }
+}
+
+void DisplayListOutputDev::drawMaskedImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, Stream *maskStr, int maskWidth, int maskHeight, bool maskInvert,
+                                           bool maskInterpolate)
+{
+    if (list) {
+        recordState(state);
+        auto op = std::make_unique<ImageOp>(ref, str, width, height, colorMap, interpolate, nullptr, false);
+        op->setMask(maskStr, maskWidth, maskHeight, maskInvert, maskInterpolate);
+        addOp(std::move(op));
+    } else {
+        OutputDev::drawMaskedImage(state, ref, str, width, height, colorMap, interpolate, maskStr, maskWidth, maskHeight, maskInvert, maskInterpolate);
+    }
+}
+
+void DisplayListOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, Stream *maskStr, int maskWidth, int maskHeight,
+                                               GfxImageColorMap *maskColorMap, bool maskInterpolate)
+{
+    if (list) {
+        recordState(state);
+        auto op = std::make_unique<ImageOp>(ref, str, width, height, colorMap, interpolate, nullptr, false);
+        op->setSoftMask(maskStr, maskWidth, maskHeight, maskColorMap, maskInterpolate);
+        addOp(std::move(op));
+    } else {
+        OutputDev::drawSoftMaskedImage(state, ref, str, width, height, colorMap, interpolate, maskStr, maskWidth, maskHeight, maskColorMap, maskInterpolate);
+    }
+}
+
+//----- transparency groups and soft masks
+
+void DisplayListOutputDev::beginTransparencyGroup(GfxState *state, const std::array<double, 4> &bbox, GfxColorSpace *blendingColorSpace, bool isolated, bool knockout, bool forSoftMask)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<BeginTransparencyGroupOp>(bbox, blendingColorSpace, isolated, knockout, forSoftMask));
+    }
+}
+
+void DisplayListOutputDev::endTransparencyGroup(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::endTransparencyGroup));
+    }
+}
+
+void DisplayListOutputDev::paintTransparencyGroup(GfxState *state, const std::array<double, 4> &bbox)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<PaintTransparencyGroupOp>(bbox));
+    }
+}
+
+void DisplayListOutputDev::setSoftMask(GfxState *state, const std::array<double, 4> &bbox, bool alpha, Function *transferFunc, GfxColor *backdropColor)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<SetSoftMaskOp>(bbox, alpha, transferFunc, backdropColor));
+    }
+}
+
+void DisplayListOutputDev::clearSoftMask(GfxState *state)
+{
+    if (list) {
+        recordState(state);
+        addOp(std::make_unique<StateOp>(StateOp::clearSoftMask));
+    }
+}
@@ -0,0 +1,213 @@
+//========================================================================
+//
+// DisplayListOutputDev.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef DISPLAYLISTOUTPUTDEV_H
+#define DISPLAYLISTOUTPUTDEV_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "poppler_private_export.h"
+#include "OutputDev.h"
+
+class Page;
+class DisplayListOp;
+
+//------------------------------------------------------------------------
+// DisplayList
+//
+// The drawing calls recorded by a DisplayListOutputDev for one page, in
+// user space.  The list can be played back into any OutputDev, at any
+// resolution, rotation or slice, without parsing the content stream
+// again.
+//
+// The list references the page, its fonts and its XRef, so the PDFDoc
+// must outlive it.  The graphics state is recorded as the fields that
+// changed between ops.  Images are kept decoded in memory.  Shadings and
+// tiling patterns are recorded as the fills Gfx decomposes them into, so
+// OutputDevs that draw them natively draw such lists differently from the
+// page; see hasFlattenedPatterns.
+// Type 3 glyphs are recorded as the drawing calls of their char procs,
+// which OutputDevs that don't interpret Type 3 glyphs get as a drawChar.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT DisplayList
+{
+public:
+    ~DisplayList();
+
+    DisplayList(const DisplayList &) = delete;
+    DisplayList &operator=(const DisplayList &) = delete;
+
+    // Play the list back into <out>; the arguments are the same as for
+    // Page::displaySlice, except for <xrefA>, which objects are fetched
+    // from instead of the document's XRef if it isn't nullptr.  The list
+    // isn't modified, so it can be played back into several OutputDevs
+    // concurrently, each thread with its own copyXRef.
+    void displaySlice(OutputDev *out, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, int sliceX, int sliceY, int sliceW, int sliceH, bool printing, bool (*abortCheckCbk)(void *data) = nullptr,
+                      void *abortCheckCbkData = nullptr, XRef *xrefA = nullptr) const;
+
+    // Return a copy of the document's XRef, to play the list back with.
+    std::unique_ptr<XRef> copyXRef() const;
+
+    // Play the whole page back into <out>.
+    void display(OutputDev *out, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, bool printing) const { displaySlice(out, hDPI, vDPI, rotate, useMediaBox, crop, -1, -1, -1, -1, printing); }
+
+    // Number of recorded drawing calls.
+    size_t getLength() const { return ops.size(); }
+
+    // Whether shadings or tiling patterns were recorded as the fills Gfx
+    // decomposes them into.
+    bool hasFlattenedPatterns() const { return flattenedPatterns; }
+
+private:
+    DisplayList(Page *pageA, int pageNumA, XRef *xrefA, const std::array<double, 6> &baseCTMA);
+
+    Page *page;
+    int pageNum;
+    XRef *xref;
+    std::array<double, 6> baseCTM; // default CTM of the recording
+    std::vector<std::unique_ptr<DisplayListOp>> ops;
+    bool flattenedPatterns = false;
+
+    friend class DisplayListOutputDev;
+};
+
+//------------------------------------------------------------------------
+// DisplayListOutputDev
+//
+// Records a page into a DisplayList:
+//
+//   DisplayListOutputDev recorder;
+//   page->display(&recorder, 72, 72, 0, false, true, false);
+//   std::unique_ptr<DisplayList> list = recorder.takeDisplayList();
+//   list->displaySlice(splashOut, 300, 300, 0, false, true, x, y, w, h, false);
+//
+// The page should be recorded whole; a recorded slice only contains what
+// was visible in it.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT DisplayListOutputDev : public OutputDev
+{
+public:
+    DisplayListOutputDev();
+    ~DisplayListOutputDev() override;
+
+    // Return the list recorded by the last page displayed, or nullptr.
+    std::unique_ptr<DisplayList> takeDisplayList();
+
+    //----- get info about output device
+
+    bool upsideDown() override { return true; }
+    bool useDrawChar() override { return true; }
+    bool interpretType3Chars() override { return true; }
+    bool useTilingPatternFill() override;
+    bool useShadedFills(int type) override;
+
+    //----- initialization and control
+
+    bool checkPageSlice(Page *page, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, int sliceX, int sliceY, int sliceW, int sliceH, bool printing, bool (*abortCheckCbk)(void *data) = nullptr,
+                        void *abortCheckCbkData = nullptr, bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data) = nullptr, void *annotDisplayDecideCbkData = nullptr) override;
+    void startPage(int pageNum, GfxState *state, XRef *xref) override;
+
+    //----- save/restore graphics state
+    void saveState(GfxState *state) override;
+    void restoreState(GfxState *state) override;
+
+    //----- update graphics state
+    void updateAll(GfxState *state) override;
+    void updateCTM(GfxState *state, double m11, double m12, double m21, double m22, double m31, double m32) override;
+    void updateLineDash(GfxState *state) override;
+    void updateFlatness(GfxState *state) override;
+    void updateLineJoin(GfxState *state) override;
+    void updateLineCap(GfxState *state) override;
+    void updateMiterLimit(GfxState *state) override;
+    void updateLineWidth(GfxState *state) override;
+    void updateStrokeAdjust(GfxState *state) override;
+    void updateAlphaIsShape(GfxState *state) override;
+    void updateTextKnockout(GfxState *state) override;
+    void updateFillColorSpace(GfxState *state) override;
+    void updateStrokeColorSpace(GfxState *state) override;
+    void updateFillColor(GfxState *state) override;
+    void updateStrokeColor(GfxState *state) override;
+    void updateBlendMode(GfxState *state) override;
+    void updateFillOpacity(GfxState *state) override;
+    void updateStrokeOpacity(GfxState *state) override;
+    void updateFillOverprint(GfxState *state) override;
+    void updateStrokeOverprint(GfxState *state) override;
+    void updateOverprintMode(GfxState *state) override;
+    void updateTransfer(GfxState *state) override;
+    void updateFont(GfxState *state) override;
+    void updateTextMat(GfxState *state) override;
+    void updateCharSpace(GfxState *state) override;
+    void updateRender(GfxState *state) override;
+    void updateRise(GfxState *state) override;
+    void updateWordSpace(GfxState *state) override;
+    void updateHorizScaling(GfxState *state) override;
+
+    //----- path painting
+    void stroke(GfxState *state) override;
+    void fill(GfxState *state) override;
+    void eoFill(GfxState *state) override;
+
+    //----- path clipping
+    void clip(GfxState *state) override;
+    void eoClip(GfxState *state) override;
+    void clipToStrokePath(GfxState *state) override;
+
+    //----- text drawing
+    void beginString(GfxState *state, const std::string &s) override;
+    void endString(GfxState *state) override;
+    void drawChar(GfxState *state, double x, double y, double dx, double dy, double originX, double originY, CharCode code, int nBytes, const Unicode *u, int uLen) override;
+    void beginTextObject(GfxState *state) override;
+    void endTextObject(GfxState *state) override;
+    void beginActualText(GfxState *state, const std::string &text) override;
+    void endActualText(GfxState *state) override;
+    bool beginType3Char(GfxState *state, double x, double y, double dx, double dy, CharCode code, const Unicode *u, int uLen) override;
+    void endType3Char(GfxState *state) override;
+    void type3D0(GfxState *state, double wx, double wy) override;
+    void type3D1(GfxState *state, double wx, double wy, double llx, double lly, double urx, double ury) override;
+
+    //----- image drawing
+    void drawImageMask(GfxState *state, Object *ref, Stream *str, int width, int height, bool invert, bool interpolate, bool inlineImg) override;
+    void setSoftMaskFromImageMask(GfxState *state, Object *ref, Stream *str, int width, int height, bool invert, bool inlineImg, std::array<double, 6> &baseMatrix) override;
+    void unsetSoftMaskFromImageMask(GfxState *state, std::array<double, 6> &baseMatrix) override;
+    void drawImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, const int *maskColors, bool inlineImg) override;
+    void drawMaskedImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, Stream *maskStr, int maskWidth, int maskHeight, bool maskInvert, bool maskInterpolate) override;
+    void drawSoftMaskedImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, Stream *maskStr, int maskWidth, int maskHeight, GfxImageColorMap *maskColorMap,
+                             bool maskInterpolate) override;
+
+    //----- transparency groups and soft masks
+    void beginTransparencyGroup(GfxState *state, const std::array<double, 4> &bbox, GfxColorSpace *blendingColorSpace, bool isolated, bool knockout, bool forSoftMask) override;
+    void endTransparencyGroup(GfxState *state) override;
+    void paintTransparencyGroup(GfxState *state, const std::array<double, 4> &bbox) override;
+    void setSoftMask(GfxState *state, const std::array<double, 4> &bbox, bool alpha, Function *transferFunc, GfxColor *backdropColor) override;
+    void clearSoftMask(GfxState *state) override;
+
+private:
+    // Record the fields of <state> updated since the last op.
+    void recordState(GfxState *state);
+    void addOp(std::unique_ptr<DisplayListOp> op);
+
+    struct SavedState
+    {
+        std::array<double, 6> ctm;
+        std::string renderingIntent;
+    };
+
+    Page *page = nullptr;
+    std::unique_ptr<DisplayList> list;
+    unsigned changes = 0; // fields updated since the last op
+    std::string renderingIntent; // as of the last op
+    std::vector<SavedState> savedStates;
+    std::vector<DisplayListOp *> openType3Chars; // beginType3Char ops without their endType3Char yet
+};
+
+#endif
@@ -22,6 +22,15 @@
 
 #    include "FlateStream.h"
 
+// Returns true if reading past the end of the compressed data in <str>
+// can't affect anybody else, i.e. the data comes (possibly through other
+// filters) from a file or memory buffer with its own bounds.
+static bool canReadInBulk(Stream *str)
+{
+    BaseStream *baseStr = str->getBaseStream();
+    return dynamic_cast<FileStream *>(baseStr) || dynamic_cast<CachedFileStream *>(baseStr) || dynamic_cast<BaseMemStream<const char> *>(baseStr);
+}
+
 FlateStream::FlateStream(std::unique_ptr<Stream> strA, int predictor, int columns, int colors, int bits) : OwnedFilterStream(std::move(strA))
 {
     if (predictor != 1) {
@@ -34,6 +43,7 @@ FlateStream::FlateStream(std::unique_ptr<Stream> strA, int predictor, int column
         pred = NULL;
     }
     out_pos = 0;
+    bulkInput = canReadInBulk(str);
     memset(&d_stream, 0, sizeof(d_stream));
     inflateInit(&d_stream);
 }
@@ -110,10 +120,14 @@ int FlateStream::fill_buffer()
         while (1) {
             /* buffer is empty so we need to fill it */
             if (d_stream.avail_in == 0) {
-                int c;
                 /* read from the source stream */
-                while (d_stream.avail_in < sizeof(in_buf) && (c = str->getChar()) != EOF) {
-                    in_buf[d_stream.avail_in++] = c;
+                if (bulkInput) {
+                    d_stream.avail_in = str->doGetChars(sizeof(in_buf), in_buf);
+                } else {
+                    const int c = str->getChar();
+                    if (c != EOF) {
+                        in_buf[d_stream.avail_in++] = c;
+                    }
                 }
                 d_stream.next_in = in_buf;
             }
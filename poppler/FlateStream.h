@@ -50,8 +50,11 @@ private:
     z_stream d_stream;
     StreamPredictor *pred;
     int status;
-    /* in_buf currently needs to be 1 or we over read from EmbedStreams */
-    unsigned char in_buf[1];
+    /* streams that share their base stream with other readers (i.e. EmbedStreams
+       of inline images) must be fed one byte at a time or we over read from them,
+       everything else is fed in chunks of sizeof(in_buf) through getChars() */
+    bool bulkInput;
+    unsigned char in_buf[4096];
     unsigned char out_buf[4096];
     int out_pos;
     int out_buf_len;
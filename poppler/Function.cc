@@ -31,11 +31,13 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <cctype>
 #include <cmath>
+#include <memory>
 #include <numbers>
 #include "goo/gmem.h"
 #include "goo/gstrtod.h"
@@ -173,6 +175,15 @@ bool Function::init(Dict *dict)
     return true;
 }
 
+void Function::transformBatch(const double *in, double *out, int count) const
+{
+    for (int i = 0; i < count; ++i) {
+        transform(in, out);
+        in += m;
+        out += n;
+    }
+}
+
 //------------------------------------------------------------------------
 // IdentityFunction
 //------------------------------------------------------------------------
@@ -207,7 +218,7 @@ void IdentityFunction::transform(const double *in, double *out) const
 // SampledFunction
 //------------------------------------------------------------------------
 
-SampledFunction::SampledFunction(Object *funcObj, Dict *dict) : cacheOut {}
+SampledFunction::SampledFunction(Object *funcObj, Dict *dict)
 {
     Stream *str;
     int sampleBits;
@@ -216,12 +227,10 @@ SampledFunction::SampledFunction(Object *funcObj, Dict *dict) : cacheOut {}
     unsigned int buf, bitMask;
     int bits;
     unsigned int s;
-    double in[funcMaxInputs];
     int i, j, t, bit, idx;
 
     idxOffset = nullptr;
     samples = nullptr;
-    sBuf = nullptr;
     ok = false;
 
     //----- initialize the generic stuff
@@ -237,9 +246,6 @@ SampledFunction::SampledFunction(Object *funcObj, Dict *dict) : cacheOut {}
         return;
     }
 
-    //----- buffer
-    sBuf = static_cast<double *>(gmallocn(1 << m, sizeof(double)));
-
     //----- get the stream
     if (!funcObj->isStream()) {
         error(errSyntaxError, -1, "Type 0 function isn't a stream");
@@ -392,13 +398,6 @@ SampledFunction::SampledFunction(Object *funcObj, Dict *dict) : cacheOut {}
     }
     str->close();
 
-    // set up the cache
-    for (i = 0; i < m; ++i) {
-        in[i] = domain[i][0];
-        cacheIn[i] = in[i] - 1;
-    }
-    transform(in, cacheOut);
-
     ok = true;
 }
 
@@ -410,9 +409,6 @@ SampledFunction::~SampledFunction()
     if (samples) {
         gfree(samples);
     }
-    if (sBuf) {
-        gfree(sBuf);
-    }
 }
 
 SampledFunction::SampledFunction(const SampledFunction *func, PrivateTag /*unused*/) : Function(func)
@@ -432,11 +428,6 @@ SampledFunction::SampledFunction(const SampledFunction *func, PrivateTag /*unuse
     samples = static_cast<double *>(gmallocn(nSamples, sizeof(double)));
     memcpy(samples, func->samples, nSamples * sizeof(double));
 
-    sBuf = static_cast<double *>(gmallocn(1 << m, sizeof(double)));
-
-    memcpy(cacheIn, func->cacheIn, funcMaxInputs * sizeof(double));
-    memcpy(cacheOut, func->cacheOut, funcMaxOutputs * sizeof(double));
-
     ok = func->ok;
 }
 
@@ -447,19 +438,13 @@ void SampledFunction::transform(const double *in, double *out) const
     double efrac0[funcMaxInputs];
     double efrac1[funcMaxInputs];
 
-    // check the cache
-    bool inCache = true;
-    for (int i = 0; i < m; ++i) {
-        if (in[i] != cacheIn[i]) {
-            inCache = false;
-            break;
-        }
-    }
-    if (inCache) {
-        for (int i = 0; i < n; ++i) {
-            out[i] = cacheOut[i];
-        }
-        return;
+    // interpolation buffer, on the stack for the usual few inputs
+    double sBufSmall[1 << 4];
+    std::unique_ptr<double[]> sBufLarge;
+    double *sBuf = sBufSmall;
+    if (m > 4) {
+        sBufLarge = std::make_unique<double[]>(1 << m);
+        sBuf = sBufLarge.get();
     }
 
     // map input values into sample array
@@ -514,13 +499,55 @@ void SampledFunction::transform(const double *in, double *out) const
             out[i] = range[i][1];
         }
     }
+}
 
-    // save current result in the cache
-    for (int i = 0; i < m; ++i) {
-        cacheIn[i] = in[i];
+void SampledFunction::transformBatch(const double *in, double *out, int count) const
+{
+    if (m != 1) {
+        Function::transformBatch(in, out, count);
+        return;
     }
-    for (int i = 0; i < n; ++i) {
-        cacheOut[i] = out[i];
+
+    // one input: locate all the samples first, then interpolate each
+    // output for all of them, as transform does
+    constexpr int chunkSize = 64;
+    int idx0[chunkSize];
+    double efrac0[chunkSize], efrac1[chunkSize];
+    const int lastSample = sampleSize[0] - 1;
+    const int offset1 = idxOffset[1];
+    for (int start = 0; start < count; start += chunkSize) {
+        const int len = std::min(chunkSize, count - start);
+        for (int j = 0; j < len; ++j) {
+            double x = (in[start + j] - domain[0][0]) * inputMul[0] + encode[0][0];
+            if (x < 0 || std::isnan(x)) {
+                x = 0;
+            } else if (x > lastSample) {
+                x = lastSample;
+            }
+            int e = static_cast<int>(x);
+            if (e == lastSample && lastSample > 0) {
+                e = lastSample - 1;
+            }
+            idx0[j] = e * n;
+            efrac1[j] = x - e;
+            efrac0[j] = 1 - efrac1[j];
+        }
+        for (int i = 0; i < n; ++i) {
+            const double decodeMul = decode[i][1] - decode[i][0];
+            double *p = out + start * n + i;
+            for (int j = 0; j < len; ++j, p += n) {
+                const int idx = idx0[j] + i;
+                const double s0 = likely(idx >= 0 && idx < nSamples) ? samples[idx] : 0;
+                const double s1 = likely(idx + offset1 >= 0 && idx + offset1 < nSamples) ? samples[idx + offset1] : 0;
+                double v = (efrac0[j] * s0 + efrac1[j] * s1) * decodeMul + decode[i][0];
+                if (v < range[i][0]) {
+                    v = range[i][0];
+                } else if (v > range[i][1]) {
+                    v = range[i][1];
+                }
+                *p = v;
+            }
+        }
     }
 }
 
@@ -660,6 +687,33 @@ void ExponentialFunction::transform(const double *in, double *out) const
     }
 }
 
+void ExponentialFunction::transformBatch(const double *in, double *out, int count) const
+{
+    for (int j = 0; j < count; ++j) {
+        double x;
+        if (in[j] < domain[0][0]) {
+            x = domain[0][0];
+        } else if (in[j] > domain[0][1]) {
+            x = domain[0][1];
+        } else {
+            x = in[j];
+        }
+        const double t = isLinear ? x : pow(x, e);
+        for (int i = 0; i < n; ++i) {
+            double v = c0[i] + t * (c1[i] - c0[i]);
+            if (hasRange) {
+                if (v < range[i][0]) {
+                    v = range[i][0];
+                } else if (v > range[i][1]) {
+                    v = range[i][1];
+                }
+            }
+            out[i] = v;
+        }
+        out += n;
+    }
+}
+
 //------------------------------------------------------------------------
 // StitchingFunction
 //------------------------------------------------------------------------
@@ -806,6 +860,45 @@ void StitchingFunction::transform(const double *in, double *out) const
     funcs[i]->transform(&x, out);
 }
 
+void StitchingFunction::transformBatch(const double *in, double *out, int count) const
+{
+    // map the inputs into their subfunctions' domains, then hand each run
+    // of inputs falling in the same subfunction to it in one batch
+    constexpr int chunkSize = 64;
+    double xs[chunkSize];
+    int fs[chunkSize];
+    const int k = funcs.size();
+    for (int start = 0; start < count; start += chunkSize) {
+        const int len = std::min(chunkSize, count - start);
+        for (int j = 0; j < len; ++j) {
+            double x;
+            if (in[start + j] < domain[0][0]) {
+                x = domain[0][0];
+            } else if (in[start + j] > domain[0][1]) {
+                x = domain[0][1];
+            } else {
+                x = in[start + j];
+            }
+            int i;
+            for (i = 0; i < k - 1; ++i) {
+                if (x < bounds[i + 1]) {
+                    break;
+                }
+            }
+            xs[j] = encode[2 * i] + (x - bounds[i]) * scale[i];
+            fs[j] = i;
+        }
+        for (int j = 0; j < len;) {
+            int runEnd = j + 1;
+            while (runEnd < len && fs[runEnd] == fs[j]) {
+                ++runEnd;
+            }
+            funcs[fs[j]]->transformBatch(xs + j, out + (start + j) * n, runEnd - j);
+            j = runEnd;
+        }
+    }
+}
+
 //------------------------------------------------------------------------
 // PostScriptFunction
 //------------------------------------------------------------------------
@@ -1082,12 +1175,805 @@ void PSStack::roll(int n, int j)
     }
 }
 
+//------------------------------------------------------------------------
+// compiled PostScript functions
+//------------------------------------------------------------------------
+
+// PostScript functions are compiled once to a register code: the depth
+// and the type of every stack slot are known at each point of a function
+// that doesn't mix types or compute stack operands, so the stack
+// operators only rename registers and every other operator becomes one
+// typed instruction writing a new register.  Constants are folded, and
+// the ones left are loaded with the inputs.  Functions that can't be
+// compiled keep being interpreted.
+
+enum PSCodeOp : unsigned char
+{
+    psCodeMove, // r[d] = r[a]
+    psCodeJumpIfFalse, // if !r[a] goto target
+    psCodeJump, // goto target
+    // unary operators, r[d] = op r[a]
+    psCodeIntToReal,
+    psCodeAbsI,
+    psCodeAbsR,
+    psCodeNegI,
+    psCodeNegR,
+    psCodeNotI,
+    psCodeNotB,
+    psCodeCeiling,
+    psCodeFloor,
+    psCodeRound,
+    psCodeTruncate,
+    psCodeCvi,
+    psCodeSqrt,
+    psCodeSin,
+    psCodeCos,
+    psCodeLn,
+    psCodeLog,
+    // binary operators, r[d] = r[a] op r[b]
+    psCodeAddI,
+    psCodeAddR,
+    psCodeSubI,
+    psCodeSubR,
+    psCodeMulI,
+    psCodeMulR,
+    psCodeDiv,
+    psCodeIdiv,
+    psCodeMod,
+    psCodeExp,
+    psCodeAtan,
+    psCodeAndI,
+    psCodeAndB,
+    psCodeOrI,
+    psCodeOrB,
+    psCodeXorI,
+    psCodeXorB,
+    psCodeBitshift,
+    psCodeEqI,
+    psCodeEqR,
+    psCodeEqB,
+    psCodeNeI,
+    psCodeNeR,
+    psCodeNeB,
+    psCodeGeI,
+    psCodeGeR,
+    psCodeGtI,
+    psCodeGtR,
+    psCodeLeI,
+    psCodeLeR,
+    psCodeLtI,
+    psCodeLtR
+};
+
+union PSValue {
+    bool booln;
+    int intg;
+    double real;
+};
+
+struct PSInstr
+{
+    PSCodeOp op;
+    unsigned char d, a, b; // registers
+    int target; // jump target
+};
+
+// registers: the inputs, the constants, then the results of instructions
+constexpr int psMaxRegs = 256;
+
+// Number of intervals of the table of one-input functions, and the
+// largest difference to the function allowed between the samples,
+// relative to the output range.
+constexpr int psLUTIntervals = 1024;
+constexpr double psLUTMaxError = 1e-4;
+constexpr int psLUTChecks = 8; // points checked in each interval
+
+struct PSCode
+{
+    std::vector<PSInstr> instrs;
+    std::vector<PSValue> consts; // registers following the inputs
+    int outRegs[funcMaxOutputs];
+    bool outIsInt[funcMaxOutputs];
+    std::vector<double> lut; // psLUTIntervals + 1 output tuples, if the function has a table
+    double lutScale;
+};
+
+// Apply a non-jump instruction.  Returns false if the interpreter would
+// report an error or skip the operator; the instruction's result is then
+// undefined.
+static inline bool applyPSInstr(const PSInstr &instr, PSValue *regs)
+{
+    PSValue &d = regs[instr.d];
+    const PSValue a = regs[instr.a];
+    const PSValue b = regs[instr.b];
+    switch (instr.op) {
+    case psCodeMove:
+        d = a;
+        break;
+    case psCodeJumpIfFalse:
+    case psCodeJump:
+        return false;
+    case psCodeIntToReal:
+        d.real = static_cast<double>(a.intg);
+        break;
+    case psCodeAbsI:
+        d.intg = abs(a.intg);
+        break;
+    case psCodeAbsR:
+        d.real = fabs(a.real);
+        break;
+    case psCodeNegI:
+        d.intg = -a.intg;
+        break;
+    case psCodeNegR:
+        d.real = -a.real;
+        break;
+    case psCodeNotI:
+        d.intg = ~a.intg;
+        break;
+    case psCodeNotB:
+        d.booln = !a.booln;
+        break;
+    case psCodeCeiling:
+        d.real = ceil(a.real);
+        break;
+    case psCodeFloor:
+        d.real = floor(a.real);
+        break;
+    case psCodeRound:
+        d.real = (a.real >= 0) ? floor(a.real + 0.5) : ceil(a.real - 0.5);
+        break;
+    case psCodeTruncate:
+        d.real = (a.real >= 0) ? floor(a.real) : ceil(a.real);
+        break;
+    case psCodeCvi:
+        d.intg = static_cast<int>(a.real);
+        break;
+    case psCodeSqrt:
+        d.real = sqrt(a.real);
+        break;
+    case psCodeSin:
+        d.real = sin(a.real * std::numbers::pi / 180.0);
+        break;
+    case psCodeCos:
+        d.real = cos(a.real * std::numbers::pi / 180.0);
+        break;
+    case psCodeLn:
+        d.real = log(a.real);
+        break;
+    case psCodeLog:
+        d.real = log10(a.real);
+        break;
+    case psCodeAddI:
+        d.intg = a.intg + b.intg;
+        break;
+    case psCodeAddR:
+        d.real = a.real + b.real;
+        break;
+    case psCodeSubI:
+        d.intg = a.intg - b.intg;
+        break;
+    case psCodeSubR:
+        d.real = a.real - b.real;
+        break;
+    case psCodeMulI:
+        if (checkedMultiply(a.intg, b.intg, &d.intg)) {
+            return false;
+        }
+        break;
+    case psCodeMulR:
+        d.real = a.real * b.real;
+        break;
+    case psCodeDiv:
+        d.real = a.real / b.real;
+        break;
+    case psCodeIdiv:
+        if (unlikely(b.intg == 0 || (b.intg == -1 && a.intg == INT_MIN))) {
+            return false;
+        }
+        d.intg = a.intg / b.intg;
+        break;
+    case psCodeMod:
+        if (unlikely(b.intg == 0)) {
+            return false;
+        }
+        d.intg = a.intg % b.intg;
+        break;
+    case psCodeExp:
+        d.real = pow(a.real, b.real);
+        break;
+    case psCodeAtan:
+        d.real = atan2(a.real, b.real) * 180.0 / std::numbers::pi;
+        if (d.real < 0) {
+            d.real += 360.0;
+        }
+        break;
+    case psCodeAndI:
+        d.intg = a.intg & b.intg;
+        break;
+    case psCodeAndB:
+        d.booln = a.booln && b.booln;
+        break;
+    case psCodeOrI:
+        d.intg = a.intg | b.intg;
+        break;
+    case psCodeOrB:
+        d.booln = a.booln || b.booln;
+        break;
+    case psCodeXorI:
+        d.intg = a.intg ^ b.intg;
+        break;
+    case psCodeXorB:
+        d.booln = a.booln ^ b.booln;
+        break;
+    case psCodeBitshift:
+        if (b.intg > 0) {
+            d.intg = a.intg << b.intg;
+        } else if (b.intg < 0) {
+            d.intg = static_cast<int>(static_cast<unsigned int>(a.intg) >> -b.intg);
+        } else {
+            d = a;
+        }
+        break;
+    case psCodeEqI:
+        d.booln = a.intg == b.intg;
+        break;
+    case psCodeEqR:
+        d.booln = a.real == b.real;
+        break;
+    case psCodeEqB:
+        d.booln = a.booln == b.booln;
+        break;
+    case psCodeNeI:
+        d.booln = a.intg != b.intg;
+        break;
+    case psCodeNeR:
+        d.booln = a.real != b.real;
+        break;
+    case psCodeNeB:
+        d.booln = a.booln != b.booln;
+        break;
+    case psCodeGeI:
+        d.booln = a.intg >= b.intg;
+        break;
+    case psCodeGeR:
+        d.booln = a.real >= b.real;
+        break;
+    case psCodeGtI:
+        d.booln = a.intg > b.intg;
+        break;
+    case psCodeGtR:
+        d.booln = a.real > b.real;
+        break;
+    case psCodeLeI:
+        d.booln = a.intg <= b.intg;
+        break;
+    case psCodeLeR:
+        d.booln = a.real <= b.real;
+        break;
+    case psCodeLtI:
+        d.booln = a.intg < b.intg;
+        break;
+    case psCodeLtR:
+        d.booln = a.real < b.real;
+        break;
+    }
+    return true;
+}
+
+// Run compiled code on inputs <in>.  Returns false if the code hit a case
+// it doesn't handle like the interpreter.
+static bool runPSCode(const PSCode &psCode, int m, int n, const double *in, double *out)
+{
+    PSValue regs[psMaxRegs];
+    for (int i = 0; i < m; ++i) {
+        regs[i].real = in[i];
+    }
+    std::copy(psCode.consts.begin(), psCode.consts.end(), regs + m);
+    const PSInstr *instrs = psCode.instrs.data();
+    const PSInstr *end = instrs + psCode.instrs.size();
+    for (const PSInstr *instr = instrs; instr < end;) {
+        if (instr->op == psCodeJumpIfFalse) {
+            instr = regs[instr->a].booln ? instr + 1 : instrs + instr->target;
+        } else if (instr->op == psCodeJump) {
+            instr = instrs + instr->target;
+        } else {
+            if (unlikely(!applyPSInstr(*instr, regs))) {
+                return false;
+            }
+            ++instr;
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        const PSValue &v = regs[psCode.outRegs[i]];
+        out[i] = psCode.outIsInt[i] ? static_cast<double>(v.intg) : v.real;
+    }
+    return true;
+}
+
+namespace {
+
+class PSCompiler
+{
+public:
+    PSCompiler(const PSObject *codeA, PSCode *psCodeA) : code(codeA), psCode(psCodeA) { }
+
+    // Compile a function of <m> inputs and <n> outputs.
+    bool compile(int m, int n);
+
+private:
+    // Registers are numbered while compiling: the inputs and results from
+    // 0, and the constants from -1 down, as they are only placed after
+    // the inputs once their number is known.
+    struct Instr
+    {
+        PSCodeOp op;
+        int d, a, b;
+        int target;
+    };
+
+    struct Slot
+    {
+        PSObjectType type; // psBool, psInt or psReal
+        bool isConst; // value is known
+        PSValue value;
+        int reg; // register holding the value; none yet for constants
+    };
+
+    static constexpr int noReg = INT_MIN;
+
+    bool compileBlock(int codePtr);
+    bool compileOp(PSOp op);
+    bool compileIf(int codePtr, bool hasElse);
+
+    int newReg() { return nRegs++; }
+    int emit(PSCodeOp op, int a, int b = 0)
+    {
+        const int d = newReg();
+        instrs.push_back({ op, d, a, b, 0 });
+        return d;
+    }
+    int emitJump(PSCodeOp op, int a = 0)
+    {
+        instrs.push_back({ op, 0, a, 0, 0 });
+        return static_cast<int>(instrs.size()) - 1;
+    }
+    int regOf(Slot &slot);
+    bool push(const Slot &slot)
+    {
+        if (stack.size() >= psStackSize) {
+            return false;
+        }
+        stack.push_back(slot);
+        return true;
+    }
+    // A constant slot, with the bytes of <value> its type doesn't use
+    // cleared, so that equal constants compare equal.
+    static Slot constSlot(PSObjectType type, const PSValue &value)
+    {
+        Slot slot { type, true, {}, noReg };
+        if (type == psBool) {
+            slot.value.booln = value.booln;
+        } else if (type == psInt) {
+            slot.value.intg = value.intg;
+        } else {
+            slot.value.real = value.real;
+        }
+        return slot;
+    }
+    bool pushConst(PSObjectType type, const PSValue &value) { return push(constSlot(type, value)); }
+    int top(int i = 0) const { return static_cast<int>(stack.size()) - 1 - i; }
+    bool isNum(int i) const { return stack[i].type == psInt || stack[i].type == psReal; }
+    bool popConstInt(int *value)
+    {
+        if (stack.empty() || stack.back().type != psInt || !stack.back().isConst) {
+            return false;
+        }
+        *value = stack.back().value.intg;
+        stack.pop_back();
+        return true;
+    }
+    void toReal(int i);
+    bool unary(PSCodeOp op, PSObjectType resultType);
+    bool binary(PSCodeOp op, PSObjectType resultType);
+
+    const PSObject *code;
+    PSCode *psCode;
+    std::vector<Instr> instrs;
+    int nRegs = 0;
+    std::vector<Slot> stack;
+};
+
+bool PSCompiler::compile(int m, int n)
+{
+    for (int i = 0; i < m; ++i) {
+        if (!push({ psReal, false, {}, newReg() })) {
+            return false;
+        }
+    }
+    if (!compileBlock(0) || static_cast<int>(stack.size()) < n) {
+        return false;
+    }
+    int outRegs[funcMaxOutputs];
+    for (int i = 0; i < n; ++i) {
+        Slot &slot = stack[stack.size() - n + i];
+        if (slot.type != psInt && slot.type != psReal) {
+            return false;
+        }
+        outRegs[i] = regOf(slot);
+        psCode->outIsInt[i] = slot.type == psInt;
+    }
+
+    // place the constants after the inputs
+    const int nConsts = psCode->consts.size();
+    if (nRegs + nConsts > psMaxRegs) {
+        return false;
+    }
+    const auto place = [m, nConsts](int reg) { return reg < 0 ? m - 1 - reg : reg < m ? reg : reg + nConsts; };
+    psCode->instrs.reserve(instrs.size());
+    for (const Instr &instr : instrs) {
+        const bool isJump = instr.op == psCodeJump || instr.op == psCodeJumpIfFalse;
+        PSInstr psInstr {};
+        psInstr.op = instr.op;
+        psInstr.d = static_cast<unsigned char>(isJump ? 0 : place(instr.d));
+        psInstr.a = static_cast<unsigned char>(place(instr.a));
+        psInstr.b = static_cast<unsigned char>(place(instr.b));
+        psInstr.target = instr.target;
+        psCode->instrs.push_back(psInstr);
+    }
+    for (int i = 0; i < n; ++i) {
+        psCode->outRegs[i] = place(outRegs[i]);
+    }
+    return true;
+}
+
+// Return the register of a slot, giving constants one.
+int PSCompiler::regOf(Slot &slot)
+{
+    if (slot.reg == noReg) {
+        const auto same = [&slot](const PSValue &value) { return memcmp(&value, &slot.value, sizeof(PSValue)) == 0; };
+        const auto it = std::ranges::find_if(psCode->consts, same);
+        slot.reg = -1 - static_cast<int>(it - psCode->consts.begin());
+        if (it == psCode->consts.end()) {
+            psCode->consts.push_back(slot.value);
+        }
+    }
+    return slot.reg;
+}
+
+bool PSCompiler::compileBlock(int codePtr)
+{
+    while (true) {
+        const PSObject &obj = code[codePtr++];
+        PSValue value;
+        switch (obj.type) {
+        case psInt:
+            value.intg = obj.intg;
+            if (!pushConst(psInt, value)) {
+                return false;
+            }
+            break;
+        case psReal:
+            value.real = obj.real;
+            if (!pushConst(psReal, value)) {
+                return false;
+            }
+            break;
+        case psOperator:
+            if (obj.op == psOpReturn) {
+                return true;
+            }
+            if (obj.op == psOpIf || obj.op == psOpIfelse) {
+                if (!compileIf(codePtr, obj.op == psOpIfelse)) {
+                    return false;
+                }
+                codePtr = code[codePtr + 1].blk;
+            } else if (!compileOp(obj.op)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+}
+
+void PSCompiler::toReal(int i)
+{
+    Slot &slot = stack[i];
+    if (slot.type != psInt) {
+        return;
+    }
+    if (slot.isConst) {
+        PSValue value;
+        value.real = static_cast<double>(slot.value.intg);
+        slot = constSlot(psReal, value);
+    } else {
+        slot.reg = emit(psCodeIntToReal, slot.reg);
+        slot.type = psReal;
+    }
+}
+
+// Replace the top slot by op applied to it, folding constants.
+bool PSCompiler::unary(PSCodeOp op, PSObjectType resultType)
+{
+    Slot &slot = stack[top()];
+    if (slot.isConst) {
+        PSValue regs[1] = { slot.value };
+        const PSInstr instr { op, 0, 0, 0, 0 };
+        if (applyPSInstr(instr, regs)) {
+            slot = constSlot(resultType, regs[0]);
+            return true;
+        }
+    }
+    slot.reg = emit(op, regOf(slot));
+    slot.type = resultType;
+    slot.isConst = false;
+    return true;
+}
+
+// Replace the two top slots by the result of op applied to them, folding
+// constants.
+bool PSCompiler::binary(PSCodeOp op, PSObjectType resultType)
+{
+    Slot &a = stack[top(1)];
+    Slot &b = stack[top()];
+    if (a.isConst && b.isConst) {
+        PSValue regs[2] = { a.value, b.value };
+        const PSInstr instr { op, 0, 0, 1, 0 };
+        if (applyPSInstr(instr, regs)) {
+            a = constSlot(resultType, regs[0]);
+            stack.pop_back();
+            return true;
+        }
+    }
+    a.reg = emit(op, regOf(a), regOf(b));
+    a.type = resultType;
+    a.isConst = false;
+    stack.pop_back();
+    return true;
+}
+
+bool PSCompiler::compileOp(PSOp op)
+{
+    const int depth = stack.size();
+    // operators the interpreter applies to the top one or two slots: the
+    // code for int, real and bool operands, or none if they are an error
+    constexpr PSCodeOp none = psCodeMove;
+    const auto byType = [this](int nArgs, PSCodeOp opI, PSCodeOp opR, PSCodeOp opB, PSObjectType resultI, PSObjectType resultR, PSObjectType resultB) {
+        if (static_cast<int>(stack.size()) < nArgs) {
+            return false;
+        }
+        const int a = top(nArgs - 1);
+        const int b = top();
+        if (stack[a].type == psInt && stack[b].type == psInt && opI != none) {
+            return nArgs == 1 ? unary(opI, resultI) : binary(opI, resultI);
+        }
+        if (isNum(a) && isNum(b) && opR != none) {
+            toReal(a);
+            toReal(b);
+            return nArgs == 1 ? unary(opR, resultR) : binary(opR, resultR);
+        }
+        if (stack[a].type == psBool && stack[b].type == psBool && opB != none) {
+            return nArgs == 1 ? unary(opB, resultB) : binary(opB, resultB);
+        }
+        return false;
+    };
+    PSValue value;
+
+    switch (op) {
+    case psOpAbs:
+        return byType(1, psCodeAbsI, psCodeAbsR, none, psInt, psReal, psBool);
+    case psOpAdd:
+        return byType(2, psCodeAddI, psCodeAddR, none, psInt, psReal, psBool);
+    case psOpAnd:
+        return byType(2, psCodeAndI, none, psCodeAndB, psInt, psReal, psBool);
+    case psOpAtan:
+        return byType(2, none, psCodeAtan, none, psInt, psReal, psBool);
+    case psOpBitshift:
+        return byType(2, psCodeBitshift, none, none, psInt, psReal, psBool);
+    case psOpCeiling:
+    case psOpFloor:
+    case psOpRound:
+    case psOpTruncate:
+        if (depth < 1 || !isNum(top())) {
+            return false;
+        }
+        if (stack[top()].type == psInt) {
+            return true;
+        }
+        return unary(op == psOpCeiling ? psCodeCeiling : op == psOpFloor ? psCodeFloor : op == psOpRound ? psCodeRound : psCodeTruncate, psReal);
+    case psOpCopy: {
+        int k;
+        if (!popConstInt(&k) || k < 0 || k > depth - 1 || depth - 1 + k > psStackSize) {
+            return false;
+        }
+        const int first = depth - 1 - k;
+        for (int i = 0; i < k; ++i) {
+            stack.push_back(stack[first + i]);
+        }
+        return true;
+    }
+    case psOpCos:
+        return byType(1, none, psCodeCos, none, psInt, psReal, psBool);
+    case psOpCvi:
+        if (depth < 1 || !isNum(top())) {
+            return false;
+        }
+        return stack[top()].type == psInt || unary(psCodeCvi, psInt);
+    case psOpCvr:
+        if (depth < 1 || !isNum(top())) {
+            return false;
+        }
+        toReal(top());
+        return true;
+    case psOpDiv:
+        return byType(2, none, psCodeDiv, none, psInt, psReal, psBool);
+    case psOpDup:
+        return depth >= 1 && push(stack[top()]);
+    case psOpEq:
+        return byType(2, psCodeEqI, psCodeEqR, psCodeEqB, psBool, psBool, psBool);
+    case psOpExch:
+    case psOpRoll: {
+        int n = 2, j = 1;
+        if (op == psOpRoll && (!popConstInt(&j) || !popConstInt(&n))) {
+            return false;
+        }
+        // let the interpreter's stack find where the slots go
+        PSStack slots;
+        for (size_t i = 0; i < stack.size(); ++i) {
+            slots.pushInt(i);
+        }
+        slots.roll(n, j);
+        const std::vector<Slot> old = stack;
+        for (int i = static_cast<int>(stack.size()) - 1; i >= 0; --i) {
+            stack[i] = old[slots.popInt()];
+        }
+        return true;
+    }
+    case psOpExp:
+        return byType(2, none, psCodeExp, none, psInt, psReal, psBool);
+    case psOpFalse:
+    case psOpTrue:
+        value.booln = op == psOpTrue;
+        return pushConst(psBool, value);
+    case psOpGe:
+        return byType(2, psCodeGeI, psCodeGeR, none, psBool, psBool, psBool);
+    case psOpGt:
+        return byType(2, psCodeGtI, psCodeGtR, none, psBool, psBool, psBool);
+    case psOpIdiv:
+        return byType(2, psCodeIdiv, none, none, psInt, psReal, psBool);
+    case psOpIndex: {
+        int i;
+        if (!popConstInt(&i) || i < 0 || i > depth - 2) {
+            return false;
+        }
+        return push(stack[depth - 2 - i]);
+    }
+    case psOpLe:
+        return byType(2, psCodeLeI, psCodeLeR, none, psBool, psBool, psBool);
+    case psOpLn:
+        return byType(1, none, psCodeLn, none, psInt, psReal, psBool);
+    case psOpLog:
+        return byType(1, none, psCodeLog, none, psInt, psReal, psBool);
+    case psOpLt:
+        return byType(2, psCodeLtI, psCodeLtR, none, psBool, psBool, psBool);
+    case psOpMod:
+        return byType(2, psCodeMod, none, none, psInt, psReal, psBool);
+    case psOpMul:
+        return byType(2, psCodeMulI, psCodeMulR, none, psInt, psReal, psBool);
+    case psOpNe:
+        return byType(2, psCodeNeI, psCodeNeR, psCodeNeB, psBool, psBool, psBool);
+    case psOpNeg:
+        return byType(1, psCodeNegI, psCodeNegR, none, psInt, psReal, psBool);
+    case psOpNot:
+        return byType(1, psCodeNotI, none, psCodeNotB, psInt, psReal, psBool);
+    case psOpOr:
+        return byType(2, psCodeOrI, none, psCodeOrB, psInt, psReal, psBool);
+    case psOpPop:
+        if (depth < 1) {
+            return false;
+        }
+        stack.pop_back();
+        return true;
+    case psOpSin:
+        return byType(1, none, psCodeSin, none, psInt, psReal, psBool);
+    case psOpSqrt:
+        return byType(1, none, psCodeSqrt, none, psInt, psReal, psBool);
+    case psOpSub:
+        return byType(2, psCodeSubI, psCodeSubR, none, psInt, psReal, psBool);
+    case psOpXor:
+        return byType(2, psCodeXorI, none, psCodeXorB, psInt, psReal, psBool);
+    case psOpIf:
+    case psOpIfelse:
+    case psOpReturn:
+        break;
+    }
+    return false;
+}
+
+// Compile an if or ifelse whose block pointers are at <codePtr>.  Both
+// branches must leave the same number and types of slots; the slots they
+// leave in different registers are moved to new ones, by code following
+// each branch:
+//
+//     if !cond goto else
+//     <then block>
+//     goto thenMoves
+//   else:
+//     <else block>
+//     <else moves>
+//     goto end
+//   thenMoves:
+//     <then moves>
+//   end:
+bool PSCompiler::compileIf(int codePtr, bool hasElse)
+{
+    if (stack.empty() || stack.back().type != psBool) {
+        return false;
+    }
+    const int thenPtr = codePtr + 2;
+    const int elsePtr = hasElse ? code[codePtr].blk : -1;
+    Slot cond = stack.back();
+    stack.pop_back();
+    if (cond.isConst) {
+        if (cond.value.booln) {
+            return compileBlock(thenPtr);
+        }
+        return !hasElse || compileBlock(elsePtr);
+    }
+
+    const int condJump = emitJump(psCodeJumpIfFalse, cond.reg);
+    const std::vector<Slot> before = stack;
+    if (!compileBlock(thenPtr)) {
+        return false;
+    }
+    const int thenJump = emitJump(psCodeJump);
+    std::vector<Slot> thenStack = std::move(stack);
+    stack = before;
+    instrs[condJump].target = instrs.size();
+    if (hasElse && !compileBlock(elsePtr)) {
+        return false;
+    }
+    if (stack.size() != thenStack.size()) {
+        return false;
+    }
+
+    std::vector<Instr> thenMoves;
+    for (size_t i = 0; i < stack.size(); ++i) {
+        Slot &elseSlot = stack[i];
+        Slot &thenSlot = thenStack[i];
+        if (elseSlot.type != thenSlot.type) {
+            return false;
+        }
+        if (elseSlot.isConst && thenSlot.isConst && memcmp(&elseSlot.value, &thenSlot.value, sizeof(PSValue)) == 0) {
+            continue;
+        }
+        if (!elseSlot.isConst && !thenSlot.isConst && elseSlot.reg == thenSlot.reg) {
+            continue;
+        }
+        const int reg = newReg();
+        thenMoves.push_back({ psCodeMove, reg, regOf(thenSlot), 0, 0 });
+        instrs.push_back({ psCodeMove, reg, regOf(elseSlot), 0, 0 });
+        elseSlot = { elseSlot.type, false, {}, reg };
+    }
+    if (thenMoves.empty()) {
+        instrs[thenJump].target = instrs.size();
+    } else {
+        const int elseJump = emitJump(psCodeJump);
+        instrs[thenJump].target = instrs.size();
+        instrs.insert(instrs.end(), thenMoves.begin(), thenMoves.end());
+        instrs[elseJump].target = instrs.size();
+    }
+    return true;
+}
+
+}
+
 PostScriptFunction::PostScriptFunction(Object *funcObj, Dict *dict)
 {
     Stream *str;
     int codePtr;
-    double in[funcMaxInputs];
-    int i;
 
     code = nullptr;
     codeSize = 0;
@@ -1126,12 +2012,7 @@ PostScriptFunction::PostScriptFunction(Object *funcObj, Dict *dict)
     }
     str->close();
 
-    //----- set up the cache
-    for (i = 0; i < m; ++i) {
-        in[i] = domain[i][0];
-        cacheIn[i] = in[i] - 1;
-    }
-    transform(in, cacheOut);
+    compile();
 
     ok = true;
 
@@ -1150,8 +2031,7 @@ PostScriptFunction::PostScriptFunction(const PostScriptFunction *func, PrivateTa
 
     codeString = func->codeString->copy();
 
-    memcpy(cacheIn, func->cacheIn, funcMaxInputs * sizeof(double));
-    memcpy(cacheOut, func->cacheOut, funcMaxOutputs * sizeof(double));
+    compiled = func->compiled;
 
     ok = func->ok;
 }
@@ -1161,24 +2041,94 @@ PostScriptFunction::~PostScriptFunction()
     gfree(code);
 }
 
+void PostScriptFunction::compile()
+{
+    auto psCode = std::make_shared<PSCode>();
+    PSCompiler compiler(code, psCode.get());
+    if (!compiler.compile(m, n)) {
+        return;
+    }
+
+    // sample one-input functions into a table, if interpolating between
+    // the samples stays close to the function at the eighths of every
+    // interval; this only checks the function at 1/8192 steps of the
+    // domain, so a bump narrower than that falling between the checked
+    // points isn't seen, and the table loses it
+    if (m == 1 && domain[0][1] > domain[0][0]) {
+        const double step = (domain[0][1] - domain[0][0]) / psLUTIntervals;
+        std::vector<double> lut((psLUTIntervals + 1) * n);
+        bool useLUT = true;
+        for (int i = 0; i <= psLUTIntervals && useLUT; ++i) {
+            const double x = i < psLUTIntervals ? domain[0][0] + i * step : domain[0][1];
+            double *sample = &lut[i * n];
+            useLUT = runPSCode(*psCode, m, n, &x, sample);
+            for (int j = 0; j < n && useLUT; ++j) {
+                useLUT = std::isfinite(sample[j]);
+                sample[j] = std::clamp(sample[j], range[j][0], range[j][1]);
+            }
+        }
+        for (int i = 0; i < psLUTIntervals * psLUTChecks && useLUT; ++i) {
+            const int k = i / psLUTChecks;
+            const double frac = static_cast<double>(i % psLUTChecks) / psLUTChecks;
+            if (frac == 0) {
+                continue;
+            }
+            const double x = domain[0][0] + (k + frac) * step;
+            double value[funcMaxOutputs];
+            useLUT = runPSCode(*psCode, m, n, &x, value);
+            for (int j = 0; j < n && useLUT; ++j) {
+                const double interpolated = lut[k * n + j] + frac * (lut[(k + 1) * n + j] - lut[k * n + j]);
+                useLUT = fabs(std::clamp(value[j], range[j][0], range[j][1]) - interpolated) <= psLUTMaxError * (range[j][1] - range[j][0]);
+            }
+        }
+        if (useLUT) {
+            psCode->lut = std::move(lut);
+            psCode->lutScale = psLUTIntervals / (domain[0][1] - domain[0][0]);
+        }
+    }
+
+    compiled = std::move(psCode);
+}
+
 void PostScriptFunction::transform(const double *in, double *out) const
 {
-    PSStack stack;
     int i;
 
-    // check the cache
-    for (i = 0; i < m; ++i) {
-        if (in[i] != cacheIn[i]) {
-            break;
+    if (compiled) {
+        if (!compiled->lut.empty() && in[0] >= domain[0][0] && in[0] <= domain[0][1]) {
+            const double t = (in[0] - domain[0][0]) * compiled->lutScale;
+            const int k = std::min(static_cast<int>(t), psLUTIntervals - 1);
+            const double frac = t - k;
+            const double *sample = &compiled->lut[k * n];
+            for (i = 0; i < n; ++i) {
+                out[i] = sample[i] + frac * (sample[n + i] - sample[i]);
+            }
+            return;
         }
-    }
-    if (i == m) {
-        for (i = 0; i < n; ++i) {
-            out[i] = cacheOut[i];
+        if (runPSCode(*compiled, m, n, in, out)) {
+            for (i = 0; i < n; ++i) {
+                if (out[i] < range[i][0]) {
+                    out[i] = range[i][0];
+                } else if (out[i] > range[i][1]) {
+                    out[i] = range[i][1];
+                }
+            }
+            return;
         }
-        return;
     }
+    interpret(in, out);
+}
+
+bool PostScriptFunction::hasLookupTable() const
+{
+    return compiled && !compiled->lut.empty();
+}
 
+void PostScriptFunction::interpret(const double *in, double *out) const
+{
+    int i;
+
+    PSStack stack;
     for (i = 0; i < m; ++i) {
         //~ may need to check for integers here
         stack.pushReal(in[i]);
@@ -1198,14 +2148,6 @@ void PostScriptFunction::transform(const double *in, double *out) const
     //   error(errSyntaxWarning, -1,
     //         "Extra values on stack at end of PostScript function");
     // }
-
-    // save current result in the cache
-    for (i = 0; i < m; ++i) {
-        cacheIn[i] = in[i];
-    }
-    for (i = 0; i < n; ++i) {
-        cacheOut[i] = out[i];
-    }
 }
 
 bool PostScriptFunction::parseCode(Stream *str, int *codePtr, int &recursionCounter)
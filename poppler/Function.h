@@ -34,6 +34,7 @@ class Dict;
 class Stream;
 struct PSObject;
 class PSStack;
+struct PSCode;
 
 //------------------------------------------------------------------------
 // Function
@@ -86,6 +87,11 @@ public:
     // Transform an input tuple into an output tuple.
     virtual void transform(const double *in, double *out) const = 0;
 
+    // Transform <count> consecutive input tuples into consecutive output
+    // tuples.  Like transform, this doesn't modify the function, so it
+    // can be called from several threads at once.
+    virtual void transformBatch(const double *in, double *out, int count) const;
+
     virtual bool isOk() const = 0;
 
 protected:
@@ -134,6 +140,7 @@ public:
     std::unique_ptr<Function> copy() const override { return std::make_unique<SampledFunction>(this); }
     Type getType() const override { return Type::Sampled; }
     void transform(const double *in, double *out) const override;
+    void transformBatch(const double *in, double *out, int count) const override;
     bool isOk() const override { return ok; }
     bool hasDifferentResultSet(const Function *func) const override;
 
@@ -159,9 +166,6 @@ private:
     int *idxOffset;
     double *samples; // the samples
     int nSamples; // size of the samples array
-    double *sBuf; // buffer for the transform function
-    mutable double cacheIn[funcMaxInputs];
-    mutable double cacheOut[funcMaxOutputs];
     bool ok;
 };
 
@@ -181,6 +185,7 @@ public:
     std::unique_ptr<Function> copy() const override { return std::make_unique<ExponentialFunction>(this); }
     Type getType() const override { return Type::Exponential; }
     void transform(const double *in, double *out) const override;
+    void transformBatch(const double *in, double *out, int count) const override;
     bool isOk() const override { return ok; }
 
     const double *getC0() const { return c0; }
@@ -213,6 +218,7 @@ public:
     std::unique_ptr<Function> copy() const override { return std::make_unique<StitchingFunction>(this); }
     Type getType() const override { return Type::Stitching; }
     void transform(const double *in, double *out) const override;
+    void transformBatch(const double *in, double *out, int count) const override;
     bool isOk() const override { return ok; }
 
     int getNumFuncs() const { return funcs.size(); }
@@ -235,7 +241,7 @@ private:
 // PostScriptFunction
 //------------------------------------------------------------------------
 
-class PostScriptFunction : public Function
+class POPPLER_PRIVATE_EXPORT PostScriptFunction : public Function
 {
     class PrivateTag
     {
@@ -251,19 +257,28 @@ public:
 
     const GooString *getCodeString() const { return codeString.get(); }
 
+    // Runs the code through the interpreter, which transform() falls back
+    // to when the compiled code can't reproduce it
+    void interpret(const double *in, double *out) const;
+    // Whether the code was compiled, and if so, whether the function is
+    // evaluated from a table of samples, which is only checked against
+    // the function at points 1/8192 of the domain apart
+    bool isCompiled() const { return compiled != nullptr; }
+    bool hasLookupTable() const;
+
     explicit PostScriptFunction(const PostScriptFunction *func, PrivateTag /*unused*/ = {});
 
 private:
     bool parseCode(Stream *str, int *codePtr, int &recursionCounter);
     std::unique_ptr<GooString> getToken(Stream *str);
     void resizeCode(int newSize);
+    void compile();
     void exec(PSStack *stack, int codePtr) const;
 
     std::unique_ptr<GooString> codeString;
     PSObject *code;
     int codeSize;
-    mutable double cacheIn[funcMaxInputs];
-    mutable double cacheOut[funcMaxOutputs];
+    std::shared_ptr<const PSCode> compiled; // register code, nullptr if the function can't be compiled
     bool ok;
 };
 
@@ -62,6 +62,7 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
 #include <cstdio>
@@ -239,7 +240,7 @@ static inline bool isSameGfxColor(const GfxColor &colorA, const GfxColor &colorB
 // GfxResources
 //------------------------------------------------------------------------
 
-GfxResources::GfxResources(XRef *xrefA, Dict *resDictA, GfxResources *nextA) : gStateCache(2), xref(xrefA)
+GfxResources::GfxResources(XRef *xrefA, Dict *resDictA, GfxResources *nextA) : gStateCache(globalParams ? globalParams->getGStateCacheSize() : 2), xref(xrefA)
 {
     if (resDictA) {
 
@@ -249,22 +250,22 @@ GfxResources::GfxResources(XRef *xrefA, Dict *resDictA, GfxResources *nextA) : g
         fontDict = resDict->lookup("Font", &fontDictRef);
 
         // get XObject dictionary
-        xObjDict = resDict->lookup("XObject");
+        xObjDict = resDict->lookup(NameAtoms::XObject);
 
         // get color space dictionary
-        colorSpaceDict = resDict->lookup("ColorSpace");
+        colorSpaceDict = resDict->lookup(NameAtoms::ColorSpace);
 
         // get pattern dictionary
-        patternDict = resDict->lookup("Pattern");
+        patternDict = resDict->lookup(NameAtoms::Pattern);
 
         // get shading dictionary
-        shadingDict = resDict->lookup("Shading");
+        shadingDict = resDict->lookup(NameAtoms::Shading);
 
         // get graphics state parameter dictionary
-        gStateDict = resDict->lookup("ExtGState");
+        gStateDict = resDict->lookup(NameAtoms::ExtGState);
 
         // get properties dictionary
-        propertiesDict = resDict->lookup("Properties");
+        propertiesDict = resDict->lookup(NameAtoms::Properties);
 
     } else {
         xObjDict.setToNull();
@@ -394,9 +395,10 @@ std::unique_ptr<GfxShading> GfxResources::lookupShading(const char *name, Output
 
     for (resPtr = this; resPtr; resPtr = resPtr->next) {
         if (resPtr->shadingDict.isDict()) {
-            Object obj = resPtr->shadingDict.dictLookup(name);
+            Ref shadingRef = Ref::INVALID();
+            Object obj = resPtr->shadingDict.getDict()->lookup(name, &shadingRef);
             if (!obj.isNull()) {
-                return GfxShading::parse(resPtr, &obj, out, state);
+                return GfxShading::parse(resPtr, &obj, out, state, shadingRef);
             }
         }
     }
@@ -604,9 +606,20 @@ void Gfx::display(Object *obj, DisplayType displayType)
         return;
     }
     parser = new Parser(xref, obj, false);
+    // operands and inline image dictionaries don't outlive their operator,
+    // allocate them together; the arena serves the nested forms, patterns
+    // and glyphs as well and gives its memory back after the outermost
+    // content stream
+    if (!objectArena) {
+        objectArena.reset(new ObjectArena);
+    }
+    parser->setArena(objectArena.get());
     go(displayType);
     delete parser;
     parser = nullptr;
+    if (displayDepth == 0) {
+        objectArena->release();
+    }
 }
 
 void Gfx::go(DisplayType displayType)
@@ -4211,19 +4224,10 @@ void Gfx::doImage(Object *ref, Stream *str, bool inlineImg)
     bool maskInterpolate;
     bool hasAlpha;
     Stream *maskStr;
+    bool reducedImage = false;
+    std::array<double, 6> reducedImageMat;
     int i, n;
 
-    // get info from the stream
-    bits = 0;
-    csMode = streamCSNone;
-#if ENABLE_LIBOPENJPEG
-    if (str->getKind() == strJPX && out->supportJPXtransparency()) {
-        auto *jpxStream = dynamic_cast<JPXStream *>(str);
-        jpxStream->setSupportJPXtransparency(true);
-    }
-#endif
-    str->getImageParams(&bits, &csMode, &hasAlpha);
-
     // get stream dict
     dict = str->getDict();
 
@@ -4292,6 +4296,25 @@ void Gfx::doImage(Object *ref, Stream *str, bool inlineImg)
         goto err1;
     }
 
+#if ENABLE_LIBOPENJPEG
+    // before anything decodes the JPX image
+    if (str->getKind() == strJPX && out->supportJPXtransparency()) {
+        auto *jpxStream = dynamic_cast<JPXStream *>(str);
+        jpxStream->setSupportJPXtransparency(true);
+    }
+#endif
+
+    // only decode what will be visible, this has to happen before
+    // getImageParams() since that decodes JPX images
+    if (!mask && !inlineImg && ocState && !singular_matrix && out->needNonText() && !out->needFullResolutionImages() && dict->lookupNF("SMask").isNull() && dict->lookupNF("Mask").isNull()) {
+        reducedImage = reduceImageDecoding(str, &width, &height, &reducedImageMat);
+    }
+
+    // get info from the stream
+    bits = 0;
+    csMode = streamCSNone;
+    str->getImageParams(&bits, &csMode, &hasAlpha);
+
     // bit depth
     if (bits == 0) {
         obj1 = dict->lookup("BitsPerComponent");
@@ -4660,6 +4683,15 @@ void Gfx::doImage(Object *ref, Stream *str, bool inlineImg)
                 out->drawSoftMaskedImage(state, ref, str, width, height, &colorMap, interpolate, maskStr, maskWidth, maskHeight, maskColorMap.get(), maskInterpolate);
             } else if (haveExplicitMask) {
                 out->drawMaskedImage(state, ref, str, width, height, &colorMap, interpolate, maskStr, maskWidth, maskHeight, maskInvert, maskInterpolate);
+            } else if (reducedImage) {
+                // map the decoded part of the image where it belongs in the unit square
+                saveState();
+                state->concatCTM(reducedImageMat[0], reducedImageMat[1], reducedImageMat[2], reducedImageMat[3], reducedImageMat[4], reducedImageMat[5]);
+                out->updateCTM(state, reducedImageMat[0], reducedImageMat[1], reducedImageMat[2], reducedImageMat[3], reducedImageMat[4], reducedImageMat[5]);
+                out->drawImage(state, ref, str, width, height, &colorMap, interpolate, haveColorKeyMask ? maskColors : nullptr, inlineImg);
+                restoreState();
+                // the stream can be drawn again, e.g. from a pattern or a form
+                str->restoreFullResolution();
             } else {
                 out->drawImage(state, ref, str, width, height, &colorMap, interpolate, haveColorKeyMask ? maskColors : nullptr, inlineImg);
             }
@@ -4674,9 +4706,47 @@ void Gfx::doImage(Object *ref, Stream *str, bool inlineImg)
     return;
 
 err1:
+    if (reducedImage) {
+        str->restoreFullResolution();
+    }
     error(errSyntaxError, getPos(), "Bad image parameters");
 }
 
+// Asks <str> to only decode the part of the <width> x <height> image that
+// is inside the clip, at the resolution it will be shown at. Returns true if
+// it will, in which case <width> and <height> are updated with the size of
+// the decoded image, and <areaMat> maps it into its part of the unit square.
+bool Gfx::reduceImageDecoding(Stream *str, int *width, int *height, std::array<double, 6> *areaMat)
+{
+    const std::array<double, 6> &ctm = state->getCTM();
+    const int targetWidth = static_cast<int>(ceil(hypot(ctm[0], ctm[1])));
+    const int targetHeight = static_cast<int>(ceil(hypot(ctm[2], ctm[3])));
+
+    // the clip in user space is the visible part of the unit square,
+    // add a pixel around it for the image scaling filters
+    double xMin, yMin, xMax, yMax;
+    state->getUserClipBBox(&xMin, &yMin, &xMax, &yMax);
+    const int fullWidth = *width;
+    const int fullHeight = *height;
+    std::array<int, 4> area = { 0, 0, fullWidth, fullHeight };
+    if (xMin < xMax && yMin < yMax) {
+        area[0] = static_cast<int>(std::clamp(floor(xMin * fullWidth) - 1, 0.0, static_cast<double>(fullWidth)));
+        area[1] = static_cast<int>(std::clamp(floor((1 - yMax) * fullHeight) - 1, 0.0, static_cast<double>(fullHeight)));
+        area[2] = static_cast<int>(std::clamp(ceil(xMax * fullWidth) + 1, 0.0, static_cast<double>(fullWidth)));
+        area[3] = static_cast<int>(std::clamp(ceil((1 - yMin) * fullHeight) + 1, 0.0, static_cast<double>(fullHeight)));
+        if (area[0] >= area[2] || area[1] >= area[3]) {
+            area = { 0, 0, fullWidth, fullHeight };
+        }
+    }
+
+    if (!str->reduceResolution(width, height, targetWidth, targetHeight, &area)) {
+        return false;
+    }
+
+    *areaMat = { static_cast<double>(area[2] - area[0]) / fullWidth, 0, 0, static_cast<double>(area[3] - area[1]) / fullHeight, static_cast<double>(area[0]) / fullWidth, 1 - static_cast<double>(area[3]) / fullHeight };
+    return true;
+}
+
 bool Gfx::checkTransparencyGroup(Dict *resDict)
 {
     // check the effect of compositing objects as a group:
@@ -4972,7 +5042,7 @@ void Gfx::opBeginImage(Object /*args*/[], int /*numArgs*/)
 std::unique_ptr<Stream> Gfx::buildImageStream()
 {
     // build dictionary
-    Object dict(std::make_unique<Dict>(xref));
+    Object dict = parser->makeDict();
     Object obj = parser->getObj();
     while (!obj.isCmd("ID") && !obj.isEOF()) {
         if (!obj.isName()) {
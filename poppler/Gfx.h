@@ -40,6 +40,7 @@
 #include "poppler_private_export.h"
 #include "GfxState.h"
 #include "Object.h"
+#include "ObjectArena.h"
 #include "PopplerCache.h"
 
 #include <stack>
@@ -238,6 +239,7 @@ private:
     MarkedContentStack *mcStack; // current BMC/EMC stack
 
     Parser *parser; // parser for page content stream(s)
+    std::unique_ptr<ObjectArena, ObjectArena::Deleter> objectArena; // for the parsed operands
 
     std::set<int> formsDrawing; // the forms/patterns that are being drawn
     std::set<int> charProcDrawing; // the charProc that are being drawn
@@ -356,6 +358,7 @@ private:
     // XObject operators
     void opXObject(Object args[], int numArgs);
     void doImage(Object *ref, Stream *str, bool inlineImg);
+    bool reduceImageDecoding(Stream *str, int *width, int *height, std::array<double, 6> *areaMat);
     void doForm(Object *str);
 
     // in-line image operators
@@ -57,6 +57,7 @@
 #include <cstring>
 #include "goo/gfile.h"
 #include "goo/gmem.h"
+#include "goo/GooTargetClones.h"
 #include "Error.h"
 #include "Object.h"
 #include "Array.h"
@@ -169,11 +170,12 @@ static const char *gfxColorSpaceModeNames[] = { "DeviceGray", "CalGray", "Device
 
 #if USE_CMS
 
-static const std::map<unsigned int, unsigned int>::size_type CMSCACHE_LIMIT = 2048;
-
 #    include <lcms2.h>
 #    define LCMS_FLAGS (cmsFLAGS_NOOPTIMIZE | cmsFLAGS_BLACKPOINTCOMPENSATION)
 
+// most single colors cached per transform
+#    define CMSCACHE_LIMIT 2048
+
 static void lcmsprofiledeleter(void *profile)
 {
     cmsCloseProfile(profile);
@@ -199,6 +201,30 @@ GfxColorTransform::GfxColorTransform(void *transformA, int cmsIntentA, unsigned
     cmsIntent = cmsIntentA;
     inputPixelType = inputPixelTypeA;
     transformPixelType = transformPixelTypeA;
+
+    // tables only for chunky 8-bit formats, of up to four channels out;
+    // the interpolated ones only if asked for, as they are not exact
+    const cmsUInt32Number inFormat = cmsGetTransformInputFormat(transform);
+    const cmsUInt32Number outFormat = cmsGetTransformOutputFormat(transform);
+    const auto isByteFormat = [](cmsUInt32Number format) { return T_BYTES(format) == 1 && !T_FLOAT(format) && !T_PLANAR(format) && T_EXTRA(format) == 0; };
+    const int nIn = T_CHANNELS(inFormat);
+    const int nOut = T_CHANNELS(outFormat);
+    if (isByteFormat(inFormat) && isByteFormat(outFormat) && nIn >= 1 && nIn <= 4 && nOut >= 1 && nOut <= 4) {
+        cacheInChannels = nIn;
+        cacheOutChannels = nOut;
+    }
+    const bool interpolated = (nIn == 3 || nIn == 4) && globalParams && globalParams->getICCLookupTables();
+    if (isByteFormat(inFormat) && isByteFormat(outFormat) && (nIn == 1 || interpolated) && nOut >= 1 && nOut <= 4) {
+        lutInChannels = nIn;
+        lutOutChannels = nOut;
+        // divisors of 255, so that 0 and 255 are grid nodes
+        lutStep = nIn == 1 ? 1 : nIn == 3 ? 15 : 17;
+        lutGridPoints = 255 / lutStep + 1;
+        lutNodes = 1;
+        for (int i = 0; i < nIn; ++i) {
+            lutNodes *= lutGridPoints;
+        }
+    }
 }
 
 GfxColorTransform::~GfxColorTransform()
@@ -206,6 +232,151 @@ GfxColorTransform::~GfxColorTransform()
     cmsDeleteTransform(transform);
 }
 
+void GfxColorTransform::buildLUT()
+{
+    std::vector<unsigned char> nodes(static_cast<size_t>(lutNodes) * lutInChannels);
+    unsigned char *p = nodes.data();
+    for (unsigned int node = 0; node < lutNodes; ++node) {
+        unsigned int idx = node;
+        for (int i = lutInChannels - 1; i >= 0; --i) {
+            p[i] = static_cast<unsigned char>((idx % lutGridPoints) * lutStep);
+            idx /= lutGridPoints;
+        }
+        p += lutInChannels;
+    }
+    lut.resize(static_cast<size_t>(lutNodes) * lutOutChannels);
+    cmsDoTransform(transform, nodes.data(), lut.data(), lutNodes);
+}
+
+void GfxColorTransform::doCachedTransform(const unsigned char *in, unsigned char *out)
+{
+    unsigned int key = 0;
+    for (int i = 0; i < cacheInChannels; ++i) {
+        key = (key << 8) | in[i];
+    }
+    {
+        std::scoped_lock locker(colorCacheMutex);
+        const auto it = colorCache.find(key);
+        if (it != colorCache.end()) {
+            for (int i = 0; i < cacheOutChannels; ++i) {
+                out[i] = static_cast<unsigned char>(it->second >> (8 * i));
+            }
+            return;
+        }
+    }
+
+    doTransform(const_cast<unsigned char *>(in), out, 1);
+    unsigned int value = 0;
+    for (int i = 0; i < cacheOutChannels; ++i) {
+        value |= static_cast<unsigned int>(out[i]) << (8 * i);
+    }
+    std::scoped_lock locker(colorCacheMutex);
+    if (colorCache.size() < CMSCACHE_LIMIT) {
+        colorCache.emplace(key, value);
+    }
+}
+
+void GfxColorTransform::doLookupTransform(const unsigned char *in, unsigned char *out, unsigned int size)
+{
+    if (size == 1 && cacheInChannels > 0 && !lutBuilt.load(std::memory_order_acquire)) {
+        doCachedTransform(in, out);
+        return;
+    }
+    if (lutInChannels == 0) {
+        doTransform(const_cast<unsigned char *>(in), out, size);
+        return;
+    }
+    if (!lutBuilt.load(std::memory_order_acquire)) {
+        // building the table costs about as much as transforming as many
+        // pixels as it has nodes, don't for a few colors
+        if (lutPixels.fetch_add(size, std::memory_order_relaxed) + size < lutNodes) {
+            doTransform(const_cast<unsigned char *>(in), out, size);
+            return;
+        }
+        std::call_once(lutOnce, [this] {
+            buildLUT();
+            lutBuilt.store(true, std::memory_order_release);
+        });
+    }
+
+    const int nOut = lutOutChannels;
+    const unsigned char *table = lut.data();
+    if (lutInChannels == 1) {
+        for (unsigned int i = 0; i < size; ++i) {
+            memcpy(out, table + in[i] * nOut, nOut);
+            out += nOut;
+        }
+        return;
+    }
+
+    // colors are interpolated in the tetrahedron of the 3D grid holding
+    // them, with four channels in the grids of the two nearest values of
+    // the last one
+    const int step = lutStep;
+    const int lastNode = lutGridPoints - 1;
+    int strides[4];
+    strides[lutInChannels - 1] = nOut;
+    for (int c = lutInChannels - 2; c >= 0; --c) {
+        strides[c] = strides[c + 1] * lutGridPoints;
+    }
+    const auto locate = [step, lastNode](int v, int &node, int &frac) {
+        node = v / step;
+        frac = v - node * step;
+        if (node == lastNode) {
+            node = lastNode - 1;
+            frac = step;
+        }
+    };
+    for (unsigned int i = 0; i < size; ++i) {
+        int n[4], r[4];
+        for (int c = 0; c < lutInChannels; ++c) {
+            locate(in[c], n[c], r[c]);
+        }
+        // offsets of the tetrahedron's corners from the base node, and
+        // weights of the edges walked to reach them
+        int d1, d2, w1, w2, w3;
+        if (r[0] >= r[1]) {
+            if (r[1] >= r[2]) {
+                d1 = strides[0], d2 = strides[0] + strides[1], w1 = r[0], w2 = r[1], w3 = r[2];
+            } else if (r[0] >= r[2]) {
+                d1 = strides[0], d2 = strides[0] + strides[2], w1 = r[0], w2 = r[2], w3 = r[1];
+            } else {
+                d1 = strides[2], d2 = strides[0] + strides[2], w1 = r[2], w2 = r[0], w3 = r[1];
+            }
+        } else {
+            if (r[0] >= r[2]) {
+                d1 = strides[1], d2 = strides[0] + strides[1], w1 = r[1], w2 = r[0], w3 = r[2];
+            } else if (r[1] >= r[2]) {
+                d1 = strides[1], d2 = strides[1] + strides[2], w1 = r[1], w2 = r[2], w3 = r[0];
+            } else {
+                d1 = strides[2], d2 = strides[1] + strides[2], w1 = r[2], w2 = r[1], w3 = r[0];
+            }
+        }
+        const int d3 = strides[0] + strides[1] + strides[2];
+        int offset = 0;
+        for (int c = 0; c < lutInChannels; ++c) {
+            offset += n[c] * strides[c];
+        }
+        const unsigned char *base = table + offset;
+        // interpolated value, scaled by step
+        const auto tetrahedral = [=](const unsigned char *p) { return p[0] * step + (p[d1] - p[0]) * w1 + (p[d2] - p[d1]) * w2 + (p[d3] - p[d2]) * w3; };
+        if (lutInChannels == 3) {
+            for (int j = 0; j < nOut; ++j) {
+                out[j] = static_cast<unsigned char>((tetrahedral(base + j) + step / 2) / step);
+            }
+        } else {
+            const int step2 = step * step;
+            for (int j = 0; j < nOut; ++j) {
+                const int v0 = tetrahedral(base + j);
+                const int v1 = tetrahedral(base + strides[3] + j);
+                out[j] = static_cast<unsigned char>((v0 * step + (v1 - v0) * r[3] + step2 / 2) / step2);
+            }
+        }
+        in += lutInChannels;
+        out += nOut;
+    }
+}
+
 // convert color space signature to cmsColor type
 static unsigned int getCMSColorSpaceType(cmsColorSpaceSignature cs);
 static unsigned int getCMSNChannels(cmsColorSpaceSignature cs);
@@ -378,6 +549,96 @@ void GfxColorSpace::getDefaultRanges(double *decodeLow, double *decodeRange, int
     }
 }
 
+// Convert a line of pixels, as the line converters take them, with
+// <convert> applied to each pixel.  Runs of equal pixels are converted
+// once.
+template<int nOut, typename T, typename Convert>
+static void convertLineByPixel(const GfxColorSpace *cs, const unsigned char *in, T *out, int length, Convert convert)
+{
+    const int nComps = cs->getNComps();
+    double low[gfxColorMaxComps], range[gfxColorMaxComps];
+    unsigned char prev[gfxColorMaxComps];
+    GfxColor color;
+    T pixel[nOut];
+
+    cs->getDefaultRanges(low, range, 255);
+    for (int i = 0; i < length; ++i, in += nComps, out += nOut) {
+        // in and out may be the same line, so in is compared to a copy
+        if (i == 0 || memcmp(in, prev, nComps) != 0) {
+            memcpy(prev, in, nComps);
+            for (int k = 0; k < nComps; ++k) {
+                color.c[k] = dblToCol(low[k] + (in[k] * range[k]) / 255);
+            }
+            convert(color, pixel);
+        }
+        std::copy_n(pixel, nOut, out);
+    }
+}
+
+void GfxColorSpace::getGrayLine(unsigned char *in, unsigned char *out, int length)
+{
+    convertLineByPixel<1>(this, in, out, length, [this](const GfxColor &color, unsigned char *pixel) {
+        GfxGray gray;
+        getGray(&color, &gray);
+        pixel[0] = colToByte(gray);
+    });
+}
+
+void GfxColorSpace::getRGBLine(unsigned char *in, unsigned int *out, int length)
+{
+    convertLineByPixel<1>(this, in, out, length, [this](const GfxColor &color, unsigned int *pixel) {
+        GfxRGB rgb;
+        getRGB(&color, &rgb);
+        pixel[0] = (static_cast<unsigned int>(colToByte(rgb.r)) << 16) | (static_cast<unsigned int>(colToByte(rgb.g)) << 8) | colToByte(rgb.b);
+    });
+}
+
+void GfxColorSpace::getRGBLine(unsigned char *in, unsigned char *out, int length)
+{
+    convertLineByPixel<3>(this, in, out, length, [this](const GfxColor &color, unsigned char *pixel) {
+        GfxRGB rgb;
+        getRGB(&color, &rgb);
+        pixel[0] = colToByte(rgb.r);
+        pixel[1] = colToByte(rgb.g);
+        pixel[2] = colToByte(rgb.b);
+    });
+}
+
+void GfxColorSpace::getRGBXLine(unsigned char *in, unsigned char *out, int length)
+{
+    convertLineByPixel<4>(this, in, out, length, [this](const GfxColor &color, unsigned char *pixel) {
+        GfxRGB rgb;
+        getRGB(&color, &rgb);
+        pixel[0] = colToByte(rgb.r);
+        pixel[1] = colToByte(rgb.g);
+        pixel[2] = colToByte(rgb.b);
+        pixel[3] = 255;
+    });
+}
+
+void GfxColorSpace::getCMYKLine(unsigned char *in, unsigned char *out, int length)
+{
+    convertLineByPixel<4>(this, in, out, length, [this](const GfxColor &color, unsigned char *pixel) {
+        GfxCMYK cmyk;
+        getCMYK(&color, &cmyk);
+        pixel[0] = colToByte(cmyk.c);
+        pixel[1] = colToByte(cmyk.m);
+        pixel[2] = colToByte(cmyk.y);
+        pixel[3] = colToByte(cmyk.k);
+    });
+}
+
+void GfxColorSpace::getDeviceNLine(unsigned char *in, unsigned char *out, int length)
+{
+    convertLineByPixel<SPOT_NCOMPS + 4>(this, in, out, length, [this](const GfxColor &color, unsigned char *pixel) {
+        GfxColor deviceN;
+        getDeviceN(&color, &deviceN);
+        for (int j = 0; j < SPOT_NCOMPS + 4; ++j) {
+            pixel[j] = colToByte(deviceN.c[j]);
+        }
+    });
+}
+
 int GfxColorSpace::getNumColorSpaceModes()
 {
     return nGfxColorSpaceModes;
@@ -1306,52 +1567,78 @@ void GfxDeviceCMYKColorSpace::getRGB(const GfxColor *color, GfxRGB *rgb) const
     rgb->b = clip01(dblToCol(b));
 }
 
-static inline void GfxDeviceCMYKColorSpacegetRGBLineHelper(unsigned char *&in, double &r, double &g, double &b)
+// The CMYK to RGB line converters work on chunks of pixels copied to
+// local arrays, in loops with a fixed trip count that the compiler
+// vectorizes once cmykToRGBMatrixMultiplication is inlined.
+
+constexpr int cmykLineChunk = 64;
+
+// Convert <length> (at most cmykLineChunk) CMYK pixels to RGB, giving the
+// same bytes as dblToByte(clip01()) of the matrix multiplication.
+GOO_FLATTEN GOO_TARGET_CLONES static void cmykToRGBChunk(const unsigned char *in, unsigned char *out, int length)
 {
-    double c, m, y, k, c1, m1, y1, k1;
+    unsigned char cmyk[4 * cmykLineChunk] = {};
+    double c[cmykLineChunk], m[cmykLineChunk], y[cmykLineChunk], k[cmykLineChunk];
+    int r[cmykLineChunk], g[cmykLineChunk], b[cmykLineChunk];
+    unsigned char rgb[3 * cmykLineChunk];
 
-    c = byteToDbl(*in++);
-    m = byteToDbl(*in++);
-    y = byteToDbl(*in++);
-    k = byteToDbl(*in++);
-    c1 = 1 - c;
-    m1 = 1 - m;
-    y1 = 1 - y;
-    k1 = 1 - k;
-    cmykToRGBMatrixMultiplication(c, m, y, k, c1, m1, y1, k1, r, g, b);
+    memcpy(cmyk, in, 4 * length);
+    for (int i = 0; i < cmykLineChunk; ++i) {
+        c[i] = byteToDbl(cmyk[4 * i]);
+        m[i] = byteToDbl(cmyk[4 * i + 1]);
+        y[i] = byteToDbl(cmyk[4 * i + 2]);
+        k[i] = byteToDbl(cmyk[4 * i + 3]);
+    }
+    // clipping the truncated bytes rather than the values to [0, 1]
+    // gives the same result, with no branches
+    for (int i = 0; i < cmykLineChunk; ++i) {
+        double rd, gd, bd;
+        cmykToRGBMatrixMultiplication(c[i], m[i], y[i], k[i], 1 - c[i], 1 - m[i], 1 - y[i], 1 - k[i], rd, gd, bd);
+        r[i] = std::clamp(static_cast<int>(rd * 255.0), 0, 255);
+        g[i] = std::clamp(static_cast<int>(gd * 255.0), 0, 255);
+        b[i] = std::clamp(static_cast<int>(bd * 255.0), 0, 255);
+    }
+    for (int i = 0; i < cmykLineChunk; ++i) {
+        rgb[3 * i] = static_cast<unsigned char>(r[i]);
+        rgb[3 * i + 1] = static_cast<unsigned char>(g[i]);
+        rgb[3 * i + 2] = static_cast<unsigned char>(b[i]);
+    }
+    memcpy(out, rgb, 3 * length);
 }
 
 void GfxDeviceCMYKColorSpace::getRGBLine(unsigned char *in, unsigned int *out, int length)
 {
-    double r, g, b;
-    for (int i = 0; i < length; i++) {
-        GfxDeviceCMYKColorSpacegetRGBLineHelper(in, r, g, b);
-        *out++ = (dblToByte(clip01(r)) << 16) | (dblToByte(clip01(g)) << 8) | dblToByte(clip01(b));
+    unsigned char rgb[3 * cmykLineChunk];
+
+    for (int x = 0; x < length; x += cmykLineChunk) {
+        const int n = std::min(length - x, cmykLineChunk);
+        cmykToRGBChunk(in + 4 * x, rgb, n);
+        for (int i = 0; i < n; ++i) {
+            *out++ = (rgb[3 * i] << 16) | (rgb[3 * i + 1] << 8) | rgb[3 * i + 2];
+        }
     }
 }
 
 void GfxDeviceCMYKColorSpace::getRGBLine(unsigned char *in, unsigned char *out, int length)
 {
-    double r, g, b;
-
-    for (int i = 0; i < length; i++) {
-        GfxDeviceCMYKColorSpacegetRGBLineHelper(in, r, g, b);
-        *out++ = dblToByte(clip01(r));
-        *out++ = dblToByte(clip01(g));
-        *out++ = dblToByte(clip01(b));
+    for (int x = 0; x < length; x += cmykLineChunk) {
+        cmykToRGBChunk(in + 4 * x, out + 3 * x, std::min(length - x, cmykLineChunk));
     }
 }
 
 void GfxDeviceCMYKColorSpace::getRGBXLine(unsigned char *in, unsigned char *out, int length)
 {
-    double r, g, b;
+    unsigned char rgb[3 * cmykLineChunk];
 
-    for (int i = 0; i < length; i++) {
-        GfxDeviceCMYKColorSpacegetRGBLineHelper(in, r, g, b);
-        *out++ = dblToByte(clip01(r));
-        *out++ = dblToByte(clip01(g));
-        *out++ = dblToByte(clip01(b));
-        *out++ = 255;
+    for (int x = 0; x < length; x += cmykLineChunk) {
+        const int n = std::min(length - x, cmykLineChunk);
+        cmykToRGBChunk(in + 4 * x, rgb, n);
+        for (int i = 0; i < n; ++i) {
+            *out++ = rgb[3 * i];
+            *out++ = rgb[3 * i + 1];
+            *out++ = rgb[3 * i + 2];
+            *out++ = 255;
+        }
     }
 }
 
@@ -1867,28 +2154,8 @@ void GfxICCBasedColorSpace::getGray(const GfxColor *color, GfxGray *gray) const
                 in[i] = colToByte(color->c[i]);
             }
         }
-        if (nComps <= 4) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            auto it = cmsCache.find(key);
-            if (it != cmsCache.end()) {
-                unsigned int value = it->second;
-                *gray = byteToCol(value & 0xff);
-                return;
-            }
-        }
-        transform->doTransform(in, out, 1);
+        transform->doLookupTransform(in, out, 1);
         *gray = byteToCol(out[0]);
-        if (nComps <= 4 && cmsCache.size() <= CMSCACHE_LIMIT) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            unsigned int value = out[0];
-            cmsCache.insert(std::pair<unsigned int, unsigned int>(key, value));
-        }
     } else {
         GfxRGB rgb;
         getRGB(color, &rgb);
@@ -1915,32 +2182,10 @@ void GfxICCBasedColorSpace::getRGB(const GfxColor *color, GfxRGB *rgb) const
                 in[i] = colToByte(color->c[i]);
             }
         }
-        if (nComps <= 4) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            auto it = cmsCache.find(key);
-            if (it != cmsCache.end()) {
-                unsigned int value = it->second;
-                rgb->r = byteToCol(value >> 16);
-                rgb->g = byteToCol((value >> 8) & 0xff);
-                rgb->b = byteToCol(value & 0xff);
-                return;
-            }
-        }
-        transform->doTransform(in, out, 1);
+        transform->doLookupTransform(in, out, 1);
         rgb->r = byteToCol(out[0]);
         rgb->g = byteToCol(out[1]);
         rgb->b = byteToCol(out[2]);
-        if (nComps <= 4 && cmsCache.size() <= CMSCACHE_LIMIT) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            unsigned int value = (out[0] << 16) + (out[1] << 8) + out[2];
-            cmsCache.insert(std::pair<unsigned int, unsigned int>(key, value));
-        }
     } else if (transform != nullptr && transform->getTransformPixelType() == PT_CMYK) {
         unsigned char in[gfxColorMaxComps];
         unsigned char out[gfxColorMaxComps];
@@ -1955,21 +2200,7 @@ void GfxICCBasedColorSpace::getRGB(const GfxColor *color, GfxRGB *rgb) const
                 in[i] = colToByte(color->c[i]);
             }
         }
-        if (nComps <= 4) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            auto it = cmsCache.find(key);
-            if (it != cmsCache.end()) {
-                unsigned int value = it->second;
-                rgb->r = byteToCol(value >> 16);
-                rgb->g = byteToCol((value >> 8) & 0xff);
-                rgb->b = byteToCol(value & 0xff);
-                return;
-            }
-        }
-        transform->doTransform(in, out, 1);
+        transform->doLookupTransform(in, out, 1);
         c = byteToDbl(out[0]);
         m = byteToDbl(out[1]);
         y = byteToDbl(out[2]);
@@ -1982,14 +2213,6 @@ void GfxICCBasedColorSpace::getRGB(const GfxColor *color, GfxRGB *rgb) const
         rgb->r = clip01(dblToCol(r));
         rgb->g = clip01(dblToCol(g));
         rgb->b = clip01(dblToCol(b));
-        if (nComps <= 4 && cmsCache.size() <= CMSCACHE_LIMIT) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            unsigned int value = (dblToByte(r) << 16) + (dblToByte(g) << 8) + dblToByte(b);
-            cmsCache.insert(std::pair<unsigned int, unsigned int>(key, value));
-        }
     } else {
         alt->getRGB(color, rgb);
     }
@@ -2003,7 +2226,7 @@ void GfxICCBasedColorSpace::getRGBLine(unsigned char *in, unsigned int *out, int
 #if USE_CMS
     if (lineTransform != nullptr && lineTransform->getTransformPixelType() == PT_RGB) {
         auto *tmp = static_cast<unsigned char *>(gmallocn(3 * length, sizeof(unsigned char)));
-        lineTransform->doTransform(in, tmp, length);
+        lineTransform->doLookupTransform(in, tmp, length);
         for (int i = 0; i < length; ++i) {
             unsigned char *current = tmp + (i * 3);
             out[i] = (current[0] << 16) | (current[1] << 8) | current[2];
@@ -2022,7 +2245,7 @@ void GfxICCBasedColorSpace::getRGBLine(unsigned char *in, unsigned char *out, in
 #if USE_CMS
     if (lineTransform != nullptr && lineTransform->getTransformPixelType() == PT_RGB) {
         auto *tmp = static_cast<unsigned char *>(gmallocn(3 * length, sizeof(unsigned char)));
-        lineTransform->doTransform(in, tmp, length);
+        lineTransform->doLookupTransform(in, tmp, length);
         unsigned char *current = tmp;
         for (int i = 0; i < length; ++i) {
             *out++ = *current++;
@@ -2032,7 +2255,7 @@ void GfxICCBasedColorSpace::getRGBLine(unsigned char *in, unsigned char *out, in
         gfree(tmp);
     } else if (lineTransform != nullptr && lineTransform->getTransformPixelType() == PT_CMYK) {
         auto *tmp = static_cast<unsigned char *>(gmallocn(4 * length, sizeof(unsigned char)));
-        lineTransform->doTransform(in, tmp, length);
+        lineTransform->doLookupTransform(in, tmp, length);
         unsigned char *current = tmp;
         double c, m, y, k, c1, m1, y1, k1, r, g, b;
         for (int i = 0; i < length; ++i) {
@@ -2063,7 +2286,7 @@ void GfxICCBasedColorSpace::getRGBXLine(unsigned char *in, unsigned char *out, i
 #if USE_CMS
     if (lineTransform != nullptr && lineTransform->getTransformPixelType() == PT_RGB) {
         auto *tmp = static_cast<unsigned char *>(gmallocn(3 * length, sizeof(unsigned char)));
-        lineTransform->doTransform(in, tmp, length);
+        lineTransform->doLookupTransform(in, tmp, length);
         unsigned char *current = tmp;
         for (int i = 0; i < length; ++i) {
             *out++ = *current++;
@@ -2084,7 +2307,7 @@ void GfxICCBasedColorSpace::getCMYKLine(unsigned char *in, unsigned char *out, i
 {
 #if USE_CMS
     if (lineTransform != nullptr && lineTransform->getTransformPixelType() == PT_CMYK) {
-        transform->doTransform(in, out, length);
+        transform->doLookupTransform(in, out, length);
     } else if (lineTransform != nullptr && nComps != 4) {
         GfxColorComp c, m, y, k;
         auto *tmp = static_cast<unsigned char *>(gmallocn(3 * length, sizeof(unsigned char)));
@@ -2120,7 +2343,7 @@ void GfxICCBasedColorSpace::getDeviceNLine(unsigned char *in, unsigned char *out
 #if USE_CMS
     if (lineTransform != nullptr && lineTransform->getTransformPixelType() == PT_CMYK) {
         auto *tmp = static_cast<unsigned char *>(gmallocn(4 * length, sizeof(unsigned char)));
-        transform->doTransform(in, tmp, length);
+        transform->doLookupTransform(in, tmp, length);
         unsigned char *p = tmp;
         for (int i = 0; i < length; i++) {
             for (int j = 0; j < 4; j++) {
@@ -2181,34 +2404,11 @@ void GfxICCBasedColorSpace::getCMYK(const GfxColor *color, GfxCMYK *cmyk) const
                 in[i] = colToByte(color->c[i]);
             }
         }
-        if (nComps <= 4) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            auto it = cmsCache.find(key);
-            if (it != cmsCache.end()) {
-                unsigned int value = it->second;
-                cmyk->c = byteToCol(value >> 24);
-                cmyk->m = byteToCol((value >> 16) & 0xff);
-                cmyk->y = byteToCol((value >> 8) & 0xff);
-                cmyk->k = byteToCol(value & 0xff);
-                return;
-            }
-        }
-        transform->doTransform(in, out, 1);
+        transform->doLookupTransform(in, out, 1);
         cmyk->c = byteToCol(out[0]);
         cmyk->m = byteToCol(out[1]);
         cmyk->y = byteToCol(out[2]);
         cmyk->k = byteToCol(out[3]);
-        if (nComps <= 4 && cmsCache.size() <= CMSCACHE_LIMIT) {
-            unsigned int key = 0;
-            for (int j = 0; j < nComps; j++) {
-                key = (key << 8) + in[j];
-            }
-            unsigned int value = (out[0] << 24) + (out[1] << 16) + (out[2] << 8) + out[3];
-            cmsCache.insert(std::pair<unsigned int, unsigned int>(key, value));
-        }
     } else if (nComps != 4 && transform != nullptr && transform->getTransformPixelType() == PT_RGB) {
         GfxRGB rgb;
         GfxColorComp c, m, y, k;
@@ -2236,33 +2436,6 @@ void GfxICCBasedColorSpace::getCMYK(const GfxColor *color, GfxCMYK *cmyk) const
 #endif
 }
 
-bool GfxICCBasedColorSpace::useGetRGBLine() const
-{
-#if USE_CMS
-    return lineTransform != nullptr || alt->useGetRGBLine();
-#else
-    return alt->useGetRGBLine();
-#endif
-}
-
-bool GfxICCBasedColorSpace::useGetCMYKLine() const
-{
-#if USE_CMS
-    return lineTransform != nullptr || alt->useGetCMYKLine();
-#else
-    return alt->useGetCMYKLine();
-#endif
-}
-
-bool GfxICCBasedColorSpace::useGetDeviceNLine() const
-{
-#if USE_CMS
-    return lineTransform != nullptr || alt->useGetDeviceNLine();
-#else
-    return alt->useGetDeviceNLine();
-#endif
-}
-
 void GfxICCBasedColorSpace::getDeviceN(const GfxColor *color, GfxColor *deviceN) const
 {
     GfxCMYK cmyk;
@@ -3300,8 +3473,9 @@ std::unique_ptr<GfxShadingPattern> GfxShadingPattern::parse(GfxResources *res, O
     }
     dict = patObj->getDict();
 
-    obj1 = dict->lookup("Shading");
-    std::unique_ptr<GfxShading> shadingA = GfxShading::parse(res, &obj1, out, state);
+    Ref shadingRef = Ref::INVALID();
+    obj1 = dict->lookup("Shading", &shadingRef);
+    std::unique_ptr<GfxShading> shadingA = GfxShading::parse(res, &obj1, out, state, shadingRef);
     if (!shadingA) {
         return {};
     }
@@ -3344,6 +3518,7 @@ std::unique_ptr<GfxPattern> GfxShadingPattern::copy() const
 GfxShading::GfxShading(int typeA)
 {
     type = static_cast<ShadingType>(typeA);
+    ref = Ref::INVALID();
 }
 
 GfxShading::GfxShading(const GfxShading *shading)
@@ -3361,15 +3536,17 @@ GfxShading::GfxShading(const GfxShading *shading)
     bbox_xMax = shading->bbox_xMax;
     bbox_yMax = shading->bbox_yMax;
     hasBBox = shading->hasBBox;
+    ref = shading->ref;
 }
 
 GfxShading::~GfxShading() = default;
 
-std::unique_ptr<GfxShading> GfxShading::parse(GfxResources *res, Object *obj, OutputDev *out, GfxState *state)
+std::unique_ptr<GfxShading> GfxShading::parse(GfxResources *res, Object *obj, OutputDev *out, GfxState *state, Ref refA)
 {
     Dict *dict;
     int typeA;
     Object obj1;
+    std::unique_ptr<GfxShading> shading;
 
     if (obj->isDict()) {
         dict = obj->getDict();
@@ -3388,38 +3565,38 @@ std::unique_ptr<GfxShading> GfxShading::parse(GfxResources *res, Object *obj, Ou
 
     switch (typeA) {
     case 1:
-        return GfxFunctionShading::parse(res, dict, out, state);
+        shading = GfxFunctionShading::parse(res, dict, out, state);
         break;
     case 2:
-        return GfxAxialShading::parse(res, dict, out, state);
+        shading = GfxAxialShading::parse(res, dict, out, state);
         break;
     case 3:
-        return GfxRadialShading::parse(res, dict, out, state);
+        shading = GfxRadialShading::parse(res, dict, out, state);
         break;
     case 4:
         if (obj->isStream()) {
-            return GfxGouraudTriangleShading::parse(res, 4, dict, obj->getStream(), out, state);
+            shading = GfxGouraudTriangleShading::parse(res, 4, dict, obj->getStream(), out, state);
         } else {
             error(errSyntaxWarning, -1, "Invalid Type 4 shading object");
         }
         break;
     case 5:
         if (obj->isStream()) {
-            return GfxGouraudTriangleShading::parse(res, 5, dict, obj->getStream(), out, state);
+            shading = GfxGouraudTriangleShading::parse(res, 5, dict, obj->getStream(), out, state);
         } else {
             error(errSyntaxWarning, -1, "Invalid Type 5 shading object");
         }
         break;
     case 6:
         if (obj->isStream()) {
-            return GfxPatchMeshShading::parse(res, 6, dict, obj->getStream(), out, state);
+            shading = GfxPatchMeshShading::parse(res, 6, dict, obj->getStream(), out, state);
         } else {
             error(errSyntaxWarning, -1, "Invalid Type 6 shading object");
         }
         break;
     case 7:
         if (obj->isStream()) {
-            return GfxPatchMeshShading::parse(res, 7, dict, obj->getStream(), out, state);
+            shading = GfxPatchMeshShading::parse(res, 7, dict, obj->getStream(), out, state);
         } else {
             error(errSyntaxWarning, -1, "Invalid Type 7 shading object");
         }
@@ -3427,7 +3604,10 @@ std::unique_ptr<GfxShading> GfxShading::parse(GfxResources *res, Object *obj, Ou
     default:
         error(errSyntaxWarning, -1, "Unimplemented shading type {0:d}", typeA);
     }
-    return {};
+    if (shading) {
+        shading->ref = refA;
+    }
+    return shading;
 }
 
 bool GfxShading::init(GfxResources *res, Dict *dict, OutputDev *out, GfxState *state)
@@ -3730,6 +3910,36 @@ int GfxUnivariateShading::getColor(double t, GfxColor *color)
     return nComps;
 }
 
+int GfxUnivariateShading::getColorBatch(const double *t, GfxColor *colors, int n)
+{
+    if (unlikely(getNFuncs() < 1 || n <= 0)) {
+        return 0;
+    }
+
+    const int nComps = getNFuncs() * funcs[0]->getOutputSize();
+    std::vector<double> out(static_cast<size_t>(n) * nComps);
+
+    if (getNFuncs() == 1) {
+        funcs[0]->transformBatch(t, out.data(), n);
+    } else {
+        // one output per function, interleaved into out
+        std::vector<double> values(n);
+        for (int i = 0; i < getNFuncs(); ++i) {
+            funcs[i]->transformBatch(t, values.data(), n);
+            for (int j = 0; j < n; ++j) {
+                out[j * nComps + i] = values[j];
+            }
+        }
+    }
+
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < nComps; ++i) {
+            colors[j].c[i] = dblToCol(out[j * nComps + i]);
+        }
+    }
+    return nComps;
+}
+
 void GfxUnivariateShading::setupCache(const Matrix *ctm, double xMin, double yMin, double xMax, double yMax)
 {
     double sMin, sMax, tMin, tMax, upperBound;
@@ -3802,12 +4012,17 @@ void GfxUnivariateShading::setupCache(const Matrix *ctm, double xMin, double yMi
         for (j = 0; j < cacheSize; ++j) {
             cacheBounds[j] = tMin + j * step;
             cacheCoeff[j] = coeff;
-
-            for (i = 0; i < nComps; ++i) {
-                cacheValues[j * nComps + i] = 0;
-            }
+        }
+        if (getNFuncs() == 1) {
+            funcs[0]->transformBatch(cacheBounds, cacheValues, cacheSize);
+        } else {
+            // one output per function, interleaved into cacheValues
+            std::vector<double> values(cacheSize);
             for (i = 0; i < getNFuncs(); ++i) {
-                funcs[i]->transform(&cacheBounds[j], &cacheValues[j * nComps + i]);
+                funcs[i]->transformBatch(cacheBounds, values.data(), cacheSize);
+                for (j = 0; j < cacheSize; ++j) {
+                    cacheValues[j * nComps + i] = values[j];
+                }
             }
         }
     }
@@ -5546,10 +5761,6 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode, std::unique_ptr<Gf
         nComps2 = colorSpace2->getNComps();
         indexedLookup = indexedCS->getLookup();
         colorSpace2->getDefaultRanges(x, y, indexHigh);
-        if (colorSpace2->useGetGrayLine() || colorSpace2->useGetRGBLine() || colorSpace2->useGetCMYKLine() || colorSpace2->useGetDeviceNLine()) {
-            byte_lookup = static_cast<unsigned char *>(gmallocn((maxPixel + 1), nComps2));
-            useByteLookup = true;
-        }
         for (k = 0; k < nComps2; ++k) {
             lookup2[k] = static_cast<GfxColorComp *>(gmallocn(maxPixel + 1, sizeof(GfxColorComp)));
             for (i = 0; i <= maxPixel; ++i) {
@@ -5562,9 +5773,6 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode, std::unique_ptr<Gf
 
                 mapped = x[k] + (indexedLookup[j * nComps2 + k] / 255.0) * y[k];
                 lookup2[k][i] = dblToCol(mapped);
-                if (useByteLookup) {
-                    byte_lookup[i * nComps2 + k] = static_cast<unsigned char>(mapped * 255);
-                }
             }
         }
         break;
@@ -5574,27 +5782,29 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode, std::unique_ptr<Gf
         colorSpace2 = sepCS->getAlt();
         nComps2 = colorSpace2->getNComps();
         sepFunc = sepCS->getFunc();
-        if (colorSpace2->useGetGrayLine() || colorSpace2->useGetRGBLine() || colorSpace2->useGetCMYKLine() || colorSpace2->useGetDeviceNLine()) {
-            byte_lookup = static_cast<unsigned char *>(gmallocn((maxPixel + 1), nComps2));
-            useByteLookup = true;
+        std::vector<double> sepIn(maxPixel + 1);
+        for (i = 0; i <= maxPixel; ++i) {
+            sepIn[i] = decodeLow[0] + (i * decodeRange[0]) / maxPixel;
         }
+        const int sepNOut = sepFunc->getOutputSize();
+        std::vector<double> sepOut(static_cast<size_t>(maxPixel + 1) * sepNOut);
+        sepFunc->transformBatch(sepIn.data(), sepOut.data(), maxPixel + 1);
         for (k = 0; k < nComps2; ++k) {
             lookup2[k] = static_cast<GfxColorComp *>(gmallocn(maxPixel + 1, sizeof(GfxColorComp)));
             for (i = 0; i <= maxPixel; ++i) {
-                x[0] = decodeLow[0] + (i * decodeRange[0]) / maxPixel;
-                sepFunc->transform(x, y);
-                lookup2[k][i] = dblToCol(y[k]);
-                if (useByteLookup) {
-                    byte_lookup[i * nComps2 + k] = static_cast<unsigned char>(y[k] * 255);
-                }
+                lookup2[k][i] = dblToCol(k < sepNOut ? sepOut[i * sepNOut + k] : 0);
             }
         }
         break;
     }
     default:
-        if ((!decode->isNull() || maxPixel != 255) && (colorSpace->useGetGrayLine() || (colorSpace->useGetRGBLine() && !decode->isNull()) || colorSpace->useGetCMYKLine() || colorSpace->useGetDeviceNLine())) {
+        // one-component maps convert lines with a palette; the others map
+        // the pixels to bytes spanning the color space's default ranges,
+        // unless they already are
+        if (nComps > 1 && (!decode->isNull() || maxPixel != 255)) {
             byte_lookup = static_cast<unsigned char *>(gmallocn((maxPixel + 1), nComps));
             useByteLookup = true;
+            colorSpace->getDefaultRanges(x, y, 255);
         }
         for (k = 0; k < nComps; ++k) {
             lookup2[k] = static_cast<GfxColorComp *>(gmallocn(maxPixel + 1, sizeof(GfxColorComp)));
@@ -5602,15 +5812,8 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode, std::unique_ptr<Gf
                 mapped = decodeLow[k] + (i * decodeRange[k]) / maxPixel;
                 lookup2[k][i] = dblToCol(mapped);
                 if (useByteLookup) {
-                    int byte;
-
-                    byte = static_cast<int>(mapped * 255.0 + 0.5);
-                    if (byte < 0) {
-                        byte = 0;
-                    } else if (byte > 255) {
-                        byte = 255;
-                    }
-                    byte_lookup[i * nComps + k] = byte;
+                    const double byte = y[k] != 0 ? (mapped - x[k]) / y[k] * 255.0 + 0.5 : 0;
+                    byte_lookup[i * nComps + k] = static_cast<unsigned char>(std::clamp(byte, 0.0, 255.0));
                 }
             }
         }
@@ -5638,7 +5841,8 @@ GfxImageColorMap::GfxImageColorMap(const GfxImageColorMap *colorMap)
         lookup2[k] = nullptr;
     }
     byte_lookup = nullptr;
-    n = 1 << bits;
+    // the tables stop at 255, as for 16 bit images
+    n = std::min(1 << bits, 256);
     for (k = 0; k < nComps; ++k) {
         lookup[k] = static_cast<GfxColorComp *>(gmallocn(n, sizeof(GfxColorComp)));
         memcpy(lookup[k], colorMap->lookup[k], n * sizeof(GfxColorComp));
@@ -5721,307 +5925,152 @@ void GfxImageColorMap::getRGB(const unsigned char *x, GfxRGB *rgb)
     }
 }
 
-void GfxImageColorMap::getGrayLine(unsigned char *in, unsigned char *out, int length)
+const unsigned char *GfxImageColorMap::getLinePalette(LinePalette palette)
 {
-    int i, j;
-    unsigned char *inp, *tmp_line;
-
-    if ((colorSpace2 && !colorSpace2->useGetGrayLine()) || (!colorSpace2 && !colorSpace->useGetGrayLine())) {
-        GfxGray gray;
-
-        inp = in;
-        for (i = 0; i < length; i++) {
-            getGray(inp, &gray);
-            out[i] = colToByte(gray);
-            inp += nComps;
-        }
-        return;
+    static constexpr int paletteComps[nLinePalettes] = { 1, 3, 4, SPOT_NCOMPS + 4 };
+    std::vector<unsigned char> &entries = linePalettes[palette];
+    if (!entries.empty()) {
+        return entries.data();
     }
 
-    switch (colorSpace->getMode()) {
-    case csIndexed:
-    case csSeparation:
-        tmp_line = static_cast<unsigned char *>(gmallocn(length, nComps2));
-        for (i = 0; i < length; i++) {
-            for (j = 0; j < nComps2; j++) {
-                unsigned char c = in[i];
-                if (byte_lookup) {
-                    c = byte_lookup[c * nComps2 + j];
-                }
-                tmp_line[i * nComps2 + j] = c;
-            }
+    // pixels above the max pixel value, which only broken streams have,
+    // get the color of the max value
+    const int n = paletteComps[palette];
+    const int maxPixel = std::min((1 << bits) - 1, 255);
+    entries.resize(256 * n);
+    for (int i = 0; i < 256; ++i) {
+        const unsigned char pix = static_cast<unsigned char>(std::min(i, maxPixel));
+        unsigned char *entry = &entries[i * n];
+        switch (palette) {
+        case linePaletteGray: {
+            GfxGray gray;
+            getGray(&pix, &gray);
+            entry[0] = colToByte(gray);
+            break;
         }
-        colorSpace2->getGrayLine(tmp_line, out, length);
-        gfree(tmp_line);
-        break;
-
-    default:
-        if (byte_lookup) {
-            inp = in;
-            for (j = 0; j < length; j++) {
-                for (i = 0; i < nComps; i++) {
-                    *inp = byte_lookup[*inp * nComps + i];
-                    inp++;
-                }
+        case linePaletteRGB: {
+            GfxRGB rgb;
+            getRGB(&pix, &rgb);
+            entry[0] = colToByte(rgb.r);
+            entry[1] = colToByte(rgb.g);
+            entry[2] = colToByte(rgb.b);
+            break;
+        }
+        case linePaletteCMYK: {
+            GfxCMYK cmyk;
+            getCMYK(&pix, &cmyk);
+            entry[0] = colToByte(cmyk.c);
+            entry[1] = colToByte(cmyk.m);
+            entry[2] = colToByte(cmyk.y);
+            entry[3] = colToByte(cmyk.k);
+            break;
+        }
+        case linePaletteDeviceN: {
+            GfxColor deviceN;
+            getDeviceN(&pix, &deviceN);
+            for (int j = 0; j < n; ++j) {
+                entry[j] = colToByte(deviceN.c[j]);
             }
+            break;
+        }
+        case nLinePalettes:
+            break;
         }
-        colorSpace->getGrayLine(in, out, length);
-        break;
     }
+    return entries.data();
 }
 
-void GfxImageColorMap::getRGBLine(unsigned char *in, unsigned int *out, int length)
+void GfxImageColorMap::applyByteLookup(unsigned char *in, int length) const
 {
-    int i, j;
-    unsigned char *inp, *tmp_line;
-
-    if (!useRGBLine()) {
-        GfxRGB rgb;
-
-        inp = in;
-        for (i = 0; i < length; i++) {
-            getRGB(inp, &rgb);
-            out[i] = (static_cast<int>(colToByte(rgb.r)) << 16) | (static_cast<int>(colToByte(rgb.g)) << 8) | (static_cast<int>(colToByte(rgb.b)) << 0);
-            inp += nComps;
-        }
+    if (!byte_lookup) {
         return;
     }
-
-    switch (colorSpace->getMode()) {
-    case csIndexed:
-    case csSeparation:
-        tmp_line = static_cast<unsigned char *>(gmallocn(length, nComps2));
-        for (i = 0; i < length; i++) {
-            for (j = 0; j < nComps2; j++) {
-                unsigned char c = in[i];
-                if (byte_lookup) {
-                    c = byte_lookup[c * nComps2 + j];
-                }
-                tmp_line[i * nComps2 + j] = c;
-            }
+    for (int j = 0; j < length; j++) {
+        for (int i = 0; i < nComps; i++) {
+            *in = byte_lookup[*in * nComps + i];
+            in++;
         }
-        colorSpace2->getRGBLine(tmp_line, out, length);
-        gfree(tmp_line);
-        break;
-
-    default:
-        if (byte_lookup) {
-            inp = in;
-            for (j = 0; j < length; j++) {
-                for (i = 0; i < nComps; i++) {
-                    *inp = byte_lookup[*inp * nComps + i];
-                    inp++;
-                }
-            }
-        }
-        colorSpace->getRGBLine(in, out, length);
-        break;
     }
 }
 
-void GfxImageColorMap::getRGBLine(unsigned char *in, unsigned char *out, int length)
+void GfxImageColorMap::getGrayLine(unsigned char *in, unsigned char *out, int length)
 {
-    int i, j;
-    unsigned char *inp, *tmp_line;
-
-    if (!useRGBLine()) {
-        GfxRGB rgb;
-
-        inp = in;
-        for (i = 0; i < length; i++) {
-            getRGB(inp, &rgb);
-            *out++ = colToByte(rgb.r);
-            *out++ = colToByte(rgb.g);
-            *out++ = colToByte(rgb.b);
-            inp += nComps;
+    if (nComps == 1) {
+        const unsigned char *palette = getLinePalette(linePaletteGray);
+        for (int i = 0; i < length; i++) {
+            out[i] = palette[in[i]];
         }
         return;
     }
+    applyByteLookup(in, length);
+    colorSpace->getGrayLine(in, out, length);
+}
 
-    switch (colorSpace->getMode()) {
-    case csIndexed:
-    case csSeparation:
-        tmp_line = static_cast<unsigned char *>(gmallocn(length, nComps2));
-        for (i = 0; i < length; i++) {
-            for (j = 0; j < nComps2; j++) {
-                unsigned char c = in[i];
-                if (byte_lookup) {
-                    c = byte_lookup[c * nComps2 + j];
-                }
-                tmp_line[i * nComps2 + j] = c;
-            }
-        }
-        colorSpace2->getRGBLine(tmp_line, out, length);
-        gfree(tmp_line);
-        break;
-
-    default:
-        if (byte_lookup) {
-            inp = in;
-            for (j = 0; j < length; j++) {
-                for (i = 0; i < nComps; i++) {
-                    *inp = byte_lookup[*inp * nComps + i];
-                    inp++;
-                }
-            }
+void GfxImageColorMap::getRGBLine(unsigned char *in, unsigned int *out, int length)
+{
+    if (nComps == 1) {
+        const unsigned char *palette = getLinePalette(linePaletteRGB);
+        for (int i = 0; i < length; i++) {
+            const unsigned char *rgb = &palette[3 * in[i]];
+            out[i] = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
         }
-        colorSpace->getRGBLine(in, out, length);
-        break;
+        return;
     }
+    applyByteLookup(in, length);
+    colorSpace->getRGBLine(in, out, length);
 }
 
-void GfxImageColorMap::getRGBXLine(unsigned char *in, unsigned char *out, int length)
+void GfxImageColorMap::getRGBLine(unsigned char *in, unsigned char *out, int length)
 {
-    int i, j;
-    unsigned char *inp, *tmp_line;
-
-    if (!useRGBLine()) {
-        GfxRGB rgb;
-
-        inp = in;
-        for (i = 0; i < length; i++) {
-            getRGB(inp, &rgb);
-            *out++ = colToByte(rgb.r);
-            *out++ = colToByte(rgb.g);
-            *out++ = colToByte(rgb.b);
-            *out++ = 255;
-            inp += nComps;
+    if (nComps == 1) {
+        const unsigned char *palette = getLinePalette(linePaletteRGB);
+        for (int i = 0; i < length; i++) {
+            memcpy(out + 3 * i, &palette[3 * in[i]], 3);
         }
         return;
     }
+    applyByteLookup(in, length);
+    colorSpace->getRGBLine(in, out, length);
+}
 
-    switch (colorSpace->getMode()) {
-    case csIndexed:
-    case csSeparation:
-        tmp_line = static_cast<unsigned char *>(gmallocn(length, nComps2));
-        for (i = 0; i < length; i++) {
-            for (j = 0; j < nComps2; j++) {
-                unsigned char c = in[i];
-                if (byte_lookup) {
-                    c = byte_lookup[c * nComps2 + j];
-                }
-                tmp_line[i * nComps2 + j] = c;
-            }
-        }
-        colorSpace2->getRGBXLine(tmp_line, out, length);
-        gfree(tmp_line);
-        break;
-
-    default:
-        if (byte_lookup) {
-            inp = in;
-            for (j = 0; j < length; j++) {
-                for (i = 0; i < nComps; i++) {
-                    *inp = byte_lookup[*inp * nComps + i];
-                    inp++;
-                }
-            }
+void GfxImageColorMap::getRGBXLine(unsigned char *in, unsigned char *out, int length)
+{
+    if (nComps == 1) {
+        const unsigned char *palette = getLinePalette(linePaletteRGB);
+        for (int i = 0; i < length; i++) {
+            memcpy(out + 4 * i, &palette[3 * in[i]], 3);
+            out[4 * i + 3] = 255;
         }
-        colorSpace->getRGBXLine(in, out, length);
-        break;
+        return;
     }
+    applyByteLookup(in, length);
+    colorSpace->getRGBXLine(in, out, length);
 }
 
 void GfxImageColorMap::getCMYKLine(unsigned char *in, unsigned char *out, int length)
 {
-    int i, j;
-    unsigned char *inp, *tmp_line;
-
-    if (!useCMYKLine()) {
-        GfxCMYK cmyk;
-
-        inp = in;
-        for (i = 0; i < length; i++) {
-            getCMYK(inp, &cmyk);
-            *out++ = colToByte(cmyk.c);
-            *out++ = colToByte(cmyk.m);
-            *out++ = colToByte(cmyk.y);
-            *out++ = colToByte(cmyk.k);
-            inp += nComps;
+    if (nComps == 1) {
+        const unsigned char *palette = getLinePalette(linePaletteCMYK);
+        for (int i = 0; i < length; i++) {
+            memcpy(out + 4 * i, &palette[4 * in[i]], 4);
         }
         return;
     }
-
-    switch (colorSpace->getMode()) {
-    case csIndexed:
-    case csSeparation:
-        tmp_line = static_cast<unsigned char *>(gmallocn(length, nComps2));
-        for (i = 0; i < length; i++) {
-            for (j = 0; j < nComps2; j++) {
-                unsigned char c = in[i];
-                if (byte_lookup) {
-                    c = byte_lookup[c * nComps2 + j];
-                }
-                tmp_line[i * nComps2 + j] = c;
-            }
-        }
-        colorSpace2->getCMYKLine(tmp_line, out, length);
-        gfree(tmp_line);
-        break;
-
-    default:
-        if (byte_lookup) {
-            inp = in;
-            for (j = 0; j < length; j++) {
-                for (i = 0; i < nComps; i++) {
-                    *inp = byte_lookup[*inp * nComps + i];
-                    inp++;
-                }
-            }
-        }
-        colorSpace->getCMYKLine(in, out, length);
-        break;
-    }
+    applyByteLookup(in, length);
+    colorSpace->getCMYKLine(in, out, length);
 }
 
 void GfxImageColorMap::getDeviceNLine(unsigned char *in, unsigned char *out, int length)
 {
-    unsigned char *inp, *tmp_line;
-
-    if (!useDeviceNLine()) {
-        GfxColor deviceN;
-
-        inp = in;
+    if (nComps == 1) {
+        const unsigned char *palette = getLinePalette(linePaletteDeviceN);
         for (int i = 0; i < length; i++) {
-            getDeviceN(inp, &deviceN);
-            for (int j = 0; j < SPOT_NCOMPS + 4; j++) {
-                *out++ = deviceN.c[j];
-            }
-            inp += nComps;
+            memcpy(out + (SPOT_NCOMPS + 4) * i, &palette[(SPOT_NCOMPS + 4) * in[i]], SPOT_NCOMPS + 4);
         }
         return;
     }
-
-    switch (colorSpace->getMode()) {
-    case csIndexed:
-    case csSeparation:
-        tmp_line = static_cast<unsigned char *>(gmallocn(length, nComps2));
-        for (int i = 0; i < length; i++) {
-            for (int j = 0; j < nComps2; j++) {
-                unsigned char c = in[i];
-                if (byte_lookup) {
-                    c = byte_lookup[c * nComps2 + j];
-                }
-                tmp_line[i * nComps2 + j] = c;
-            }
-        }
-        colorSpace2->getDeviceNLine(tmp_line, out, length);
-        gfree(tmp_line);
-        break;
-
-    default:
-        if (byte_lookup) {
-            inp = in;
-            for (int j = 0; j < length; j++) {
-                for (int i = 0; i < nComps; i++) {
-                    *inp = byte_lookup[*inp * nComps + i];
-                    inp++;
-                }
-            }
-        }
-        colorSpace->getDeviceNLine(in, out, length);
-        break;
-    }
+    applyByteLookup(in, length);
+    colorSpace->getDeviceNLine(in, out, length);
 }
 
 void GfxImageColorMap::getCMYK(const unsigned char *x, GfxCMYK *cmyk)
@@ -46,9 +46,11 @@
 #include "Function.h"
 
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 class Array;
@@ -230,7 +232,7 @@ GfxLCMSProfilePtr POPPLER_PRIVATE_EXPORT make_GfxLCMSProfilePtr(void *profile);
 #endif
 
 // wrapper of cmsHTRANSFORM to copy
-class GfxColorTransform
+class POPPLER_PRIVATE_EXPORT GfxColorTransform
 {
 public:
     void doTransform(void *in, void *out, unsigned int size);
@@ -243,12 +245,40 @@ public:
     int getInputPixelType() const { return inputPixelType; }
     int getTransformPixelType() const { return transformPixelType; }
 
+    // Transform <size> pixels through a table sampled from the transform,
+    // built once enough pixels went through it: a direct table for one
+    // input channel, and, if GlobalParams::setICCLookupTables was set when
+    // the transform was created, a grid interpolated tetrahedrally for
+    // three or four.  Falls back to doTransform for the other transforms
+    // and those that don't take and return 8-bit components.  Single
+    // colors transformed before there is a table are looked up in an exact
+    // cache of the colors LCMS transformed.  Can be called from several
+    // threads at once.
+    void doLookupTransform(const unsigned char *in, unsigned char *out, unsigned int size);
+
 private:
     GfxColorTransform() = default;
+    void buildLUT();
+    void doCachedTransform(const unsigned char *in, unsigned char *out);
     void *transform;
     int cmsIntent;
     unsigned int inputPixelType;
     unsigned int transformPixelType;
+
+    int lutInChannels = 0; // 0 if the transform can't have a table
+    int lutOutChannels = 0;
+    int lutStep = 1; // input values between grid nodes
+    int lutGridPoints = 0; // grid nodes per input channel
+    unsigned int lutNodes = 0;
+    std::vector<unsigned char> lut; // lutOutChannels bytes per node, last input channel varying fastest
+    std::atomic<unsigned int> lutPixels = 0; // pixels transformed before the table is built
+    std::atomic<bool> lutBuilt = false;
+    std::once_flag lutOnce;
+
+    int cacheInChannels = 0; // 0 if single colors aren't cached
+    int cacheOutChannels = 0;
+    std::map<unsigned int, unsigned int> colorCache; // packed input bytes to packed output bytes
+    std::mutex colorCacheMutex;
 };
 
 class POPPLER_PRIVATE_EXPORT GfxColorSpace
@@ -271,26 +301,23 @@ public:
     virtual void getRGB(const GfxColor *color, GfxRGB *rgb) const = 0;
     virtual void getCMYK(const GfxColor *color, GfxCMYK *cmyk) const = 0;
     virtual void getDeviceN(const GfxColor *color, GfxColor *deviceN) const = 0;
-    virtual void getGrayLine(unsigned char * /*in*/, unsigned char * /*out*/, int /*length*/) { error(errInternal, -1, "GfxColorSpace::getGrayLine this should not happen"); }
-    virtual void getRGBLine(unsigned char * /*in*/, unsigned int * /*out*/, int /*length*/) { error(errInternal, -1, "GfxColorSpace::getRGBLine (first variant) this should not happen"); }
-    virtual void getRGBLine(unsigned char * /*in*/, unsigned char * /*out*/, int /*length*/) { error(errInternal, -1, "GfxColorSpace::getRGBLine (second variant) this should not happen"); }
-    virtual void getRGBXLine(unsigned char * /*in*/, unsigned char * /*out*/, int /*length*/) { error(errInternal, -1, "GfxColorSpace::getRGBXLine this should not happen"); }
-    virtual void getCMYKLine(unsigned char * /*in*/, unsigned char * /*out*/, int /*length*/) { error(errInternal, -1, "GfxColorSpace::getCMYKLine this should not happen"); }
-    virtual void getDeviceNLine(unsigned char * /*in*/, unsigned char * /*out*/, int /*length*/) { error(errInternal, -1, "GfxColorSpace::getDeviceNLine this should not happen"); }
+
+    // Convert a line of <length> pixels, with a byte per component
+    // spanning the default range of the component (see getDefaultRanges
+    // with a max pixel value of 255).  Color spaces without a faster
+    // converter, among them CalGray, CalRGB and Lab, convert each pixel
+    // with getGray, getRGB, getCMYK or getDeviceN.
+    virtual void getGrayLine(unsigned char *in, unsigned char *out, int length);
+    virtual void getRGBLine(unsigned char *in, unsigned int *out, int length);
+    virtual void getRGBLine(unsigned char *in, unsigned char *out, int length);
+    virtual void getRGBXLine(unsigned char *in, unsigned char *out, int length);
+    virtual void getCMYKLine(unsigned char *in, unsigned char *out, int length);
+    virtual void getDeviceNLine(unsigned char *in, unsigned char *out, int length);
 
     // create mapping for spot colorants
     virtual void createMapping(std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationList, size_t maxSepComps);
     const std::vector<int> &getMapping() const { return mapping; }
 
-    // Does this ColorSpace support getRGBLine?
-    virtual bool useGetRGBLine() const { return false; }
-    // Does this ColorSpace support getGrayLine?
-    virtual bool useGetGrayLine() const { return false; }
-    // Does this ColorSpace support getCMYKLine?
-    virtual bool useGetCMYKLine() const { return false; }
-    // Does this ColorSpace support getDeviceNLine?
-    virtual bool useGetDeviceNLine() const { return false; }
-
     // Return the number of color components.
     virtual int getNComps() const = 0;
 
@@ -342,11 +369,6 @@ public:
     void getCMYKLine(unsigned char *in, unsigned char *out, int length) override;
     void getDeviceNLine(unsigned char *in, unsigned char *out, int length) override;
 
-    bool useGetRGBLine() const override { return true; }
-    bool useGetGrayLine() const override { return true; }
-    bool useGetCMYKLine() const override { return true; }
-    bool useGetDeviceNLine() const override { return true; }
-
     int getNComps() const override { return 1; }
     void getDefaultColor(GfxColor *color) const override;
 
@@ -418,11 +440,6 @@ public:
     void getCMYKLine(unsigned char *in, unsigned char *out, int length) override;
     void getDeviceNLine(unsigned char *in, unsigned char *out, int length) override;
 
-    bool useGetRGBLine() const override { return true; }
-    bool useGetGrayLine() const override { return true; }
-    bool useGetCMYKLine() const override { return true; }
-    bool useGetDeviceNLine() const override { return true; }
-
     int getNComps() const override { return 3; }
     void getDefaultColor(GfxColor *color) const override;
 
@@ -516,9 +533,6 @@ public:
     void getRGBXLine(unsigned char *in, unsigned char *out, int length) override;
     void getCMYKLine(unsigned char *in, unsigned char *out, int length) override;
     void getDeviceNLine(unsigned char *in, unsigned char *out, int length) override;
-    bool useGetRGBLine() const override { return true; }
-    bool useGetCMYKLine() const override { return true; }
-    bool useGetDeviceNLine() const override { return true; }
 
     int getNComps() const override { return 4; }
     void getDefaultColor(GfxColor *color) const override;
@@ -600,10 +614,6 @@ public:
     void getCMYKLine(unsigned char *in, unsigned char *out, int length) override;
     void getDeviceNLine(unsigned char *in, unsigned char *out, int length) override;
 
-    bool useGetRGBLine() const override;
-    bool useGetCMYKLine() const override;
-    bool useGetDeviceNLine() const override;
-
     int getNComps() const override { return nComps; }
     void getDefaultColor(GfxColor *color) const override;
 
@@ -631,7 +641,6 @@ private:
     int getIntent() { return (transform != nullptr) ? transform->getIntent() : 0; }
     std::shared_ptr<GfxColorTransform> transform;
     std::shared_ptr<GfxColorTransform> lineTransform; // color transform for line
-    mutable std::map<unsigned int, unsigned int> cmsCache;
 #endif
 };
 //------------------------------------------------------------------------
@@ -659,10 +668,6 @@ public:
     void getCMYKLine(unsigned char *in, unsigned char *out, int length) override;
     void getDeviceNLine(unsigned char *in, unsigned char *out, int length) override;
 
-    bool useGetRGBLine() const override { return true; }
-    bool useGetCMYKLine() const override { return true; }
-    bool useGetDeviceNLine() const override { return true; }
-
     int getNComps() const override { return 1; }
     void getDefaultColor(GfxColor *color) const override;
 
@@ -914,7 +919,9 @@ public:
     GfxShading(const GfxShading &) = delete;
     GfxShading &operator=(const GfxShading &other) = delete;
 
-    static std::unique_ptr<GfxShading> parse(GfxResources *res, Object *obj, OutputDev *out, GfxState *state);
+    // <refA> is the object the shading was read from, if it was an
+    // indirect reference
+    static std::unique_ptr<GfxShading> parse(GfxResources *res, Object *obj, OutputDev *out, GfxState *state, Ref refA = Ref::INVALID());
 
     virtual std::unique_ptr<GfxShading> copy() const = 0;
 
@@ -930,6 +937,8 @@ public:
         *yMaxA = bbox_yMax;
     }
     bool getHasBBox() const { return hasBBox; }
+    // Ref::INVALID() for inline shadings
+    Ref getRef() const { return ref; }
 
 protected:
     virtual bool init(GfxResources *res, Dict *dict, OutputDev *out, GfxState *state);
@@ -940,6 +949,7 @@ protected:
     std::unique_ptr<GfxColorSpace> colorSpace;
     GfxColor background;
     double bbox_xMin, bbox_yMin, bbox_xMax, bbox_yMax;
+    Ref ref;
 };
 
 //------------------------------------------------------------------------
@@ -962,6 +972,9 @@ public:
     // returns the nComps of the shading
     // i.e. how many positions of color have been set
     int getColor(double t, GfxColor *color);
+    // same as getColor() for <n> parameter values at once, evaluating
+    // the functions in batches; ignores the cache
+    int getColorBatch(const double *t, GfxColor *colors, int n);
 
     void setupCache(const Matrix *ctm, double xMin, double yMin, double xMax, double yMax);
 
@@ -1263,10 +1276,6 @@ public:
     double getDecodeLow(int i) const { return decodeLow[i]; }
     double getDecodeHigh(int i) const { return decodeLow[i] + decodeRange[i]; }
 
-    bool useRGBLine() const { return (colorSpace2 && colorSpace2->useGetRGBLine()) || (!colorSpace2 && colorSpace->useGetRGBLine()); }
-    bool useCMYKLine() const { return (colorSpace2 && colorSpace2->useGetCMYKLine()) || (!colorSpace2 && colorSpace->useGetCMYKLine()); }
-    bool useDeviceNLine() const { return (colorSpace2 && colorSpace2->useGetDeviceNLine()) || (!colorSpace2 && colorSpace->useGetDeviceNLine()); }
-
     // Convert an image pixel to a color.
     void getGray(const unsigned char *x, GfxGray *gray);
     void getRGB(const unsigned char *x, GfxRGB *rgb);
@@ -1291,6 +1300,22 @@ public:
 private:
     explicit GfxImageColorMap(const GfxImageColorMap *colorMap);
 
+    enum LinePalette
+    {
+        linePaletteGray,
+        linePaletteRGB,
+        linePaletteCMYK,
+        linePaletteDeviceN,
+        nLinePalettes
+    };
+
+    // Return the line converter output for the 256 pixel values of a
+    // one-component map.
+    const unsigned char *getLinePalette(LinePalette palette);
+    // Map the pixels of a line of a several-component map to the bytes the
+    // color space's line converters take.
+    void applyByteLookup(unsigned char *in, int length) const;
+
     std::unique_ptr<GfxColorSpace> colorSpace; // the image color space
     int bits; // bits per component
     int nComps; // number of components in a pixel
@@ -1305,6 +1330,7 @@ private:
             decodeLow[gfxColorMaxComps];
     double // max - min value for each component
             decodeRange[gfxColorMaxComps];
+    std::vector<unsigned char> linePalettes[nLinePalettes]; // built on first use
     bool useMatte;
     GfxColor matteColor;
     bool ok;
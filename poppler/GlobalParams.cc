@@ -421,6 +421,8 @@ GlobalParams::GlobalParams(std::string customPopplerDataDir) : popplerDataDir(st
     printCommands = false;
     profileCommands = false;
     errQuiet = false;
+    gStateCacheSize = 2;
+    iccLookupTables = false;
 
     cidToUnicodeCache = std::make_unique<CharCodeToUnicodeCache>(cidToUnicodeCacheSize);
     unicodeToUnicodeCache = std::make_unique<CharCodeToUnicodeCache>(unicodeToUnicodeCacheSize);
@@ -1445,6 +1447,18 @@ bool GlobalParams::getErrQuiet() const
     return errQuiet;
 }
 
+std::size_t GlobalParams::getGStateCacheSize()
+{
+    globalParamsLocker();
+    return gStateCacheSize;
+}
+
+bool GlobalParams::getICCLookupTables()
+{
+    globalParamsLocker();
+    return iccLookupTables;
+}
+
 std::shared_ptr<CharCodeToUnicode> GlobalParams::getCIDToUnicode(const std::string &collection)
 {
     std::shared_ptr<CharCodeToUnicode> ctu;
@@ -1532,6 +1546,18 @@ void GlobalParams::setErrQuiet(bool errQuietA)
     errQuiet = errQuietA;
 }
 
+void GlobalParams::setGStateCacheSize(std::size_t size)
+{
+    globalParamsLocker();
+    gStateCacheSize = size;
+}
+
+void GlobalParams::setICCLookupTables(bool iccLookupTablesA)
+{
+    globalParamsLocker();
+    iccLookupTables = iccLookupTablesA;
+}
+
 #ifdef ANDROID
 void GlobalParams::setFontDir(const std::string &fontDir)
 {
@@ -42,6 +42,7 @@
 #include <cassert>
 #include "poppler_private_export.h"
 #include <cstdio>
+#include <cstddef>
 #include "CharTypes.h"
 #include "UnicodeMap.h"
 #include "Error.h"
@@ -148,6 +149,8 @@ public:
     bool getPrintCommands();
     bool getProfileCommands();
     bool getErrQuiet() const;
+    std::size_t getGStateCacheSize();
+    bool getICCLookupTables();
 
     std::shared_ptr<CharCodeToUnicode> getCIDToUnicode(const std::string &collection);
     const UnicodeMap *getUnicodeMap(const std::string &encodingName);
@@ -164,6 +167,14 @@ public:
     void setPrintCommands(bool printCommandsA);
     void setProfileCommands(bool profileCommandsA);
     void setErrQuiet(bool errQuietA);
+    // Number of ExtGState objects each resource dictionary keeps parsed,
+    // applies to the resource dictionaries created afterwards
+    void setGStateCacheSize(std::size_t size);
+    // Whether ICC color transforms with three or four input channels go
+    // through interpolated lookup tables, which is faster for images but
+    // may be off by a few 8-bit steps; applies to the transforms created
+    // afterwards
+    void setICCLookupTables(bool iccLookupTablesA);
 #ifdef ANDROID
     static void setFontDir(const std::string &fontDir);
 #endif
@@ -213,6 +224,8 @@ private:
     bool printCommands; // print the drawing commands
     bool profileCommands; // profile the drawing commands
     bool errQuiet; // suppress error messages?
+    std::size_t gStateCacheSize; // ExtGState cache size per resource dict
+    bool iccLookupTables; // interpolated tables for ICC transforms
 
     std::unique_ptr<CharCodeToUnicodeCache> cidToUnicodeCache;
     std::unique_ptr<CharCodeToUnicodeCache> unicodeToUnicodeCache;
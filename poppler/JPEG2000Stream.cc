@@ -22,6 +22,7 @@
 
 #include "config.h"
 #include "JPEG2000Stream.h"
+#include <algorithm>
 #include <openjpeg.h>
 
 struct JPXStreamPrivate
@@ -32,7 +33,16 @@ struct JPXStreamPrivate
     int npixels = 0;
     int ncomps = 0;
     bool inited = false;
+
+    // decoding hints, see JPXStream::reduceResolution()
+    int reduce = 0; // number of highest resolution levels to discard
+    bool useArea = false;
+    int fullWidth = 0; // image size the area refers to
+    int fullHeight = 0;
+    std::array<int, 4> area = {}; // in: requested area, out: decoded area
+
     void init2(OPJ_CODEC_FORMAT format, const unsigned char *buf, int length, bool indexed);
+    bool setupDecodeArea(opj_codec_t *decoder);
 };
 
 static inline unsigned char adjustComp(int r, int adjust, int depth, int sgndcorr, bool indexed)
@@ -181,6 +191,56 @@ void JPXStream::getImageParams(int *bitsPerComponent, StreamColorSpaceMode *csMo
     }
 }
 
+bool JPXStream::reduceResolution(int *width, int *height, int targetWidth, int targetHeight, std::array<int, 4> *area)
+{
+    // the image is decoded as a whole the first time it is read,
+    // it's too late to change anything after that
+    if (priv->inited) {
+        return false;
+    }
+
+    int reduce = 0;
+    while (reduce < 30 && (*width >> (reduce + 1)) >= targetWidth && (*height >> (reduce + 1)) >= targetHeight) {
+        ++reduce;
+    }
+    const bool fullArea = (*area)[0] == 0 && (*area)[1] == 0 && (*area)[2] == *width && (*area)[3] == *height;
+    if (reduce == 0 && fullArea) {
+        return false;
+    }
+
+    priv->reduce = reduce;
+    priv->useArea = !fullArea;
+    priv->fullWidth = *width;
+    priv->fullHeight = *height;
+    priv->area = *area;
+    init();
+    if (!priv->image) {
+        // don't make things worse than decoding everything, which happens
+        // on the first read as if we had never been asked
+        error(errSyntaxWarning, -1, "Could not decode JPX image at reduced resolution, decoding all of it");
+        restoreFullResolution();
+        return false;
+    }
+    if (priv->reduce == 0 && !priv->useArea) {
+        // the hints didn't fit the image, what we decoded is the full image
+        return false;
+    }
+
+    *width = static_cast<int>(priv->image->comps[0].w);
+    *height = static_cast<int>(priv->image->comps[0].h);
+    *area = priv->area;
+    return true;
+}
+
+void JPXStream::restoreFullResolution()
+{
+    // the image is decoded again, in full, on the next read
+    priv->reduce = 0;
+    priv->useArea = false;
+    close();
+    priv->inited = false;
+}
+
 static void libopenjpeg_error_callback(const char *msg, void * /*client_data*/)
 {
     error(errSyntaxError, -1, "{0:s}", msg);
@@ -373,8 +433,12 @@ void JPXStreamPrivate::init2(OPJ_CODEC_FORMAT format, const unsigned char *buf,
         goto error;
     }
 
-    /* Optional if you want decode the entire image */
-    if (!opj_set_decode_area(decoder, image, parameters.DA_x0, parameters.DA_y0, parameters.DA_x1, parameters.DA_y1)) {
+    if (reduce != 0 || useArea) {
+        if (!setupDecodeArea(decoder)) {
+            goto error;
+        }
+    } else if (!opj_set_decode_area(decoder, image, parameters.DA_x0, parameters.DA_y0, parameters.DA_x1, parameters.DA_y1)) {
+        /* Optional if you want decode the entire image */
         error(errSyntaxWarning, -1, "X2");
         goto error;
     }
@@ -409,3 +473,65 @@ error:
         error(errSyntaxError, -1, "Did no succeed opening JPX Stream.");
     }
 }
+
+// Applies the reduce and area hints to the decoder, adjusting them to what
+// the image allows, must be called after the header has been read.
+bool JPXStreamPrivate::setupDecodeArea(opj_codec_t *decoder)
+{
+    const int imageWidth = static_cast<int>(image->x1 - image->x0);
+    const int imageHeight = static_cast<int>(image->y1 - image->y0);
+    bool hintsUsable = imageWidth == fullWidth && imageHeight == fullHeight;
+    for (OPJ_UINT32 component = 0; component < image->numcomps; component++) {
+        if (image->comps[component].dx != 1 || image->comps[component].dy != 1) {
+            hintsUsable = false;
+        }
+    }
+    if (!hintsUsable) {
+        reduce = 0;
+        useArea = false;
+        area = { 0, 0, fullWidth, fullHeight };
+        return opj_set_decode_area(decoder, image, 0, 0, 0, 0);
+    }
+
+    // can't discard more resolution levels than there are
+    if (opj_codestream_info_v2_t *info = opj_get_cstr_info(decoder)) {
+        if (info->m_default_tile_info.tccp_info) {
+            for (OPJ_UINT32 component = 0; component < info->nbcomps; component++) {
+                const int numResolutions = static_cast<int>(info->m_default_tile_info.tccp_info[component].numresolutions);
+                reduce = std::min(reduce, numResolutions - 1);
+            }
+        } else {
+            reduce = 0;
+        }
+        opj_destroy_cstr_info(&info);
+    } else {
+        reduce = 0;
+    }
+    reduce = std::max(reduce, 0);
+
+    if (reduce != 0 && !opj_set_decoded_resolution_factor(decoder, reduce)) {
+        error(errSyntaxWarning, -1, "Unable to set JPX resolution factor");
+        return false;
+    }
+
+    if (!useArea) {
+        area = { 0, 0, fullWidth, fullHeight };
+        return opj_set_decode_area(decoder, image, 0, 0, 0, 0);
+    }
+
+    // the decoded area is aligned to the reduced resolution grid
+    const int step = 1 << reduce;
+    const auto alignDown = [step](int v) { return v / step * step; };
+    const auto alignUp = [step](int v, int max) { return std::min((v + step - 1) / step * step, max); };
+    area = { alignDown(area[0]), alignDown(area[1]), alignUp(area[2], imageWidth), alignUp(area[3], imageHeight) };
+    if (area[0] >= area[2] || area[1] >= area[3]) {
+        useArea = false;
+        area = { 0, 0, fullWidth, fullHeight };
+        return opj_set_decode_area(decoder, image, 0, 0, 0, 0);
+    }
+    if (!opj_set_decode_area(decoder, image, image->x0 + area[0], image->y0 + area[1], image->x0 + area[2], image->y0 + area[3])) {
+        error(errSyntaxWarning, -1, "Unable to set JPX decode area");
+        return false;
+    }
+    return true;
+}
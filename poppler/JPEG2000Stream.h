@@ -43,6 +43,8 @@ public:
     std::optional<std::string> getPSFilter(int psLevel, const char *indent) override;
     bool isBinary(bool last = true) const override;
     void getImageParams(int *bitsPerComponent, StreamColorSpaceMode *csMode, bool *hasAlpha) override;
+    bool reduceResolution(int *width, int *height, int targetWidth, int targetHeight, std::array<int, 4> *area) override;
+    void restoreFullResolution() override;
 
     // Whether this JPX Stream should handle transparency (usually set when OutputDev also supports it)
     void setSupportJPXtransparency(bool val) { handleJPXtransparency = val; }
@@ -0,0 +1,98 @@
+//========================================================================
+//
+// NameAtom.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "NameAtom.h"
+
+namespace {
+
+// Keys and values found in almost every file. Names not listed here work
+// the same, they just aren't shared.
+constexpr std::array wellKnownNames = {
+    // structure
+    "Type", "Subtype", "Length", "Filter", "DecodeParms", "Parent", "Kids", "Count", "Size", "Root", "Info", "Prev", "Index", "Names", "Dests", "Outlines",
+    "First", "Last", "Next", "Title", "Catalog", "Pages", "Page", "ObjStm", "XRef", "N", "W", "Encrypt", "ID", "Metadata", "AcroForm", "StructTreeRoot",
+    "MarkInfo", "Lang", "OCProperties", "PageLabels", "ViewerPreferences", "Version", "Extends",
+    // pages and resources
+    "MediaBox", "CropBox", "BleedBox", "TrimBox", "ArtBox", "Rotate", "Contents", "Resources", "Group", "Annots", "Thumb", "UserUnit", "ProcSet", "PDF",
+    "Text", "ImageB", "ImageC", "ImageI", "Font", "XObject", "ExtGState", "ColorSpace", "Pattern", "Shading", "Properties",
+    // filters
+    "FlateDecode", "LZWDecode", "ASCIIHexDecode", "ASCII85Decode", "RunLengthDecode", "DCTDecode", "JPXDecode", "JBIG2Decode", "CCITTFaxDecode", "Crypt",
+    "Predictor", "Colors", "Columns", "BitsPerComponent", "K", "Rows", "BlackIs1", "EncodedByteAlign", "EndOfBlock", "JBIG2Globals", "ColorTransform",
+    // images and forms
+    "Image", "Form", "Width", "Height", "Decode", "Interpolate", "ImageMask", "Mask", "SMask", "SMaskInData", "Matte", "Intent", "BBox", "Matrix", "FormType",
+    "PS", "OC", "S", "Transparency", "CS", "I", "BPC", "D", "DP", "F", "H", "IM",
+    // color spaces
+    "DeviceGray", "DeviceRGB", "DeviceCMYK", "CalGray", "CalRGB", "Lab", "ICCBased", "Indexed", "Separation", "DeviceN", "Alternate", "WhitePoint",
+    "BlackPoint", "Gamma", "Range", "G", "RGB", "CMYK", "None", "All", "DefaultGray", "DefaultRGB", "DefaultCMYK",
+    // graphics state, patterns, shadings and functions
+    "LW", "LC", "LJ", "ML", "RI", "OP", "op", "OPM", "SA", "BM", "CA", "ca", "AIS", "TK", "TR", "TR2", "BG", "BG2", "UCR", "UCR2", "HT", "Normal",
+    "Multiply", "Screen", "Luminosity", "Alpha", "PatternType", "PaintType", "TilingType", "XStep", "YStep", "ShadingType", "Coords", "Domain", "Extend",
+    "Function", "Background", "AntiAlias", "FunctionType", "C0", "C1", "Functions", "Bounds", "Encode", "BitsPerSample", "Order", "BitsPerCoordinate",
+    "BitsPerFlag", "VerticesPerRow",
+    // fonts
+    "Type0", "Type1", "Type1C", "Type3", "TrueType", "MMType1", "CIDFontType0", "CIDFontType0C", "CIDFontType2", "OpenType", "BaseFont", "FirstChar",
+    "LastChar", "Widths", "Encoding", "FontDescriptor", "ToUnicode", "DescendantFonts", "CIDSystemInfo", "CIDToGIDMap", "DW", "DW2", "W2", "Registry",
+    "Ordering", "Supplement", "Identity", "Identity-H", "Identity-V", "FontName", "FontFamily", "FontStretch", "FontWeight", "Flags", "FontBBox",
+    "ItalicAngle", "Ascent", "Descent", "Leading", "CapHeight", "XHeight", "StemV", "StemH", "AvgWidth", "MaxWidth", "MissingWidth", "CharSet",
+    "FontFile", "FontFile2", "FontFile3", "CharProcs", "FontMatrix", "Differences", "BaseEncoding", "WinAnsiEncoding", "MacRomanEncoding",
+    "MacExpertEncoding", "StandardEncoding",
+    // annotations, actions and marked content
+    "Annot", "Rect", "P", "NM", "M", "AP", "AS", "Border", "BS", "BE", "C", "IC", "T", "Popup", "RC", "CreationDate", "Link", "Widget", "Dest", "A", "AA",
+    "URI", "GoTo", "GoToR", "Launch", "Named", "JavaScript", "JS", "Action", "Off", "FT", "Ff", "V", "DV", "DA", "Q", "MK", "Fields", "DR", "Tx", "Btn",
+    "Ch", "Sig", "XYZ", "Fit", "FitH", "FitV", "FitB", "FitR", "OCG", "OCMD", "OCGs", "Usage", "MCID", "StructParents", "StructParent", "Pg", "ActualText",
+    "Alt", "E",
+};
+
+// Built once and only read afterwards, so it can be used without locking
+class WellKnownTable
+{
+public:
+    WellKnownTable()
+    {
+        names.reserve(wellKnownNames.size());
+        for (const char *name : wellKnownNames) {
+            names.emplace_back(name);
+        }
+        index.reserve(names.size());
+        for (const std::string &name : names) {
+            index.emplace(name, &name);
+        }
+    }
+
+    const std::string *find(std::string_view name) const
+    {
+        const auto it = index.find(name);
+        return it != index.end() ? it->second : nullptr;
+    }
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string_view, const std::string *> index;
+};
+
+const WellKnownTable &wellKnownTable()
+{
+    // Never destroyed, atoms in static objects may outlive any destructor
+    static const WellKnownTable *table = new WellKnownTable;
+    return *table;
+}
+
+}
+
+NameAtom::NameAtom(std::string_view name) : known(wellKnownTable().find(name))
+{
+    if (!known) {
+        other = name;
+    }
+}
@@ -0,0 +1,69 @@
+//========================================================================
+//
+// NameAtom.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef NAMEATOM_H
+#define NAMEATOM_H
+
+#include <string>
+#include <string_view>
+
+#include "poppler_private_export.h"
+
+//------------------------------------------------------------------------
+// NameAtom
+//
+// A PDF name. The names in a fixed list of well-known keys and values
+// (see NameAtom.cc) point into one table built at startup and never
+// modified, so comparing two of them is comparing two pointers and
+// copying them never allocates. Any other name is stored in the atom
+// itself, like a std::string.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT NameAtom
+{
+public:
+    explicit NameAtom(std::string_view name);
+
+    const std::string &str() const { return known ? *known : other; }
+    const char *c_str() const { return str().c_str(); }
+
+    // A well-known name is never stored in <other>, so two atoms of the
+    // same name are either both well-known or both not
+    bool operator==(const NameAtom &atom) const { return known == atom.known && (known || other == atom.other); }
+    bool operator==(std::string_view name) const { return str() == name; }
+
+private:
+    const std::string *known; // entry of the well-known names table
+    std::string other; // the name, if it isn't well-known
+};
+
+//------------------------------------------------------------------------
+// Atoms of frequently used names, so that looking them up doesn't need
+// to go through the table.
+//------------------------------------------------------------------------
+
+namespace NameAtoms {
+inline const NameAtom BitsPerComponent { "BitsPerComponent" };
+inline const NameAtom ColorSpace { "ColorSpace" };
+inline const NameAtom DecodeParms { "DecodeParms" };
+inline const NameAtom ExtGState { "ExtGState" };
+inline const NameAtom Filter { "Filter" };
+inline const NameAtom Font { "Font" };
+inline const NameAtom Height { "Height" };
+inline const NameAtom Length { "Length" };
+inline const NameAtom Pattern { "Pattern" };
+inline const NameAtom Properties { "Properties" };
+inline const NameAtom Resources { "Resources" };
+inline const NameAtom Shading { "Shading" };
+inline const NameAtom Subtype { "Subtype" };
+inline const NameAtom Type { "Type" };
+inline const NameAtom Width { "Width" };
+inline const NameAtom XObject { "XObject" };
+}
+
+#endif
@@ -101,7 +101,7 @@ void Object::print(FILE *f) const
         fprintf(f, ">");
     } break;
     case objName:
-        fprintf(f, "/%s", std::get<std::string>(data).c_str());
+        fprintf(f, "/%s", std::get<NameAtom>(data).c_str());
         break;
     case objNull:
         fprintf(f, "null");
@@ -48,6 +48,7 @@
 #include "goo/GooString.h"
 #include "goo/GooLikely.h"
 #include "Error.h"
+#include "NameAtom.h"
 #include "poppler_private_export.h"
 
 #define OBJECT_TYPE_CHECK(wanted_type)                                                                                                                                                                                                         \
@@ -229,13 +230,25 @@ public:
     Object(ObjType typeA, std::string &&stringA) : type { typeA }, data { std::move(stringA) } { assert(typeA == objHexString); }
 
     Object(ObjType typeA, const char *v) : Object(typeA, std::string_view(v)) { }
-    Object(ObjType typeA, std::string_view v) : type { typeA }, data { std::string { v } } { assert(typeA == objName || typeA == objCmd); }
+    Object(ObjType typeA, std::string_view v) : type { typeA }
+    {
+        assert(typeA == objName || typeA == objCmd);
+        if (typeA == objName) {
+            data = NameAtom { v };
+        } else {
+            data = std::string { v };
+        }
+    }
+
+    explicit Object(NameAtom nameA) : type { objName }, data { nameA } { }
 
     explicit Object(long long int64gA) : type { objInt64 }, data { int64gA } { }
 
     explicit Object(std::unique_ptr<Array> arrayA) : type { objArray }, data { std::shared_ptr<Array>(std::move(arrayA)) } { }
+    explicit Object(std::shared_ptr<Array> arrayA) : type { objArray }, data { std::move(arrayA) } { }
 
     explicit Object(std::unique_ptr<Dict> &&dictA) : type { objDict }, data { std::shared_ptr<Dict>(std::move(dictA)) } { }
+    explicit Object(std::shared_ptr<Dict> dictA) : type { objDict }, data { std::move(dictA) } { }
 
     template<typename StreamType>
         requires(std::is_base_of_v<Stream, StreamType>)
@@ -378,7 +391,8 @@ public:
     }
 
     // Special type checking.
-    bool isName(std::string_view nameA) const { return type == objName && getName() == nameA; }
+    bool isName(std::string_view nameA) const { return type == objName && std::get<NameAtom>(data) == nameA; }
+    bool isName(const NameAtom &nameA) const { return type == objName && std::get<NameAtom>(data) == nameA; }
     bool isArrayOfLength(int length) const;
     bool isArrayOfLengthAtLeast(int length) const;
     bool isDict(std::string_view dictType) const;
@@ -439,12 +453,17 @@ public:
     const char *getName() const
     {
         OBJECT_TYPE_CHECK(objName);
-        return std::get<std::string>(data).c_str();
+        return std::get<NameAtom>(data).c_str();
     }
     const std::string &getNameString() const
     {
         OBJECT_TYPE_CHECK(objName);
-        return std::get<std::string>(data);
+        return std::get<NameAtom>(data).str();
+    }
+    NameAtom getNameAtom() const
+    {
+        OBJECT_TYPE_CHECK(objName);
+        return std::get<NameAtom>(data);
     }
     Array *getArray() const
     {
@@ -538,13 +557,13 @@ private:
     {
     };
     explicit Object(ObjType typeA) { type = typeA; }
-    explicit Object(ObjType typeA, std::variant<std::monostate, bool, int, long long, double, std::string, std::shared_ptr<Array>, std::shared_ptr<Dict>, std::shared_ptr<Stream>, Ref> dataA, PrivateTag /*unnamed*/)
+    explicit Object(ObjType typeA, std::variant<std::monostate, bool, int, long long, double, std::string, NameAtom, std::shared_ptr<Array>, std::shared_ptr<Dict>, std::shared_ptr<Stream>, Ref> dataA, PrivateTag /*unnamed*/)
         : type { typeA }, data { std::move(dataA) }
     {
     }
 
     ObjType type; // object type
-    std::variant<std::monostate, bool, int, long long, double, std::string, std::shared_ptr<Array>, std::shared_ptr<Dict>, std::shared_ptr<Stream>, Ref> data;
+    std::variant<std::monostate, bool, int, long long, double, std::string, NameAtom, std::shared_ptr<Array>, std::shared_ptr<Dict>, std::shared_ptr<Stream>, Ref> data;
 };
 
 //------------------------------------------------------------------------
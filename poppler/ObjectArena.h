@@ -0,0 +1,116 @@
+//========================================================================
+//
+// ObjectArena.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef OBJECTARENA_H
+#define OBJECTARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+//------------------------------------------------------------------------
+// ObjectArena
+//
+// Memory pool for the short lived Arrays and Dicts of content streams,
+// so that they don't go through malloc one by one. Gfx owns one and
+// gives its memory back once the content streams it is drawing are done.
+//
+// The arena is not thread safe: objects allocated from it must be freed
+// from the thread using it. Such objects are not expected to outlive the
+// arena owner; if some do, the arena is only deleted once the last of
+// them is freed.
+//------------------------------------------------------------------------
+
+class ObjectArena
+{
+public:
+    template<typename T>
+    class Allocator
+    {
+    public:
+        using value_type = T;
+
+        explicit Allocator(ObjectArena *arenaA) : arena(arenaA) { }
+        template<typename U>
+        Allocator(const Allocator<U> &other) : arena(other.arena) // NOLINT(google-explicit-constructor)
+        {
+        }
+
+        T *allocate(std::size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+        void deallocate(T *p, std::size_t n) { arena->deallocate(p, n * sizeof(T), alignof(T)); }
+
+        template<typename U>
+        bool operator==(const Allocator<U> &other) const
+        {
+            return arena == other.arena;
+        }
+
+    private:
+        template<typename U>
+        friend class Allocator;
+
+        ObjectArena *arena;
+    };
+
+    // Deletes the arena now, or once the last object allocated from it is
+    // freed
+    struct Deleter
+    {
+        void operator()(ObjectArena *arena) const
+        {
+            if (arena->live == 0) {
+                delete arena;
+            } else {
+                arena->orphaned = true;
+            }
+        }
+    };
+
+    ObjectArena() = default;
+    ObjectArena(const ObjectArena &) = delete;
+    ObjectArena &operator=(const ObjectArena &) = delete;
+
+    // Allocates the object and its reference count from the arena
+    template<typename T, typename... Args>
+    std::shared_ptr<T> make(Args &&...args)
+    {
+        return std::allocate_shared<T>(Allocator<T>(this), std::forward<Args>(args)...);
+    }
+
+    // Gives the memory back to the system if no object allocated from the
+    // arena is alive
+    void release()
+    {
+        if (live == 0) {
+            resource.release();
+        }
+    }
+
+private:
+    void *allocate(std::size_t bytes, std::size_t alignment)
+    {
+        void *p = resource.allocate(bytes, alignment);
+        ++live;
+        return p;
+    }
+
+    void deallocate(void *p, std::size_t bytes, std::size_t alignment)
+    {
+        resource.deallocate(p, bytes, alignment);
+        if (--live == 0 && orphaned) {
+            delete this;
+        }
+    }
+
+    std::pmr::unsynchronized_pool_resource resource;
+    std::size_t live = 0; // allocations not freed yet
+    bool orphaned = false;
+};
+
+#endif
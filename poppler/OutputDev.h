@@ -116,6 +116,11 @@ public:
     // Does this device supports transparency (alpha channel) in JPX streams?
     virtual bool supportJPXtransparency() { return false; }
 
+    // Does this device need the full image data?  If this returns false,
+    // image streams will be asked to only decode the visible part of the
+    // images at the resolution they are shown, see Stream::reduceResolution().
+    virtual bool needFullResolutionImages() { return true; }
+
     //----- initialization and control
 
     // Set default transform matrix.
@@ -362,6 +367,8 @@ public:
     GfxLCMSProfilePtr getDefaultCMYKProfile() const { return defaultCMYKProfile; }
 
     PopplerCache<Ref, GfxICCBasedColorSpace> *getIccColorSpaceCache() { return &iccColorSpaceCache; }
+    // Number of parsed ICCBased color spaces kept, 5 by default
+    void setIccColorSpaceCacheSize(std::size_t size) { iccColorSpaceCache.setMaxCost(size); }
 #endif
 
 private:
@@ -65,6 +65,22 @@ Parser::Parser(XRef *xrefA, Object *objectA, bool allowStreamsA) : lexer { xrefA
 
 Parser::~Parser() = default;
 
+Object Parser::makeArray()
+{
+    if (arena) {
+        return Object(arena->make<Array>(lexer.getXRef()));
+    }
+    return Object(std::make_unique<Array>(lexer.getXRef()));
+}
+
+Object Parser::makeDict()
+{
+    if (arena) {
+        return Object(arena->make<Dict>(lexer.getXRef()));
+    }
+    return Object(std::make_unique<Dict>(lexer.getXRef()));
+}
+
 Object Parser::getObj(int recursion)
 {
     return getObj(false, nullptr, cryptRC4, 0, 0, 0, recursion);
@@ -102,7 +118,7 @@ Object Parser::getObj(bool simpleOnly, const unsigned char *fileKey, CryptAlgori
     // array
     if (!simpleOnly && buf1.isCmd("[")) {
         shift();
-        obj = Object(std::make_unique<Array>(lexer.getXRef()));
+        obj = makeArray();
         while (!buf1.isCmd("]") && !buf1.isEOF() && recursion + 1 < recursionLimit) {
             Object obj2 = getObj(false, fileKey, encAlgorithm, keyLength, objNum, objGen, recursion + 1);
             obj.arrayAdd(std::move(obj2));
@@ -121,7 +137,7 @@ Object Parser::getObj(bool simpleOnly, const unsigned char *fileKey, CryptAlgori
         // dictionary or stream
     } else if (!simpleOnly && buf1.isCmd("<<")) {
         shift(objNum);
-        obj = Object(std::make_unique<Dict>(lexer.getXRef()));
+        obj = makeDict();
         bool hasContentsEntry = false;
         while (!buf1.isCmd(">>") && !buf1.isEOF()) {
             if (!buf1.isName()) {
@@ -149,7 +165,7 @@ Object Parser::getObj(bool simpleOnly, const unsigned char *fileKey, CryptAlgori
                 if (unlikely(recursion + 1 >= recursionLimit)) {
                     break;
                 }
-                obj.dictAdd(key.getName(), std::move(obj2));
+                obj.getDict()->add(key.getNameAtom(), std::move(obj2));
             }
         }
         if (buf1.isEOF()) {
@@ -169,6 +185,7 @@ Object Parser::getObj(bool simpleOnly, const unsigned char *fileKey, CryptAlgori
                 }
             }
         }
+        obj.getDict()->sortEntries();
         // stream objects are not allowed inside content streams or
         // object streams
         if (buf2.isCmd("stream")) {
@@ -249,7 +266,7 @@ std::unique_ptr<Stream> Parser::makeStream(Object &&dict, const unsigned char *f
     pos = lexerStream->getPos();
 
     // get length
-    Object obj = dict.dictLookup("Length", recursion);
+    Object obj = dict.getDict()->lookup(NameAtoms::Length, recursion);
     if (obj.isInt()) {
         length = obj.getInt();
     } else if (obj.isInt64()) {
@@ -29,6 +29,7 @@
 #define PARSER_H
 
 #include "Lexer.h"
+#include "ObjectArena.h"
 
 //------------------------------------------------------------------------
 // Parser
@@ -63,11 +64,20 @@ public:
     // Get current position in file.
     Goffset getPos() { return lexer.getPos(); }
 
+    // Allocate the arrays and dictionaries that are parsed from now on
+    // from the given arena, which must outlive the parser.
+    void setArena(ObjectArena *arenaA) { arena = arenaA; }
+
+    // Create an empty array or dictionary, from the arena if there's one.
+    Object makeArray();
+    Object makeDict();
+
 private:
     Lexer lexer; // input stream
     bool allowStreams; // parse stream objects?
     Object buf1, buf2; // next two tokens
     int inlineImg; // set when inline image data is encountered
+    ObjectArena *arena = nullptr;
 
     std::unique_ptr<Stream> makeStream(Object &&dict, const unsigned char *fileKey, CryptAlgorithm encAlgorithm, int keyLength, int objNum, int objGen, int recursion, bool strict);
     void shift(int objNum = -1);
@@ -14,11 +14,18 @@
 #ifndef POPPLER_CACHE_H
 #define POPPLER_CACHE_H
 
-#include <algorithm>
+#include <cstddef>
+#include <list>
 #include <memory>
+#include <unordered_map>
 #include <utility>
-#include <vector>
 
+// Least recently used cache.
+//
+// Every item has a cost, 1 by default, so that the maximum cost is the
+// maximum number of items. Callers that want a memory budget instead
+// can pass the size in bytes of each item to put() and set the maximum
+// cost to the budget in bytes.
 template<typename Key, typename Item>
 class PopplerCache
 {
@@ -26,50 +33,105 @@ public:
     PopplerCache(const PopplerCache &) = delete;
     PopplerCache &operator=(const PopplerCache &other) = delete;
 
-    explicit PopplerCache(std::size_t cacheSizeA) { entries.reserve(cacheSizeA); }
+    explicit PopplerCache(std::size_t maxCostA) : maxCost(maxCostA) { }
 
     /* The item returned is owned by the cache */
     Item *lookup(const Key &key)
     {
-        if (!entries.empty() && entries.front().first == key) {
-            return entries.front().second.get();
+        const auto it = index.find(key);
+        if (it == index.end()) {
+            ++misses;
+            return nullptr;
         }
 
-        for (auto it = entries.begin(); it != entries.end(); ++it) {
-            if (it->first == key) {
-                auto *item = it->second.get();
+        ++hits;
+        // move the entry to the front of the list, i.e. most recently used
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->item.get();
+    }
+
+    /* The key and item pointers ownership is taken by the cache */
+    void put(const Key &key, Item *item, std::size_t cost = 1) { put(key, std::unique_ptr<Item> { item }, cost); }
 
-                std::rotate(entries.begin(), it, std::next(it));
+    /* The key and item pointers ownership is taken by the cache
+     * The item just added is never evicted by this call, even if its
+     * cost is above the maximum cost, so it stays valid until the next
+     * put() or setMaxCost() */
+    void put(const Key &key, std::unique_ptr<Item> &&item, std::size_t cost = 1)
+    {
+        remove(key);
 
-                return item;
-            }
-        }
+        entries.push_front(Entry { .key = key, .item = std::move(item), .cost = cost });
+        index.emplace(key, entries.begin());
+        totalCost += cost;
 
-        return nullptr;
+        trim(maxCost);
     }
 
-    /* The key and item pointers ownership is taken by the cache */
-    void put(const Key &key, Item *item)
+    /* Deletes the item for key, if any */
+    void remove(const Key &key)
     {
-        if (entries.size() == entries.capacity()) {
-            entries.pop_back();
+        const auto it = index.find(key);
+        if (it == index.end()) {
+            return;
         }
 
-        entries.emplace(entries.begin(), key, std::unique_ptr<Item> { item });
+        totalCost -= it->second->cost;
+        entries.erase(it->second);
+        index.erase(it);
     }
 
-    /* The key and item pointers ownership is taken by the cache */
-    void put(const Key &key, std::unique_ptr<Item> &&item)
+    /* Deletes all the items */
+    void clear()
     {
-        if (entries.size() == entries.capacity()) {
-            entries.pop_back();
-        }
+        entries.clear();
+        index.clear();
+        totalCost = 0;
+    }
 
-        entries.emplace(entries.begin(), key, std::move(item));
+    std::size_t getMaxCost() const { return maxCost; }
+
+    /* Evicts the least recently used items until the total cost fits in maxCostA */
+    void setMaxCost(std::size_t maxCostA)
+    {
+        maxCost = maxCostA;
+        trim(maxCost);
     }
 
+    std::size_t getTotalCost() const { return totalCost; }
+    std::size_t size() const { return entries.size(); }
+
+    unsigned long getHits() const { return hits; }
+    unsigned long getMisses() const { return misses; }
+    unsigned long getEvictions() const { return evictions; }
+
 private:
-    std::vector<std::pair<Key, std::unique_ptr<Item>>> entries;
+    struct Entry
+    {
+        Key key;
+        std::unique_ptr<Item> item;
+        std::size_t cost;
+    };
+
+    // Keeps at least the most recently used item
+    void trim(std::size_t budget)
+    {
+        while (totalCost > budget && entries.size() > 1) {
+            Entry &entry = entries.back();
+            totalCost -= entry.cost;
+            index.erase(entry.key);
+            entries.pop_back();
+            ++evictions;
+        }
+    }
+
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator> index;
+    std::size_t maxCost;
+    std::size_t totalCost = 0;
+    unsigned long hits = 0;
+    unsigned long misses = 0;
+    unsigned long evictions = 0;
 };
 
 #endif
@@ -0,0 +1,295 @@
+//========================================================================
+//
+// SplashBandRenderer.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DisplayListOutputDev.h"
+#include "GfxState.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "SplashBandRenderer.h"
+
+namespace {
+
+// The user's abort callback is only polled by the calling thread, the
+// other threads just follow its result.
+struct AbortState
+{
+    bool (*abortCheckCbk)(void *data);
+    void *abortCheckCbkData;
+    std::atomic<bool> aborted = false;
+};
+
+bool checkAbortCallingThread(void *data)
+{
+    auto *abortState = static_cast<AbortState *>(data);
+    if (!abortState->aborted && abortState->abortCheckCbk && (*abortState->abortCheckCbk)(abortState->abortCheckCbkData)) {
+        abortState->aborted = true;
+    }
+    return abortState->aborted;
+}
+
+bool checkAbortWorker(void *data)
+{
+    return static_cast<AbortState *>(data)->aborted;
+}
+
+bool abortAlways(void * /*data*/)
+{
+    return true;
+}
+
+// Runs <renderBands> on the calling thread and on <nThreads> - 1 others.
+// An exception thrown by one of them (from the OutputDev factory or the
+// band callback) aborts the others, calling <wakeUp> to wake up the ones
+// waiting, and is rethrown once they are all done.
+template<typename RenderBands, typename WakeUp>
+void runThreads(int nThreads, AbortState *abortState, const RenderBands &renderBands, const WakeUp &wakeUp)
+{
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    const auto run = [&](bool callingThread) {
+        try {
+            renderBands(callingThread);
+        } catch (...) {
+            {
+                const std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            abortState->aborted = true;
+            wakeUp();
+        }
+    };
+
+    {
+        // joined when leaving the scope, even if starting one fails
+        std::vector<std::jthread> workers;
+        workers.reserve(nThreads - 1);
+        for (int i = 1; i < nThreads; ++i) {
+            workers.emplace_back(run, false);
+        }
+        run(true);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Copies <rows> rows of <src> starting at <srcY> to the rows starting at
+// <dstY> of <dst>.
+void copyRows(SplashBitmap *dst, int dstY, SplashBitmap *src, int srcY, int rows)
+{
+    rows = std::min({ rows, src->getHeight() - srcY, dst->getHeight() - dstY });
+    const size_t rowBytes = std::min(std::abs(src->getRowSize()), std::abs(dst->getRowSize()));
+    const size_t alphaBytes = std::min(src->getAlphaRowSize(), dst->getAlphaRowSize());
+    for (int row = 0; row < rows; ++row) {
+        memcpy(dst->getDataPtr() + static_cast<ptrdiff_t>(dstY + row) * dst->getRowSize(), src->getDataPtr() + static_cast<ptrdiff_t>(srcY + row) * src->getRowSize(), rowBytes);
+        if (dst->getAlphaPtr() && src->getAlphaPtr()) {
+            memcpy(dst->getAlphaPtr() + static_cast<size_t>(dstY + row) * dst->getAlphaRowSize(), src->getAlphaPtr() + static_cast<size_t>(srcY + row) * src->getAlphaRowSize(), alphaBytes);
+        }
+    }
+}
+
+}
+
+//------------------------------------------------------------------------
+// SplashBandRenderer
+//------------------------------------------------------------------------
+
+SplashBandRenderer::SplashBandRenderer(int nThreadsA, OutputDevFactory makeOutputDevA) : nThreads(std::max(nThreadsA, 1)), makeOutputDev(std::move(makeOutputDevA)) { }
+
+SplashBandRenderer::~SplashBandRenderer() = default;
+
+void SplashBandRenderer::displayPageSlice(SplashOutputDev *out, PDFDoc *doc, int page, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, bool printing, int sliceX, int sliceY, int sliceW, int sliceH,
+                                          bool (*abortCheckCbk)(void *data), void *abortCheckCbkData, bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data), void *annotDisplayDecideCbkData,
+                                          bool copyXRef)
+{
+    if (nThreads == 1) {
+        doc->displayPageSlice(out, page, hDPI, vDPI, rotate, useMediaBox, crop, printing, sliceX, sliceY, sliceW, sliceH, abortCheckCbk, abortCheckCbkData, annotDisplayDecideCbk, annotDisplayDecideCbkData, copyXRef);
+        return;
+    }
+
+    // the whole page is recorded, the slice is applied when playing back
+    DisplayListOutputDev recorder;
+    doc->displayPageSlice(&recorder, page, 72, 72, 0, useMediaBox, crop, printing, -1, -1, -1, -1, abortCheckCbk, abortCheckCbkData, annotDisplayDecideCbk, annotDisplayDecideCbkData, copyXRef);
+    const std::unique_ptr<DisplayList> list = recorder.takeDisplayList();
+    if (!list) {
+        return;
+    }
+
+    // SplashOutputDev draws shadings and tiling patterns itself, which the
+    // list can't play back, so such pages are drawn in one go
+    if (list->hasFlattenedPatterns()) {
+        doc->displayPageSlice(out, page, hDPI, vDPI, rotate, useMediaBox, crop, printing, sliceX, sliceY, sliceW, sliceH, abortCheckCbk, abortCheckCbkData, annotDisplayDecideCbk, annotDisplayDecideCbkData, copyXRef);
+        return;
+    }
+
+    // start and end the page in <out> without drawing anything, which sets
+    // up its bitmap
+    list->displaySlice(out, hDPI, vDPI, rotate, useMediaBox, crop, sliceX, sliceY, sliceW, sliceH, printing, abortAlways, nullptr);
+    SplashBitmap *bitmap = out->getBitmap();
+    const int w = bitmap->getWidth();
+    const int h = bitmap->getHeight();
+
+    // halftone screens are aligned on the bitmap origin, so bands would
+    // come out dithered differently
+    if (bitmap->getMode() == splashModeMono1 || h == 1) {
+        list->displaySlice(out, hDPI, vDPI, rotate, useMediaBox, crop, sliceX, sliceY, sliceW, sliceH, printing, abortCheckCbk, abortCheckCbkData);
+        return;
+    }
+
+    const int x0 = sliceW >= 0 && sliceH >= 0 ? sliceX : 0;
+    const int y0 = sliceW >= 0 && sliceH >= 0 ? sliceY : 0;
+
+    // more bands than threads, so that threads getting simpler bands
+    // don't wait for the others
+    const int nBands = std::min(h, 2 * nThreads);
+    const int bandHeight = (h + nBands - 1) / nBands;
+    std::atomic<int> nextBand = 0;
+    AbortState abortState { abortCheckCbk, abortCheckCbkData };
+
+    const auto renderBands = [&](bool callingThread) {
+        const std::unique_ptr<SplashOutputDev> bandOut = makeOutputDev();
+        const std::unique_ptr<XRef> xref = list->copyXRef();
+        int band;
+        while (!abortState.aborted && (band = nextBand++) < nBands) {
+            const int y = band * bandHeight;
+            if (y >= h) {
+                break;
+            }
+            list->displaySlice(bandOut.get(), hDPI, vDPI, rotate, useMediaBox, crop, x0, y0 + y, w, std::min(bandHeight, h - y), printing, callingThread ? checkAbortCallingThread : checkAbortWorker, &abortState, xref.get());
+            copyRows(bitmap, y, bandOut->getBitmap(), 0, bandHeight);
+        }
+    };
+
+    // the calling thread renders bands too
+    runThreads(std::min(nThreads, nBands), &abortState, renderBands, [] { });
+}
+
+bool SplashBandRenderer::displayPageSliceBands(PDFDoc *doc, int page, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, bool printing, int sliceX, int sliceY, int sliceW, int sliceH, int bandHeight,
+                                               const BandCallback &bandCbk, bool (*abortCheckCbk)(void *data), void *abortCheckCbkData, bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data),
+                                               void *annotDisplayDecideCbkData, bool copyXRef)
+{
+    DisplayListOutputDev recorder;
+    doc->displayPageSlice(&recorder, page, 72, 72, 0, useMediaBox, crop, printing, -1, -1, -1, -1, abortCheckCbk, abortCheckCbkData, annotDisplayDecideCbk, annotDisplayDecideCbkData, copyXRef);
+    const std::unique_ptr<DisplayList> list = recorder.takeDisplayList();
+    if (!list) {
+        return false;
+    }
+
+    int w, h;
+    getPageSliceSize(doc, page, hDPI, vDPI, rotate, useMediaBox, sliceX, sliceY, sliceW, sliceH, &w, &h);
+    const int x0 = sliceW >= 0 && sliceH >= 0 ? sliceX : 0;
+    const int y0 = sliceW >= 0 && sliceH >= 0 ? sliceY : 0;
+
+    const std::unique_ptr<SplashOutputDev> out = makeOutputDev();
+    if (out->getColorMode() == splashModeMono1) {
+        // halftone screens are aligned on the bitmap origin and are at most
+        // 64 pixels tall, so bands starting on multiples of 64 rows are
+        // dithered like the whole page
+        bandHeight = (bandHeight + 63) & ~63;
+    }
+    bandHeight = std::clamp(bandHeight, 1, h);
+
+    const int nBands = (h + bandHeight - 1) / bandHeight;
+
+    // SplashOutputDev draws shadings and tiling patterns itself, which the
+    // list can't play back, so the bands of such pages are drawn from the
+    // page, one after the other, each as a slice of the page; the shadings
+    // are sampled at the pixels of each band, which may round a few colors
+    // differently than drawing the page in one go
+    if (list->hasFlattenedPatterns()) {
+        for (int band = 0; band < nBands; ++band) {
+            const int y = band * bandHeight;
+            doc->displayPageSlice(out.get(), page, hDPI, vDPI, rotate, useMediaBox, crop, printing, x0, y0 + y, w, std::min(bandHeight, h - y), abortCheckCbk, abortCheckCbkData, annotDisplayDecideCbk, annotDisplayDecideCbkData,
+                                  copyXRef);
+            if ((abortCheckCbk && (*abortCheckCbk)(abortCheckCbkData)) || !bandCbk(out->getBitmap(), y)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::atomic<int> nextBand = 0;
+    int nextOutBand = 0; // guarded by outMutex
+    std::mutex outMutex;
+    std::condition_variable outCond;
+    AbortState abortState { abortCheckCbk, abortCheckCbkData };
+
+    const auto renderBands = [&](SplashOutputDev *bandOut, bool callingThread) {
+        const std::unique_ptr<XRef> xref = list->copyXRef();
+        int band;
+        while (!abortState.aborted && (band = nextBand++) < nBands) {
+            const int y = band * bandHeight;
+            list->displaySlice(bandOut, hDPI, vDPI, rotate, useMediaBox, crop, x0, y0 + y, w, std::min(bandHeight, h - y), printing, callingThread ? checkAbortCallingThread : checkAbortWorker, &abortState, xref.get());
+
+            // wait for the bands above to be handed out
+            std::unique_lock<std::mutex> lock(outMutex);
+            outCond.wait(lock, [&] { return nextOutBand == band || abortState.aborted; });
+            if (!abortState.aborted && !bandCbk(bandOut->getBitmap(), y)) {
+                abortState.aborted = true;
+            }
+            ++nextOutBand;
+            outCond.notify_all();
+        }
+
+        // wake up the threads waiting for a band that won't come
+        if (abortState.aborted) {
+            const std::lock_guard<std::mutex> lock(outMutex);
+            outCond.notify_all();
+        }
+    };
+
+    const auto run = [&](bool callingThread) {
+        if (callingThread) {
+            renderBands(out.get(), true);
+        } else {
+            renderBands(makeOutputDev().get(), false);
+        }
+    };
+    const auto wakeUp = [&] {
+        const std::lock_guard<std::mutex> lock(outMutex);
+        outCond.notify_all();
+    };
+    runThreads(std::min(nThreads, nBands), &abortState, run, wakeUp);
+    return !abortState.aborted;
+}
+
+void SplashBandRenderer::getPageSliceSize(PDFDoc *doc, int page, double hDPI, double vDPI, int rotate, bool useMediaBox, int sliceX, int sliceY, int sliceW, int sliceH, int *width, int *height)
+{
+    // compute the size like Page::createGfx and SplashOutputDev::startPage do
+    Page *p = doc->getPage(page);
+    if (!p) {
+        *width = *height = 1;
+        return;
+    }
+    rotate += p->getRotate();
+    if (rotate >= 360) {
+        rotate -= 360;
+    } else if (rotate < 0) {
+        rotate += 360;
+    }
+    PDFRectangle box;
+    bool crop = false;
+    p->makeBox(hDPI, vDPI, rotate, useMediaBox, true, sliceX, sliceY, sliceW, sliceH, &box, &crop);
+    const GfxState state(hDPI, vDPI, &box, rotate, true);
+    *width = std::max(static_cast<int>(state.getPageWidth() + 0.5), 1);
+    *height = std::max(static_cast<int>(state.getPageHeight() + 0.5), 1);
+}
@@ -0,0 +1,87 @@
+//========================================================================
+//
+// SplashBandRenderer.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHBANDRENDERER_H
+#define SPLASHBANDRENDERER_H
+
+#include <functional>
+#include <memory>
+
+#include "poppler_private_export.h"
+
+class Annot;
+class PDFDoc;
+class SplashBitmap;
+class SplashOutputDev;
+
+//------------------------------------------------------------------------
+// SplashBandRenderer
+//
+// Rasterizes a single page with several threads.  The page is parsed
+// once into a DisplayList, which is then played back into horizontal
+// bands of the page, each drawn by its own SplashOutputDev, and the bands
+// are copied into the bitmap of the caller's SplashOutputDev, or handed
+// to the caller one after the other without ever drawing the whole page
+// into one bitmap.  The bands share the parsed resources, fonts and
+// decoded images of the list.
+//
+// The list only has shadings and tiling patterns as the fills Gfx
+// decomposes them into, which SplashOutputDev draws differently, so pages
+// with shadings or patterns are drawn in one go by a single thread, and
+// displayPageSliceBands draws each band from the page in turn.
+//
+// Exceptions thrown by the OutputDev factory or the band callback, from
+// any thread, stop the rendering and are rethrown to the caller once all
+// the threads are done.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT SplashBandRenderer
+{
+public:
+    // Returns a new SplashOutputDev set up like the one the page is
+    // rendered into, and started with startDoc for the same PDFDoc.
+    using OutputDevFactory = std::function<std::unique_ptr<SplashOutputDev>()>;
+
+    // Called with each band of the page and the row of the page it starts
+    // at; returns false to stop rendering.
+    using BandCallback = std::function<bool(SplashBitmap *band, int y)>;
+
+    SplashBandRenderer(int nThreadsA, OutputDevFactory makeOutputDevA);
+    ~SplashBandRenderer();
+
+    SplashBandRenderer(const SplashBandRenderer &) = delete;
+    SplashBandRenderer &operator=(const SplashBandRenderer &) = delete;
+
+    // Render the page into <out>, which must already have been started
+    // with startDoc; afterwards, out->getBitmap() holds the image
+    // PDFDoc::displayPageSlice would have drawn, up to rounding in a few
+    // anti-aliased pixels.  <abortCheckCbk> is only called from the
+    // calling thread.  <copyXRef> is used for parsing the page, the bands
+    // always use a copy.
+    void displayPageSlice(SplashOutputDev *out, PDFDoc *doc, int page, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, bool printing, int sliceX, int sliceY, int sliceW, int sliceH,
+                          bool (*abortCheckCbk)(void *data) = nullptr, void *abortCheckCbkData = nullptr, bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data) = nullptr, void *annotDisplayDecideCbkData = nullptr,
+                          bool copyXRef = false);
+
+    // Render the page in bands of about <bandHeight> rows and pass them to
+    // <bandCbk> from top to bottom, serialized but from any of the
+    // threads.  At most one band per thread is held in memory, and a band
+    // may only be used until <bandCbk> returns.  Returns false if the
+    // rendering was aborted or stopped by <bandCbk>.
+    bool displayPageSliceBands(PDFDoc *doc, int page, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, bool printing, int sliceX, int sliceY, int sliceW, int sliceH, int bandHeight, const BandCallback &bandCbk,
+                               bool (*abortCheckCbk)(void *data) = nullptr, void *abortCheckCbkData = nullptr, bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data) = nullptr, void *annotDisplayDecideCbkData = nullptr,
+                               bool copyXRef = false);
+
+    // Return the size of the bitmap displayPageSlice draws the page in.
+    static void getPageSliceSize(PDFDoc *doc, int page, double hDPI, double vDPI, int rotate, bool useMediaBox, int sliceX, int sliceY, int sliceW, int sliceH, int *width, int *height);
+
+private:
+    const int nThreads;
+    const OutputDevFactory makeOutputDev;
+};
+
+#endif
@@ -71,6 +71,8 @@
 #include "fofi/FoFiTrueType.h"
 #include "goo/gmem.h"
 #include "splash/SplashBitmap.h"
+#include "splash/SplashBitmapPool.h"
+#include "splash/SplashClip.h"
 #include "splash/SplashGlyphBitmap.h"
 #include "splash/SplashPattern.h"
 #include "splash/SplashPath.h"
@@ -271,7 +273,7 @@ bool SplashFunctionPattern::getColor(int x, int y, SplashColorPtr c) const
 // SplashUnivariatePattern
 //------------------------------------------------------------------------
 
-SplashUnivariatePattern::SplashUnivariatePattern(SplashColorMode colorModeA, GfxState *stateA, GfxUnivariateShading *shadingA)
+SplashUnivariatePattern::SplashUnivariatePattern(SplashColorMode colorModeA, GfxState *stateA, GfxUnivariateShading *shadingA, std::shared_ptr<const SplashShadingRamp> rampA) : ramp(std::move(rampA))
 {
     Matrix ctm;
     double xMin, yMin, xMax, yMax;
@@ -288,8 +290,13 @@ SplashUnivariatePattern::SplashUnivariatePattern(SplashColorMode colorModeA, Gfx
     t1 = shading->getDomain1();
     dt = t1 - t0;
 
-    stateA->getUserClipBBox(&xMin, &yMin, &xMax, &yMax);
-    shadingA->setupCache(&ctm, xMin, yMin, xMax, yMax);
+    if (ramp) {
+        rampScale = (ramp->size > 1 && dt != 0) ? (ramp->size - 1) / dt : 0;
+    } else {
+        rampScale = 0;
+        stateA->getUserClipBBox(&xMin, &yMin, &xMax, &yMax);
+        shadingA->setupCache(&ctm, xMin, yMin, xMax, yMax);
+    }
     gfxMode = shadingA->getColorSpace()->getMode();
 }
 
@@ -305,6 +312,21 @@ bool SplashUnivariatePattern::getColor(int x, int y, SplashColorPtr c) const
         return false;
     }
 
+    if (ramp) {
+        // getParameter() keeps t within the domain; blend the two
+        // neighbouring samples with an 8-bit weight
+        const int nComps = splashColorModeNComps[colorMode];
+        double i = (t - t0) * rampScale;
+        i = i > 0 ? std::min(i, ramp->size - 1.0) : 0;
+        const int j = std::min(static_cast<int>(i), ramp->size - 2);
+        const int w = static_cast<int>((i - j) * 256 + 0.5);
+        const unsigned char *p = &ramp->colors[static_cast<size_t>(j) * nComps];
+        for (int k = 0; k < nComps; ++k) {
+            c[k] = static_cast<unsigned char>((p[k] * (256 - w) + p[k + nComps] * w + 128) >> 8);
+        }
+        return true;
+    }
+
     const int filled = shading->getColor(t, &gfxColor);
     if (unlikely(filled < shading->getColorSpace()->getNComps())) {
         for (int i = filled; i < shading->getColorSpace()->getNComps(); ++i) {
@@ -331,7 +353,7 @@ bool SplashUnivariatePattern::testPosition(int x, int y) const
 //------------------------------------------------------------------------
 #define RADIAL_EPSILON (1. / 1024 / 1024)
 
-SplashRadialPattern::SplashRadialPattern(SplashColorMode colorModeA, GfxState *stateA, GfxRadialShading *shadingA) : SplashUnivariatePattern(colorModeA, stateA, shadingA)
+SplashRadialPattern::SplashRadialPattern(SplashColorMode colorModeA, GfxState *stateA, GfxRadialShading *shadingA, std::shared_ptr<const SplashShadingRamp> rampA) : SplashUnivariatePattern(colorModeA, stateA, shadingA, std::move(rampA))
 {
     SplashColor defaultColor;
     GfxColor srcColor;
@@ -446,7 +468,7 @@ bool SplashRadialPattern::getParameter(double xs, double ys, double *t) const
 // SplashAxialPattern
 //------------------------------------------------------------------------
 
-SplashAxialPattern::SplashAxialPattern(SplashColorMode colorModeA, GfxState *stateA, GfxAxialShading *shadingA) : SplashUnivariatePattern(colorModeA, stateA, shadingA)
+SplashAxialPattern::SplashAxialPattern(SplashColorMode colorModeA, GfxState *stateA, GfxAxialShading *shadingA, std::shared_ptr<const SplashShadingRamp> rampA) : SplashUnivariatePattern(colorModeA, stateA, shadingA, std::move(rampA))
 {
     SplashColor defaultColor;
     GfxColor srcColor;
@@ -493,6 +515,19 @@ constexpr int type3FontCacheAssoc = 8;
 constexpr int type3FontCacheMaxSets = 8;
 constexpr int type3FontCacheSize = 128 * 1024;
 
+//------------------------------------------------------------------------
+// Shading ramp parameters
+constexpr int shadingRampMinSize = 256;
+constexpr int shadingRampMaxSize = 65536;
+constexpr int shadingRampChunk = 256; // samples evaluated per batch
+constexpr int shadingRampCacheSize = 32;
+
+//------------------------------------------------------------------------
+// Bitmap pool parameters: temporary bitmaps are kept up to this many
+// times the size of the page bitmap, and at most bitmapPoolMaxSize bytes
+constexpr size_t bitmapPoolPages = 2;
+constexpr size_t bitmapPoolMaxSize = 64 * 1024 * 1024;
+
 //------------------------------------------------------------------------
 // Divide a 16-bit value (in [0, 255*255]) by 255, returning an 8-bit result.
 static inline unsigned char div255(int x)
@@ -1228,6 +1263,9 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA, int bitmapRowPadA,
     bitmapTopDown = bitmapTopDownA;
     fontAntialias = true;
     vectorAntialias = true;
+    analyticAntialias = false;
+    lanczosImageDownscaling = false;
+    shadingRamps = true;
     overprintPreview = overprintPreviewA;
     enableFreeType = true;
     enableFreeTypeHinting = false;
@@ -1244,6 +1282,7 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA, int bitmapRowPadA,
 
     doc = nullptr;
 
+    bitmapPool = new SplashBitmapPool(0); // sized by startPage
     bitmap = new SplashBitmap(1, 1, bitmapRowPad, colorMode, colorMode != splashModeMono1, bitmapTopDown);
     splash = new Splash(bitmap, vectorAntialias, &screenParams);
     splash->setMinLineWidth(s_minLineWidth);
@@ -1295,6 +1334,7 @@ SplashOutputDev::~SplashOutputDev()
     delete fontEngine;
     delete splash;
     delete bitmap;
+    delete bitmapPool;
     delete textClipPath;
 }
 
@@ -1309,6 +1349,7 @@ void SplashOutputDev::startDoc(PDFDoc *docA)
         delete t3FontCache[i];
     }
     nT3Fonts = 0;
+    shadingRampCache.clear();
 }
 
 void SplashOutputDev::startPage(int /*pageNum*/, GfxState *state, XRef *xrefA)
@@ -1336,7 +1377,20 @@ void SplashOutputDev::startPage(int /*pageNum*/, GfxState *state, XRef *xrefA)
         delete splash;
         splash = nullptr;
     }
-    if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight()) {
+    SplashColorPtr bufferData = nullptr;
+    int bufferRowSize = 0;
+    if (bitmapBufferFunc) {
+        bufferData = bitmapBufferFunc(w, h, &bufferRowSize);
+    }
+    if (bufferData) {
+        delete bitmap;
+        bitmap = new SplashBitmap(bitmapTopDown ? bufferData : bufferData + static_cast<ptrdiff_t>(h - 1) * bufferRowSize, w, h, bitmapTopDown ? bufferRowSize : -bufferRowSize, colorMode, colorMode != splashModeMono1);
+        if (!bitmap->getDataPtr()) {
+            delete bitmap;
+            w = h = 1;
+            bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, colorMode != splashModeMono1, bitmapTopDown);
+        }
+    } else if (!bitmap || bitmap->hasExternalData() || w != bitmap->getWidth() || h != bitmap->getHeight()) {
         if (bitmap) {
             delete bitmap;
             bitmap = nullptr;
@@ -1348,8 +1402,17 @@ void SplashOutputDev::startPage(int /*pageNum*/, GfxState *state, XRef *xrefA)
             bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, colorMode != splashModeMono1, bitmapTopDown);
         }
     }
+    // temporary bitmaps are at most the size of the page, so devices
+    // drawing small pages or bands don't keep more than they need
+    size_t pageBytes = static_cast<size_t>(std::abs(bitmap->getRowSize())) * bitmap->getHeight();
+    if (bitmap->getAlphaPtr()) {
+        pageBytes += static_cast<size_t>(bitmap->getAlphaRowSize()) * bitmap->getHeight();
+    }
+    bitmapPool->setMaxSize(std::min(bitmapPoolPages * pageBytes, bitmapPoolMaxSize));
     splash = new Splash(bitmap, vectorAntialias, &screenParams);
     splash->setThinLineMode(thinLineMode);
+    splash->setAnalyticAA(analyticAntialias);
+    splash->setLanczosDownscaling(lanczosImageDownscaling);
     splash->setMinLineWidth(s_minLineWidth);
     if (state) {
         splash->setMatrix(state->getCTM());
@@ -1756,30 +1819,35 @@ void SplashOutputDev::updateOverprintMode(GfxState *state)
 void SplashOutputDev::updateTransfer(GfxState *state)
 {
     unsigned char red[256], green[256], blue[256], gray[256];
-    double x, y;
+    double x[256], y[256];
     int i;
 
+    const auto toTable = [&y](unsigned char *table) {
+        for (int j = 0; j < 256; ++j) {
+            table[j] = static_cast<unsigned char>(y[j] * 255.0 + 0.5);
+        }
+    };
     const std::vector<std::unique_ptr<Function>> &transfer = state->getTransfer();
     if (!transfer.empty() && transfer[0]->getInputSize() == 1 && transfer[0]->getOutputSize() == 1) {
+        for (i = 0; i < 256; ++i) {
+            x[i] = i / 255.0;
+        }
         if (transfer.size() == 4 && transfer[1]->getInputSize() == 1 && transfer[1]->getOutputSize() == 1 && transfer[2]->getInputSize() == 1 && transfer[2]->getOutputSize() == 1 && transfer[3]->getInputSize() == 1
             && transfer[3]->getOutputSize() == 1) {
-            for (i = 0; i < 256; ++i) {
-                x = i / 255.0;
-                transfer[0]->transform(&x, &y);
-                red[i] = static_cast<unsigned char>(y * 255.0 + 0.5);
-                transfer[1]->transform(&x, &y);
-                green[i] = static_cast<unsigned char>(y * 255.0 + 0.5);
-                transfer[2]->transform(&x, &y);
-                blue[i] = static_cast<unsigned char>(y * 255.0 + 0.5);
-                transfer[3]->transform(&x, &y);
-                gray[i] = static_cast<unsigned char>(y * 255.0 + 0.5);
-            }
+            transfer[0]->transformBatch(x, y, 256);
+            toTable(red);
+            transfer[1]->transformBatch(x, y, 256);
+            toTable(green);
+            transfer[2]->transformBatch(x, y, 256);
+            toTable(blue);
+            transfer[3]->transformBatch(x, y, 256);
+            toTable(gray);
         } else {
-            for (i = 0; i < 256; ++i) {
-                x = i / 255.0;
-                transfer[0]->transform(&x, &y);
-                red[i] = green[i] = blue[i] = gray[i] = static_cast<unsigned char>(y * 255.0 + 0.5);
-            }
+            transfer[0]->transformBatch(x, y, 256);
+            toTable(red);
+            memcpy(green, red, 256);
+            memcpy(blue, red, 256);
+            memcpy(gray, red, 256);
         }
     } else {
         for (i = 0; i < 256; ++i) {
@@ -2494,6 +2562,7 @@ void SplashOutputDev::type3D1(GfxState *state, double /*wx*/, double /*wy*/, dou
     } else {
         bitmap = new SplashBitmap(t3Font->glyphW, t3Font->glyphH, 1, splashModeMono8, false);
         splash = new Splash(bitmap, vectorAntialias, t3GlyphStack->origSplash->getScreen());
+        splash->setAnalyticAA(analyticAntialias);
         color[0] = 0x00;
         splash->clear(color);
         color[0] = 0xff;
@@ -2643,8 +2712,9 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state, Object * /*ref*/
     imgMaskData.height = height;
     imgMaskData.y = 0;
 
-    transpGroupStack->softmask = new SplashBitmap(bitmap->getWidth(), bitmap->getHeight(), 1, splashModeMono8, false);
+    transpGroupStack->softmask = bitmapPool->take(bitmap->getWidth(), bitmap->getHeight(), 1, splashModeMono8, false);
     maskSplash = new Splash(transpGroupStack->softmask, vectorAntialias);
+    maskSplash->setAnalyticAA(analyticAntialias);
     maskColor[0] = 0;
     maskSplash->clear(maskColor);
     maskColor[0] = 0xff;
@@ -2671,7 +2741,7 @@ void SplashOutputDev::unsetSoftMaskFromImageMask(GfxState *state, std::array<dou
         for (int c = 0; c < transpGroupStack->softmask->getRowSize() * transpGroupStack->softmask->getHeight(); c++) {
             dest[c] = src[c];
         }
-        delete transpGroupStack->softmask;
+        bitmapPool->give(transpGroupStack->softmask);
         transpGroupStack->softmask = nullptr;
     }
     endTransparencyGroup(state);
@@ -2742,10 +2812,7 @@ bool SplashOutputDev::imageSrc(void *data, SplashColorPtr colorLine, unsigned ch
     auto *imgData = static_cast<SplashOutImageData *>(data);
     unsigned char *p;
     SplashColorPtr q, col;
-    GfxRGB rgb;
     GfxGray gray;
-    GfxCMYK cmyk;
-    GfxColor deviceN;
     int nComps, x;
 
     if (imgData->y == imgData->height) {
@@ -2823,54 +2890,16 @@ bool SplashOutputDev::imageSrc(void *data, SplashColorPtr colorLine, unsigned ch
             break;
         case splashModeRGB8:
         case splashModeBGR8:
-            if (imgData->colorMap->useRGBLine()) {
-                imgData->colorMap->getRGBLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
-            } else {
-                for (x = 0, q = colorLine; x < imgData->width; ++x, p += nComps) {
-                    imgData->colorMap->getRGB(p, &rgb);
-                    *q++ = colToByte(rgb.r);
-                    *q++ = colToByte(rgb.g);
-                    *q++ = colToByte(rgb.b);
-                }
-            }
+            imgData->colorMap->getRGBLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
             break;
         case splashModeXBGR8:
-            if (imgData->colorMap->useRGBLine()) {
-                imgData->colorMap->getRGBXLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
-            } else {
-                for (x = 0, q = colorLine; x < imgData->width; ++x, p += nComps) {
-                    imgData->colorMap->getRGB(p, &rgb);
-                    *q++ = colToByte(rgb.r);
-                    *q++ = colToByte(rgb.g);
-                    *q++ = colToByte(rgb.b);
-                    *q++ = 255;
-                }
-            }
+            imgData->colorMap->getRGBXLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
             break;
         case splashModeCMYK8:
-            if (imgData->colorMap->useCMYKLine()) {
-                imgData->colorMap->getCMYKLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
-            } else {
-                for (x = 0, q = colorLine; x < imgData->width; ++x, p += nComps) {
-                    imgData->colorMap->getCMYK(p, &cmyk);
-                    *q++ = colToByte(cmyk.c);
-                    *q++ = colToByte(cmyk.m);
-                    *q++ = colToByte(cmyk.y);
-                    *q++ = colToByte(cmyk.k);
-                }
-            }
+            imgData->colorMap->getCMYKLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
             break;
         case splashModeDeviceN8:
-            if (imgData->colorMap->useDeviceNLine()) {
-                imgData->colorMap->getDeviceNLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
-            } else {
-                for (x = 0, q = colorLine; x < imgData->width; ++x, p += nComps) {
-                    imgData->colorMap->getDeviceN(p, &deviceN);
-                    for (int cp = 0; cp < SPOT_NCOMPS + 4; cp++) {
-                        *q++ = colToByte(deviceN.c[cp]);
-                    }
-                }
-            }
+            imgData->colorMap->getDeviceNLine(p, static_cast<unsigned char *>(colorLine), imgData->width);
             break;
         }
     }
@@ -3674,7 +3703,7 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object * /* ref */, S
         maskColorMap->getGray(&pix, &gray);
         imgMaskData.lookup[i] = colToByte(gray);
     }
-    maskBitmap = new SplashBitmap(bitmap->getWidth(), bitmap->getHeight(), 1, splashModeMono8, false);
+    maskBitmap = bitmapPool->take(bitmap->getWidth(), bitmap->getHeight(), 1, splashModeMono8, false);
     {
         Splash maskSplash { maskBitmap, vectorAntialias };
         maskColor[0] = 0;
@@ -3685,7 +3714,7 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object * /* ref */, S
         }
         gfree(imgMaskData.lookup);
     }
-    splash->setSoftMask(maskBitmap);
+    splash->setSoftMask(maskBitmap, bitmapPool);
 
     //----- draw the source image
 
@@ -3846,6 +3875,15 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, const std::array<d
     } else if (y > yMax) {
         yMax = y;
     }
+
+    // nothing outside the clip region is painted from the group, and
+    // nothing outside it is drawn with a soft mask
+    const SplashClip &clip = splash->getClip();
+    xMin = std::max(xMin, clip.getXMin());
+    yMin = std::max(yMin, clip.getYMin());
+    xMax = std::min(xMax, clip.getXMax());
+    yMax = std::min(yMax, clip.getYMax());
+
     tx = static_cast<int>(floor(xMin));
     if (tx < 0) {
         tx = 0;
@@ -3884,7 +3922,7 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, const std::array<d
     transpGroup->ty = ty;
     transpGroup->blendingColorSpace = blendingColorSpace;
     transpGroup->isolated = isolated;
-    transpGroup->shape = (knockout && !isolated) ? SplashBitmap::copy(bitmap) : nullptr;
+    transpGroup->shape = (knockout && !isolated) ? bitmapPool->takeCopy(bitmap) : nullptr;
     transpGroup->knockout = (knockout && isolated);
     transpGroup->knockoutOpacity = 1.0;
     transpGroup->backdropBitmap = nullptr;
@@ -3912,14 +3950,16 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, const std::array<d
     }
 
     // create the temporary bitmap
-    bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, true, bitmapTopDown, bitmap->getSeparationList());
+    bitmap = bitmapPool->take(w, h, bitmapRowPad, colorMode, true, bitmapTopDown, bitmap->getSeparationList());
     if (!bitmap->getDataPtr()) {
-        delete bitmap;
+        bitmapPool->give(bitmap);
         w = h = 1;
-        bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, true, bitmapTopDown);
+        bitmap = bitmapPool->take(w, h, bitmapRowPad, colorMode, true, bitmapTopDown);
     }
     splash = new Splash(bitmap, vectorAntialias, transpGroup->origSplash->getScreen());
     splash->setThinLineMode(transpGroup->origSplash->getThinLineMode());
+    splash->setAnalyticAA(analyticAntialias);
+    splash->setLanczosDownscaling(lanczosImageDownscaling);
     splash->setMinLineWidth(s_minLineWidth);
     //~ Acrobat apparently copies at least the fill and stroke colors, and
     //~ maybe other state(?) -- but not the clipping path (and not sure
@@ -3941,7 +3981,7 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, const std::array<d
         if (!isolated && transpGroup->origBitmap->getAlphaPtr() && transpGroup->origSplash->getInNonIsolatedGroup()) {
             // when drawing a non-isolated group into another non-isolated group,
             // compute a backdrop bitmap with corrected alpha values
-            auto *backdropBitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, true, bitmapTopDown);
+            SplashBitmap *backdropBitmap = bitmapPool->take(w, h, bitmapRowPad, colorMode, true, bitmapTopDown);
             transpGroup->origSplash->blitCorrectedAlpha(backdropBitmap, tx, ty, 0, 0, w, h);
             transpGroup->backdropBitmap = backdropBitmap;
             splash->setInTransparencyGroup(backdropBitmap, 0, 0, true, knockout);
@@ -3998,11 +4038,11 @@ void SplashOutputDev::paintTransparencyGroup(GfxState * /*state*/, const std::ar
     if (transpGroupStack != nullptr && transpGroup->knockoutOpacity < transpGroupStack->knockoutOpacity) {
         transpGroupStack->knockoutOpacity = transpGroup->knockoutOpacity;
     }
-    delete transpGroup->shape;
-    delete transpGroup->backdropBitmap;
+    bitmapPool->give(transpGroup->shape);
+    bitmapPool->give(transpGroup->backdropBitmap);
     delete transpGroup;
 
-    delete tBitmap;
+    bitmapPool->give(tBitmap);
 }
 
 void SplashOutputDev::setSoftMask(GfxState * /*state*/, const std::array<double, 4> & /*bbox*/, bool alpha, Function *transferFunc, GfxColor *backdropColor)
@@ -4016,7 +4056,6 @@ void SplashOutputDev::setSoftMask(GfxState * /*state*/, const std::array<double,
     GfxRGB rgb;
     GfxCMYK cmyk;
     GfxColor deviceN;
-    double lum, lum2;
     int tx, ty, x, y;
 
     tx = transpGroupStack->tx;
@@ -4029,6 +4068,7 @@ void SplashOutputDev::setSoftMask(GfxState * /*state*/, const std::array<double,
         //~ space is given
         if (transpGroupStack->blendingColorSpace) {
             tSplash = new Splash(tBitmap, vectorAntialias, transpGroupStack->origSplash->getScreen());
+            tSplash->setAnalyticAA(analyticAntialias);
             switch (tBitmap->getMode()) {
             case splashModeMono1:
                 // transparency is not supported in mono1 mode
@@ -4069,10 +4109,10 @@ void SplashOutputDev::setSoftMask(GfxState * /*state*/, const std::array<double,
         }
     }
 
-    auto *softMask = new SplashBitmap(bitmap->getWidth(), bitmap->getHeight(), 1, splashModeMono8, false);
+    SplashBitmap *softMask = bitmapPool->take(bitmap->getWidth(), bitmap->getHeight(), 1, splashModeMono8, false);
     if (!softMask->getDataPtr()) {
-        delete softMask;
-        softMask = new SplashBitmap(1, 1, 1, splashModeMono8, false);
+        bitmapPool->give(softMask);
+        softMask = bitmapPool->take(1, 1, 1, splashModeMono8, false);
     }
     unsigned char fill = 0;
     if (transpGroupStack->blendingColorSpace) {
@@ -4089,56 +4129,73 @@ void SplashOutputDev::setSoftMask(GfxState * /*state*/, const std::array<double,
     if (yMax > softMask->getHeight() - ty) {
         yMax = softMask->getHeight() - ty;
     }
+    // the transfer function takes the alphas through a table, and the
+    // luminosities a row at a time
+    unsigned char alphaTransfer[256];
+    if (alpha && transferFunc) {
+        double in[256], out[256];
+        for (int i = 0; i < 256; ++i) {
+            in[i] = i / 255.0;
+        }
+        transferFunc->transformBatch(in, out, 256);
+        for (int i = 0; i < 256; ++i) {
+            alphaTransfer[i] = static_cast<int>(out[i] * 255.0 + 0.5);
+        }
+    }
+    std::vector<double> lum, lum2;
+    if (!alpha && xMax > 0) {
+        lum.resize(xMax);
+        lum2.resize(xMax);
+    }
     for (y = 0; y < yMax; ++y) {
-        for (x = 0; x < xMax; ++x) {
-            if (alpha) {
-                if (transferFunc) {
-                    lum = tBitmap->getAlpha(x, y) / 255.0;
-                    transferFunc->transform(&lum, &lum2);
-                    p[x] = static_cast<int>(lum2 * 255.0 + 0.5);
-                } else {
-                    p[x] = tBitmap->getAlpha(x, y);
-                }
-            } else {
+        if (alpha) {
+            for (x = 0; x < xMax; ++x) {
+                p[x] = transferFunc ? alphaTransfer[tBitmap->getAlpha(x, y)] : tBitmap->getAlpha(x, y);
+            }
+        } else {
+            for (x = 0; x < xMax; ++x) {
                 tBitmap->getPixel(x, y, color);
                 // convert to luminosity
                 switch (tBitmap->getMode()) {
                 case splashModeMono1:
                 case splashModeMono8:
-                    lum = color[0] / 255.0;
+                    lum[x] = color[0] / 255.0;
                     break;
                 case splashModeXBGR8:
                 case splashModeRGB8:
                 case splashModeBGR8:
-                    lum = (0.3 / 255.0) * color[0] + (0.59 / 255.0) * color[1] + (0.11 / 255.0) * color[2];
+                    lum[x] = (0.3 / 255.0) * color[0] + (0.59 / 255.0) * color[1] + (0.11 / 255.0) * color[2];
                     break;
                 case splashModeCMYK8:
                 case splashModeDeviceN8:
-                    lum = (1 - color[3] / 255.0) - (0.3 / 255.0) * color[0] - (0.59 / 255.0) * color[1] - (0.11 / 255.0) * color[2];
-                    if (lum < 0) {
-                        lum = 0;
+                    lum[x] = (1 - color[3] / 255.0) - (0.3 / 255.0) * color[0] - (0.59 / 255.0) * color[1] - (0.11 / 255.0) * color[2];
+                    if (lum[x] < 0) {
+                        lum[x] = 0;
                     }
                     break;
                 }
-                if (transferFunc) {
-                    transferFunc->transform(&lum, &lum2);
-                } else {
-                    lum2 = lum;
-                }
-                p[x] = static_cast<int>(lum2 * 255.0 + 0.5);
+            }
+            if (transferFunc) {
+                transferFunc->transformBatch(lum.data(), lum2.data(), xMax);
+            } else {
+                std::copy_n(lum.begin(), xMax, lum2.begin());
+            }
+            for (x = 0; x < xMax; ++x) {
+                p[x] = static_cast<int>(lum2[x] * 255.0 + 0.5);
             }
         }
         p += softMask->getRowSize();
     }
-    splash->setSoftMask(softMask);
+    splash->setSoftMask(softMask, bitmapPool);
 
     // pop the stack
     transpGroup = transpGroupStack;
     transpGroupStack = transpGroup->next;
-    delete transpGroup->backdropBitmap;
+    bitmapPool->give(transpGroup->shape);
+    bitmapPool->give(transpGroup->backdropBitmap);
     delete transpGroup;
 
-    delete tBitmap;
+    bitmapPool->give(tBitmap);
 }
 
 void SplashOutputDev::clearSoftMask(GfxState * /*state*/)
@@ -4184,6 +4241,18 @@ void SplashOutputDev::setVectorAntialias(bool vaa)
 }
 #endif
 
+void SplashOutputDev::setAnalyticAntialias(bool aaa)
+{
+    analyticAntialias = aaa;
+    splash->setAnalyticAA(aaa);
+}
+
+void SplashOutputDev::setLanczosImageDownscaling(bool lanczos)
+{
+    lanczosImageDownscaling = lanczos;
+    splash->setLanczosDownscaling(lanczos);
+}
+
 void SplashOutputDev::setFreeTypeHinting(bool enable, bool enableSlightHintingA)
 {
     enableFreeTypeHinting = enable;
@@ -4354,15 +4423,16 @@ bool SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog * /*
     matc[3] = ctm[3];
 
     const bool doFastBlit = matc[0] > 0 && matc[1] == 0 && matc[2] == 0 && matc[3] > 0;
-    bitmap = new SplashBitmap(surface_width, surface_height, 1, (paintType == 1 || doFastBlit) ? colorMode : splashModeMono8, true);
+    bitmap = bitmapPool->take(surface_width, surface_height, 1, (paintType == 1 || doFastBlit) ? colorMode : splashModeMono8, true);
     if (bitmap->getDataPtr() == nullptr) {
         SplashBitmap *tBitmap = bitmap;
         bitmap = formerBitmap;
-        delete tBitmap;
+        bitmapPool->give(tBitmap);
         state->setCTM(savedCTM[0], savedCTM[1], savedCTM[2], savedCTM[3], savedCTM[4], savedCTM[5]);
         return false;
     }
     splash = new Splash(bitmap, true);
+    splash->setAnalyticAA(analyticAntialias);
     updateCTM(gfx->getState(), m1.m[0], m1.m[1], m1.m[2], m1.m[3], m1.m[4], m1.m[5]);
 
     if (paintType == 2) {
@@ -4373,6 +4443,7 @@ bool SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog * /*
         splash->clear(paperColor, 0);
     }
     splash->setThinLineMode(formerSplash->getThinLineMode());
+    splash->setLanczosDownscaling(lanczosImageDownscaling);
     splash->setMinLineWidth(s_minLineWidth);
     if (doFastBlit) {
         // drawImage would colorize the greyscale pattern in tilingBitmapSrc buffer accessor while tiling.
@@ -4407,7 +4478,7 @@ bool SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog * /*
     } else {
         retValue = splash->drawImage(&tilingBitmapSrc, nullptr, &imgData, colorMode, true, result_width, result_height, matc, false, true) == SplashError::NoError;
     }
-    delete tBitmap;
+    bitmapPool->give(tBitmap);
     if (!retValue) {
         state->setCTM(savedCTM[0], savedCTM[1], savedCTM[2], savedCTM[3], savedCTM[4], savedCTM[5]);
     }
@@ -4565,9 +4636,104 @@ bool SplashOutputDev::functionShadedFill(GfxState *state, GfxFunctionShading *sh
     return retVal;
 }
 
+// Sample the colors of a shading into a ramp with at least one sample
+// per device pixel along the shading.  Ramps of shading objects are
+// kept across fills and pages, for the color conversion they were made
+// with, and a finer ramp serves coarser fills.
+std::shared_ptr<const SplashShadingRamp> SplashOutputDev::getShadingRamp(GfxState *state, GfxUnivariateShading *shading)
+{
+    Matrix ctm;
+    double xMin, yMin, xMax, yMax;
+
+    if (!shadingRamps || unlikely(shading->getNFuncs() < 1)) {
+        return {};
+    }
+
+    state->getCTM(&ctm);
+    const double extent = ctm.norm() * shading->getDistance(0, 1);
+    if (!(extent >= 0)) {
+        return {};
+    }
+    int size = shadingRampMinSize;
+    while (size < shadingRampMaxSize && size <= extent) {
+        size *= 2;
+    }
+
+    // the ramp colors depend on the rendering intent and, with color
+    // management, on the display profile, and the DeviceN mapping on the
+    // separations seen so far
+    GfxColorSpace *colorSpace = shading->getColorSpace();
+    ShadingRampCacheEntry key;
+    key.ref = shading->getRef();
+    key.renderingIntent = state->getRenderingIntent();
+    key.colorSpaceMode = colorSpace->getMode();
+    key.iccProfile = key.colorSpaceMode == csICCBased ? static_cast<GfxICCBasedColorSpace *>(colorSpace)->getRef() : Ref::INVALID();
+#if USE_CMS
+    key.displayProfile = state->getDisplayProfile();
+#endif
+    const bool cacheable = key.ref != Ref::INVALID() && colorMode != splashModeDeviceN8;
+    const auto isShadingEntry = [&key](const ShadingRampCacheEntry &entry) {
+        return entry.ref == key.ref && entry.renderingIntent == key.renderingIntent && entry.colorSpaceMode == key.colorSpaceMode && entry.iccProfile == key.iccProfile
+#if USE_CMS
+                && entry.displayProfile == key.displayProfile
+#endif
+                ;
+    };
+    if (cacheable) {
+        for (auto it = shadingRampCache.begin(); it != shadingRampCache.end(); ++it) {
+            if (isShadingEntry(*it) && it->ramp->size >= size) {
+                std::rotate(it, it + 1, shadingRampCache.end());
+                return shadingRampCache.back().ramp;
+            }
+        }
+    } else {
+        // a one-off ramp only pays off if it is smaller than the fill
+        state->getClipBBox(&xMin, &yMin, &xMax, &yMax);
+        if (size > (xMax - xMin) * (yMax - yMin)) {
+            return {};
+        }
+    }
+
+    const int nComps = splashColorModeNComps[colorMode];
+    const double t0 = shading->getDomain0();
+    const double dt = (shading->getDomain1() - t0) / (size - 1);
+    auto ramp = std::make_shared<SplashShadingRamp>();
+    ramp->size = size;
+    ramp->colors.resize(static_cast<size_t>(size) * nComps);
+
+    colorSpace->createMapping(bitmap->getSeparationList(), SPOT_NCOMPS);
+    double t[shadingRampChunk];
+    GfxColor colors[shadingRampChunk];
+    for (int i = 0; i < size; i += shadingRampChunk) {
+        const int n = std::min(shadingRampChunk, size - i);
+        for (int j = 0; j < n; ++j) {
+            t[j] = t0 + (i + j) * dt;
+        }
+        const int filled = shading->getColorBatch(t, colors, n);
+        for (int j = 0; j < n; ++j) {
+            SplashColor color;
+            for (int k = filled; k < colorSpace->getNComps(); ++k) {
+                colors[j].c[k] = 0;
+            }
+            convertGfxColor(color, colorMode, colorSpace, &colors[j]);
+            memcpy(&ramp->colors[static_cast<size_t>(i + j) * nComps], color, nComps);
+        }
+    }
+
+    if (cacheable) {
+        std::erase_if(shadingRampCache, isShadingEntry);
+        if (static_cast<int>(shadingRampCache.size()) >= shadingRampCacheSize) {
+            shadingRampCache.erase(shadingRampCache.begin());
+        }
+        key.ramp = ramp;
+        shadingRampCache.push_back(std::move(key));
+    }
+    return ramp;
+}
+
 bool SplashOutputDev::axialShadedFill(GfxState *state, GfxAxialShading *shading, double /*tMin*/, double /*tMax*/)
 {
-    auto *pattern = new SplashAxialPattern(colorMode, state, shading);
+    auto *pattern = new SplashAxialPattern(colorMode, state, shading, getShadingRamp(state, shading));
     bool retVal = univariateShadedFill(state, pattern);
 
     delete pattern;
@@ -4577,7 +4743,7 @@ bool SplashOutputDev::axialShadedFill(GfxState *state, GfxAxialShading *shading,
 
 bool SplashOutputDev::radialShadedFill(GfxState *state, GfxRadialShading *shading, double /*tMin*/, double /*tMax*/)
 {
-    auto *pattern = new SplashRadialPattern(colorMode, state, shading);
+    auto *pattern = new SplashRadialPattern(colorMode, state, shading, getShadingRamp(state, shading));
     bool retVal = univariateShadedFill(state, pattern);
 
     delete pattern;
@@ -40,9 +40,13 @@
 #include "GfxState.h"
 #include "GlobalParams.h"
 
+#include <functional>
+#include <string>
+
 class PDFDoc;
 class Gfx8BitFont;
 class SplashBitmap;
+class SplashBitmapPool;
 class Splash;
 class SplashPath;
 class SplashFontEngine;
@@ -84,10 +88,20 @@ protected:
     GfxColorSpaceMode gfxMode;
 };
 
+// Device colors of a univariate shading, sampled evenly over its
+// whole domain.
+struct SplashShadingRamp
+{
+    int size; // number of samples
+    std::vector<unsigned char> colors; // size samples of the color mode's nComps bytes
+};
+
 class SplashUnivariatePattern : public SplashPattern
 {
 public:
-    SplashUnivariatePattern(SplashColorMode colorMode, GfxState *state, GfxUnivariateShading *shading);
+    // Colors come from <rampA> when it is set, otherwise the shading is
+    // evaluated and converted for each pixel.
+    SplashUnivariatePattern(SplashColorMode colorMode, GfxState *state, GfxUnivariateShading *shading, std::shared_ptr<const SplashShadingRamp> rampA);
 
     ~SplashUnivariatePattern() override;
 
@@ -110,14 +124,16 @@ protected:
     GfxState *state;
     SplashColorMode colorMode;
     GfxColorSpaceMode gfxMode;
+    std::shared_ptr<const SplashShadingRamp> ramp;
+    double rampScale; // ramp samples per unit of t
 };
 
 class SplashAxialPattern : public SplashUnivariatePattern
 {
 public:
-    SplashAxialPattern(SplashColorMode colorMode, GfxState *state, GfxAxialShading *shading);
+    SplashAxialPattern(SplashColorMode colorMode, GfxState *state, GfxAxialShading *shading, std::shared_ptr<const SplashShadingRamp> rampA = nullptr);
 
-    SplashPattern *copy() const override { return new SplashAxialPattern(colorMode, state, static_cast<GfxAxialShading *>(shading)); }
+    SplashPattern *copy() const override { return new SplashAxialPattern(colorMode, state, static_cast<GfxAxialShading *>(shading), ramp); }
 
     ~SplashAxialPattern() override;
 
@@ -167,9 +183,9 @@ private:
 class SplashRadialPattern : public SplashUnivariatePattern
 {
 public:
-    SplashRadialPattern(SplashColorMode colorMode, GfxState *state, GfxRadialShading *shading);
+    SplashRadialPattern(SplashColorMode colorMode, GfxState *state, GfxRadialShading *shading, std::shared_ptr<const SplashShadingRamp> rampA = nullptr);
 
-    SplashPattern *copy() const override { return new SplashRadialPattern(colorMode, state, static_cast<GfxRadialShading *>(shading)); }
+    SplashPattern *copy() const override { return new SplashRadialPattern(colorMode, state, static_cast<GfxRadialShading *>(shading), ramp); }
 
     ~SplashRadialPattern() override;
 
@@ -221,6 +237,9 @@ public:
     // text in Type 3 fonts will be drawn with drawChar/drawString.
     bool interpretType3Chars() override { return true; }
 
+    // Splash only keeps the image pixels it shows.
+    bool needFullResolutionImages() override { return false; }
+
     //----- initialization and control
 
     // Start a page.
@@ -315,10 +334,24 @@ public:
     int getBitmapWidth();
     int getBitmapHeight();
 
+    // Get the color mode of the bitmaps.
+    SplashColorMode getColorMode() const { return colorMode; }
+
     // Returns the last rasterized bitmap, transferring ownership to the
     // caller.
     SplashBitmap *takeBitmap();
 
+    // Called by startPage with the size of the page, to render into a
+    // buffer owned by the caller: it returns a buffer of <height> rows of
+    // <width> pixels in the color mode of the bitmaps, and sets <rowSize>
+    // to the distance between rows, in bytes; or it returns nullptr to
+    // render into a buffer owned by the bitmap.
+    using BitmapBufferFunc = std::function<SplashColorPtr(int width, int height, int *rowSize)>;
+
+    // Render the next pages into the buffers <func> returns, which saves
+    // copying the page bitmap into an image of the caller.
+    void setBitmapBufferFunc(BitmapBufferFunc func) { bitmapBufferFunc = std::move(func); }
+
     // Get the Splash object.
     Splash *getSplash() { return splash; }
 
@@ -340,6 +373,21 @@ public:
     bool getFontAntialias() const { return fontAntialias; }
     void setFontAntialias(bool anti) { fontAntialias = anti; }
 
+    // Rasterize anti-aliased vector fills with exact area coverage
+    // instead of supersampling (see Splash::setAnalyticAA).
+    bool getAnalyticAntialias() const { return analyticAntialias; }
+    void setAnalyticAntialias(bool aaa);
+
+    // Scale images down with a Lanczos filter instead of a box filter
+    // (see Splash::setLanczosDownscaling).
+    bool getLanczosImageDownscaling() const { return lanczosImageDownscaling; }
+    void setLanczosImageDownscaling(bool lanczos);
+
+    // Sample the colors of axial and radial shadings into ramps instead of
+    // evaluating the shading functions at each pixel.
+    bool getShadingRamps() const { return shadingRamps; }
+    void setShadingRamps(bool ramps) { shadingRamps = ramps; }
+
     void setFreeTypeHinting(bool enable, bool enableSlightHinting);
     void setEnableFreeType(bool enable) { enableFreeType = enable; }
 
@@ -348,6 +396,7 @@ protected:
 
 private:
     bool univariateShadedFill(GfxState *state, SplashUnivariatePattern *pattern);
+    std::shared_ptr<const SplashShadingRamp> getShadingRamp(GfxState *state, GfxUnivariateShading *shading);
 
     void setupScreenParams(double hDPI, double vDPI);
     static SplashPattern *getColor(GfxGray gray);
@@ -376,6 +425,9 @@ private:
     bool bitmapTopDown;
     bool fontAntialias;
     bool vectorAntialias;
+    bool analyticAntialias;
+    bool lanczosImageDownscaling;
+    bool shadingRamps;
     bool overprintPreview;
     bool enableFreeType;
     bool enableFreeTypeHinting;
@@ -391,12 +443,29 @@ private:
     SplashBitmap *bitmap;
     Splash *splash;
     SplashFontEngine *fontEngine;
+    SplashBitmapPool *bitmapPool; // temporary bitmaps of groups, soft masks and patterns
+    BitmapBufferFunc bitmapBufferFunc; // page bitmap buffers owned by the caller
 
     T3FontCache * // Type 3 font cache
             t3FontCache[splashOutT3FontCacheSize];
     int nT3Fonts; // number of valid entries in t3FontCache
     T3GlyphStack *t3GlyphStack; // Type 3 glyph context stack
 
+    // color ramps of shading objects, by rendering intent, color space and
+    // display profile, least recently used first
+    struct ShadingRampCacheEntry
+    {
+        Ref ref;
+        std::string renderingIntent;
+        GfxColorSpaceMode colorSpaceMode;
+        Ref iccProfile; // of ICCBased color spaces
+#if USE_CMS
+        GfxLCMSProfilePtr displayProfile;
+#endif
+        std::shared_ptr<const SplashShadingRamp> ramp;
+    };
+    std::vector<ShadingRampCacheEntry> shadingRampCache;
+
     SplashFont *font; // current font
     bool needFontUpdate; // set when the font needs to be updated
     SplashPath *textClipPath; // clipping path built with text object
@@ -179,11 +179,11 @@ std::unique_ptr<Stream> Stream::addFilters(std::unique_ptr<Stream> str, Dict *di
     Object params, params2;
     int i;
 
-    obj = dict->lookup("Filter", recursion);
+    obj = dict->lookup(NameAtoms::Filter, recursion);
     if (obj.isNull()) {
         obj = dict->lookup("F", recursion);
     }
-    params = dict->lookup("DecodeParms", recursion);
+    params = dict->lookup(NameAtoms::DecodeParms, recursion);
     if (params.isNull()) {
         params = dict->lookup("DP", recursion);
     }
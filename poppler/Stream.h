@@ -46,6 +46,7 @@
 #ifndef STREAM_H
 #define STREAM_H
 
+#include <array>
 #include <atomic>
 #include <cstdio>
 #include <vector>
@@ -261,6 +262,20 @@ public:
     // Get image parameters which are defined by the stream contents.
     virtual void getImageParams(int * /*bitsPerComponent*/, StreamColorSpaceMode * /*csMode*/, bool * /*hasAlpha*/) { }
 
+    // Ask an image stream of <width> x <height> pixels to decode at a lower
+    // resolution, but not lower than <targetWidth> x <targetHeight> for the
+    // whole image, and to decode only the part of the image inside <area>
+    // (x0, y0, x1, y1 in image pixels, origin at the top left corner), if it
+    // can do so cheaply. Returns true if it will, in which case <area> is
+    // updated with the part of the image actually decoded and <width> and
+    // <height> with the size of the image returned from the next rewind()
+    // until the stream is closed or restoreFullResolution() is called.
+    virtual bool reduceResolution(int * /*width*/, int * /*height*/, int /*targetWidth*/, int /*targetHeight*/, std::array<int, 4> * /*area*/) { return false; }
+
+    // Undo reduceResolution(), the next rewind() returns the whole image at
+    // its full size.
+    virtual void restoreFullResolution() { }
+
     // Return the next stream in the "stack".
     virtual Stream *getNextStream() const { return nullptr; }
 
@@ -896,6 +896,10 @@ bool XRef::constructXRef(bool *wasReconstructed, bool needCatalogDict)
     int streamEndsSize = 0;
     streamEndsLen = 0;
 
+    if (objectCache) {
+        objectCache->clear();
+    }
+
     resize(0); // free entries properly
     gfree(entries);
     capacity = 0;
@@ -1311,6 +1315,14 @@ Object XRef::fetch(int num, int gen, int recursion, Goffset *endPos)
         if (e->gen != gen || e->offset < 0) {
             goto err;
         }
+        if (objectCache && !endPos) {
+            // deep copies, callers may modify the returned object in place
+            if (const Object *cachedObj = objectCache->lookup(ref)) {
+                ++objectCacheHits;
+                return cachedObj->deepCopy();
+            }
+            ++objectCacheMisses;
+        }
         Goffset subStreamOffset;
         if (checkedAdd(start, e->offset, &subStreamOffset)) {
             goto err;
@@ -1343,6 +1355,9 @@ Object XRef::fetch(int num, int gen, int recursion, Goffset *endPos)
         if (endPos) {
             *endPos = parser.getPos();
         }
+        if (objectCache && (obj.isDict() || obj.isArray())) {
+            objectCache->put(ref, std::make_unique<Object>(obj.deepCopy()));
+        }
         return obj;
     }
 
@@ -1426,6 +1441,16 @@ void XRef::unlock()
     mutex.unlock();
 }
 
+void XRef::setObjectCacheSize(std::size_t cacheSize)
+{
+    xrefLocker();
+    if (cacheSize == 0) {
+        objectCache.reset();
+    } else {
+        objectCache = std::make_unique<PopplerCache<Ref, Object>>(cacheSize);
+    }
+}
+
 Object XRef::getDocInfo()
 {
     return trailerDict.dictLookup("Info");
@@ -1544,6 +1569,9 @@ bool XRef::add(int num, int gen, Goffset offs, bool used)
     e->gen = gen;
     e->obj.setToNull();
     e->flags = 0;
+    if (objectCache) {
+        objectCache->remove({ .num = num, .gen = gen });
+    }
     if (used) {
         e->type = xrefEntryUncompressed;
         e->offset = offs;
@@ -1567,6 +1595,9 @@ void XRef::setModifiedObject(const Object *o, Ref r)
     }
     e->obj = o->copy();
     e->setFlag(XRefEntry::Updated, true);
+    if (objectCache) {
+        objectCache->remove(r);
+    }
     setModified();
 }
 
@@ -1613,6 +1644,9 @@ void XRef::removeIndirectObject(Ref r)
     if (e->type == xrefEntryFree) {
         return;
     }
+    if (objectCache) {
+        objectCache->remove({ .num = r.num, .gen = e->gen });
+    }
     e->obj = Object();
     e->type = xrefEntryFree;
     if (likely(e->gen < 65535)) {
@@ -38,6 +38,7 @@
 #ifndef XREF_H
 #define XREF_H
 
+#include <atomic>
 #include <functional>
 
 #include "poppler_private_export.h"
@@ -234,6 +235,15 @@ public:
     void lock();
     void unlock();
 
+    // Keep up to <cacheSize> parsed dictionaries and arrays of uncompressed objects
+    // so that fetching them again doesn't reparse them from the file.
+    // Cache hits return a deep copy, so modifying a fetched object in place
+    // doesn't change what later fetches return.
+    // 0 (the default) disables the cache.
+    void setObjectCacheSize(std::size_t cacheSize);
+    unsigned long getObjectCacheHits() const { return objectCacheHits; }
+    unsigned long getObjectCacheMisses() const { return objectCacheMisses; }
+
 private:
     BaseStream *str; // input stream
     Goffset start; // offset in file (to allow for garbage
@@ -271,6 +281,10 @@ private:
 
     RefRecursionChecker refsBeingFetched;
 
+    std::unique_ptr<PopplerCache<Ref, Object>> objectCache; // parsed objects cache, null if disabled
+    std::atomic<unsigned long> objectCacheHits = 0;
+    std::atomic<unsigned long> objectCacheMisses = 0;
+
     int reserve(int newSize);
     int resize(int newSize);
     void constructTrailerDict(Goffset pos, bool needCatalogDict);
@@ -706,6 +706,16 @@ Document::RenderBackend Document::renderBackend() const
     return m_doc->m_backend;
 }
 
+void Document::setPageRenderThreads(int threads)
+{
+    m_doc->m_pageRenderThreads = qMax(threads, 1);
+}
+
+int Document::pageRenderThreads() const
+{
+    return m_doc->m_pageRenderThreads;
+}
+
 QSet<Document::RenderBackend> Document::availableRenderBackends()
 {
     QSet<Document::RenderBackend> ret;
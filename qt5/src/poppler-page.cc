@@ -59,6 +59,7 @@
 
 #include <config.h>
 #include <cfloat>
+#include <utility>
 #include <poppler-config.h>
 #include <PDFDoc.h>
 #include <Catalog.h>
@@ -69,6 +70,7 @@
 #include <Link.h>
 #include <QPainterOutputDev.h>
 #include <Rendition.h>
+#include <SplashBandRenderer.h>
 #include <SplashOutputDev.h>
 #include <goo/gmem.h>
 #include <splash/SplashBitmap.h>
@@ -131,6 +133,20 @@ public:
         }
     }
 
+    // Render the next pages straight into the image getXBGRImage returns.
+    // Only for the XBGR8 color mode.
+    void renderToImageBuffer()
+    {
+        setBitmapBufferFunc([this](int width, int height, int *rowSize) -> SplashColorPtr {
+            image = QImage(width, height, ignorePaperColor ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+            if (image.isNull()) {
+                return nullptr;
+            }
+            *rowSize = image.bytesPerLine();
+            return image.bits();
+        });
+    }
+
     QImage getXBGRImage(bool takeImageData)
     {
         SplashBitmap *b = getBitmap();
@@ -146,7 +162,9 @@ public:
             const int bh = b->getHeight();
             const int brs = b->getRowSize();
 
-            SplashColorPtr data = takeImageData ? b->takeData() : b->getDataPtr();
+            // the page was rendered into the image already
+            const bool renderedToImage = takeImageData && b->hasExternalData();
+            SplashColorPtr data = takeImageData && !renderedToImage ? b->takeData() : b->getDataPtr();
 
             if (QSysInfo::ByteOrder == QSysInfo::BigEndian) {
                 // Convert byte order from RGBX to XBGR.
@@ -160,6 +178,9 @@ public:
                 }
             }
 
+            if (renderedToImage) {
+                return std::exchange(image, QImage());
+            }
             if (takeImageData) {
                 // Construct a Qt image holding (and also owning) the raw bitmap data.
                 QImage i(data, bw, bh, brs, format, gfree, data);
@@ -176,6 +197,7 @@ public:
 
 private:
     bool ignorePaperColor;
+    QImage image; // the image renderToImageBuffer renders into
 };
 
 Qt5SplashOutputDev::~Qt5SplashOutputDev() = default;
@@ -587,25 +609,39 @@ QImage Page::renderToImage(double xres, double yres, int xPos, int yPos, int w,
 
         const bool ignorePaperColor = m_page->parentDoc->m_hints & Document::IgnorePaperColor;
 
-        Qt5SplashOutputDev splash_output(colorMode, 4, ignorePaperColor, ignorePaperColor ? nullptr : bgColor, true, thinLineMode, overprintPreview);
-
-        splash_output.setCallbacks(partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, payload);
-
-        splash_output.setFontAntialias((m_page->parentDoc->m_hints & Document::TextAntialiasing) != 0);
-        splash_output.setVectorAntialias((m_page->parentDoc->m_hints & Document::Antialiasing) != 0);
-        splash_output.setFreeTypeHinting((m_page->parentDoc->m_hints & Document::TextHinting) != 0, (m_page->parentDoc->m_hints & Document::TextSlightHinting) != 0);
+        const auto setupOutputDev = [&](SplashOutputDev *output) {
+            output->setFontAntialias((m_page->parentDoc->m_hints & Document::TextAntialiasing) != 0);
+            output->setVectorAntialias((m_page->parentDoc->m_hints & Document::Antialiasing) != 0);
+            output->setFreeTypeHinting((m_page->parentDoc->m_hints & Document::TextHinting) != 0, (m_page->parentDoc->m_hints & Document::TextSlightHinting) != 0);
 
 #if USE_CMS
-        splash_output.setDisplayProfile(m_page->parentDoc->m_displayProfile);
+            output->setDisplayProfile(m_page->parentDoc->m_displayProfile);
 #endif
 
-        splash_output.startDoc(m_page->parentDoc->doc.get());
+            output->startDoc(m_page->parentDoc->doc.get());
+        };
+
+        Qt5SplashOutputDev splash_output(colorMode, 4, ignorePaperColor, ignorePaperColor ? nullptr : bgColor, true, thinLineMode, overprintPreview);
+
+        splash_output.setCallbacks(partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, payload);
+        setupOutputDev(&splash_output);
+        if (colorMode == splashModeXBGR8) {
+            splash_output.renderToImageBuffer();
+        }
+
+        // the bands of pages rendered by several threads don't report
+        // partial updates
+        SplashBandRenderer bandRenderer(m_page->parentDoc->m_pageRenderThreads, [&] {
+            auto bandOutput = std::make_unique<Qt5SplashOutputDev>(colorMode, 4, ignorePaperColor, ignorePaperColor ? nullptr : bgColor, true, thinLineMode, overprintPreview);
+            setupOutputDev(bandOutput.get());
+            return bandOutput;
+        });
 
         const bool hideAnnotations = m_page->parentDoc->m_hints & Document::HideAnnotations;
 
         OutputDevCallbackHelper *abortHelper = &splash_output;
-        m_page->parentDoc->doc->displayPageSlice(&splash_output, m_page->index + 1, xres, yres, rotation, false, true, false, xPos, yPos, w, h, shouldAbortRenderCallback ? shouldAbortRenderInternalCallback : nullAbortCallBack, abortHelper,
-                                                 hideAnnotations ? annotDisplayDecideCbk : nullAnnotCallBack, nullptr, true);
+        bandRenderer.displayPageSlice(&splash_output, m_page->parentDoc->doc.get(), m_page->index + 1, xres, yres, rotation, false, true, false, xPos, yPos, w, h, shouldAbortRenderCallback ? shouldAbortRenderInternalCallback : nullAbortCallBack,
+                                      abortHelper, hideAnnotations ? annotDisplayDecideCbk : nullAnnotCallBack, nullptr, true);
 
         img = splash_output.getXBGRImage(true /* takeImageData */);
         break;
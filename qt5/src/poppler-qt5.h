@@ -1828,6 +1828,30 @@ QString subject = m_doc->info("Subject");
      */
     RenderBackend renderBackend() const;
 
+    /**
+      Sets the number of threads the Splash backend renders each page with.
+
+      With more than one thread, Page::renderToImage() parses the page once,
+      then draws horizontal bands of it concurrently.  This lowers the time
+      taken by large pages and high resolutions; the image only differs
+      from a single threaded rendering by rounding in a few anti-aliased
+      pixels, and no partial updates are reported.  Pages with shadings or
+      tiling patterns are rendered by a single thread.
+
+      \param threads the number of threads per page
+
+      \since 26.05
+     */
+    void setPageRenderThreads(int threads);
+    /**
+      The number of threads the Splash backend renders each page with
+
+      The default is 1.
+
+      \since 26.05
+     */
+    int pageRenderThreads() const;
+
     /**
       The available rendering backends.
 
@@ -208,6 +208,7 @@ void DocumentData::init()
     m_backend = Document::SplashBackend;
     paperColor = Qt::white;
     m_hints = 0;
+    m_pageRenderThreads = 1;
     m_optContentModel = nullptr;
     xrefReconstructed = false;
     xrefReconstructedCallback = {};
@@ -42,6 +42,7 @@
 #include <numbers>
 #include "goo/gmem.h"
 #include "goo/GooLikely.h"
+#include "goo/GooTargetClones.h"
 #include "poppler/GfxState.h"
 #include "poppler/Error.h"
 #include "SplashErrorCodes.h"
@@ -51,6 +52,7 @@
 #include "SplashPath.h"
 #include "SplashXPath.h"
 #include "SplashXPathScanner.h"
+#include "SplashXPathCoverageScanner.h"
 #include "SplashPattern.h"
 #include "SplashScreen.h"
 #include "SplashFont.h"
@@ -178,6 +180,10 @@ struct SplashPipe
 
     // the "run" function
     void (Splash::*run)(SplashPipe *pipe);
+
+    // the span version of "run", or nullptr if there is none for this
+    // pipe (see the span versions of the special cases below)
+    void (Splash::*runSpan)(SplashPipe *pipe, const unsigned char *shape, int n);
 };
 
 SplashPipeResultColorCtrl Splash::pipeResultColorNoAlphaBlend[] = { splashPipeResultColorNoAlphaBlendMono, splashPipeResultColorNoAlphaBlendMono, splashPipeResultColorNoAlphaBlendRGB,    splashPipeResultColorNoAlphaBlendRGB,
@@ -237,6 +243,7 @@ inline void Splash::pipeInit(SplashPipe *pipe, int x, int y, SplashPattern *patt
 
     // select the 'run' function
     pipe->run = &Splash::pipeRun;
+    pipe->runSpan = nullptr;
     if (!pipe->pattern && pipe->noTransparency && !state->blendFunc) {
         if (bitmap->mode == splashModeMono1 && !pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunSimpleMono1;
@@ -244,12 +251,16 @@ inline void Splash::pipeInit(SplashPipe *pipe, int x, int y, SplashPattern *patt
             pipe->run = &Splash::pipeRunSimpleMono8;
         } else if (bitmap->mode == splashModeRGB8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunSimpleRGB8;
+            pipe->runSpan = &Splash::pipeRunSimpleRGB8Span;
         } else if (bitmap->mode == splashModeXBGR8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunSimpleXBGR8;
+            pipe->runSpan = &Splash::pipeRunSimpleXBGR8Span;
         } else if (bitmap->mode == splashModeBGR8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunSimpleBGR8;
+            pipe->runSpan = &Splash::pipeRunSimpleBGR8Span;
         } else if (bitmap->mode == splashModeCMYK8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunSimpleCMYK8;
+            pipe->runSpan = &Splash::pipeRunSimpleCMYK8Span;
         } else if (bitmap->mode == splashModeDeviceN8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunSimpleDeviceN8;
         }
@@ -260,12 +271,16 @@ inline void Splash::pipeInit(SplashPipe *pipe, int x, int y, SplashPattern *patt
             pipe->run = &Splash::pipeRunAAMono8;
         } else if (bitmap->mode == splashModeRGB8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunAARGB8;
+            pipe->runSpan = &Splash::pipeRunAARGB8Span;
         } else if (bitmap->mode == splashModeXBGR8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunAAXBGR8;
+            pipe->runSpan = &Splash::pipeRunAAXBGR8Span;
         } else if (bitmap->mode == splashModeBGR8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunAABGR8;
+            pipe->runSpan = &Splash::pipeRunAABGR8Span;
         } else if (bitmap->mode == splashModeCMYK8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunAACMYK8;
+            pipe->runSpan = &Splash::pipeRunAACMYK8Span;
         } else if (bitmap->mode == splashModeDeviceN8 && pipe->destAlphaPtr) {
             pipe->run = &Splash::pipeRunAADeviceN8;
         }
@@ -1148,6 +1163,377 @@ void Splash::pipeRunAABGR8(SplashPipe *pipe)
     ++pipe->x;
 }
 
+//------------------------------------------------------------------------
+// span versions of the pipeRunSimple* and pipeRunAA* special cases
+//
+// These draw n consecutive pixels starting at the current pipe position.
+// If shape is non-null, it holds one shape value per pixel, and pixels
+// with a zero shape are skipped; otherwise every pixel is drawn with
+// pipe->shape.  They give the same bytes as the per-pixel versions.
+//
+// Whole chunks of spanChunk pixels are copied to local arrays, one entry
+// per color byte, and composited in loops with a fixed trip count that
+// the compiler vectorizes; the remaining pixels are done one by one.
+// Transfer functions other than the identity are looked up byte by byte.
+// The per-pixel versions' special cases for opaque and fully transparent
+// pixels fall out of the general formula, and its division by the
+// result alpha is done in single precision, which truncates to the same
+// integer: the quotient is below 256 and, if it is not an integer, at
+// least 1/255 away from one.
+//------------------------------------------------------------------------
+
+constexpr int spanChunk = 32;
+
+// Copy each of the spanChunk entries of in to nComps entries of out.
+template<int nComps>
+static inline void expandSpanChunk(const unsigned char *__restrict in, unsigned char *__restrict out)
+{
+    for (int i = 0; i < spanChunk; ++i) {
+        const unsigned char v = in[i];
+        out[nComps * i] = v;
+        out[nComps * i + 1] = v;
+        out[nComps * i + 2] = v;
+        if (nComps == 4) {
+            out[nComps * i + 3] = v;
+        }
+    }
+}
+
+// Repeat the nComps entries of c spanChunk times in out.
+template<int nComps>
+static inline void repeatSpanChunk(const unsigned char *c, unsigned char *__restrict out)
+{
+    for (int i = 0; i < spanChunk; ++i) {
+        out[nComps * i] = c[0];
+        out[nComps * i + 1] = c[1];
+        out[nComps * i + 2] = c[2];
+        if (nComps == 4) {
+            out[nComps * i + 3] = c[3];
+        }
+    }
+}
+
+// Set drawPixel, and drawByte for each color byte, to 0xff for the pixels
+// of a chunk to be drawn: all of them without a shape array.
+template<int nComps>
+static inline void spanChunkDrawMask(const unsigned char *__restrict s, bool hasShape, unsigned char *__restrict drawPixel, unsigned char *__restrict drawByte)
+{
+    const unsigned char drawAll = hasShape ? 0 : 0xff;
+    for (int i = 0; i < spanChunk; ++i) {
+        drawPixel[i] = drawAll | (s[i] ? 0xff : 0);
+    }
+    expandSpanChunk<nComps>(drawPixel, drawByte);
+}
+
+// Set maskByte to 0xff for the color bytes of a chunk with their bit set
+// in mask.
+template<int nComps>
+static inline void spanChunkByteMask(int mask, unsigned char *__restrict maskByte)
+{
+    unsigned char maskComp[4];
+    for (int k = 0; k < 4; ++k) {
+        maskComp[k] = (mask & (1 << k)) ? 0xff : 0;
+    }
+    repeatSpanChunk<nComps>(maskComp, maskByte);
+}
+
+// Write the result color byte c to *p if write is set, adding it to the
+// destination if additive is set.
+static inline void overprintSpanByte(unsigned char *p, unsigned char c, bool write, bool additive)
+{
+    if (write) {
+        *p = additive ? std::min(*p + c, 255) : c;
+    }
+}
+
+// Fill n (a multiple of spanChunk) pixels with the opaque color c, given
+// per color byte; only the bytes in overprintMask are written, and added
+// to the destination if overprintAdditive is set.
+template<int nComps>
+static inline void simpleSpanChunks(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, int n, const unsigned char *c, int overprintMask, bool overprintAdditive)
+{
+    unsigned char pattern[nComps * spanChunk], writeByte[nComps * spanChunk];
+    const unsigned char additive = overprintAdditive ? 0xff : 0;
+
+    repeatSpanChunk<nComps>(c, pattern);
+    memset(destAlphaPtr, 255, n);
+    if ((overprintMask & ((1 << nComps) - 1)) == (1 << nComps) - 1 && !overprintAdditive) {
+        for (int x = 0; x < n; x += spanChunk) {
+            memcpy(destColorPtr + nComps * x, pattern, nComps * spanChunk);
+        }
+        return;
+    }
+
+    spanChunkByteMask<nComps>(overprintMask, writeByte);
+    for (int x = 0; x < n; x += spanChunk) {
+        unsigned char color[nComps * spanChunk];
+
+        memcpy(color, destColorPtr + nComps * x, nComps * spanChunk);
+        for (int j = 0; j < nComps * spanChunk; ++j) {
+            const unsigned char sum = std::min(color[j] + pattern[j], 255);
+            const unsigned char v = (sum & additive) | (pattern[j] & ~additive);
+            color[j] = writeByte[j] ? v : color[j];
+        }
+        memcpy(destColorPtr + nComps * x, color, nComps * spanChunk);
+    }
+}
+
+// Composite n (a multiple of spanChunk) pixels of the color cSrc, given
+// per color byte, with alpha aInput over the destination, through the
+// transfer functions unless transfer is null; the color bytes in setMask
+// are set to 255.  Only the bytes in overprintMask are written, and added
+// to the destination if overprintAdditive is set.
+template<int nComps>
+static inline void aaSpanChunks(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, const unsigned char *shape, unsigned char constShape, int n, unsigned char aInput, const unsigned char *cSrc, const unsigned char *const *transfer,
+                                int setMask, int overprintMask, bool overprintAdditive)
+{
+    unsigned char src[nComps * spanChunk], setByte[nComps * spanChunk], writeByte[nComps * spanChunk];
+
+    repeatSpanChunk<nComps>(cSrc, src);
+    spanChunkByteMask<nComps>(setMask, setByte);
+    spanChunkByteMask<nComps>(overprintMask, writeByte);
+    for (int x = 0; x < n; x += spanChunk) {
+        unsigned char color[nComps * spanChunk], alpha[spanChunk], s[spanChunk];
+        unsigned char drawPixel[spanChunk], drawByte[nComps * spanChunk];
+        unsigned char aSrc[spanChunk], aResult[spanChunk];
+        unsigned char sByte[nComps * spanChunk], aSrcByte[nComps * spanChunk], aResultByte[nComps * spanChunk];
+        unsigned char q[nComps * spanChunk], cResult[nComps * spanChunk];
+
+        memcpy(color, destColorPtr + nComps * x, nComps * spanChunk);
+        memcpy(alpha, destAlphaPtr + x, spanChunk);
+        if (shape) {
+            memcpy(s, shape + x, spanChunk);
+        } else {
+            memset(s, constShape, spanChunk);
+        }
+        spanChunkDrawMask<nComps>(s, shape, drawPixel, drawByte);
+        for (int i = 0; i < spanChunk; ++i) {
+            aSrc[i] = div255(aInput * s[i]);
+            aResult[i] = aSrc[i] + alpha[i] - div255(aSrc[i] * alpha[i]);
+        }
+        expandSpanChunk<nComps>(s, sByte);
+        expandSpanChunk<nComps>(aSrc, aSrcByte);
+        expandSpanChunk<nComps>(aResult, aResultByte);
+        for (int j = 0; j < nComps * spanChunk; ++j) {
+            const int num = (aResultByte[j] - aSrcByte[j]) * color[j] + aSrcByte[j] * src[j];
+            const int divisor = aResultByte[j] | (aResultByte[j] == 0);
+            q[j] = static_cast<unsigned char>(static_cast<int>(static_cast<float>(num) / static_cast<float>(divisor)));
+        }
+        if (transfer) {
+            for (int i = 0; i < spanChunk; ++i) {
+                for (int k = 0; k < nComps; ++k) {
+                    cResult[nComps * i + k] = aResult[i] ? transfer[k][q[nComps * i + k]] : 0;
+                }
+            }
+        } else {
+            for (int j = 0; j < nComps * spanChunk; ++j) {
+                cResult[j] = aResultByte[j] ? q[j] : 0;
+            }
+        }
+        for (int j = 0; j < nComps * spanChunk; ++j) {
+            cResult[j] |= setByte[j];
+            const unsigned char v = (overprintAdditive && sByte[j]) ? std::min(color[j] + cResult[j], 255) : cResult[j];
+            color[j] = (drawByte[j] & writeByte[j]) ? v : color[j];
+        }
+        for (int i = 0; i < spanChunk; ++i) {
+            alpha[i] = drawPixel[i] ? aResult[i] : alpha[i];
+        }
+        memcpy(destColorPtr + nComps * x, color, nComps * spanChunk);
+        memcpy(destAlphaPtr + x, alpha, spanChunk);
+    }
+}
+
+// The chunk kernels for three and four color bytes; the RGB8, BGR8 and
+// XBGR8 versions only differ in the byte order of the color and the
+// transfer functions.
+GOO_FLATTEN GOO_TARGET_CLONES static void simpleSpanChunks3(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, int n, const unsigned char *c, int overprintMask, bool overprintAdditive)
+{
+    simpleSpanChunks<3>(destColorPtr, destAlphaPtr, n, c, overprintMask, overprintAdditive);
+}
+
+GOO_FLATTEN GOO_TARGET_CLONES static void simpleSpanChunks4(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, int n, const unsigned char *c, int overprintMask, bool overprintAdditive)
+{
+    simpleSpanChunks<4>(destColorPtr, destAlphaPtr, n, c, overprintMask, overprintAdditive);
+}
+
+GOO_FLATTEN GOO_TARGET_CLONES static void aaSpanChunks3(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, const unsigned char *shape, unsigned char constShape, int n, unsigned char aInput, const unsigned char *cSrc,
+                                                        const unsigned char *const *transfer, int setMask, int overprintMask, bool overprintAdditive)
+{
+    aaSpanChunks<3>(destColorPtr, destAlphaPtr, shape, constShape, n, aInput, cSrc, transfer, setMask, overprintMask, overprintAdditive);
+}
+
+GOO_FLATTEN GOO_TARGET_CLONES static void aaSpanChunks4(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, const unsigned char *shape, unsigned char constShape, int n, unsigned char aInput, const unsigned char *cSrc,
+                                                        const unsigned char *const *transfer, int setMask, int overprintMask, bool overprintAdditive)
+{
+    aaSpanChunks<4>(destColorPtr, destAlphaPtr, shape, constShape, n, aInput, cSrc, transfer, setMask, overprintMask, overprintAdditive);
+}
+
+// Fill a span with the opaque color c: the whole chunks with the chunk
+// kernels, and the rest pixel by pixel.  The simple pipes are only used
+// without shapes, so spans with a shape array are drawn pixel by pixel.
+template<int nComps>
+static inline void simpleSpan(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, const unsigned char *shape, int n, const unsigned char *c, int overprintMask, bool overprintAdditive)
+{
+    const int nChunks = shape ? 0 : n - n % spanChunk;
+    if (nChunks > 0) {
+        if constexpr (nComps == 3) {
+            simpleSpanChunks3(destColorPtr, destAlphaPtr, nChunks, c, overprintMask, overprintAdditive);
+        } else {
+            simpleSpanChunks4(destColorPtr, destAlphaPtr, nChunks, c, overprintMask, overprintAdditive);
+        }
+    }
+
+    const unsigned char c0 = c[0], c1 = c[1], c2 = c[2], c3 = nComps == 4 ? c[3] : 0;
+    for (int x = nChunks; x < n; ++x) {
+        if (shape && !shape[x]) {
+            continue;
+        }
+        unsigned char *p = destColorPtr + nComps * x;
+        overprintSpanByte(p, c0, overprintMask & 1, overprintAdditive);
+        overprintSpanByte(p + 1, c1, overprintMask & 2, overprintAdditive);
+        overprintSpanByte(p + 2, c2, overprintMask & 4, overprintAdditive);
+        if (nComps == 4) {
+            overprintSpanByte(p + 3, c3, overprintMask & 8, overprintAdditive);
+        }
+        destAlphaPtr[x] = 255;
+    }
+}
+
+// The color byte for a pixel composited like pipeRunAA*, through the
+// transfer function unless it is null.
+static inline unsigned char aaSpanByte(unsigned char cDest, unsigned char cSrc, unsigned char aSrc, unsigned char aResult, const unsigned char *transfer)
+{
+    unsigned char c;
+    if (aSrc == 255) {
+        c = cSrc;
+    } else if (aResult == 0) {
+        return 0;
+    } else {
+        c = static_cast<unsigned char>(((aResult - aSrc) * cDest + aSrc * cSrc) / aResult);
+    }
+    return transfer ? transfer[c] : c;
+}
+
+// Composite a span of the color cSrc over the destination: the whole
+// chunks with the chunk kernels, and the rest pixel by pixel.
+template<int nComps>
+static inline void aaSpan(SplashColorPtr destColorPtr, unsigned char *destAlphaPtr, const unsigned char *shape, unsigned char constShape, int n, unsigned char aInput, const unsigned char *cSrc, const unsigned char *const *transfer,
+                          int setMask, int overprintMask, bool overprintAdditive)
+{
+    const int nChunks = n - n % spanChunk;
+    if (nChunks > 0) {
+        if constexpr (nComps == 3) {
+            aaSpanChunks3(destColorPtr, destAlphaPtr, shape, constShape, nChunks, aInput, cSrc, transfer, setMask, overprintMask, overprintAdditive);
+        } else {
+            aaSpanChunks4(destColorPtr, destAlphaPtr, shape, constShape, nChunks, aInput, cSrc, transfer, setMask, overprintMask, overprintAdditive);
+        }
+    }
+
+    const unsigned char c0 = cSrc[0], c1 = cSrc[1], c2 = cSrc[2], c3 = nComps == 4 ? cSrc[3] : 0;
+    const unsigned char *t0 = transfer ? transfer[0] : nullptr, *t1 = transfer ? transfer[1] : nullptr, *t2 = transfer ? transfer[2] : nullptr, *t3 = transfer && nComps == 4 ? transfer[3] : nullptr;
+    for (int x = nChunks; x < n; ++x) {
+        unsigned char s = constShape;
+        if (shape) {
+            s = shape[x];
+            if (s == 0) {
+                continue;
+            }
+        }
+        unsigned char *p = destColorPtr + nComps * x;
+        const unsigned char aSrc = div255(aInput * s);
+        const unsigned char aDest = destAlphaPtr[x];
+        const unsigned char aResult = aSrc + aDest - div255(aSrc * aDest);
+        const bool additive = overprintAdditive && s != 0;
+        overprintSpanByte(p, (setMask & 1) ? 255 : aaSpanByte(p[0], c0, aSrc, aResult, t0), overprintMask & 1, additive);
+        overprintSpanByte(p + 1, (setMask & 2) ? 255 : aaSpanByte(p[1], c1, aSrc, aResult, t1), overprintMask & 2, additive);
+        overprintSpanByte(p + 2, (setMask & 4) ? 255 : aaSpanByte(p[2], c2, aSrc, aResult, t2), overprintMask & 4, additive);
+        if (nComps == 4) {
+            overprintSpanByte(p + 3, (setMask & 8) ? 255 : aaSpanByte(p[3], c3, aSrc, aResult, t3), overprintMask & 8, additive);
+        }
+        destAlphaPtr[x] = aResult;
+    }
+}
+
+void Splash::pipeRunSimpleRGB8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char c[3] = { state->rgbTransferR[pipe->cSrc[0]], state->rgbTransferG[pipe->cSrc[1]], state->rgbTransferB[pipe->cSrc[2]] };
+    simpleSpan<3>(pipe->destColorPtr, pipe->destAlphaPtr, shape, n, c, 0x7, false);
+    pipe->destColorPtr += 3 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
+void Splash::pipeRunSimpleXBGR8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char c[4] = { state->rgbTransferB[pipe->cSrc[2]], state->rgbTransferG[pipe->cSrc[1]], state->rgbTransferR[pipe->cSrc[0]], 255 };
+    simpleSpan<4>(pipe->destColorPtr, pipe->destAlphaPtr, shape, n, c, 0xf, false);
+    pipe->destColorPtr += 4 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
+void Splash::pipeRunSimpleBGR8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char c[3] = { state->rgbTransferB[pipe->cSrc[2]], state->rgbTransferG[pipe->cSrc[1]], state->rgbTransferR[pipe->cSrc[0]] };
+    simpleSpan<3>(pipe->destColorPtr, pipe->destAlphaPtr, shape, n, c, 0x7, false);
+    pipe->destColorPtr += 3 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
+// matches pipeRunAARGB8 pixel for pixel
+void Splash::pipeRunAARGB8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char *transfer[3] = { state->rgbTransferR, state->rgbTransferG, state->rgbTransferB };
+    aaSpan<3>(pipe->destColorPtr, pipe->destAlphaPtr, shape, pipe->shape, n, pipe->aInput, pipe->cSrc, state->rgbTransferIdentity ? nullptr : transfer, 0, 0x7, false);
+    pipe->destColorPtr += 3 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
+// matches pipeRunAAXBGR8 pixel for pixel
+void Splash::pipeRunAAXBGR8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char cSrc[4] = { pipe->cSrc[2], pipe->cSrc[1], pipe->cSrc[0], 255 };
+    // the fourth byte is set to 255, whatever its transfer function
+    const unsigned char *transfer[4] = { state->rgbTransferB, state->rgbTransferG, state->rgbTransferR, state->rgbTransferR };
+    aaSpan<4>(pipe->destColorPtr, pipe->destAlphaPtr, shape, pipe->shape, n, pipe->aInput, cSrc, state->rgbTransferIdentity ? nullptr : transfer, 0x8, 0xf, false);
+    pipe->destColorPtr += 4 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
+// matches pipeRunAABGR8 pixel for pixel
+void Splash::pipeRunAABGR8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char cSrc[3] = { pipe->cSrc[2], pipe->cSrc[1], pipe->cSrc[0] };
+    const unsigned char *transfer[3] = { state->rgbTransferB, state->rgbTransferG, state->rgbTransferR };
+    aaSpan<3>(pipe->destColorPtr, pipe->destAlphaPtr, shape, pipe->shape, n, pipe->aInput, cSrc, state->rgbTransferIdentity ? nullptr : transfer, 0, 0x7, false);
+    pipe->destColorPtr += 3 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
+// matches pipeRunSimpleCMYK8 pixel for pixel
+void Splash::pipeRunSimpleCMYK8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char c[4] = { state->cmykTransferC[pipe->cSrc[0]], state->cmykTransferM[pipe->cSrc[1]], state->cmykTransferY[pipe->cSrc[2]], state->cmykTransferK[pipe->cSrc[3]] };
+    simpleSpan<4>(pipe->destColorPtr, pipe->destAlphaPtr, shape, n, c, state->overprintMask, state->overprintAdditive);
+    pipe->destColorPtr += 4 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
+// matches pipeRunAACMYK8 pixel for pixel
+void Splash::pipeRunAACMYK8Span(SplashPipe *pipe, const unsigned char *shape, int n)
+{
+    const unsigned char *transfer[4] = { state->cmykTransferC, state->cmykTransferM, state->cmykTransferY, state->cmykTransferK };
+    aaSpan<4>(pipe->destColorPtr, pipe->destAlphaPtr, shape, pipe->shape, n, pipe->aInput, pipe->cSrc, state->cmykTransferIdentity ? nullptr : transfer, 0, state->overprintMask, state->overprintAdditive);
+    pipe->destColorPtr += 4 * n;
+    pipe->destAlphaPtr += n;
+    pipe->x += n;
+}
+
 // special case:
 // !pipe->pattern && !pipe->noTransparency && !state->softMask &&
 // pipe->usesShape && !pipe->alpha0Ptr && !state->blendFunc &&
@@ -1408,8 +1794,14 @@ inline void Splash::drawSpan(SplashPipe *pipe, int x0, int x1, int y, bool noCli
 
     if (noClip) {
         pipeSetXY(pipe, x0, y);
-        for (x = x0; x <= x1; ++x) {
-            (this->*pipe->run)(pipe);
+        if (pipe->runSpan) {
+            if (x0 <= x1) {
+                (this->*pipe->runSpan)(pipe, nullptr, x1 - x0 + 1);
+            }
+        } else {
+            for (x = x0; x <= x1; ++x) {
+                (this->*pipe->run)(pipe);
+            }
         }
     } else {
         if (x0 < state->clip->getXMinI()) {
@@ -1441,6 +1833,14 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, bool adj
 #endif
     int x;
 
+    // with a span function, collect the shape values and draw the whole
+    // line at once; aaGamma[t] is nonzero for t > 0, so pixels with no
+    // coverage are skipped exactly as below
+    const bool useSpan = pipe->runSpan && !adjustLine && x0 <= x1;
+    if (useSpan) {
+        aaLineShapes.resize(x1 - x0 + 1);
+    }
+
 #if splashAASize == 4
     p0 = aaBuf->getDataPtr() + (x0 >> 1);
     p1 = p0 + aaBuf->getRowSize();
@@ -1471,13 +1871,52 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, bool adj
         }
 #endif
 
-        if (t != 0) {
+        if (useSpan) {
+            aaLineShapes[x - x0] = static_cast<int>(aaGamma[t]);
+        } else if (t != 0) {
             pipe->shape = adjustLine ? div255(static_cast<int>(static_cast<int>(lineOpacity) * aaGamma[t])) : static_cast<int>(aaGamma[t]);
             (this->*pipe->run)(pipe);
         } else {
             pipeIncX(pipe);
         }
     }
+    if (useSpan) {
+        pipeSetXY(pipe, x0, y);
+        (this->*pipe->runSpan)(pipe, aaLineShapes.data(), x1 - x0 + 1);
+    }
+}
+
+// Draws the pixels [<x0>,<x1>] of line <y> with the shape values
+// <coverage> from the analytic AA rasterizer.
+inline void Splash::drawCoverageLine(SplashPipe *pipe, unsigned char *coverage, int x0, int x1, int y)
+{
+    // apply the same gamma as aaGamma does to the supersampled coverage
+    static const auto coverageGamma = [] {
+        std::array<unsigned char, 256> table;
+        for (int i = 0; i < 256; ++i) {
+            table[i] = static_cast<unsigned char>(splashRound(splashPow(static_cast<double>(i) / 255.0, splashAAGamma) * 255));
+        }
+        return table;
+    }();
+
+    const int n = x1 - x0 + 1;
+    for (int i = 0; i < n; ++i) {
+        coverage[i] = coverageGamma[coverage[i]];
+    }
+
+    pipeSetXY(pipe, x0, y);
+    if (pipe->runSpan) {
+        (this->*pipe->runSpan)(pipe, coverage, n);
+    } else {
+        for (int i = 0; i < n; ++i) {
+            if (coverage[i] != 0) {
+                pipe->shape = coverage[i];
+                (this->*pipe->run)(pipe);
+            } else {
+                pipeIncX(pipe);
+            }
+        }
+    }
 }
 
 //------------------------------------------------------------------------
@@ -1514,6 +1953,8 @@ Splash::Splash(SplashBitmap *bitmapA, bool vectorAntialiasA, SplashScreenParams
     }
     minLineWidth = 0;
     thinLineMode = splashThinLineDefault;
+    analyticAA = false;
+    lanczosDownscaling = false;
     debugMode = false;
     alpha0Bitmap = nullptr;
     groupBackBitmap = nullptr;
@@ -1539,6 +1980,8 @@ Splash::Splash(SplashBitmap *bitmapA, bool vectorAntialiasA, const SplashScreen
     }
     minLineWidth = 0;
     thinLineMode = splashThinLineDefault;
+    analyticAA = false;
+    lanczosDownscaling = false;
     debugMode = false;
     alpha0Bitmap = nullptr;
     groupBackBitmap = nullptr;
@@ -1766,9 +2209,9 @@ SplashError Splash::clipToPath(const SplashPath &path, bool eo)
     return state->clip->clipToPath(path, state->matrix, state->flatness, eo);
 }
 
-void Splash::setSoftMask(SplashBitmap *softMask)
+void Splash::setSoftMask(SplashBitmap *softMask, SplashBitmapPool *softMaskPool)
 {
-    state->setSoftMask(softMask);
+    state->setSoftMask(softMask, softMaskPool);
 }
 
 void Splash::setInTransparencyGroup(SplashBitmap *groupBackBitmapA, int groupBackXA, int groupBackYA, bool nonIsolated, bool knockout)
@@ -2428,6 +2871,36 @@ SplashError Splash::fillWithPattern(SplashPath *path, bool eo, SplashPattern *pa
     }
 
     SplashXPath xPath(*path, state->matrix, state->flatness, true, adjustLine, linePosI);
+
+    // the analytic coverage rasterizer doesn't handle thin line
+    // adjustment nor anti-aliased clipping, fall back to supersampling
+    // for those
+    if (analyticAA && vectorAntialias && !inShading && thinLineMode == splashThinLineDefault) {
+        // stroke adjusted edges go exactly on the pixel boundaries here
+        std::unique_ptr<SplashXPath> exactXPath;
+        if (path->hints) {
+            exactXPath = std::make_unique<SplashXPath>(*path, state->matrix, state->flatness, true, adjustLine, linePosI, true);
+        }
+        SplashXPathCoverageScanner coverageScanner(exactXPath ? *exactXPath : xPath, eo, state->clip->getYMinI(), state->clip->getYMaxI());
+        coverageScanner.getBBox(&xMinI, &yMinI, &xMaxI, &yMaxI);
+        clipRes = state->clip->testRect(xMinI, yMinI, xMaxI, yMaxI);
+        if (clipRes == splashClipAllOutside) {
+            opClipRes = clipRes;
+            return SplashError::NoError;
+        }
+        if (clipRes == splashClipAllInside) {
+            pipeInit(&pipe, 0, yMinI, pattern, nullptr, static_cast<unsigned char>(splashRound(alpha * 255)), true, false);
+            for (y = yMinI; y <= yMaxI; ++y) {
+                unsigned char *coverage = coverageScanner.renderCoverageLine(y, &x0, &x1);
+                if (coverage) {
+                    drawCoverageLine(&pipe, coverage, x0, x1, y);
+                }
+            }
+            opClipRes = clipRes;
+            return SplashError::NoError;
+        }
+    }
+
     if (vectorAntialias && !inShading) {
         xPath.aaScale();
     }
@@ -2684,13 +3157,19 @@ void Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph, bool noClip)
             pipeInit(&pipe, xStart, yStart, state->fillPattern, nullptr, static_cast<unsigned char>(splashRound(state->fillAlpha * 255)), true, false);
             for (yy = 0, y1 = yStart; yy < yyLimit; ++yy, ++y1) {
                 pipeSetXY(&pipe, xStart, y1);
-                for (xx = 0, x1 = xStart; xx < xxLimit; ++xx, ++x1) {
-                    alpha = p[xx];
-                    if (alpha != 0) {
-                        pipe.shape = alpha;
-                        (this->*pipe.run)(&pipe);
-                    } else {
-                        pipeIncX(&pipe);
+                if (pipe.runSpan) {
+                    if (xxLimit > 0) {
+                        (this->*pipe.runSpan)(&pipe, p, xxLimit);
+                    }
+                } else {
+                    for (xx = 0, x1 = xStart; xx < xxLimit; ++xx, ++x1) {
+                        alpha = p[xx];
+                        if (alpha != 0) {
+                            pipe.shape = alpha;
+                            (this->*pipe.run)(&pipe);
+                        } else {
+                            pipeIncX(&pipe);
+                        }
                     }
                 }
                 p += glyph->w;
@@ -3105,6 +3584,149 @@ void Splash::arbitraryTransformMask(SplashImageMaskSource src, void *srcData, in
     }
 }
 
+//------------------------------------------------------------------------
+// row kernels of the image and mask scalers
+//
+// The kernels are instantiated for the component layout of each color
+// mode: <nComps> components per pixel in the source rows, and the first
+// three components stored in reverse order for BGR8 and XBGR8 (bgr =
+// true, with nComps = 4 meaning XBGR8), which leaves the per pixel loops
+// with a fixed trip count.  The kernels working on whole rows of
+// components (accumulateRow, lanczosAccumulateRow and interpolateRows)
+// go through the rows in chunks of scaleChunk components, whose loops
+// have a fixed trip count and restrict pointers, so that the compiler
+// vectorizes them without run time alias checks; they are also built for
+// AVX2.  The others (boxFilterRow, replicateRow and expandRow) step
+// through the source with the scale Bresenham or a filter, pixel by
+// pixel, and stay scalar.
+//------------------------------------------------------------------------
+
+constexpr int scaleChunk = 64;
+
+// Store the components of a scaled pixel in the order of the color mode.
+template<int nComps, bool bgr>
+static inline void storeScaledPixel(unsigned char *destPtr, const unsigned int *pix)
+{
+    if (bgr) {
+        destPtr[0] = static_cast<unsigned char>(pix[2]);
+        destPtr[1] = static_cast<unsigned char>(pix[1]);
+        destPtr[2] = static_cast<unsigned char>(pix[0]);
+        if (nComps == 4) {
+            destPtr[3] = 255;
+        }
+    } else {
+        for (int c = 0; c < nComps; ++c) {
+            destPtr[c] = static_cast<unsigned char>(pix[c]);
+        }
+    }
+}
+
+// Box filter a row of <srcRow>, which holds the sums of the source rows
+// mapped to the destination row, down to <scaledWidth> pixels.  <xp> and
+// <xq> are the x scale Bresenham parameters; <d0> and <d1> scale the sums
+// of xp and xp + 1 pixels to the destination range, in 9.23 fixed point.
+template<int nComps, bool bgr, typename T>
+static void boxFilterRow(const T *srcRow, unsigned char *destPtr, int scaledWidth, int xp, int xq, unsigned int d0, unsigned int d1)
+{
+    unsigned int pix[nComps];
+    int xt = 0;
+    for (int x = 0; x < scaledWidth; ++x, destPtr += nComps) {
+        for (int c = 0; c < nComps; ++c) {
+            pix[c] = 0;
+        }
+        // xp pixels, and one more on the Bresenham steps
+        for (int i = 0; i < xp; ++i, srcRow += nComps) {
+            for (int c = 0; c < nComps; ++c) {
+                pix[c] += srcRow[c];
+            }
+        }
+        unsigned int d = d0;
+        if ((xt += xq) >= scaledWidth) {
+            xt -= scaledWidth;
+            for (int c = 0; c < nComps; ++c) {
+                pix[c] += srcRow[c];
+            }
+            srcRow += nComps;
+            d = d1;
+        }
+        for (int c = 0; c < nComps; ++c) {
+            pix[c] = (pix[c] * d) >> 23;
+        }
+        storeScaledPixel<nComps, bgr>(destPtr, pix);
+    }
+}
+
+// Replicate each of the <srcWidth> pixels of <srcRow> xp or xp + 1 times,
+// scaled by <d> in 9.23 fixed point.
+template<int nComps, bool bgr, typename T>
+static void replicateRow(const T *srcRow, unsigned char *destPtr, int srcWidth, int xp, int xq, unsigned int d)
+{
+    unsigned int pix[nComps];
+    int xt = 0;
+    for (int x = 0; x < srcWidth; ++x, srcRow += nComps) {
+        for (int c = 0; c < nComps; ++c) {
+            pix[c] = (srcRow[c] * d) >> 23;
+        }
+        // xp copies, and one more on the Bresenham steps
+        for (int i = 0; i < xp; ++i, destPtr += nComps) {
+            storeScaledPixel<nComps, bgr>(destPtr, pix);
+        }
+        if ((xt += xq) >= srcWidth) {
+            xt -= srcWidth;
+            storeScaledPixel<nComps, bgr>(destPtr, pix);
+            destPtr += nComps;
+        }
+    }
+}
+
+// Add a source row to the sums in <pixBuf>.
+GOO_TARGET_CLONES static void accumulateRow(unsigned int *__restrict pixBuf, const unsigned char *__restrict lineBuf, int n)
+{
+    int j = 0;
+    for (; j + scaleChunk <= n; j += scaleChunk) {
+        for (int i = 0; i < scaleChunk; ++i) {
+            pixBuf[j + i] += lineBuf[j + i];
+        }
+    }
+    for (; j < n; ++j) {
+        pixBuf[j] += lineBuf[j];
+    }
+}
+
+// Copy the first row of <destPtr> to the <nRows> - 1 rows below it.
+static inline void replicateRows(unsigned char *destPtr, int rowSize, int nRows)
+{
+    for (int i = 1; i < nRows; ++i) {
+        memcpy(destPtr + i * rowSize, destPtr, rowSize);
+    }
+}
+
+// Return the instance of a row kernel for the component layout of
+// <mode>: <select> is a generic lambda with <int nComps, bool bgr>
+// template parameters which returns a pointer to the kernel.  Returns
+// nullptr for Mono1, which the scalers don't support.
+template<typename Select>
+static auto selectScaleKernel(SplashColorMode mode, Select select) -> decltype(select.template operator()<1, false>())
+{
+    switch (mode) {
+    case splashModeMono8:
+        return select.template operator()<1, false>();
+    case splashModeRGB8:
+        return select.template operator()<3, false>();
+    case splashModeBGR8:
+        return select.template operator()<3, true>();
+    case splashModeXBGR8:
+        return select.template operator()<4, true>();
+    case splashModeCMYK8:
+        return select.template operator()<4, false>();
+    case splashModeDeviceN8:
+        return select.template operator()<SPOT_NCOMPS + 4, false>();
+    case splashModeMono1: // mono1 is not allowed
+        break;
+    }
+    return nullptr;
+}
+
 // Scale an image mask into a SplashBitmap.
 std::unique_ptr<SplashBitmap> Splash::scaleMask(SplashImageMaskSource src, void *srcData, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight)
 {
@@ -3129,10 +3751,9 @@ void Splash::scaleMaskYdownXdown(SplashImageMaskSource src, void *srcData, int s
 {
     unsigned char *lineBuf;
     unsigned int *pixBuf;
-    unsigned int pix;
     unsigned char *destPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, d, d0, d1;
-    int i, j;
+    int yp, yq, xp, xq, yt, y, yStep;
+    int i;
 
     // Bresenham parameters for y scale
     yp = srcHeight / scaledHeight;
@@ -3174,40 +3795,12 @@ void Splash::scaleMaskYdownXdown(SplashImageMaskSource src, void *srcData, int s
         memset(pixBuf, 0, srcWidth * sizeof(int));
         for (i = 0; i < yStep; ++i) {
             (*src)(srcData, lineBuf);
-            for (j = 0; j < srcWidth; ++j) {
-                pixBuf[j] += lineBuf[j];
-            }
+            accumulateRow(pixBuf, lineBuf, srcWidth);
         }
 
-        // init x scale Bresenham
-        xt = 0;
-        d0 = (255 << 23) / (yStep * xp);
-        d1 = (255 << 23) / (yStep * (xp + 1));
-
-        xx = 0;
-        for (x = 0; x < scaledWidth; ++x) {
-
-            // x scale Bresenham
-            if ((xt += xq) >= scaledWidth) {
-                xt -= scaledWidth;
-                xStep = xp + 1;
-                d = d1;
-            } else {
-                xStep = xp;
-                d = d0;
-            }
-
-            // compute the final pixel
-            pix = 0;
-            for (i = 0; i < xStep; ++i) {
-                pix += pixBuf[xx++];
-            }
-            // (255 * pix) / xStep * yStep
-            pix = (pix * d) >> 23;
-
-            // store the pixel
-            *destPtr++ = static_cast<unsigned char>(pix);
-        }
+        // (255 * pix) / xStep * yStep
+        boxFilterRow<1, false>(pixBuf, destPtr, scaledWidth, xp, xq, (255 << 23) / (yStep * xp), (255 << 23) / (yStep * (xp + 1)));
+        destPtr += scaledWidth;
     }
 
     gfree(pixBuf);
@@ -3218,10 +3811,9 @@ void Splash::scaleMaskYdownXup(SplashImageMaskSource src, void *srcData, int src
 {
     unsigned char *lineBuf;
     unsigned int *pixBuf;
-    unsigned int pix;
     unsigned char *destPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, d;
-    int i, j;
+    int yp, yq, xp, xq, yt, y, yStep;
+    int i;
 
     destPtr = dest->data;
     if (destPtr == nullptr) {
@@ -3268,35 +3860,12 @@ void Splash::scaleMaskYdownXup(SplashImageMaskSource src, void *srcData, int src
         memset(pixBuf, 0, srcWidth * sizeof(int));
         for (i = 0; i < yStep; ++i) {
             (*src)(srcData, lineBuf);
-            for (j = 0; j < srcWidth; ++j) {
-                pixBuf[j] += lineBuf[j];
-            }
+            accumulateRow(pixBuf, lineBuf, srcWidth);
         }
 
-        // init x scale Bresenham
-        xt = 0;
-        d = (255 << 23) / yStep;
-
-        for (x = 0; x < srcWidth; ++x) {
-
-            // x scale Bresenham
-            if ((xt += xq) >= srcWidth) {
-                xt -= srcWidth;
-                xStep = xp + 1;
-            } else {
-                xStep = xp;
-            }
-
-            // compute the final pixel
-            pix = pixBuf[x];
-            // (255 * pix) / yStep
-            pix = (pix * d) >> 23;
-
-            // store the pixel
-            for (i = 0; i < xStep; ++i) {
-                *destPtr++ = static_cast<unsigned char>(pix);
-            }
-        }
+        // (255 * pix) / yStep
+        replicateRow<1, false>(pixBuf, destPtr, srcWidth, xp, xq, (255 << 23) / yStep);
+        destPtr += scaledWidth;
     }
 
     gfree(pixBuf);
@@ -3306,10 +3875,8 @@ void Splash::scaleMaskYdownXup(SplashImageMaskSource src, void *srcData, int src
 void Splash::scaleMaskYupXdown(SplashImageMaskSource src, void *srcData, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest)
 {
     unsigned char *lineBuf;
-    unsigned int pix;
-    unsigned char *destPtr0, *destPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, d, d0, d1;
-    int i;
+    unsigned char *destPtr0;
+    int yp, yq, xp, xq, yt, y, yStep;
 
     destPtr0 = dest->data;
     if (destPtr0 == nullptr) {
@@ -3348,38 +3915,9 @@ void Splash::scaleMaskYupXdown(SplashImageMaskSource src, void *srcData, int src
         // read row from image
         (*src)(srcData, lineBuf);
 
-        // init x scale Bresenham
-        xt = 0;
-        d0 = (255 << 23) / xp;
-        d1 = (255 << 23) / (xp + 1);
-
-        xx = 0;
-        for (x = 0; x < scaledWidth; ++x) {
-
-            // x scale Bresenham
-            if ((xt += xq) >= scaledWidth) {
-                xt -= scaledWidth;
-                xStep = xp + 1;
-                d = d1;
-            } else {
-                xStep = xp;
-                d = d0;
-            }
-
-            // compute the final pixel
-            pix = 0;
-            for (i = 0; i < xStep; ++i) {
-                pix += lineBuf[xx++];
-            }
-            // (255 * pix) / xStep
-            pix = (pix * d) >> 23;
-
-            // store the pixel
-            for (i = 0; i < yStep; ++i) {
-                destPtr = destPtr0 + i * scaledWidth + x;
-                *destPtr = static_cast<unsigned char>(pix);
-            }
-        }
+        // (255 * pix) / xStep
+        boxFilterRow<1, false>(lineBuf, destPtr0, scaledWidth, xp, xq, (255 << 23) / xp, (255 << 23) / (xp + 1));
+        replicateRows(destPtr0, scaledWidth, yStep);
 
         destPtr0 += yStep * scaledWidth;
     }
@@ -3390,10 +3928,8 @@ void Splash::scaleMaskYupXdown(SplashImageMaskSource src, void *srcData, int src
 void Splash::scaleMaskYupXup(SplashImageMaskSource src, void *srcData, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest)
 {
     unsigned char *lineBuf;
-    unsigned int pix;
-    unsigned char *destPtr0, *destPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx;
-    int i, j;
+    unsigned char *destPtr0;
+    int yp, yq, xp, xq, yt, y, yStep;
 
     destPtr0 = dest->data;
     if (destPtr0 == nullptr) {
@@ -3438,39 +3974,20 @@ void Splash::scaleMaskYupXup(SplashImageMaskSource src, void *srcData, int srcWi
         // read row from image
         (*src)(srcData, lineBuf);
 
-        // init x scale Bresenham
-        xt = 0;
+        // compute the final pixels
+        for (int x = 0; x < srcWidth; ++x) {
+            lineBuf[x] = lineBuf[x] ? 255 : 0;
+        }
 
-        xx = 0;
-        for (x = 0; x < srcWidth; ++x) {
+        // store the pixels
+        replicateRow<1, false>(lineBuf, destPtr0, srcWidth, xp, xq, 1 << 23);
+        replicateRows(destPtr0, scaledWidth, yStep);
 
-            // x scale Bresenham
-            if ((xt += xq) >= srcWidth) {
-                xt -= srcWidth;
-                xStep = xp + 1;
-            } else {
-                xStep = xp;
-            }
+        destPtr0 += yStep * scaledWidth;
+    }
 
-            // compute the final pixel
-            pix = lineBuf[x] ? 255 : 0;
-
-            // store the pixel
-            for (i = 0; i < yStep; ++i) {
-                for (j = 0; j < xStep; ++j) {
-                    destPtr = destPtr0 + i * scaledWidth + xx + j;
-                    *destPtr++ = static_cast<unsigned char>(pix);
-                }
-            }
-
-            xx += xStep;
-        }
-
-        destPtr0 += yStep * scaledWidth;
-    }
-
-    gfree(lineBuf);
-}
+    gfree(lineBuf);
+}
 
 void Splash::blitMask(const SplashBitmap &src, int xDest, int yDest, SplashClipResult clipRes)
 {
@@ -3495,7 +4012,13 @@ void Splash::blitMask(const SplashBitmap &src, int xDest, int yDest, SplashClipR
         }
     } else {
         pipeInit(&pipe, xDest, yDest, state->fillPattern, nullptr, static_cast<unsigned char>(splashRound(state->fillAlpha * 255)), true, false);
-        if (clipRes == splashClipAllInside) {
+        if (clipRes == splashClipAllInside && pipe.runSpan) {
+            for (y = 0; y < h; ++y) {
+                pipeSetXY(&pipe, xDest, yDest + y);
+                (this->*pipe.runSpan)(&pipe, p, w);
+                p += w;
+            }
+        } else if (clipRes == splashClipAllInside) {
             for (y = 0; y < h; ++y) {
                 pipeSetXY(&pipe, xDest, yDest + y);
                 for (x = 0; x < w; ++x) {
@@ -4005,7 +4528,9 @@ std::unique_ptr<SplashBitmap> Splash::scaleImage(SplashImageSource src, void *sr
     if (dest->getDataPtr() != nullptr && srcHeight > 0 && srcWidth > 0) {
         bool success = true;
         if (scaledHeight < srcHeight) {
-            if (scaledWidth < srcWidth) {
+            if (scaledWidth < srcWidth && lanczosDownscaling && !tilingPattern) {
+                success = scaleImageLanczos(src, srcData, srcMode, nComps, srcAlpha, srcWidth, srcHeight, scaledWidth, scaledHeight, dest.get());
+            } else if (scaledWidth < srcWidth) {
                 success = scaleImageYdownXdown(src, srcData, srcMode, nComps, srcAlpha, srcWidth, srcHeight, scaledWidth, scaledHeight, dest.get());
             } else {
                 success = scaleImageYdownXup(src, srcData, srcMode, nComps, srcAlpha, srcWidth, srcHeight, scaledWidth, scaledHeight, dest.get());
@@ -4034,13 +4559,12 @@ bool Splash::scaleImageYdownXdown(SplashImageSource src, void *srcData, SplashCo
 {
     unsigned char *lineBuf, *alphaLineBuf;
     unsigned int *pixBuf, *alphaPixBuf;
-    unsigned int pix0, pix1, pix2;
-    unsigned int pix3;
-    unsigned int pix[SPOT_NCOMPS + 4], cp;
-    unsigned int alpha;
     unsigned char *destPtr, *destAlphaPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
-    int i, j;
+    int yp, yq, xp, xq, yt, y, yStep;
+    unsigned int d0, d1;
+    int i;
+
+    const auto scaleRow = selectScaleKernel(srcMode, []<int n, bool bgr>() { return &boxFilterRow<n, bgr, unsigned int>; });
 
     // Bresenham parameters for y scale
     yp = srcHeight / scaledHeight;
@@ -4103,182 +4627,208 @@ bool Splash::scaleImageYdownXdown(SplashImageSource src, void *srcData, SplashCo
         }
         for (i = 0; i < yStep; ++i) {
             (*src)(srcData, lineBuf, alphaLineBuf);
-            for (j = 0; j < srcWidth * nComps; ++j) {
-                pixBuf[j] += lineBuf[j];
-            }
+            accumulateRow(pixBuf, lineBuf, srcWidth * nComps);
             if (srcAlpha) {
-                for (j = 0; j < srcWidth; ++j) {
-                    alphaPixBuf[j] += alphaLineBuf[j];
-                }
+                accumulateRow(alphaPixBuf, alphaLineBuf, srcWidth);
             }
         }
 
-        // init x scale Bresenham
-        xt = 0;
+        // pix / xStep * yStep
         d0 = (1 << 23) / (yStep * xp);
         d1 = (1 << 23) / (yStep * (xp + 1));
+        if (scaleRow) {
+            scaleRow(pixBuf, destPtr, scaledWidth, xp, xq, d0, d1);
+        }
+        destPtr += scaledWidth * nComps;
 
-        xx = xxa = 0;
-        for (x = 0; x < scaledWidth; ++x) {
+        // process alpha
+        if (srcAlpha) {
+            boxFilterRow<1, false>(alphaPixBuf, destAlphaPtr, scaledWidth, xp, xq, d0, d1);
+            destAlphaPtr += scaledWidth;
+        }
+    }
 
-            // x scale Bresenham
-            if ((xt += xq) >= scaledWidth) {
-                xt -= scaledWidth;
-                xStep = xp + 1;
-                d = d1;
-            } else {
-                xStep = xp;
-                d = d0;
-            }
+    gfree(alphaPixBuf);
+    gfree(alphaLineBuf);
+    gfree(pixBuf);
+    gfree(lineBuf);
 
-            switch (srcMode) {
+    return true;
+}
 
-            case splashModeMono8:
+//------------------------------------------------------------------------
+// Lanczos downscaling
+//------------------------------------------------------------------------
 
-                // compute the final pixel
-                pix0 = 0;
-                for (i = 0; i < xStep; ++i) {
-                    pix0 += pixBuf[xx++];
-                }
-                // pix / xStep * yStep
-                pix0 = (pix0 * d) >> 23;
+namespace {
 
-                // store the pixel
-                *destPtr++ = static_cast<unsigned char>(pix0);
-                break;
+// Lanczos-3 filter weights of the source pixels of each destination
+// pixel along one axis.  Every destination pixel has <nTaps> weights,
+// applying to the source pixels from first[i] on; the weights of pixels
+// beyond the edges of the image are folded onto the edge pixels.
+struct LanczosFilter
+{
+    LanczosFilter(int srcSize, int scaledSize);
 
-            case splashModeRGB8:
+    int nTaps;
+    std::vector<int> first;
+    std::vector<float> weights;
+};
 
-                // compute the final pixel
-                pix0 = pix1 = pix2 = 0;
-                for (i = 0; i < xStep; ++i) {
-                    pix0 += pixBuf[xx];
-                    pix1 += pixBuf[xx + 1];
-                    pix2 += pixBuf[xx + 2];
-                    xx += 3;
-                }
-                // pix / xStep * yStep
-                pix0 = (pix0 * d) >> 23;
-                pix1 = (pix1 * d) >> 23;
-                pix2 = (pix2 * d) >> 23;
-
-                // store the pixel
-                *destPtr++ = static_cast<unsigned char>(pix0);
-                *destPtr++ = static_cast<unsigned char>(pix1);
-                *destPtr++ = static_cast<unsigned char>(pix2);
-                break;
+double lanczos3(double t)
+{
+    if (t == 0) {
+        return 1;
+    }
+    if (t <= -3 || t >= 3) {
+        return 0;
+    }
+    const double pt = std::numbers::pi * t;
+    return 3 * sin(pt) * sin(pt / 3) / (pt * pt);
+}
 
-            case splashModeXBGR8:
+LanczosFilter::LanczosFilter(int srcSize, int scaledSize)
+{
+    // the filter is stretched by the scale factor, so that it averages
+    // all the source pixels of a destination pixel
+    const double scale = static_cast<double>(srcSize) / scaledSize;
+    const double support = 3 * scale;
+    nTaps = std::min(static_cast<int>(ceil(2 * support)) + 1, srcSize);
+    first.resize(scaledSize);
+    weights.assign(static_cast<size_t>(scaledSize) * nTaps, 0);
+    for (int i = 0; i < scaledSize; ++i) {
+        const double center = (i + 0.5) * scale - 0.5;
+        const int lo = static_cast<int>(ceil(center - support));
+        const int hi = static_cast<int>(floor(center + support));
+        first[i] = std::clamp(lo, 0, srcSize - nTaps);
+        float *w = &weights[static_cast<size_t>(i) * nTaps];
+        double sum = 0;
+        for (int j = lo; j <= hi; ++j) {
+            const double wj = lanczos3((j - center) / scale);
+            w[std::clamp(j, 0, srcSize - 1) - first[i]] += static_cast<float>(wj);
+            sum += wj;
+        }
+        for (int k = 0; k < nTaps; ++k) {
+            w[k] = static_cast<float>(w[k] / sum);
+        }
+    }
+}
 
-                // compute the final pixel
-                pix0 = pix1 = pix2 = 0;
-                for (i = 0; i < xStep; ++i) {
-                    pix0 += pixBuf[xx];
-                    pix1 += pixBuf[xx + 1];
-                    pix2 += pixBuf[xx + 2];
-                    xx += 4;
-                }
-                // pix / xStep * yStep
-                pix0 = (pix0 * d) >> 23;
-                pix1 = (pix1 * d) >> 23;
-                pix2 = (pix2 * d) >> 23;
-
-                // store the pixel
-                *destPtr++ = static_cast<unsigned char>(pix2);
-                *destPtr++ = static_cast<unsigned char>(pix1);
-                *destPtr++ = static_cast<unsigned char>(pix0);
-                *destPtr++ = static_cast<unsigned char>(255);
-                break;
+}
 
-            case splashModeBGR8:
+// Filter a row of vertically filtered source pixels horizontally, and
+// round the result, which can overshoot because of the negative lobes of
+// the filter, into a destination row.
+template<int nComps, bool bgr>
+static void lanczosFilterRow(const float *srcRow, unsigned char *destPtr, const LanczosFilter &filter, int scaledWidth)
+{
+    const int nTaps = filter.nTaps;
+    const float *w = filter.weights.data();
+    float sum[nComps];
+    unsigned int pix[nComps];
+    for (int x = 0; x < scaledWidth; ++x, w += nTaps, destPtr += nComps) {
+        const float *p = srcRow + filter.first[x] * nComps;
+        for (int c = 0; c < nComps; ++c) {
+            sum[c] = 0;
+        }
+        for (int k = 0; k < nTaps; ++k, p += nComps) {
+            for (int c = 0; c < nComps; ++c) {
+                sum[c] += w[k] * p[c];
+            }
+        }
+        for (int c = 0; c < nComps; ++c) {
+            pix[c] = static_cast<unsigned int>(std::clamp(sum[c], 0.0f, 255.0f) + 0.5f);
+        }
+        storeScaledPixel<nComps, bgr>(destPtr, pix);
+    }
+}
 
-                // compute the final pixel
-                pix0 = pix1 = pix2 = 0;
-                for (i = 0; i < xStep; ++i) {
-                    pix0 += pixBuf[xx];
-                    pix1 += pixBuf[xx + 1];
-                    pix2 += pixBuf[xx + 2];
-                    xx += 3;
-                }
-                // pix / xStep * yStep
-                pix0 = (pix0 * d) >> 23;
-                pix1 = (pix1 * d) >> 23;
-                pix2 = (pix2 * d) >> 23;
-
-                // store the pixel
-                *destPtr++ = static_cast<unsigned char>(pix2);
-                *destPtr++ = static_cast<unsigned char>(pix1);
-                *destPtr++ = static_cast<unsigned char>(pix0);
-                break;
+// Add a weighted source row to a row of vertically filtered pixels.
+GOO_TARGET_CLONES static void lanczosAccumulateRow(float *__restrict acc, const unsigned char *__restrict lineBuf, float w, int n)
+{
+    int j = 0;
+    for (; j + scaleChunk <= n; j += scaleChunk) {
+        for (int i = 0; i < scaleChunk; ++i) {
+            acc[j + i] += w * lineBuf[j + i];
+        }
+    }
+    for (; j < n; ++j) {
+        acc[j] += w * lineBuf[j];
+    }
+}
 
-            case splashModeCMYK8:
+// Scale down an image with a separable Lanczos-3 filter.  Each source row
+// is added, weighted, to the destination rows whose vertical filter
+// covers it; once all of its source rows are in, a destination row is
+// filtered horizontally.  Only the destination rows in progress are kept.
+bool Splash::scaleImageLanczos(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest)
+{
+    const auto filterRow = selectScaleKernel(srcMode, []<int n, bool bgr>() { return &lanczosFilterRow<n, bgr>; });
+    if (!filterRow) {
+        return false;
+    }
 
-                // compute the final pixel
-                pix0 = pix1 = pix2 = pix3 = 0;
-                for (i = 0; i < xStep; ++i) {
-                    pix0 += pixBuf[xx];
-                    pix1 += pixBuf[xx + 1];
-                    pix2 += pixBuf[xx + 2];
-                    pix3 += pixBuf[xx + 3];
-                    xx += 4;
-                }
-                // pix / xStep * yStep
-                pix0 = (pix0 * d) >> 23;
-                pix1 = (pix1 * d) >> 23;
-                pix2 = (pix2 * d) >> 23;
-                pix3 = (pix3 * d) >> 23;
-
-                // store the pixel
-                *destPtr++ = static_cast<unsigned char>(pix0);
-                *destPtr++ = static_cast<unsigned char>(pix1);
-                *destPtr++ = static_cast<unsigned char>(pix2);
-                *destPtr++ = static_cast<unsigned char>(pix3);
-                break;
-            case splashModeDeviceN8:
+    const LanczosFilter xFilter(srcWidth, scaledWidth);
+    const LanczosFilter yFilter(srcHeight, scaledHeight);
+    const int nTaps = yFilter.nTaps;
 
-                // compute the final pixel
-                for (cp = 0; cp < SPOT_NCOMPS + 4; cp++) {
-                    pix[cp] = 0;
-                }
-                for (i = 0; i < xStep; ++i) {
-                    for (cp = 0; cp < SPOT_NCOMPS + 4; cp++) {
-                        pix[cp] += pixBuf[xx + cp];
-                    }
-                    xx += (SPOT_NCOMPS + 4);
-                }
-                // pix / xStep * yStep
-                for (cp = 0; cp < SPOT_NCOMPS + 4; cp++) {
-                    pix[cp] = (pix[cp] * d) >> 23;
-                }
+    // the destination rows covering a source row start at most nTaps
+    // source rows apart
+    int nAcc = 0;
+    for (int y0 = 0, y1 = 0; y0 < scaledHeight; ++y0) {
+        while (y1 < scaledHeight && yFilter.first[y1] < yFilter.first[y0] + nTaps) {
+            ++y1;
+        }
+        nAcc = std::max(nAcc, y1 - y0);
+    }
 
-                // store the pixel
-                for (cp = 0; cp < SPOT_NCOMPS + 4; cp++) {
-                    *destPtr++ = static_cast<unsigned char>(pix[cp]);
-                }
-                break;
+    const int lineSize = srcWidth * nComps;
+    unsigned char *lineBuf = static_cast<unsigned char *>(gmallocn_checkoverflow(srcWidth, nComps));
+    unsigned char *alphaLineBuf = srcAlpha ? static_cast<unsigned char *>(gmalloc_checkoverflow(srcWidth)) : nullptr;
+    float *accBuf = static_cast<float *>(gmallocn3(nAcc, lineSize, sizeof(float), true));
+    float *alphaAccBuf = srcAlpha ? static_cast<float *>(gmallocn3(nAcc, srcWidth, sizeof(float), true)) : nullptr;
+    if (unlikely(!lineBuf || !accBuf || (srcAlpha && (!alphaLineBuf || !alphaAccBuf)))) {
+        error(errInternal, -1, "Couldn't allocate memory in Splash::scaleImageLanczos");
+        gfree(lineBuf);
+        gfree(alphaLineBuf);
+        gfree(accBuf);
+        gfree(alphaAccBuf);
+        return false;
+    }
 
-            case splashModeMono1: // mono1 is not allowed
-            default:
-                break;
+    // destination rows [yOut, yNext) are in progress, in row y % nAcc of
+    // accBuf
+    int yNext = 0, yOut = 0;
+    for (int r = 0; r < srcHeight; ++r) {
+        (*src)(srcData, lineBuf, alphaLineBuf);
+
+        for (; yNext < scaledHeight && yFilter.first[yNext] <= r; ++yNext) {
+            memset(accBuf + static_cast<size_t>(yNext % nAcc) * lineSize, 0, lineSize * sizeof(float));
+            if (srcAlpha) {
+                memset(alphaAccBuf + static_cast<size_t>(yNext % nAcc) * srcWidth, 0, srcWidth * sizeof(float));
             }
+        }
 
-            // process alpha
+        for (int y = yOut; y < yNext; ++y) {
+            const float w = yFilter.weights[static_cast<size_t>(y) * nTaps + r - yFilter.first[y]];
+            lanczosAccumulateRow(accBuf + static_cast<size_t>(y % nAcc) * lineSize, lineBuf, w, lineSize);
             if (srcAlpha) {
-                alpha = 0;
-                for (i = 0; i < xStep; ++i, ++xxa) {
-                    alpha += alphaPixBuf[xxa];
-                }
-                // alpha / xStep * yStep
-                alpha = (alpha * d) >> 23;
-                *destAlphaPtr++ = static_cast<unsigned char>(alpha);
+                lanczosAccumulateRow(alphaAccBuf + static_cast<size_t>(y % nAcc) * srcWidth, alphaLineBuf, w, srcWidth);
+            }
+        }
+
+        for (; yOut < yNext && yFilter.first[yOut] + nTaps - 1 == r; ++yOut) {
+            filterRow(accBuf + static_cast<size_t>(yOut % nAcc) * lineSize, dest->data + static_cast<size_t>(yOut) * scaledWidth * nComps, xFilter, scaledWidth);
+            if (srcAlpha) {
+                lanczosFilterRow<1, false>(alphaAccBuf + static_cast<size_t>(yOut % nAcc) * srcWidth, dest->alpha + static_cast<size_t>(yOut) * scaledWidth, xFilter, scaledWidth);
             }
         }
     }
 
-    gfree(alphaPixBuf);
-    gfree(alphaLineBuf);
-    gfree(pixBuf);
     gfree(lineBuf);
+    gfree(alphaLineBuf);
+    gfree(accBuf);
+    gfree(alphaAccBuf);
 
     return true;
 }
@@ -4287,11 +4837,12 @@ bool Splash::scaleImageYdownXup(SplashImageSource src, void *srcData, SplashColo
 {
     unsigned char *lineBuf, *alphaLineBuf;
     unsigned int *pixBuf, *alphaPixBuf;
-    unsigned int pix[splashMaxColorComps];
-    unsigned int alpha;
     unsigned char *destPtr, *destAlphaPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, d;
-    int i, j;
+    int yp, yq, xp, xq, yt, y, yStep;
+    unsigned int d;
+    int i;
+
+    const auto scaleRow = selectScaleKernel(srcMode, []<int n, bool bgr>() { return &replicateRow<n, bgr, unsigned int>; });
 
     // Bresenham parameters for y scale
     yp = srcHeight / scaledHeight;
@@ -4356,92 +4907,23 @@ bool Splash::scaleImageYdownXup(SplashImageSource src, void *srcData, SplashColo
         }
         for (i = 0; i < yStep; ++i) {
             (*src)(srcData, lineBuf, alphaLineBuf);
-            for (j = 0; j < srcWidth * nComps; ++j) {
-                pixBuf[j] += lineBuf[j];
-            }
+            accumulateRow(pixBuf, lineBuf, srcWidth * nComps);
             if (srcAlpha) {
-                for (j = 0; j < srcWidth; ++j) {
-                    alphaPixBuf[j] += alphaLineBuf[j];
-                }
+                accumulateRow(alphaPixBuf, alphaLineBuf, srcWidth);
             }
         }
 
-        // init x scale Bresenham
-        xt = 0;
+        // pixBuf[] / yStep
         d = (1 << 23) / yStep;
+        if (scaleRow) {
+            scaleRow(pixBuf, destPtr, srcWidth, xp, xq, d);
+        }
+        destPtr += scaledWidth * nComps;
 
-        for (x = 0; x < srcWidth; ++x) {
-
-            // x scale Bresenham
-            if ((xt += xq) >= srcWidth) {
-                xt -= srcWidth;
-                xStep = xp + 1;
-            } else {
-                xStep = xp;
-            }
-
-            // compute the final pixel
-            for (i = 0; i < nComps; ++i) {
-                // pixBuf[] / yStep
-                pix[i] = (pixBuf[x * nComps + i] * d) >> 23;
-            }
-
-            // store the pixel
-            switch (srcMode) {
-            case splashModeMono1: // mono1 is not allowed
-                break;
-            case splashModeMono8:
-                for (i = 0; i < xStep; ++i) {
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                }
-                break;
-            case splashModeRGB8:
-                for (i = 0; i < xStep; ++i) {
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                }
-                break;
-            case splashModeXBGR8:
-                for (i = 0; i < xStep; ++i) {
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    *destPtr++ = static_cast<unsigned char>(255);
-                }
-                break;
-            case splashModeBGR8:
-                for (i = 0; i < xStep; ++i) {
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                }
-                break;
-            case splashModeCMYK8:
-                for (i = 0; i < xStep; ++i) {
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                    *destPtr++ = static_cast<unsigned char>(pix[3]);
-                }
-                break;
-            case splashModeDeviceN8:
-                for (i = 0; i < xStep; ++i) {
-                    for (unsigned int cp : pix) {
-                        *destPtr++ = static_cast<unsigned char>(cp);
-                    }
-                }
-                break;
-            }
-
-            // process alpha
-            if (srcAlpha) {
-                // alphaPixBuf[] / yStep
-                alpha = (alphaPixBuf[x] * d) >> 23;
-                for (i = 0; i < xStep; ++i) {
-                    *destAlphaPtr++ = static_cast<unsigned char>(alpha);
-                }
-            }
+        // process alpha
+        if (srcAlpha) {
+            replicateRow<1, false>(alphaPixBuf, destAlphaPtr, srcWidth, xp, xq, d);
+            destAlphaPtr += scaledWidth;
         }
     }
 
@@ -4456,11 +4938,11 @@ bool Splash::scaleImageYdownXup(SplashImageSource src, void *srcData, SplashColo
 bool Splash::scaleImageYupXdown(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest)
 {
     unsigned char *lineBuf, *alphaLineBuf;
-    unsigned int pix[splashMaxColorComps];
-    unsigned int alpha;
-    unsigned char *destPtr0, *destPtr, *destAlphaPtr0, *destAlphaPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
-    int i, j;
+    unsigned char *destPtr0, *destAlphaPtr0;
+    int yp, yq, xp, xq, yt, y, yStep;
+    unsigned int d0, d1;
+
+    const auto scaleRow = selectScaleKernel(srcMode, []<int n, bool bgr>() { return &boxFilterRow<n, bgr, unsigned char>; });
 
     // Bresenham parameters for y scale
     yp = scaledHeight / srcHeight;
@@ -4487,6 +4969,10 @@ bool Splash::scaleImageYupXdown(SplashImageSource src, void *srcData, SplashColo
         alphaLineBuf = nullptr;
     }
 
+    // pix[] / xStep
+    d0 = (1 << 23) / xp;
+    d1 = (1 << 23) / (xp + 1);
+
     // init y scale Bresenham
     yt = 0;
 
@@ -4505,105 +4991,16 @@ bool Splash::scaleImageYupXdown(SplashImageSource src, void *srcData, SplashColo
         // read row from image
         (*src)(srcData, lineBuf, alphaLineBuf);
 
-        // init x scale Bresenham
-        xt = 0;
-        d0 = (1 << 23) / xp;
-        d1 = (1 << 23) / (xp + 1);
-
-        xx = xxa = 0;
-        for (x = 0; x < scaledWidth; ++x) {
-
-            // x scale Bresenham
-            if ((xt += xq) >= scaledWidth) {
-                xt -= scaledWidth;
-                xStep = xp + 1;
-                d = d1;
-            } else {
-                xStep = xp;
-                d = d0;
-            }
-
-            // compute the final pixel
-            for (i = 0; i < nComps; ++i) {
-                pix[i] = 0;
-            }
-            for (i = 0; i < xStep; ++i) {
-                for (j = 0; j < nComps; ++j, ++xx) {
-                    pix[j] += lineBuf[xx];
-                }
-            }
-            for (i = 0; i < nComps; ++i) {
-                // pix[] / xStep
-                pix[i] = (pix[i] * d) >> 23;
-            }
-
-            // store the pixel
-            switch (srcMode) {
-            case splashModeMono1: // mono1 is not allowed
-                break;
-            case splashModeMono8:
-                for (i = 0; i < yStep; ++i) {
-                    destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                }
-                break;
-            case splashModeRGB8:
-                for (i = 0; i < yStep; ++i) {
-                    destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                }
-                break;
-            case splashModeXBGR8:
-                for (i = 0; i < yStep; ++i) {
-                    destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    *destPtr++ = static_cast<unsigned char>(255);
-                }
-                break;
-            case splashModeBGR8:
-                for (i = 0; i < yStep; ++i) {
-                    destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                }
-                break;
-            case splashModeCMYK8:
-                for (i = 0; i < yStep; ++i) {
-                    destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-                    *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    *destPtr++ = static_cast<unsigned char>(pix[1]);
-                    *destPtr++ = static_cast<unsigned char>(pix[2]);
-                    *destPtr++ = static_cast<unsigned char>(pix[3]);
-                }
-                break;
-            case splashModeDeviceN8:
-                for (i = 0; i < yStep; ++i) {
-                    destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-                    for (unsigned int cp : pix) {
-                        *destPtr++ = static_cast<unsigned char>(cp);
-                    }
-                }
-                break;
-            }
+        // scale the row, and copy it to the other yStep - 1 rows
+        if (scaleRow) {
+            scaleRow(lineBuf, destPtr0, scaledWidth, xp, xq, d0, d1);
+            replicateRows(destPtr0, scaledWidth * nComps, yStep);
+        }
 
-            // process alpha
-            if (srcAlpha) {
-                alpha = 0;
-                for (i = 0; i < xStep; ++i, ++xxa) {
-                    alpha += alphaLineBuf[xxa];
-                }
-                // alpha / xStep
-                alpha = (alpha * d) >> 23;
-                for (i = 0; i < yStep; ++i) {
-                    destAlphaPtr = destAlphaPtr0 + i * scaledWidth + x;
-                    *destAlphaPtr = static_cast<unsigned char>(alpha);
-                }
-            }
+        // process alpha
+        if (srcAlpha) {
+            boxFilterRow<1, false>(alphaLineBuf, destAlphaPtr0, scaledWidth, xp, xq, d0, d1);
+            replicateRows(destAlphaPtr0, scaledWidth, yStep);
         }
 
         destPtr0 += yStep * scaledWidth * nComps;
@@ -4621,11 +5018,10 @@ bool Splash::scaleImageYupXdown(SplashImageSource src, void *srcData, SplashColo
 bool Splash::scaleImageYupXup(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest)
 {
     unsigned char *lineBuf, *alphaLineBuf;
-    unsigned int pix[splashMaxColorComps];
-    unsigned int alpha;
-    unsigned char *destPtr0, *destPtr, *destAlphaPtr0, *destAlphaPtr;
-    int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx;
-    int i, j;
+    unsigned char *destPtr0, *destAlphaPtr0;
+    int yp, yq, xp, xq, yt, y, yStep;
+
+    const auto scaleRow = selectScaleKernel(srcMode, []<int n, bool bgr>() { return &replicateRow<n, bgr, unsigned char>; });
 
     // Bresenham parameters for y scale
     yp = scaledHeight / srcHeight;
@@ -4671,103 +5067,17 @@ bool Splash::scaleImageYupXup(SplashImageSource src, void *srcData, SplashColorM
         // read row from image
         (*src)(srcData, lineBuf, alphaLineBuf);
 
-        // init x scale Bresenham
-        xt = 0;
-
-        xx = 0;
-        for (x = 0; x < srcWidth; ++x) {
-
-            // x scale Bresenham
-            if ((xt += xq) >= srcWidth) {
-                xt -= srcWidth;
-                xStep = xp + 1;
-            } else {
-                xStep = xp;
-            }
-
-            // compute the final pixel
-            for (i = 0; i < nComps; ++i) {
-                pix[i] = lineBuf[x * nComps + i];
-            }
-
-            // store the pixel
-            switch (srcMode) {
-            case splashModeMono1: // mono1 is not allowed
-                break;
-            case splashModeMono8:
-                for (i = 0; i < yStep; ++i) {
-                    for (j = 0; j < xStep; ++j) {
-                        destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-                        *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    }
-                }
-                break;
-            case splashModeRGB8:
-                for (i = 0; i < yStep; ++i) {
-                    for (j = 0; j < xStep; ++j) {
-                        destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-                        *destPtr++ = static_cast<unsigned char>(pix[0]);
-                        *destPtr++ = static_cast<unsigned char>(pix[1]);
-                        *destPtr++ = static_cast<unsigned char>(pix[2]);
-                    }
-                }
-                break;
-            case splashModeXBGR8:
-                for (i = 0; i < yStep; ++i) {
-                    for (j = 0; j < xStep; ++j) {
-                        destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-                        *destPtr++ = static_cast<unsigned char>(pix[2]);
-                        *destPtr++ = static_cast<unsigned char>(pix[1]);
-                        *destPtr++ = static_cast<unsigned char>(pix[0]);
-                        *destPtr++ = static_cast<unsigned char>(255);
-                    }
-                }
-                break;
-            case splashModeBGR8:
-                for (i = 0; i < yStep; ++i) {
-                    for (j = 0; j < xStep; ++j) {
-                        destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-                        *destPtr++ = static_cast<unsigned char>(pix[2]);
-                        *destPtr++ = static_cast<unsigned char>(pix[1]);
-                        *destPtr++ = static_cast<unsigned char>(pix[0]);
-                    }
-                }
-                break;
-            case splashModeCMYK8:
-                for (i = 0; i < yStep; ++i) {
-                    for (j = 0; j < xStep; ++j) {
-                        destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-                        *destPtr++ = static_cast<unsigned char>(pix[0]);
-                        *destPtr++ = static_cast<unsigned char>(pix[1]);
-                        *destPtr++ = static_cast<unsigned char>(pix[2]);
-                        *destPtr++ = static_cast<unsigned char>(pix[3]);
-                    }
-                }
-                break;
-            case splashModeDeviceN8:
-                for (i = 0; i < yStep; ++i) {
-                    for (j = 0; j < xStep; ++j) {
-                        destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-                        for (unsigned int cp : pix) {
-                            *destPtr++ = static_cast<unsigned char>(cp);
-                        }
-                    }
-                }
-                break;
-            }
-
-            // process alpha
-            if (srcAlpha) {
-                alpha = alphaLineBuf[x];
-                for (i = 0; i < yStep; ++i) {
-                    for (j = 0; j < xStep; ++j) {
-                        destAlphaPtr = destAlphaPtr0 + i * scaledWidth + xx + j;
-                        *destAlphaPtr = static_cast<unsigned char>(alpha);
-                    }
-                }
-            }
+        // replicate the pixels of the row, and copy it to the other
+        // yStep - 1 rows; the scale factor of 1 leaves the pixels as is
+        if (scaleRow) {
+            scaleRow(lineBuf, destPtr0, srcWidth, xp, xq, 1 << 23);
+            replicateRows(destPtr0, scaledWidth * nComps, yStep);
+        }
 
-            xx += xStep;
+        // process alpha
+        if (srcAlpha) {
+            replicateRow<1, false>(alphaLineBuf, destAlphaPtr0, srcWidth, xp, xq, 1 << 23);
+            replicateRows(destAlphaPtr0, scaledWidth, yStep);
         }
 
         destPtr0 += yStep * scaledWidth * nComps;
@@ -4782,14 +5092,12 @@ bool Splash::scaleImageYupXup(SplashImageSource src, void *srcData, SplashColorM
     return true;
 }
 
-// expand source row to scaledWidth using linear interpolation
-static void expandRow(unsigned char *srcBuf, unsigned char *dstBuf, int srcWidth, int scaledWidth, int nComps)
+// expand source row to scaledWidth using linear interpolation; <xInt>
+// and <xFrac> hold the source pixel and the weight of the next one for
+// each destination pixel
+template<int nComps>
+static void expandRow(unsigned char *srcBuf, unsigned char *dstBuf, const int *xInt, const double *xFrac, int srcWidth, int scaledWidth)
 {
-    double xStep = static_cast<double>(srcWidth) / scaledWidth;
-    double xSrc = 0.0;
-    double xFrac, xInt;
-    int p;
-
     // pad the source with an extra pixel equal to the last pixel
     // so that when xStep is inside the last pixel we still have two
     // pixels to interpolate between.
@@ -4797,13 +5105,59 @@ static void expandRow(unsigned char *srcBuf, unsigned char *dstBuf, int srcWidth
         srcBuf[srcWidth * nComps + i] = srcBuf[(srcWidth - 1) * nComps + i];
     }
 
-    for (int x = 0; x < scaledWidth; x++) {
-        xFrac = modf(xSrc, &xInt);
-        p = static_cast<int>(xInt);
+    for (int x = 0; x < scaledWidth; x++, dstBuf += nComps) {
+        const unsigned char *p = srcBuf + nComps * xInt[x];
         for (int c = 0; c < nComps; c++) {
-            dstBuf[nComps * x + c] = static_cast<unsigned char>(srcBuf[nComps * p + c] * (1.0 - xFrac) + srcBuf[nComps * (p + 1) + c] * xFrac);
+            dstBuf[c] = static_cast<unsigned char>(p[c] * (1.0 - xFrac[x]) + p[nComps + c] * xFrac[x]);
         }
-        xSrc += xStep;
+    }
+}
+
+// Interpolate one component; the value is in [0, 255], and truncating it
+// through int, which vectorizes, gives the same byte.
+static inline unsigned char interpolateComp(unsigned char v1, unsigned char v2, double yFrac)
+{
+    return static_cast<unsigned char>(static_cast<int>(v1 * (1.0 - yFrac) + v2 * yFrac));
+}
+
+// interpolate between two expanded rows, with weight yFrac for the second
+template<int nComps, bool bgr>
+GOO_TARGET_CLONES static void interpolateRows(const unsigned char *__restrict lineBuf1, const unsigned char *__restrict lineBuf2, unsigned char *__restrict destPtr, int scaledWidth, double yFrac)
+{
+    const int n = scaledWidth * nComps;
+    int j = 0;
+    if (!bgr) {
+        for (; j + scaleChunk <= n; j += scaleChunk) {
+            for (int i = 0; i < scaleChunk; ++i) {
+                destPtr[j + i] = interpolateComp(lineBuf1[j + i], lineBuf2[j + i], yFrac);
+            }
+        }
+    } else {
+        // chunks of scaleChunk pixels, interpolated in a local buffer and
+        // stored with the components swapped
+        constexpr int chunk = scaleChunk * nComps;
+        unsigned char pix[chunk];
+        for (; j + chunk <= n; j += chunk) {
+            for (int i = 0; i < chunk; ++i) {
+                pix[i] = interpolateComp(lineBuf1[j + i], lineBuf2[j + i], yFrac);
+            }
+            for (int i = 0; i < chunk; i += nComps) {
+                destPtr[j + i] = pix[i + 2];
+                destPtr[j + i + 1] = pix[i + 1];
+                destPtr[j + i + 2] = pix[i];
+                if (nComps == 4) {
+                    destPtr[j + i + 3] = 255;
+                }
+            }
+        }
+    }
+
+    unsigned int pix[nComps];
+    for (; j < n; j += nComps) {
+        for (int c = 0; c < nComps; ++c) {
+            pix[c] = interpolateComp(lineBuf1[j + c], lineBuf2[j + c], yFrac);
+        }
+        storeScaledPixel<nComps, bgr>(destPtr + j, pix);
     }
 }
 
@@ -4811,14 +5165,18 @@ static void expandRow(unsigned char *srcBuf, unsigned char *dstBuf, int srcWidth
 bool Splash::scaleImageYupXupBilinear(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest)
 {
     unsigned char *srcBuf, *lineBuf1, *lineBuf2, *alphaSrcBuf, *alphaLineBuf1, *alphaLineBuf2;
-    unsigned int pix[splashMaxColorComps];
-    unsigned char *destPtr0, *destPtr, *destAlphaPtr0, *destAlphaPtr;
-    int i;
+    unsigned char *destPtr0, *destAlphaPtr0;
 
     if (srcWidth < 1 || srcHeight < 1) {
         return false;
     }
 
+    const auto expandColorRow = selectScaleKernel(srcMode, []<int n, bool bgr>() { return &expandRow<n>; });
+    const auto interpolateColorRows = selectScaleKernel(srcMode, []<int n, bool bgr>() { return &interpolateRows<n, bgr>; });
+    if (!expandColorRow) {
+        return true;
+    }
+
     // allocate buffers
     srcBuf = static_cast<unsigned char *>(gmallocn_checkoverflow(srcWidth + 1, nComps)); // + 1 pixel of padding
     if (unlikely(!srcBuf)) {
@@ -4877,14 +5235,26 @@ bool Splash::scaleImageYupXupBilinear(SplashImageSource src, void *srcData, Spla
         alphaLineBuf2 = nullptr;
     }
 
+    // the source pixels to interpolate between are the same for every row
+    std::vector<int> xInt(scaledWidth);
+    std::vector<double> xFrac(scaledWidth);
+    double xSrc = 0.0;
+    double xStep = static_cast<double>(srcWidth) / scaledWidth;
+    for (int x = 0; x < scaledWidth; x++) {
+        double xIntD;
+        xFrac[x] = modf(xSrc, &xIntD);
+        xInt[x] = static_cast<int>(xIntD);
+        xSrc += xStep;
+    }
+
     double ySrc = 0.0;
     double yStep = static_cast<double>(srcHeight) / scaledHeight;
     double yFrac, yInt;
     int currentSrcRow = -1;
     (*src)(srcData, srcBuf, alphaSrcBuf);
-    expandRow(srcBuf, lineBuf2, srcWidth, scaledWidth, nComps);
+    expandColorRow(srcBuf, lineBuf2, xInt.data(), xFrac.data(), srcWidth, scaledWidth);
     if (srcAlpha) {
-        expandRow(alphaSrcBuf, alphaLineBuf2, srcWidth, scaledWidth, 1);
+        expandRow<1>(alphaSrcBuf, alphaLineBuf2, xInt.data(), xFrac.data(), srcWidth, scaledWidth);
     }
 
     destPtr0 = dest->data;
@@ -4903,62 +5273,19 @@ bool Splash::scaleImageYupXupBilinear(SplashImageSource src, void *srcData, Spla
             }
             if (currentSrcRow < srcHeight - 1) {
                 (*src)(srcData, srcBuf, alphaSrcBuf);
-                expandRow(srcBuf, lineBuf2, srcWidth, scaledWidth, nComps);
+                expandColorRow(srcBuf, lineBuf2, xInt.data(), xFrac.data(), srcWidth, scaledWidth);
                 if (srcAlpha) {
-                    expandRow(alphaSrcBuf, alphaLineBuf2, srcWidth, scaledWidth, 1);
+                    expandRow<1>(alphaSrcBuf, alphaLineBuf2, xInt.data(), xFrac.data(), srcWidth, scaledWidth);
                 }
             }
         }
 
         // write row y using linear interpolation on lineBuf1 and lineBuf2
-        for (int x = 0; x < scaledWidth; ++x) {
-            // compute the final pixel
-            for (i = 0; i < nComps; ++i) {
-                pix[i] = static_cast<unsigned char>(lineBuf1[x * nComps + i] * (1.0 - yFrac) + lineBuf2[x * nComps + i] * yFrac);
-            }
-
-            // store the pixel
-            destPtr = destPtr0 + (y * scaledWidth + x) * nComps;
-            switch (srcMode) {
-            case splashModeMono1: // mono1 is not allowed
-                break;
-            case splashModeMono8:
-                *destPtr++ = static_cast<unsigned char>(pix[0]);
-                break;
-            case splashModeRGB8:
-                *destPtr++ = static_cast<unsigned char>(pix[0]);
-                *destPtr++ = static_cast<unsigned char>(pix[1]);
-                *destPtr++ = static_cast<unsigned char>(pix[2]);
-                break;
-            case splashModeXBGR8:
-                *destPtr++ = static_cast<unsigned char>(pix[2]);
-                *destPtr++ = static_cast<unsigned char>(pix[1]);
-                *destPtr++ = static_cast<unsigned char>(pix[0]);
-                *destPtr++ = static_cast<unsigned char>(255);
-                break;
-            case splashModeBGR8:
-                *destPtr++ = static_cast<unsigned char>(pix[2]);
-                *destPtr++ = static_cast<unsigned char>(pix[1]);
-                *destPtr++ = static_cast<unsigned char>(pix[0]);
-                break;
-            case splashModeCMYK8:
-                *destPtr++ = static_cast<unsigned char>(pix[0]);
-                *destPtr++ = static_cast<unsigned char>(pix[1]);
-                *destPtr++ = static_cast<unsigned char>(pix[2]);
-                *destPtr++ = static_cast<unsigned char>(pix[3]);
-                break;
-            case splashModeDeviceN8:
-                for (unsigned int cp : pix) {
-                    *destPtr++ = static_cast<unsigned char>(cp);
-                }
-                break;
-            }
+        interpolateColorRows(lineBuf1, lineBuf2, destPtr0 + y * scaledWidth * nComps, scaledWidth, yFrac);
 
-            // process alpha
-            if (srcAlpha) {
-                destAlphaPtr = destAlphaPtr0 + y * scaledWidth + x;
-                *destAlphaPtr = static_cast<unsigned char>(alphaLineBuf1[x] * (1.0 - yFrac) + alphaLineBuf2[x] * yFrac);
-            }
+        // process alpha
+        if (srcAlpha) {
+            interpolateRows<1, false>(alphaLineBuf1, alphaLineBuf2, destAlphaPtr0 + y * scaledWidth, scaledWidth, yFrac);
         }
 
         ySrc += yStep;
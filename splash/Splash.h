@@ -28,12 +28,15 @@
 #ifndef SPLASH_H
 #define SPLASH_H
 
+#include <vector>
+
 #include "SplashTypes.h"
 #include "SplashClip.h"
 #include "SplashPattern.h"
 #include "poppler_private_export.h"
 
 class SplashBitmap;
+class SplashBitmapPool;
 struct SplashGlyphBitmap;
 class SplashState;
 class SplashScreen;
@@ -139,7 +142,9 @@ public:
     SplashError clipToRect(double x0, double y0, double x1, double y1);
     // NB: uses untransformed coordinates.
     SplashError clipToPath(const SplashPath &path, bool eo);
-    void setSoftMask(SplashBitmap *softMask);
+    // <softMask> is returned to <softMaskPool>, if not nullptr, once it
+    // is no longer used.
+    void setSoftMask(SplashBitmap *softMask, SplashBitmapPool *softMaskPool = nullptr);
     void setInTransparencyGroup(SplashBitmap *groupBackBitmapA, int groupBackXA, int groupBackYA, bool nonIsolated, bool knockout);
     void setTransfer(unsigned char *red, unsigned char *green, unsigned char *blue, unsigned char *gray);
     void setOverprintMask(unsigned int overprintMask, bool additive);
@@ -236,6 +241,18 @@ public:
     void setThinLineMode(SplashThinLineMode thinLineModeA) { thinLineMode = thinLineModeA; }
     SplashThinLineMode getThinLineMode() { return thinLineMode; }
 
+    // Setter/Getter for analytic anti-aliasing: if enabled, filled paths
+    // that aren't clipped are rasterized with exact area coverage
+    // instead of splashAASize x splashAASize supersampling.
+    void setAnalyticAA(bool analyticAAA) { analyticAA = analyticAAA; }
+    bool getAnalyticAA() const { return analyticAA; }
+
+    // Setter/Getter for Lanczos downscaling: if enabled, images scaled
+    // down in both directions are resampled with a Lanczos-3 filter
+    // instead of averaging the source pixels of each destination pixel.
+    void setLanczosDownscaling(bool lanczosDownscalingA) { lanczosDownscaling = lanczosDownscalingA; }
+    bool getLanczosDownscaling() const { return lanczosDownscaling; }
+
     // Get clipping status for the last drawing operation subject to
     // clipping.
     SplashClipResult getClipRes() { return opClipRes; }
@@ -274,6 +291,14 @@ private:
     void pipeRunAABGR8(SplashPipe *pipe);
     void pipeRunAACMYK8(SplashPipe *pipe);
     void pipeRunAADeviceN8(SplashPipe *pipe);
+    void pipeRunSimpleRGB8Span(SplashPipe *pipe, const unsigned char *shape, int n);
+    void pipeRunSimpleXBGR8Span(SplashPipe *pipe, const unsigned char *shape, int n);
+    void pipeRunSimpleBGR8Span(SplashPipe *pipe, const unsigned char *shape, int n);
+    void pipeRunAARGB8Span(SplashPipe *pipe, const unsigned char *shape, int n);
+    void pipeRunAAXBGR8Span(SplashPipe *pipe, const unsigned char *shape, int n);
+    void pipeRunAABGR8Span(SplashPipe *pipe, const unsigned char *shape, int n);
+    void pipeRunSimpleCMYK8Span(SplashPipe *pipe, const unsigned char *shape, int n);
+    void pipeRunAACMYK8Span(SplashPipe *pipe, const unsigned char *shape, int n);
     void pipeSetXY(SplashPipe *pipe, int x, int y);
     void pipeIncX(SplashPipe *pipe);
     void drawPixel(SplashPipe *pipe, int x, int y, bool noClip);
@@ -281,6 +306,7 @@ private:
     void drawAAPixel(SplashPipe *pipe, int x, int y);
     void drawSpan(SplashPipe *pipe, int x0, int x1, int y, bool noClip);
     void drawAALine(SplashPipe *pipe, int x0, int x1, int y, bool adjustLine = false, unsigned char lineOpacity = 0);
+    void drawCoverageLine(SplashPipe *pipe, unsigned char *coverage, int x0, int x1, int y);
     static void transform(const std::array<double, 6> &matrix, double xi, double yi, double *xo, double *yo);
     void strokeNarrow(const SplashPath &path);
     void strokeWide(const SplashPath &path, double w);
@@ -303,6 +329,7 @@ private:
     std::unique_ptr<SplashBitmap> scaleImage(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, bool interpolate,
                                              bool tilingPattern = false);
     static bool scaleImageYdownXdown(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest);
+    static bool scaleImageLanczos(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest);
     static bool scaleImageYdownXup(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest);
     static bool scaleImageYupXdown(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest);
     static bool scaleImageYupXup(SplashImageSource src, void *srcData, SplashColorMode srcMode, int nComps, bool srcAlpha, int srcWidth, int srcHeight, int scaledWidth, int scaledHeight, SplashBitmap *dest);
@@ -326,8 +353,11 @@ private:
                                 //   bitmap containing the alpha0 values
     int alpha0X, alpha0Y; // offset within alpha0Bitmap
     double aaGamma[splashAASize * splashAASize + 1];
+    std::vector<unsigned char> aaLineShapes; // per-pixel shapes for drawAALine
     double minLineWidth;
     SplashThinLineMode thinLineMode;
+    bool analyticAA;
+    bool lanczosDownscaling;
     SplashClipResult opClipRes;
     SplashBitmap *groupBackBitmap; // backdrop bitmap for knockout/non-isolated groups
     int groupBackX, groupBackY; // offset within groupBackBitmap
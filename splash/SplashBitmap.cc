@@ -35,6 +35,7 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
@@ -54,58 +55,38 @@
 // SplashBitmap
 //------------------------------------------------------------------------
 
-SplashBitmap::SplashBitmap(int widthA, int heightA, int rowPadA, SplashColorMode modeA, bool alphaA, bool topDown, const std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationListA)
+// Returns the size of a row of <width> pixels in mode <mode>, without
+// padding, or -1 if it overflows.
+static int getUnpaddedRowSize(int width, SplashColorMode mode)
 {
-    width = widthA;
-    height = heightA;
-    mode = modeA;
-    rowPad = rowPadA;
-    rowSize = -1; // some compilers can't see it will be initialized
+    if (width <= 0) {
+        return -1;
+    }
     switch (mode) {
     case splashModeMono1:
-        if (width > 0) {
-            rowSize = (width + 7) >> 3;
-        } else {
-            rowSize = -1;
-        }
-        break;
+        return (width + 7) >> 3;
     case splashModeMono8:
-        if (width > 0) {
-            rowSize = width;
-        } else {
-            rowSize = -1;
-        }
-        break;
+        return width;
     case splashModeRGB8:
     case splashModeBGR8:
-        if (width > 0 && width <= INT_MAX / 3) {
-            rowSize = width * 3;
-        } else {
-            rowSize = -1;
-        }
-        break;
+        return width <= INT_MAX / 3 ? width * 3 : -1;
     case splashModeXBGR8:
-        if (width > 0 && width <= INT_MAX / 4) {
-            rowSize = width * 4;
-        } else {
-            rowSize = -1;
-        }
-        break;
     case splashModeCMYK8:
-        if (width > 0 && width <= INT_MAX / 4) {
-            rowSize = width * 4;
-        } else {
-            rowSize = -1;
-        }
-        break;
+        return width <= INT_MAX / 4 ? width * 4 : -1;
     case splashModeDeviceN8:
-        if (width > 0 && width <= INT_MAX / static_cast<int>(splashMaxColorComps)) {
-            rowSize = width * splashMaxColorComps;
-        } else {
-            rowSize = -1;
-        }
-        break;
+        return width <= INT_MAX / static_cast<int>(splashMaxColorComps) ? width * splashMaxColorComps : -1;
     }
+    return -1;
+}
+
+SplashBitmap::SplashBitmap(int widthA, int heightA, int rowPadA, SplashColorMode modeA, bool alphaA, bool topDown, const std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationListA)
+{
+    width = widthA;
+    height = heightA;
+    mode = modeA;
+    rowPad = rowPadA;
+    externalData = false;
+    rowSize = getUnpaddedRowSize(width, mode);
     if (rowSize > 0) {
         rowSize += rowPad - 1;
         rowSize -= rowSize % rowPad;
@@ -132,6 +113,32 @@ SplashBitmap::SplashBitmap(int widthA, int heightA, int rowPadA, SplashColorMode
     }
 }
 
+SplashBitmap::SplashBitmap(SplashColorPtr dataA, int widthA, int heightA, int rowSizeA, SplashColorMode modeA, bool alphaA, const std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationListA)
+{
+    width = widthA;
+    height = heightA;
+    mode = modeA;
+    rowSize = rowSizeA;
+    // rows padded to the row size are exactly <rowSizeA> long, so bitmaps
+    // created like this one get the same layout
+    rowPad = rowSize == INT_MIN ? 1 : std::max(std::abs(rowSize), 1);
+    externalData = true;
+    const int minRowSize = getUnpaddedRowSize(width, mode);
+    if (dataA && height > 0 && minRowSize > 0 && rowPad >= minRowSize) {
+        data = dataA;
+        alpha = alphaA ? static_cast<unsigned char *>(gmallocn_checkoverflow(width, height)) : nullptr;
+    } else {
+        data = nullptr;
+        alpha = nullptr;
+    }
+    separationList = new std::vector<std::unique_ptr<GfxSeparationColorSpace>>();
+    if (separationListA != nullptr) {
+        for (const std::unique_ptr<GfxSeparationColorSpace> &separation : *separationListA) {
+            separationList->push_back(separation->copyAsOwnType());
+        }
+    }
+}
+
 SplashBitmap *SplashBitmap::copy(const SplashBitmap *src)
 {
     auto *result = new SplashBitmap(src->getWidth(), src->getHeight(), src->getRowPad(), src->getMode(), src->getAlphaPtr() != nullptr, src->getRowSize() >= 0, src->getSeparationList());
@@ -154,7 +161,7 @@ SplashBitmap *SplashBitmap::copy(const SplashBitmap *src)
 
 SplashBitmap::~SplashBitmap()
 {
-    if (data) {
+    if (data && !externalData) {
         if (rowSize < 0) {
             gfree(data + (height - 1) * rowSize);
         } else {
@@ -180,6 +187,38 @@ SplashError SplashBitmap::writePNMFile(char *fileName)
 }
 
 SplashError SplashBitmap::writePNMFile(FILE *f)
+{
+    const SplashError e = writePNMHeader(f, mode, width, height);
+    if (e != SplashError::NoError) {
+        return e;
+    }
+    return writePNMRows(f);
+}
+
+SplashError SplashBitmap::writePNMHeader(FILE *f, SplashColorMode modeA, int widthA, int heightA)
+{
+    switch (modeA) {
+    case splashModeMono1:
+        fprintf(f, "P4\n%d %d\n", widthA, heightA);
+        break;
+    case splashModeMono8:
+        fprintf(f, "P5\n%d %d\n255\n", widthA, heightA);
+        break;
+    case splashModeRGB8:
+    case splashModeXBGR8:
+    case splashModeBGR8:
+        fprintf(f, "P6\n%d %d\n255\n", widthA, heightA);
+        break;
+    case splashModeCMYK8:
+    case splashModeDeviceN8:
+        // PNM doesn't support CMYK
+        error(errInternal, -1, "unsupported SplashBitmap mode");
+        return SplashError::Generic;
+    }
+    return SplashError::NoError;
+}
+
+SplashError SplashBitmap::writePNMRows(FILE *f)
 {
     SplashColorPtr row, p;
     int x, y;
@@ -187,7 +226,6 @@ SplashError SplashBitmap::writePNMFile(FILE *f)
     switch (mode) {
 
     case splashModeMono1:
-        fprintf(f, "P4\n%d %d\n", width, height);
         row = data;
         for (y = 0; y < height; ++y) {
             p = row;
@@ -200,7 +238,6 @@ SplashError SplashBitmap::writePNMFile(FILE *f)
         break;
 
     case splashModeMono8:
-        fprintf(f, "P5\n%d %d\n255\n", width, height);
         row = data;
         for (y = 0; y < height; ++y) {
             fwrite(row, 1, width, f);
@@ -209,7 +246,6 @@ SplashError SplashBitmap::writePNMFile(FILE *f)
         break;
 
     case splashModeRGB8:
-        fprintf(f, "P6\n%d %d\n255\n", width, height);
         row = data;
         for (y = 0; y < height; ++y) {
             fwrite(row, 1, 3 * width, f);
@@ -218,7 +254,6 @@ SplashError SplashBitmap::writePNMFile(FILE *f)
         break;
 
     case splashModeXBGR8:
-        fprintf(f, "P6\n%d %d\n255\n", width, height);
         row = data;
         for (y = 0; y < height; ++y) {
             p = row;
@@ -233,7 +268,6 @@ SplashError SplashBitmap::writePNMFile(FILE *f)
         break;
 
     case splashModeBGR8:
-        fprintf(f, "P6\n%d %d\n255\n", width, height);
         row = data;
         for (y = 0; y < height; ++y) {
             p = row;
@@ -333,6 +367,9 @@ SplashColorPtr SplashBitmap::takeData()
 {
     SplashColorPtr data2;
 
+    if (externalData) {
+        return nullptr;
+    }
     data2 = data;
     data = nullptr;
     return data2;
@@ -368,11 +405,11 @@ void SplashBitmap::setJpegParams(ImgWriter *writer, WriteImgParams *params)
 #endif
 }
 
-SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, double hDPI, double vDPI, WriteImgParams *params)
+std::unique_ptr<ImgWriter> SplashBitmap::createImgWriter(SplashImageFileFormat format, SplashColorMode modeA, WriteImgParams *params, SplashColorMode *imageWriterFormat)
 {
     ImgWriter *writer;
 
-    SplashColorMode imageWriterFormat = splashModeRGB8;
+    *imageWriterFormat = splashModeRGB8;
 
     switch (format) {
 #if ENABLE_LIBPNG
@@ -396,14 +433,14 @@ SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, do
 
 #if ENABLE_LIBTIFF
     case splashFormatTiff:
-        switch (mode) {
+        switch (modeA) {
         case splashModeMono1:
             writer = new TiffWriter(TiffWriter::MONOCHROME);
-            imageWriterFormat = splashModeMono1;
+            *imageWriterFormat = splashModeMono1;
             break;
         case splashModeMono8:
             writer = new TiffWriter(TiffWriter::GRAY);
-            imageWriterFormat = splashModeMono8;
+            *imageWriterFormat = splashModeMono8;
             break;
         case splashModeRGB8:
         case splashModeBGR8:
@@ -414,7 +451,7 @@ SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, do
             writer = new TiffWriter(TiffWriter::CMYK);
             break;
         default:
-            fprintf(stderr, "TiffWriter: Mode %d not supported\n", mode);
+            fprintf(stderr, "TiffWriter: Mode %d not supported\n", modeA);
             writer = new TiffWriter();
         }
         if (writer && params) {
@@ -422,6 +459,7 @@ SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, do
         }
         break;
 #else
+        (void)modeA;
         (void)params;
 #endif
 
@@ -429,12 +467,21 @@ SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, do
         // Not the greatest error message, but users of this function should
         // have already checked whether their desired format is compiled in.
         error(errInternal, -1, "Support for this image type not compiled in");
+        return nullptr;
+    }
+
+    return std::unique_ptr<ImgWriter>(writer);
+}
+
+SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, double hDPI, double vDPI, WriteImgParams *params)
+{
+    SplashColorMode imageWriterFormat;
+    const std::unique_ptr<ImgWriter> writer = createImgWriter(format, mode, params, &imageWriterFormat);
+    if (!writer) {
         return SplashError::Generic;
     }
 
-    const SplashError e = writeImgFile(writer, f, hDPI, vDPI, imageWriterFormat);
-    delete writer;
-    return e;
+    return writeImgFile(writer.get(), f, hDPI, vDPI, imageWriterFormat);
 }
 
 #include "poppler/GfxState_helpers.h"
@@ -568,27 +615,24 @@ static inline unsigned char div255(int x)
 bool SplashBitmap::convertToXBGR(ConversionMode conversionMode)
 {
     if (mode == splashModeXBGR8) {
-        if (conversionMode != conversionOpaque) {
+        if (conversionMode != conversionOpaque && alpha) {
             // Copy the alpha channel into the fourth component so that XBGR becomes ABGR.
-            const SplashColorPtr dbegin = data;
-            const SplashColorPtr dend = data + rowSize * height;
-
-            unsigned char *const abegin = alpha;
-            unsigned char *const aend = alpha + width * height;
-
-            SplashColorPtr d = dbegin;
-            unsigned char *a = abegin;
-
-            if (conversionMode == conversionAlphaPremultiplied) {
-                for (; d < dend && a < aend; d += 4, a += 1) {
-                    d[0] = div255(d[0] * *a);
-                    d[1] = div255(d[1] * *a);
-                    d[2] = div255(d[2] * *a);
-                    d[3] = *a;
-                }
-            } else {
-                for (d += 3; d < dend && a < aend; d += 4, a += 1) {
-                    *d = *a;
+            for (int y = 0; y < height; ++y) {
+                SplashColorPtr d = data + static_cast<ptrdiff_t>(y) * rowSize;
+                const unsigned char *a = alpha + static_cast<size_t>(y) * width;
+                const unsigned char *const aend = a + width;
+
+                if (conversionMode == conversionAlphaPremultiplied) {
+                    for (; a < aend; d += 4, a += 1) {
+                        d[0] = div255(d[0] * *a);
+                        d[1] = div255(d[1] * *a);
+                        d[2] = div255(d[2] * *a);
+                        d[3] = *a;
+                    }
+                } else {
+                    for (d += 3; a < aend; d += 4, a += 1) {
+                        *d = *a;
+                    }
                 }
             }
         }
@@ -603,7 +647,10 @@ bool SplashBitmap::convertToXBGR(ConversionMode conversionMode)
             unsigned char *row = newdata + y * newrowSize;
             getXBGRLine(y, row, conversionMode);
         }
-        if (rowSize < 0) {
+        if (externalData) {
+            externalData = false;
+            rowPad = 4;
+        } else if (rowSize < 0) {
             gfree(data + (height - 1) * rowSize);
         } else {
             gfree(data);
@@ -667,22 +714,55 @@ SplashError SplashBitmap::writeImgFile(ImgWriter *writer, FILE *f, double hDPI,
         return SplashError::Generic;
     }
 
-    switch (mode) {
-    case splashModeCMYK8:
-        if (writer->supportCMYK()) {
-            SplashColorPtr row;
-            auto **row_pointers = new unsigned char *[height];
-            row = data;
+    const SplashError e = writeImgRows(writer, imageWriterFormat, true);
+    if (e != SplashError::NoError) {
+        return e;
+    }
+
+    if (!writer->close()) {
+        return SplashError::Generic;
+    }
+
+    return SplashError::NoError;
+}
+
+SplashError SplashBitmap::writeImgRows(ImgWriter *writer, SplashColorMode imageWriterFormat)
+{
+    return writeImgRows(writer, imageWriterFormat, false);
+}
+
+SplashError SplashBitmap::writeImgRows(ImgWriter *writer, SplashColorMode imageWriterFormat, bool wholeImage)
+{
+    if (mode != splashModeRGB8 && mode != splashModeMono8 && mode != splashModeMono1 && mode != splashModeXBGR8 && mode != splashModeBGR8 && mode != splashModeCMYK8 && mode != splashModeDeviceN8) {
+        error(errInternal, -1, "unsupported SplashBitmap mode");
+        return SplashError::Generic;
+    }
 
+    // writes the rows as they are; ImgWriter::writePointers can only be
+    // given the whole image
+    const auto writeDataRows = [&]() {
+        if (wholeImage) {
+            std::vector<unsigned char *> rowPointers(height);
             for (int y = 0; y < height; ++y) {
-                row_pointers[y] = row;
-                row += rowSize;
+                rowPointers[y] = data + static_cast<ptrdiff_t>(y) * rowSize;
+            }
+            return writer->writePointers(rowPointers.data(), height);
+        }
+        for (int y = 0; y < height; ++y) {
+            unsigned char *row = data + static_cast<ptrdiff_t>(y) * rowSize;
+            if (!writer->writeRow(&row)) {
+                return false;
             }
-            if (!writer->writePointers(row_pointers, height)) {
-                delete[] row_pointers;
+        }
+        return true;
+    };
+
+    switch (mode) {
+    case splashModeCMYK8:
+        if (writer->supportCMYK()) {
+            if (!writeDataRows()) {
                 return SplashError::Generic;
             }
-            delete[] row_pointers;
         } else {
             auto *row = new unsigned char[3 * width];
             for (int y = 0; y < height; y++) {
@@ -718,21 +798,11 @@ SplashError SplashBitmap::writeImgFile(ImgWriter *writer, FILE *f, double hDPI,
             delete[] row;
         }
         break;
-    case splashModeRGB8: {
-        SplashColorPtr row;
-        auto **row_pointers = new unsigned char *[height];
-        row = data;
-
-        for (int y = 0; y < height; ++y) {
-            row_pointers[y] = row;
-            row += rowSize;
-        }
-        if (!writer->writePointers(row_pointers, height)) {
-            delete[] row_pointers;
+    case splashModeRGB8:
+        if (!writeDataRows()) {
             return SplashError::Generic;
         }
-        delete[] row_pointers;
-    } break;
+        break;
 
     case splashModeBGR8: {
         auto *row = new unsigned char[3 * width];
@@ -772,19 +842,9 @@ SplashError SplashBitmap::writeImgFile(ImgWriter *writer, FILE *f, double hDPI,
 
     case splashModeMono8: {
         if (imageWriterFormat == splashModeMono8) {
-            SplashColorPtr row;
-            auto **row_pointers = new unsigned char *[height];
-            row = data;
-
-            for (int y = 0; y < height; ++y) {
-                row_pointers[y] = row;
-                row += rowSize;
-            }
-            if (!writer->writePointers(row_pointers, height)) {
-                delete[] row_pointers;
+            if (!writeDataRows()) {
                 return SplashError::Generic;
             }
-            delete[] row_pointers;
         } else if (imageWriterFormat == splashModeRGB8) {
             auto *row = new unsigned char[3 * width];
             for (int y = 0; y < height; y++) {
@@ -809,19 +869,9 @@ SplashError SplashBitmap::writeImgFile(ImgWriter *writer, FILE *f, double hDPI,
 
     case splashModeMono1: {
         if (imageWriterFormat == splashModeMono1) {
-            SplashColorPtr row;
-            auto **row_pointers = new unsigned char *[height];
-            row = data;
-
-            for (int y = 0; y < height; ++y) {
-                row_pointers[y] = row;
-                row += rowSize;
-            }
-            if (!writer->writePointers(row_pointers, height)) {
-                delete[] row_pointers;
+            if (!writeDataRows()) {
                 return SplashError::Generic;
             }
-            delete[] row_pointers;
         } else if (imageWriterFormat == splashModeRGB8) {
             auto *row = new unsigned char[3 * width];
             for (int y = 0; y < height; y++) {
@@ -849,9 +899,5 @@ SplashError SplashBitmap::writeImgFile(ImgWriter *writer, FILE *f, double hDPI,
         break;
     }
 
-    if (!writer->close()) {
-        return SplashError::Generic;
-    }
-
     return SplashError::NoError;
 }
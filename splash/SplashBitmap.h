@@ -56,6 +56,12 @@ public:
     // <rowPad> bytes.  If <topDown> is false, the bitmap will be stored
     // upside-down, i.e., with the last row first in memory.
     SplashBitmap(int widthA, int heightA, int rowPad, SplashColorMode modeA, bool alphaA, bool topDown = true, const std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationList = nullptr);
+    // Create a new bitmap using <dataA>, which the caller owns and must
+    // keep until the bitmap is deleted, as color data.  Row zero starts
+    // at <dataA> and the next ones are <rowSizeA> bytes apart; a negative
+    // <rowSizeA> makes an upside-down bitmap.  The alpha data is owned by
+    // the bitmap, as usual.
+    SplashBitmap(SplashColorPtr dataA, int widthA, int heightA, int rowSizeA, SplashColorMode modeA, bool alphaA, const std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationList = nullptr);
     static SplashBitmap *copy(const SplashBitmap *src);
 
     ~SplashBitmap();
@@ -69,6 +75,8 @@ public:
     int getAlphaRowSize() const { return width; }
     int getRowPad() const { return rowPad; }
     SplashColorMode getMode() const { return mode; }
+    // Whether the color data is owned by the caller.
+    bool hasExternalData() const { return externalData; }
     SplashColorPtr getDataPtr() { return data; }
     unsigned char *getAlphaPtr() { return alpha; }
     std::vector<std::unique_ptr<GfxSeparationColorSpace>> *getSeparationList() { return separationList; }
@@ -80,6 +88,12 @@ public:
     SplashError writePNMFile(FILE *f);
     SplashError writeAlphaPGMFile(char *fileName);
 
+    // Write the PNM header for a <widthA> x <heightA> image in mode
+    // <modeA>, and the rows of this bitmap without any header: an image
+    // can be written in bands, one bitmap at a time.
+    static SplashError writePNMHeader(FILE *f, SplashColorMode modeA, int widthA, int heightA);
+    SplashError writePNMRows(FILE *f);
+
     struct WriteImgParams
     {
         int jpegQuality = -1;
@@ -92,6 +106,16 @@ public:
     SplashError writeImgFile(SplashImageFileFormat format, FILE *f, double hDPI, double vDPI, WriteImgParams *params = nullptr);
     SplashError writeImgFile(ImgWriter *writer, FILE *f, double hDPI, double vDPI, SplashColorMode imageWriterFormat);
 
+    // Create the ImgWriter writeImgFile uses for <format> and bitmaps in
+    // mode <modeA>, and set <imageWriterFormat> to the row format it
+    // takes.  Returns nullptr if <format> isn't compiled in.
+    static std::unique_ptr<ImgWriter> createImgWriter(SplashImageFileFormat format, SplashColorMode modeA, WriteImgParams *params, SplashColorMode *imageWriterFormat);
+
+    // Write the rows of this bitmap to <writer>, which the caller has
+    // initialized and will close: an image can be written in bands, one
+    // bitmap at a time.
+    SplashError writeImgRows(ImgWriter *writer, SplashColorMode imageWriterFormat);
+
     enum ConversionMode
     {
         conversionOpaque,
@@ -109,7 +133,8 @@ public:
 
     // Caller takes ownership of the bitmap data.  The SplashBitmap
     // object is no longer valid -- the next call should be to the
-    // destructor.
+    // destructor.  Returns nullptr if the color data is owned by the
+    // caller already.
     SplashColorPtr takeData();
 
 private:
@@ -122,10 +147,12 @@ private:
     unsigned char *alpha; // pointer to row zero of the alpha data
                           //   (always top-down)
     std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationList; // list of spot colorants and their mapping functions
+    bool externalData; // the color data is owned by the caller
 
     friend class Splash;
 
     static void setJpegParams(ImgWriter *writer, WriteImgParams *params);
+    SplashError writeImgRows(ImgWriter *writer, SplashColorMode imageWriterFormat, bool wholeImage);
 };
 
 #endif
@@ -0,0 +1,118 @@
+//========================================================================
+//
+// SplashBitmapPool.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "poppler/GfxState.h"
+#include "SplashBitmap.h"
+#include "SplashBitmapPool.h"
+
+//------------------------------------------------------------------------
+// SplashBitmapPool
+//------------------------------------------------------------------------
+
+SplashBitmapPool::SplashBitmapPool(size_t maxSizeA) : size(0), maxSize(maxSizeA) { }
+
+SplashBitmapPool::~SplashBitmapPool() = default;
+
+SplashBitmap *SplashBitmapPool::take(int width, int height, int rowPad, SplashColorMode mode, bool alpha, bool topDown, const std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationList)
+{
+    auto bucket = buckets.find(Key(width, height, rowPad, mode, alpha, topDown));
+    if (bucket == buckets.end()) {
+        return new SplashBitmap(width, height, rowPad, mode, alpha, topDown, separationList);
+    }
+
+    SplashBitmap *bitmap = bucket->second->release();
+    size -= getBitmapSize(*bitmap);
+    bitmaps.erase(bucket->second);
+    buckets.erase(bucket);
+
+    std::vector<std::unique_ptr<GfxSeparationColorSpace>> *bitmapSeparationList = bitmap->getSeparationList();
+    bitmapSeparationList->clear();
+    if (separationList != nullptr) {
+        for (const std::unique_ptr<GfxSeparationColorSpace> &separation : *separationList) {
+            bitmapSeparationList->push_back(separation->copyAsOwnType());
+        }
+    }
+    return bitmap;
+}
+
+SplashBitmap *SplashBitmapPool::takeCopy(const SplashBitmap *src)
+{
+    SplashBitmap *result = take(src->getWidth(), src->getHeight(), src->getRowPad(), src->getMode(), src->getAlphaPtr() != nullptr, src->getRowSize() >= 0, src->getSeparationList());
+    if (!result->getDataPtr()) {
+        return result;
+    }
+    const size_t dataSize = static_cast<size_t>(std::abs(src->getRowSize())) * src->getHeight();
+    if (src->getRowSize() < 0) {
+        // row zero is the last one in memory
+        memcpy(result->getDataPtr() + static_cast<ptrdiff_t>(src->getHeight() - 1) * src->getRowSize(), src->getDataPtr() + static_cast<ptrdiff_t>(src->getHeight() - 1) * src->getRowSize(), dataSize);
+    } else {
+        memcpy(result->getDataPtr(), src->getDataPtr(), dataSize);
+    }
+    if (src->getAlphaPtr() != nullptr && result->getAlphaPtr() != nullptr) {
+        memcpy(result->getAlphaPtr(), src->getAlphaPtr(), static_cast<size_t>(src->getAlphaRowSize()) * src->getHeight());
+    }
+    return result;
+}
+
+void SplashBitmapPool::give(SplashBitmap *bitmap)
+{
+    if (!bitmap) {
+        return;
+    }
+    const size_t bitmapSize = getBitmapSize(*bitmap);
+    if (!bitmap->getDataPtr() || bitmap->hasExternalData() || bitmapSize > maxSize) {
+        delete bitmap;
+        return;
+    }
+    bitmaps.emplace_front(bitmap);
+    buckets.emplace(getKey(*bitmap), bitmaps.begin());
+    size += bitmapSize;
+    trim();
+}
+
+void SplashBitmapPool::setMaxSize(size_t maxSizeA)
+{
+    maxSize = maxSizeA;
+    trim();
+}
+
+SplashBitmapPool::Key SplashBitmapPool::getKey(const SplashBitmap &bitmap)
+{
+    return Key(bitmap.getWidth(), bitmap.getHeight(), bitmap.getRowPad(), bitmap.getMode(), bitmap.getAlphaPtr() != nullptr, bitmap.getRowSize() >= 0);
+}
+
+size_t SplashBitmapPool::getBitmapSize(const SplashBitmap &bitmap)
+{
+    size_t bitmapSize = static_cast<size_t>(std::abs(bitmap.getRowSize())) * bitmap.getHeight();
+    if (bitmap.getAlphaPtr()) {
+        bitmapSize += static_cast<size_t>(bitmap.getAlphaRowSize()) * bitmap.getHeight();
+    }
+    return bitmapSize;
+}
+
+void SplashBitmapPool::trim()
+{
+    while (size > maxSize && !bitmaps.empty()) {
+        const SplashBitmap &bitmap = *bitmaps.back();
+        size -= getBitmapSize(bitmap);
+        auto range = buckets.equal_range(getKey(bitmap));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == std::prev(bitmaps.end())) {
+                buckets.erase(it);
+                break;
+            }
+        }
+        bitmaps.pop_back();
+    }
+}
@@ -0,0 +1,79 @@
+//========================================================================
+//
+// SplashBitmapPool.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHBITMAPPOOL_H
+#define SPLASHBITMAPPOOL_H
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "SplashTypes.h"
+#include "poppler_private_export.h"
+
+class SplashBitmap;
+class GfxSeparationColorSpace;
+
+//------------------------------------------------------------------------
+// SplashBitmapPool
+//
+// Keeps the temporary bitmaps of transparency groups, soft masks and
+// patterns once they are no longer used, bucketed by size and mode, so
+// that the next temporary bitmap of the same size doesn't need to be
+// allocated again.  The least recently returned bitmaps are freed when
+// the pooled bitmaps exceed the memory budget, which the owner should
+// size after what it draws, as every pool keeps up to its budget.  A
+// pool isn't thread safe.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT SplashBitmapPool
+{
+public:
+    explicit SplashBitmapPool(size_t maxSizeA);
+    ~SplashBitmapPool();
+
+    SplashBitmapPool(const SplashBitmapPool &) = delete;
+    SplashBitmapPool &operator=(const SplashBitmapPool &) = delete;
+
+    // Return a bitmap, as new SplashBitmap(...) would, reusing a pooled
+    // one if there is one with the same size and mode.  As with a new
+    // bitmap, the pixels and alpha values are not initialized, and the
+    // data pointer is nullptr if the bitmap can't be allocated.
+    SplashBitmap *take(int width, int height, int rowPad, SplashColorMode mode, bool alpha, bool topDown = true, const std::vector<std::unique_ptr<GfxSeparationColorSpace>> *separationList = nullptr);
+
+    // Return a copy of <src>, as SplashBitmap::copy would.
+    SplashBitmap *takeCopy(const SplashBitmap *src);
+
+    // Return <bitmap>, which the caller must not use anymore, to the
+    // pool.  It is freed if it doesn't fit in the budget.
+    void give(SplashBitmap *bitmap);
+
+    // Set the memory budget, in bytes; 0 disables pooling.
+    void setMaxSize(size_t maxSizeA);
+
+    // Bytes of pooled bitmaps.
+    size_t getSize() const { return size; }
+
+private:
+    // width, height, row padding, mode, alpha, top-down
+    using Key = std::tuple<int, int, int, SplashColorMode, bool, bool>;
+
+    static Key getKey(const SplashBitmap &bitmap);
+    static size_t getBitmapSize(const SplashBitmap &bitmap);
+    void trim();
+
+    std::list<std::unique_ptr<SplashBitmap>> bitmaps; // most recently returned first
+    std::multimap<Key, std::list<std::unique_ptr<SplashBitmap>>::iterator> buckets;
+    size_t size; // bytes of pooled bitmaps
+    size_t maxSize;
+};
+
+#endif
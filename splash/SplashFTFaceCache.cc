@@ -0,0 +1,214 @@
+//========================================================================
+//
+// SplashFTFaceCache.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "goo/ft_utils.h"
+#include "SplashFontFile.h"
+#include "SplashFTFaceCache.h"
+#include "SplashGlyphCache.h"
+
+namespace {
+
+// rough size of the data FreeType allocates for a face, so that faces
+// read from files count too
+constexpr size_t faceOverhead = 16 * 1024;
+
+struct CachedFace
+{
+    std::shared_ptr<SplashFTFace> face;
+    std::weak_ptr<SplashFTFace> users; // the pointer getFace returns
+};
+
+struct FaceCache
+{
+    using FaceList = std::list<CachedFace>;
+
+    std::mutex mutex;
+    FaceList faces; // most recently used first
+    std::unordered_multimap<size_t, FaceList::iterator> index; // faces by source hash
+    size_t size = 0; // sum of the sizes of faces
+    size_t maxSize = 64 * 1024 * 1024;
+
+    // FT_New_Face and FT_Done_Face must not run concurrently on a library;
+    // libMutex is never locked before mutex
+    std::mutex libMutex;
+    FT_Library lib = nullptr; // freed when the last face is
+    int liveFaces = 0; // faces loaded with lib
+};
+
+void trimCache(FaceCache &cache);
+
+// Drops the unreferenced faces at exit, which frees the library unless
+// faces are still used, in which case the last one frees it.
+struct FaceCacheCleanup
+{
+    FaceCache *cache;
+
+    ~FaceCacheCleanup()
+    {
+        const std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->maxSize = 0;
+        trimCache(*cache);
+    }
+};
+
+FaceCache &faceCache()
+{
+    // never destroyed, faces can be released by other static destructors
+    static auto *cache = new FaceCache;
+    static FaceCacheCleanup cleanup { cache };
+    return *cache;
+}
+
+size_t hashSrc(const SplashFontSrc &src)
+{
+    if (src.isFile()) {
+        return std::hash<std::string>()(src.fileName());
+    }
+    return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char *>(src.buf().data()), src.buf().size()));
+}
+
+// Drop unreferenced faces, least recently used first, until the cache
+// fits in its budget.  The cache's mutex must be locked.
+void trimCache(FaceCache &cache)
+{
+    for (auto it = cache.faces.end(); cache.size > cache.maxSize && it != cache.faces.begin();) {
+        --it;
+        if (it->face.use_count() == 1) {
+            cache.size -= it->face->getSize();
+            auto [first, last] = cache.index.equal_range(it->face->hash);
+            cache.index.erase(std::find_if(first, last, [&](const auto &entry) { return entry.second == it; }));
+            it = cache.faces.erase(it);
+        }
+    }
+}
+
+// Returns the pointer to <entry>'s face that its users share; when the
+// last of them goes away, the faces over the budget are dropped.  The
+// cache's mutex must be locked.
+std::shared_ptr<SplashFTFace> getUsers(CachedFace &entry)
+{
+    std::shared_ptr<SplashFTFace> users = entry.users.lock();
+    if (!users) {
+        users = std::shared_ptr<SplashFTFace>(entry.face.get(), [face = entry.face](SplashFTFace * /*unused*/) mutable {
+            FaceCache &cache = faceCache();
+            const std::lock_guard<std::mutex> lock(cache.mutex);
+            face.reset();
+            trimCache(cache);
+        });
+        entry.users = users;
+    }
+    return users;
+}
+
+}
+
+//------------------------------------------------------------------------
+// SplashFTFace
+//------------------------------------------------------------------------
+
+SplashFTFace::SplashFTFace(std::unique_ptr<SplashFontSrc> srcA, int faceIndexA, size_t hashA) : id(SplashGlyphCache::newFontID()), hash(hashA), src(std::move(srcA)), faceIndex(faceIndexA) { }
+
+SplashFTFace::~SplashFTFace()
+{
+    if (face) {
+        FaceCache &cache = faceCache();
+        const std::lock_guard<std::mutex> libLock(cache.libMutex);
+        FT_Done_Face(face);
+        if (--cache.liveFaces == 0) {
+            FT_Done_FreeType(cache.lib);
+            cache.lib = nullptr;
+        }
+    }
+}
+
+bool SplashFTFace::matches(const SplashFontSrc &srcA, int faceIndexA, size_t hashA) const
+{
+    if (hash != hashA || faceIndex != faceIndexA || src->isFile() != srcA.isFile()) {
+        return false;
+    }
+    if (src->isFile()) {
+        return src->fileName() == srcA.fileName();
+    }
+    return src->buf() == srcA.buf();
+}
+
+//------------------------------------------------------------------------
+// SplashFTFaceCache
+//------------------------------------------------------------------------
+
+std::shared_ptr<SplashFTFace> SplashFTFaceCache::getFace(std::unique_ptr<SplashFontSrc> src, int faceIndex)
+{
+    FaceCache &cache = faceCache();
+    const size_t hash = hashSrc(*src);
+
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+    auto [first, last] = cache.index.equal_range(hash);
+    auto entry = std::find_if(first, last, [&](const auto &e) { return e.second->face->matches(*src, faceIndex, hash); });
+    if (entry != last) {
+        cache.faces.splice(cache.faces.begin(), cache.faces, entry->second);
+        return getUsers(cache.faces.front());
+    }
+
+    std::shared_ptr<SplashFTFace> face(new SplashFTFace(std::move(src), faceIndex, hash));
+    bool loaded;
+    {
+        const std::lock_guard<std::mutex> libLock(cache.libMutex);
+        if (!cache.lib && FT_Init_FreeType(&cache.lib)) {
+            cache.lib = nullptr;
+        }
+        if (!cache.lib) {
+            loaded = false;
+        } else if (face->src->isFile()) {
+            loaded = !ft_new_face_from_file(cache.lib, face->src->fileName().c_str(), faceIndex, &face->face);
+        } else {
+            loaded = !FT_New_Memory_Face(cache.lib, static_cast<const FT_Byte *>(face->src->buf().data()), face->src->buf().size(), faceIndex, &face->face);
+        }
+        if (loaded) {
+            ++cache.liveFaces;
+        } else if (cache.lib && cache.liveFaces == 0) {
+            FT_Done_FreeType(cache.lib);
+            cache.lib = nullptr;
+        }
+    }
+    if (!loaded) {
+        face->face = nullptr;
+        return nullptr;
+    }
+    face->size = (face->face->stream ? face->face->stream->size : 0) + faceOverhead;
+
+    cache.faces.push_front({ std::move(face), {} });
+    cache.index.emplace(hash, cache.faces.begin());
+    cache.size += cache.faces.front().face->getSize();
+    std::shared_ptr<SplashFTFace> users = getUsers(cache.faces.front());
+    trimCache(cache);
+    return users;
+}
+
+void SplashFTFaceCache::setMaxSize(size_t maxSizeA)
+{
+    FaceCache &cache = faceCache();
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.maxSize = maxSizeA;
+    trimCache(cache);
+}
+
+SplashFTFaceCache::Stats SplashFTFaceCache::getStats()
+{
+    FaceCache &cache = faceCache();
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+    return { cache.size, cache.faces.size() };
+}
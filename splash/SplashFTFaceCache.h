@@ -0,0 +1,96 @@
+//========================================================================
+//
+// SplashFTFaceCache.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHFTFACECACHE_H
+#define SPLASHFTFACECACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "poppler_private_export.h"
+
+class SplashFontSrc;
+
+//------------------------------------------------------------------------
+// SplashFTFace
+//
+// A FreeType face shared by every SplashFTFontFile loaded from the same
+// font program, in any document or font engine.  A face can't be used by
+// several threads at once: <mutex> must be held around every FreeType
+// call on the face, its sizes or its glyph slot.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT SplashFTFace
+{
+public:
+    ~SplashFTFace();
+
+    SplashFTFace(const SplashFTFace &) = delete;
+    SplashFTFace &operator=(const SplashFTFace &) = delete;
+
+    // Memory the face is counted for in the cache budget: its font
+    // program, read from memory or from a file, and FreeType's data.
+    size_t getSize() const { return size; }
+
+    const unsigned long long id; // SplashGlyphCache font ID of the face
+    const size_t hash; // hash of the font program or file name
+    FT_Face face = nullptr;
+    std::mutex mutex;
+
+private:
+    SplashFTFace(std::unique_ptr<SplashFontSrc> srcA, int faceIndexA, size_t hashA);
+
+    bool matches(const SplashFontSrc &srcA, int faceIndexA, size_t hashA) const;
+
+    const std::unique_ptr<SplashFontSrc> src; // the font program FreeType reads
+    const int faceIndex;
+    size_t size = 0;
+
+    friend class SplashFTFaceCache;
+};
+
+//------------------------------------------------------------------------
+// SplashFTFaceCache
+//
+// Process-wide cache of SplashFTFaces, keyed by the content of embedded
+// font programs and by the file name of external ones, so that documents
+// embedding the same font don't load it again.  Faces stay in the cache
+// after their last SplashFTFontFile is gone, until the cached faces
+// exceed the memory budget; the least recently used unreferenced faces
+// are dropped first, when a face is loaded, when the budget changes and
+// when the last user of a face goes away.  The FreeType library is freed
+// with the last face, and the unreferenced faces are dropped at exit.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT SplashFTFaceCache
+{
+public:
+    struct Stats
+    {
+        size_t size; // bytes counted for the cached faces
+        size_t faces; // number of cached faces, used or not
+    };
+
+    // Return the face <faceIndex> of <src>, loading it if it isn't
+    // cached.  <src> is kept by the face if it is loaded, and dropped if
+    // the face was cached.  Returns nullptr if FreeType can't load it.
+    static std::shared_ptr<SplashFTFace> getFace(std::unique_ptr<SplashFontSrc> src, int faceIndex);
+
+    // Set the memory budget, in bytes as counted by
+    // SplashFTFace::getSize; 0 disables keeping faces that aren't
+    // referenced anymore.
+    static void setMaxSize(size_t maxSizeA);
+
+    static Stats getStats();
+};
+
+#endif
@@ -35,7 +35,9 @@
 #include "goo/gmem.h"
 #include "SplashMath.h"
 #include "SplashGlyphBitmap.h"
+#include "SplashGlyphCache.h"
 #include "SplashPath.h"
+#include "SplashFTFaceCache.h"
 #include "SplashFTFontEngine.h"
 #include "SplashFTFontFile.h"
 #include "SplashFTFont.h"
@@ -60,7 +62,8 @@ SplashFTFont::SplashFTFont(const std::shared_ptr<SplashFTFontFile> &fontFileA, c
     int div;
     int x, y;
 
-    face = fontFileA->face;
+    const std::lock_guard<std::mutex> lock(fontFileA->face->mutex);
+    face = fontFileA->face->face;
     if (FT_New_Size(face, &sizeObj)) {
         return;
     }
@@ -148,7 +151,15 @@ SplashFTFont::SplashFTFont(const std::shared_ptr<SplashFTFontFile> &fontFileA, c
     isOk = true;
 }
 
-SplashFTFont::~SplashFTFont() = default;
+SplashFTFont::~SplashFTFont()
+{
+    // the face outlives this font when it's shared
+    if (sizeObj) {
+        auto *ff = static_cast<SplashFTFontFile *>(fontFile.get());
+        const std::lock_guard<std::mutex> lock(ff->face->mutex);
+        FT_Done_Size(sizeObj);
+    }
+}
 
 bool SplashFTFont::getGlyph(int c, int xFrac, int /*yFrac*/, SplashGlyphBitmap *bitmap, int x0, int y0, const SplashClip &clip, SplashClipResult *clipRes)
 {
@@ -185,6 +196,27 @@ static FT_Int32 getFTLoadFlags(bool type1, bool trueType, bool aa, bool enableFr
     return ret;
 }
 
+bool SplashFTFont::getGlyphCacheKey(int c, int xFrac, int /*yFrac*/, SplashGlyphCacheKey *key)
+{
+    if (unlikely(!isOk)) {
+        return false;
+    }
+
+    auto *ff = static_cast<SplashFTFontFile *>(fontFile.get());
+    key->fontID = ff->face->id;
+    key->mat = mat;
+    if (c >= 0 && static_cast<size_t>(c) < ff->codeToGID.size()) {
+        key->glyph = ff->codeToGID[c];
+    } else {
+        key->glyph = c;
+    }
+    key->xFrac = xFrac;
+    key->yFrac = 0;
+    key->flags = getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting);
+    key->aa = aa;
+    return true;
+}
+
 bool SplashFTFont::makeGlyph(int c, int xFrac, int /*yFrac*/, SplashGlyphBitmap *bitmap, int x0, int y0, const SplashClip &clip, SplashClipResult *clipRes)
 {
     SplashFTFontFile *ff;
@@ -200,12 +232,14 @@ bool SplashFTFont::makeGlyph(int c, int xFrac, int /*yFrac*/, SplashGlyphBitmap
     }
 
     ff = static_cast<SplashFTFontFile *>(fontFile.get());
+    const std::lock_guard<std::mutex> lock(ff->face->mutex);
+    FT_Face face = ff->face->face;
 
-    ff->face->size = sizeObj;
+    face->size = sizeObj;
     offset.x = static_cast<FT_Pos>(static_cast<int>(static_cast<double>(xFrac) * splashFontFractionMul * 64));
     offset.y = 0;
-    FT_Set_Transform(ff->face, &matrix, &offset);
-    slot = ff->face->glyph;
+    FT_Set_Transform(face, &matrix, &offset);
+    slot = face->glyph;
 
     if (c >= 0 && static_cast<size_t>(c) < ff->codeToGID.size()) {
         gid = static_cast<FT_UInt>(ff->codeToGID[c]);
@@ -213,14 +247,14 @@ bool SplashFTFont::makeGlyph(int c, int xFrac, int /*yFrac*/, SplashGlyphBitmap
         gid = static_cast<FT_UInt>(c);
     }
 
-    if (FT_Load_Glyph(ff->face, gid, getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting))) {
+    if (FT_Load_Glyph(face, gid, getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting))) {
         return false;
     }
 
     // prelimirary values based on FT_Outline_Get_CBox
     // we add two pixels to each side to be in the safe side
     FT_BBox cbox;
-    FT_Outline_Get_CBox(&ff->face->glyph->outline, &cbox);
+    FT_Outline_Get_CBox(&face->glyph->outline, &cbox);
     bitmap->x = -(cbox.xMin / 64) + 2;
     bitmap->y = (cbox.yMax / 64) + 2;
     bitmap->w = ((cbox.xMax - cbox.xMin) / 64) + 4;
@@ -290,8 +324,10 @@ double SplashFTFont::getGlyphAdvance(int c)
     offset.x = 0;
     offset.y = 0;
 
-    ff->face->size = sizeObj;
-    FT_Set_Transform(ff->face, &identityMatrix, &offset);
+    const std::lock_guard<std::mutex> lock(ff->face->mutex);
+    FT_Face face = ff->face->face;
+    face->size = sizeObj;
+    FT_Set_Transform(face, &identityMatrix, &offset);
 
     if (c >= 0 && static_cast<size_t>(c) < ff->codeToGID.size()) {
         gid = static_cast<FT_UInt>(ff->codeToGID[c]);
@@ -299,12 +335,12 @@ double SplashFTFont::getGlyphAdvance(int c)
         gid = static_cast<FT_UInt>(c);
     }
 
-    if (FT_Load_Glyph(ff->face, gid, getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting))) {
+    if (FT_Load_Glyph(face, gid, getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting))) {
         return -1;
     }
 
     // 64.0 is 1 in 26.6 format
-    return ff->face->glyph->metrics.horiAdvance / 64.0 / size;
+    return face->glyph->metrics.horiAdvance / 64.0 / size;
 }
 
 struct SplashFTFontPath
@@ -342,15 +378,17 @@ SplashPath *SplashFTFont::getGlyphPath(int c)
     }
 
     ff = static_cast<SplashFTFontFile *>(fontFile.get());
-    ff->face->size = sizeObj;
-    FT_Set_Transform(ff->face, &textMatrix, nullptr);
-    slot = ff->face->glyph;
+    const std::lock_guard<std::mutex> lock(ff->face->mutex);
+    FT_Face face = ff->face->face;
+    face->size = sizeObj;
+    FT_Set_Transform(face, &textMatrix, nullptr);
+    slot = face->glyph;
     if (c >= 0 && static_cast<size_t>(c) < ff->codeToGID.size()) {
         gid = ff->codeToGID[c];
     } else {
         gid = static_cast<FT_UInt>(c);
     }
-    if (FT_Load_Glyph(ff->face, gid, getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting))) {
+    if (FT_Load_Glyph(face, gid, getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting))) {
         return nullptr;
     }
     if (FT_Get_Glyph(slot, &glyph)) {
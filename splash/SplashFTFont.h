@@ -46,6 +46,10 @@ public:
     // Munge xFrac and yFrac before calling SplashFont::getGlyph.
     bool getGlyph(int c, int xFrac, int yFrac, SplashGlyphBitmap *bitmap, int x0, int y0, const SplashClip &clip, SplashClipResult *clipRes) override;
 
+    // Glyphs are cached by face, matrix, glyph index and load flags, so
+    // that fonts of any engine sharing the face share the glyphs.
+    bool getGlyphCacheKey(int c, int xFrac, int yFrac, SplashGlyphCacheKey *key) override;
+
     // Rasterize a glyph.  The <xFrac> and <yFrac> values are the same
     // as described for getGlyph.
     bool makeGlyph(int c, int xFrac, int yFrac, SplashGlyphBitmap *bitmap, int x0, int y0, const SplashClip &clip, SplashClipResult *clipRes) override;
@@ -57,7 +61,7 @@ public:
     double getGlyphAdvance(int c) override;
 
 private:
-    FT_Size sizeObj;
+    FT_Size sizeObj = nullptr;
     FT_Matrix matrix;
     FT_Matrix textMatrix;
     double textScale = 0;
@@ -27,8 +27,7 @@
 #ifndef SPLASHFTFONTENGINE_H
 #define SPLASHFTFONTENGINE_H
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -61,12 +60,11 @@ public:
     void setAA(bool aaA) { aa = aaA; }
 
 private:
-    SplashFTFontEngine(bool aaA, bool enableFreeTypeHintingA, bool enableSlightHintingA, FT_Library libA);
+    SplashFTFontEngine(bool aaA, bool enableFreeTypeHintingA, bool enableSlightHintingA);
 
     bool aa;
     bool enableFreeTypeHinting;
     bool enableSlightHinting;
-    FT_Library lib;
 
     friend class SplashFTFontFile;
     friend class SplashFTFont;
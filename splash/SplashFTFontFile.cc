@@ -24,8 +24,8 @@
 
 #include <config.h>
 
-#include "goo/ft_utils.h"
 #include "poppler/GfxFont.h"
+#include "SplashFTFaceCache.h"
 #include "SplashFTFontEngine.h"
 #include "SplashFTFont.h"
 #include "SplashFTFontFile.h"
@@ -37,86 +37,64 @@
 
 std::shared_ptr<SplashFontFile> SplashFTFontFile::loadType1Font(SplashFTFontEngine *engineA, std::unique_ptr<SplashFontFileID> idA, std::unique_ptr<SplashFontSrc> src, const std::array<const char *, 256> &encA, int faceIndexA)
 {
-    FT_Face faceA;
     const char *name;
     int i;
 
-    if (src->isFile()) {
-        if (ft_new_face_from_file(engineA->lib, src->fileName().c_str(), faceIndexA, &faceA)) {
-            return nullptr;
-        }
-    } else {
-        if (FT_New_Memory_Face(engineA->lib, static_cast<const FT_Byte *>(src->buf().data()), src->buf().size(), faceIndexA, &faceA)) {
-            return nullptr;
-        }
+    std::shared_ptr<SplashFTFace> faceA = SplashFTFaceCache::getFace(std::move(src), faceIndexA);
+    if (!faceA) {
+        return nullptr;
     }
     std::vector<int> codeToGIDA;
     codeToGIDA.resize(256, 0);
-    for (i = 0; i < 256; ++i) {
-        if ((name = encA[i])) {
-            codeToGIDA[i] = static_cast<int>(FT_Get_Name_Index(faceA, const_cast<char *>(name)));
-            if (codeToGIDA[i] == 0) {
-                name = GfxFont::getAlternateName(name);
-                if (name) {
-                    codeToGIDA[i] = FT_Get_Name_Index(faceA, const_cast<char *>(name));
+    {
+        const std::lock_guard<std::mutex> lock(faceA->mutex);
+        for (i = 0; i < 256; ++i) {
+            if ((name = encA[i])) {
+                codeToGIDA[i] = static_cast<int>(FT_Get_Name_Index(faceA->face, const_cast<char *>(name)));
+                if (codeToGIDA[i] == 0) {
+                    name = GfxFont::getAlternateName(name);
+                    if (name) {
+                        codeToGIDA[i] = FT_Get_Name_Index(faceA->face, const_cast<char *>(name));
+                    }
                 }
             }
         }
     }
 
-    return std::make_shared<SplashFTFontFile>(engineA, std::move(idA), std::move(src), faceA, std::move(codeToGIDA), false, true);
+    return std::make_shared<SplashFTFontFile>(engineA, std::move(idA), std::move(faceA), std::move(codeToGIDA), false, true);
 }
 
 std::shared_ptr<SplashFontFile> SplashFTFontFile::loadCIDFont(SplashFTFontEngine *engineA, std::unique_ptr<SplashFontFileID> idA, std::unique_ptr<SplashFontSrc> src, std::vector<int> &&codeToGIDA, int faceIndexA)
 {
-    FT_Face faceA;
-
-    if (src->isFile()) {
-        if (ft_new_face_from_file(engineA->lib, src->fileName().c_str(), faceIndexA, &faceA)) {
-            return nullptr;
-        }
-    } else {
-        if (FT_New_Memory_Face(engineA->lib, static_cast<const FT_Byte *>(src->buf().data()), src->buf().size(), faceIndexA, &faceA)) {
-            return nullptr;
-        }
+    std::shared_ptr<SplashFTFace> faceA = SplashFTFaceCache::getFace(std::move(src), faceIndexA);
+    if (!faceA) {
+        return nullptr;
     }
 
-    return std::make_shared<SplashFTFontFile>(engineA, std::move(idA), std::move(src), faceA, std::move(codeToGIDA), false, false);
+    return std::make_shared<SplashFTFontFile>(engineA, std::move(idA), std::move(faceA), std::move(codeToGIDA), false, false);
 }
 
 std::shared_ptr<SplashFontFile> SplashFTFontFile::loadTrueTypeFont(SplashFTFontEngine *engineA, std::unique_ptr<SplashFontFileID> idA, std::unique_ptr<SplashFontSrc> src, std::vector<int> &&codeToGIDA, int faceIndexA)
 {
-    FT_Face faceA;
-
-    if (src->isFile()) {
-        if (ft_new_face_from_file(engineA->lib, src->fileName().c_str(), faceIndexA, &faceA)) {
-            return nullptr;
-        }
-    } else {
-        if (FT_New_Memory_Face(engineA->lib, static_cast<const FT_Byte *>(src->buf().data()), src->buf().size(), faceIndexA, &faceA)) {
-            return nullptr;
-        }
+    std::shared_ptr<SplashFTFace> faceA = SplashFTFaceCache::getFace(std::move(src), faceIndexA);
+    if (!faceA) {
+        return nullptr;
     }
 
-    return std::make_shared<SplashFTFontFile>(engineA, std::move(idA), std::move(src), faceA, std::move(codeToGIDA), true, false);
+    return std::make_shared<SplashFTFontFile>(engineA, std::move(idA), std::move(faceA), std::move(codeToGIDA), true, false);
 }
 
-SplashFTFontFile::SplashFTFontFile(SplashFTFontEngine *engineA, std::unique_ptr<SplashFontFileID> idA, std::unique_ptr<SplashFontSrc> srcA, FT_Face faceA, std::vector<int> &&codeToGIDA, bool trueTypeA, bool type1A, PrivateTag /*unused*/)
-    : SplashFontFile(std::move(idA), std::move(srcA))
+SplashFTFontFile::SplashFTFontFile(SplashFTFontEngine *engineA, std::unique_ptr<SplashFontFileID> idA, std::shared_ptr<SplashFTFace> faceA, std::vector<int> &&codeToGIDA, bool trueTypeA, bool type1A, PrivateTag /*unused*/)
+    : SplashFontFile(std::move(idA), nullptr)
 {
     engine = engineA;
-    face = faceA;
+    face = std::move(faceA);
     codeToGID = std::move(codeToGIDA);
     trueType = trueTypeA;
     type1 = type1A;
 }
 
-SplashFTFontFile::~SplashFTFontFile()
-{
-    if (face) {
-        FT_Done_Face(face);
-    }
-}
+SplashFTFontFile::~SplashFTFontFile() = default;
 
 SplashFont *SplashFTFontFile::makeFont(const std::array<double, 4> &mat, const std::array<double, 4> &textMat)
 {
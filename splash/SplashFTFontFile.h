@@ -34,6 +34,7 @@
 #include <memory>
 
 class SplashFontFileID;
+class SplashFTFace;
 class SplashFTFontEngine;
 
 //------------------------------------------------------------------------
@@ -57,11 +58,11 @@ public:
     // file.
     SplashFont *makeFont(const std::array<double, 4> &mat, const std::array<double, 4> &textMat) override;
 
-    SplashFTFontFile(SplashFTFontEngine *engineA, std::unique_ptr<SplashFontFileID> idA, std::unique_ptr<SplashFontSrc> src, FT_Face faceA, std::vector<int> &&codeToGIDA, bool trueTypeA, bool type1A, PrivateTag /*unused*/ = {});
+    SplashFTFontFile(SplashFTFontEngine *engineA, std::unique_ptr<SplashFontFileID> idA, std::shared_ptr<SplashFTFace> faceA, std::vector<int> &&codeToGIDA, bool trueTypeA, bool type1A, PrivateTag /*unused*/ = {});
 
 private:
     SplashFTFontEngine *engine;
-    FT_Face face;
+    std::shared_ptr<SplashFTFace> face; // shared with the other files loaded from the same font program
     std::vector<int> codeToGID;
     bool trueType;
     bool type1;
@@ -22,23 +22,12 @@
 
 #include <config.h>
 
-#include <climits>
-#include <cstring>
 #include "goo/gmem.h"
 #include "SplashGlyphBitmap.h"
+#include "SplashGlyphCache.h"
 #include "SplashFontFile.h"
 #include "SplashFont.h"
 
-//------------------------------------------------------------------------
-
-struct SplashFontCacheTag
-{
-    int c;
-    short xFrac, yFrac; // x and y fractions
-    int mru; // valid bit (0x80000000) and MRU index
-    int x, y, w, h; // offset and size of glyph
-};
-
 //------------------------------------------------------------------------
 // SplashFont
 //------------------------------------------------------------------------
@@ -48,72 +37,24 @@ SplashFont::SplashFont(const std::shared_ptr<SplashFontFile> &fontFileA, const s
     fontFile = fontFileA;
     aa = aaA;
 
-    cache = nullptr;
-    cacheTags = nullptr;
-
     xMin = yMin = xMax = yMax = 0;
+    glyphW = glyphH = 0;
 }
 
 void SplashFont::initCache()
 {
-    int i;
-
     // this should be (max - min + 1), but we add some padding to
     // deal with rounding errors
     glyphW = xMax - xMin + 3;
     glyphH = yMax - yMin + 3;
-    if (glyphW > INT_MAX / glyphH) {
-        glyphSize = -1;
-    } else {
-        if (aa) {
-            glyphSize = glyphW * glyphH;
-        } else {
-            glyphSize = ((glyphW + 7) >> 3) * glyphH;
-        }
-    }
-
-    // set up the glyph pixmap cache
-    cacheAssoc = 8;
-    if (glyphSize <= 64) {
-        cacheSets = 32;
-    } else if (glyphSize <= 128) {
-        cacheSets = 16;
-    } else if (glyphSize <= 256) {
-        cacheSets = 8;
-    } else if (glyphSize <= 512) {
-        cacheSets = 4;
-    } else if (glyphSize <= 1024) {
-        cacheSets = 2;
-    } else {
-        cacheSets = 1;
-    }
-    cache = static_cast<unsigned char *>(gmallocn_checkoverflow(cacheSets * cacheAssoc, glyphSize));
-    if (cache != nullptr) {
-        cacheTags = static_cast<SplashFontCacheTag *>(gmallocn(cacheSets * cacheAssoc, sizeof(SplashFontCacheTag)));
-        for (i = 0; i < cacheSets * cacheAssoc; ++i) {
-            cacheTags[i].mru = i & (cacheAssoc - 1);
-        }
-    } else {
-        cacheAssoc = 0;
-    }
 }
 
-SplashFont::~SplashFont()
-{
-    if (cache) {
-        gfree(cache);
-    }
-    if (cacheTags) {
-        gfree(cacheTags);
-    }
-}
+SplashFont::~SplashFont() = default;
 
 bool SplashFont::getGlyph(int c, int xFrac, int yFrac, SplashGlyphBitmap *bitmap, int x0, int y0, const SplashClip &clip, SplashClipResult *clipRes)
 {
     SplashGlyphBitmap bitmap2;
-    int size;
-    unsigned char *p;
-    int i, j, k;
+    SplashGlyphCacheKey key;
 
     // no fractional coordinates for large glyphs or non-anti-aliased
     // glyphs
@@ -122,22 +63,17 @@ bool SplashFont::getGlyph(int c, int xFrac, int yFrac, SplashGlyphBitmap *bitmap
     }
 
     // check the cache
-    i = (c & (cacheSets - 1)) * cacheAssoc;
-    for (j = 0; j < cacheAssoc; ++j) {
-        if ((cacheTags[i + j].mru & 0x80000000) && cacheTags[i + j].c == c && static_cast<int>(cacheTags[i + j].xFrac) == xFrac && static_cast<int>(cacheTags[i + j].yFrac) == yFrac) {
-            bitmap->x = cacheTags[i + j].x;
-            bitmap->y = cacheTags[i + j].y;
-            bitmap->w = cacheTags[i + j].w;
-            bitmap->h = cacheTags[i + j].h;
-            for (k = 0; k < cacheAssoc; ++k) {
-                if (k != j && (cacheTags[i + k].mru & 0x7fffffff) < (cacheTags[i + j].mru & 0x7fffffff)) {
-                    ++cacheTags[i + k].mru;
-                }
-            }
-            cacheTags[i + j].mru = 0x80000000;
-            bitmap->aa = aa;
-            bitmap->data = cache + (i + j) * glyphSize;
+    const bool cacheable = getGlyphCacheKey(c, xFrac, yFrac, &key);
+    if (cacheable) {
+        if (std::shared_ptr<const SplashGlyphCache::Glyph> glyph = SplashGlyphCache::lookup(key)) {
+            bitmap->x = glyph->x;
+            bitmap->y = glyph->y;
+            bitmap->w = glyph->w;
+            bitmap->h = glyph->h;
+            bitmap->aa = glyph->aa;
+            bitmap->data = glyph->data.get();
             bitmap->freeData = false;
+            bitmap->dataOwner = std::move(glyph);
 
             int rectXMin, rectYMin;
             if (checkedSubtraction(x0, bitmap->x, &rectXMin)) {
@@ -167,44 +103,19 @@ bool SplashFont::getGlyph(int c, int xFrac, int yFrac, SplashGlyphBitmap *bitmap
 
     // if the glyph doesn't fit in the bounding box, return a temporary
     // uncached bitmap
-    if (bitmap2.w > glyphW || bitmap2.h > glyphH) {
+    if (!cacheable || bitmap2.w > glyphW || bitmap2.h > glyphH) {
         *bitmap = bitmap2;
         return true;
     }
 
     // insert glyph pixmap in cache
-    if (aa) {
-        size = bitmap2.w * bitmap2.h;
-    } else {
-        size = ((bitmap2.w + 7) >> 3) * bitmap2.h;
-    }
-    p = nullptr; // make gcc happy
-    if (cacheAssoc == 0) {
-        // we had problems on the malloc of the cache, so ignore it
-        *bitmap = bitmap2;
-    } else {
-        for (j = 0; j < cacheAssoc; ++j) {
-            if ((cacheTags[i + j].mru & 0x7fffffff) == cacheAssoc - 1) {
-                cacheTags[i + j].mru = 0x80000000;
-                cacheTags[i + j].c = c;
-                cacheTags[i + j].xFrac = static_cast<short>(xFrac);
-                cacheTags[i + j].yFrac = static_cast<short>(yFrac);
-                cacheTags[i + j].x = bitmap2.x;
-                cacheTags[i + j].y = bitmap2.y;
-                cacheTags[i + j].w = bitmap2.w;
-                cacheTags[i + j].h = bitmap2.h;
-                p = cache + (i + j) * glyphSize;
-                memcpy(p, bitmap2.data, size);
-            } else {
-                ++cacheTags[i + j].mru;
-            }
-        }
-        *bitmap = bitmap2;
-        bitmap->data = p;
-        bitmap->freeData = false;
-        if (bitmap2.freeData) {
-            gfree(bitmap2.data);
-        }
+    std::shared_ptr<const SplashGlyphCache::Glyph> glyph = SplashGlyphCache::insert(key, bitmap2);
+    *bitmap = bitmap2;
+    bitmap->data = glyph->data.get();
+    bitmap->freeData = false;
+    bitmap->dataOwner = std::move(glyph);
+    if (bitmap2.freeData) {
+        gfree(bitmap2.data);
     }
     return true;
 }
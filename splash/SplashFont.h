@@ -30,7 +30,7 @@
 #include <array>
 
 struct SplashGlyphBitmap;
-struct SplashFontCacheTag;
+struct SplashGlyphCacheKey;
 class SplashFontFile;
 class SplashPath;
 
@@ -68,8 +68,9 @@ public:
         return fontFileA == fontFile && matA[0] == mat[0] && matA[1] == mat[1] && matA[2] == mat[2] && matA[3] == mat[3] && textMatA[0] == textMat[0] && textMatA[1] == textMat[1] && textMatA[2] == textMat[2] && textMatA[3] == textMat[3];
     }
 
-    // Get a glyph - this does a cache lookup first, and if not found,
-    // creates a new bitmap and adds it to the cache.  The <xFrac> and
+    // Get a glyph - this does a lookup in the SplashGlyphCache first,
+    // and if not found, creates a new bitmap and adds it to the cache;
+    // bitmap->dataOwner keeps a cached bitmap alive.  The <xFrac> and
     // <yFrac> values are splashFontFractionBits bits each, representing
     // the numerators of fractions in [0, 1), where the denominator is
     // splashFontFraction = 1 << splashFontFractionBits.  Subclasses
@@ -77,6 +78,10 @@ public:
     // support fractional coordinates.
     virtual bool getGlyph(int c, int xFrac, int yFrac, SplashGlyphBitmap *bitmap, int x0, int y0, const SplashClip &clip, SplashClipResult *clipRes);
 
+    // Set <key> to what identifies a glyph in the SplashGlyphCache.
+    // Returns false if the glyphs of this font can't be cached.
+    virtual bool getGlyphCacheKey(int /*c*/, int /*xFrac*/, int /*yFrac*/, SplashGlyphCacheKey * /*key*/) { return false; }
+
     // Rasterize a glyph.  The <xFrac> and <yFrac> values are the same
     // as described for getGlyph.
     virtual bool makeGlyph(int c, int xFrac, int yFrac, SplashGlyphBitmap *bitmap, int x0, int y0, const SplashClip &clip, SplashClipResult *clipRes) = 0;
@@ -105,13 +110,7 @@ protected:
                                          //   (text space -> user space)
     bool aa; // anti-aliasing
     int xMin, yMin, xMax, yMax; // glyph bounding box
-    unsigned char *cache; // glyph bitmap cache
-    SplashFontCacheTag * // cache tags
-            cacheTags;
-    int glyphW, glyphH; // size of glyph bitmaps
-    int glyphSize; // size of glyph bitmaps, in bytes
-    int cacheSets; // number of sets in cache
-    int cacheAssoc; // cache associativity (glyphs per set)
+    int glyphW, glyphH; // max size of cached glyph bitmaps
 };
 
 #endif
@@ -33,6 +33,7 @@
 #include <algorithm>
 
 #include "SplashMath.h"
+#include "SplashFTFaceCache.h"
 #include "SplashFTFontEngine.h"
 #include "SplashFontFile.h"
 #include "SplashFontFileID.h"
@@ -142,6 +143,11 @@ void SplashFontEngine::setAA(bool aa)
     }
 }
 
+void SplashFontEngine::setFontFileCacheSize(size_t size)
+{
+    SplashFTFaceCache::setMaxSize(size);
+}
+
 SplashFont *SplashFontEngine::getFont(std::shared_ptr<SplashFontFile> fontFile, const std::array<double, 4> &textMat, const std::array<double, 6> &ctm)
 {
     std::array<double, 4> mat;
@@ -29,6 +29,7 @@
 #define SPLASHFONTENGINE_H
 
 #include <array>
+#include <cstddef>
 #include <memory>
 #include <vector>
 
@@ -83,6 +84,12 @@ public:
     bool getAA();
     void setAA(bool aa);
 
+    // Set the memory budget, in bytes of font data, of the font files
+    // cached for the whole process: a font file loaded again by any
+    // engine, e.g. for another document embedding the same font, is
+    // shared instead of being parsed again.
+    static void setFontFileCacheSize(size_t size);
+
 private:
     std::array<SplashFont *, 16> fontCache;
 
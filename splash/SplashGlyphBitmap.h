@@ -7,6 +7,8 @@
 #ifndef SPLASHGLYPHBITMAP_H
 #define SPLASHGLYPHBITMAP_H
 
+#include <memory>
+
 //------------------------------------------------------------------------
 // SplashGlyphBitmap
 //------------------------------------------------------------------------
@@ -18,6 +20,7 @@ struct SplashGlyphBitmap
              //   bitmap; false means 1-bit
     unsigned char *data; // bitmap data
     bool freeData; // true if data memory should be freed
+    std::shared_ptr<const void> dataOwner; // keeps shared data alive
 };
 
 #endif
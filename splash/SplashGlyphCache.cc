@@ -0,0 +1,170 @@
+//========================================================================
+//
+// SplashGlyphCache.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "SplashGlyphBitmap.h"
+#include "SplashGlyphCache.h"
+
+namespace {
+
+struct KeyHash
+{
+    size_t operator()(const SplashGlyphCacheKey &key) const
+    {
+        unsigned long long h = key.fontID;
+        const auto mix = [&h](unsigned long long v) { h = (h ^ v) * 0x100000001b3ULL; };
+        for (const double m : key.mat) {
+            mix(std::bit_cast<unsigned long long>(m));
+        }
+        mix(static_cast<unsigned int>(key.glyph));
+        mix((static_cast<unsigned long long>(key.xFrac) << 16) | (static_cast<unsigned long long>(key.yFrac) << 8) | (key.aa ? 1 : 0));
+        mix(static_cast<unsigned int>(key.flags));
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+// The cache is split into shards with their own lock and budget, so that
+// threads drawing text rarely wait for each other.
+constexpr int nShards = 16;
+
+// bookkeeping bytes counted for each glyph
+constexpr size_t glyphOverhead = 128;
+
+struct Shard
+{
+    std::mutex mutex;
+    std::list<std::pair<SplashGlyphCacheKey, std::shared_ptr<const SplashGlyphCache::Glyph>>> glyphs; // most recently used first
+    std::unordered_map<SplashGlyphCacheKey, decltype(glyphs)::iterator, KeyHash> index;
+    size_t size = 0;
+
+    void trim(size_t maxSize)
+    {
+        while (size > maxSize && !glyphs.empty()) {
+            size -= glyphOverhead + glyphDataSize(*glyphs.back().second);
+            index.erase(glyphs.back().first);
+            glyphs.pop_back();
+        }
+    }
+
+    static size_t glyphDataSize(const SplashGlyphCache::Glyph &glyph) { return static_cast<size_t>(glyph.aa ? glyph.w : (glyph.w + 7) >> 3) * glyph.h; }
+};
+
+struct GlyphCache
+{
+    std::array<Shard, nShards> shards;
+    std::atomic<size_t> maxSize = 16 * 1024 * 1024;
+    std::atomic<unsigned long long> hits = 0;
+    std::atomic<unsigned long long> misses = 0;
+    std::atomic<unsigned long long> nextFontID = 1;
+};
+
+GlyphCache &glyphCache()
+{
+    static GlyphCache cache;
+    return cache;
+}
+
+Shard &getShard(GlyphCache &cache, const SplashGlyphCacheKey &key)
+{
+    // not the low bits, which pick the bucket in the shard's index
+    return cache.shards[(KeyHash()(key) >> 16) % nShards];
+}
+
+}
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+unsigned long long SplashGlyphCache::newFontID()
+{
+    return glyphCache().nextFontID++;
+}
+
+std::shared_ptr<const SplashGlyphCache::Glyph> SplashGlyphCache::lookup(const SplashGlyphCacheKey &key)
+{
+    GlyphCache &cache = glyphCache();
+    Shard &shard = getShard(cache, key);
+
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        ++cache.misses;
+        return nullptr;
+    }
+    ++cache.hits;
+    shard.glyphs.splice(shard.glyphs.begin(), shard.glyphs, it->second);
+    return it->second->second;
+}
+
+std::shared_ptr<const SplashGlyphCache::Glyph> SplashGlyphCache::insert(const SplashGlyphCacheKey &key, const SplashGlyphBitmap &bitmap)
+{
+    auto glyph = std::make_shared<Glyph>();
+    glyph->x = bitmap.x;
+    glyph->y = bitmap.y;
+    glyph->w = bitmap.w;
+    glyph->h = bitmap.h;
+    glyph->aa = bitmap.aa;
+    const size_t dataSize = Shard::glyphDataSize(*glyph);
+    glyph->data = std::make_unique_for_overwrite<unsigned char[]>(dataSize);
+    memcpy(glyph->data.get(), bitmap.data, dataSize);
+
+    GlyphCache &cache = glyphCache();
+    const size_t shardMaxSize = cache.maxSize / nShards;
+    if (glyphOverhead + dataSize > shardMaxSize) {
+        return glyph;
+    }
+    Shard &shard = getShard(cache, key);
+
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        return it->second->second;
+    }
+    shard.glyphs.emplace_front(key, glyph);
+    shard.index.emplace(key, shard.glyphs.begin());
+    shard.size += glyphOverhead + dataSize;
+    shard.trim(shardMaxSize);
+    return glyph;
+}
+
+void SplashGlyphCache::setMaxSize(size_t maxSize)
+{
+    GlyphCache &cache = glyphCache();
+    cache.maxSize = maxSize;
+    for (Shard &shard : cache.shards) {
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.trim(maxSize / nShards);
+    }
+}
+
+size_t SplashGlyphCache::getMaxSize()
+{
+    return glyphCache().maxSize;
+}
+
+SplashGlyphCache::Stats SplashGlyphCache::getStats()
+{
+    GlyphCache &cache = glyphCache();
+    Stats stats { cache.hits, cache.misses, 0, 0 };
+    for (Shard &shard : cache.shards) {
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.size += shard.size;
+        stats.glyphs += shard.glyphs.size();
+    }
+    return stats;
+}
@@ -0,0 +1,81 @@
+//========================================================================
+//
+// SplashGlyphCache.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHGLYPHCACHE_H
+#define SPLASHGLYPHCACHE_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include "poppler_private_export.h"
+
+struct SplashGlyphBitmap;
+
+//------------------------------------------------------------------------
+// SplashGlyphCacheKey
+//------------------------------------------------------------------------
+
+struct SplashGlyphCacheKey
+{
+    unsigned long long fontID; // font program, see SplashGlyphCache::newFontID
+    std::array<double, 4> mat; // font transform matrix
+    int glyph; // glyph index in the font program
+    int xFrac, yFrac; // fractional position
+    int flags; // rasterizer options
+    bool aa; // anti-aliasing
+
+    bool operator==(const SplashGlyphCacheKey &key) const = default;
+};
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//
+// Process-wide cache of rasterized glyphs, shared by the SplashFonts of
+// every page, output device and thread, so that a glyph is rasterized
+// once for each transform and fractional position.  The least recently
+// used glyphs are dropped when the bitmaps exceed the memory budget.
+// Glyphs stay valid while they are referenced, even once dropped.
+//------------------------------------------------------------------------
+
+class POPPLER_PRIVATE_EXPORT SplashGlyphCache
+{
+public:
+    struct Glyph
+    {
+        int x, y, w, h; // offset and size of the bitmap, as in SplashGlyphBitmap
+        bool aa;
+        std::unique_ptr<unsigned char[]> data;
+    };
+
+    struct Stats
+    {
+        unsigned long long hits;
+        unsigned long long misses;
+        size_t size; // bytes of cached bitmaps
+        size_t glyphs; // number of cached glyphs
+    };
+
+    // Return a new font ID, never returned before.
+    static unsigned long long newFontID();
+
+    // Return the glyph cached for <key>, or nullptr.
+    static std::shared_ptr<const Glyph> lookup(const SplashGlyphCacheKey &key);
+
+    // Cache a copy of <bitmap> for <key>, and return it.  If another
+    // thread cached the glyph meanwhile, its copy is returned.
+    static std::shared_ptr<const Glyph> insert(const SplashGlyphCacheKey &key, const SplashGlyphBitmap &bitmap);
+
+    // Set the memory budget, in bytes; 0 disables the cache.
+    static void setMaxSize(size_t maxSize);
+    static size_t getMaxSize();
+
+    static Stats getStats();
+};
+
+#endif
@@ -29,6 +29,7 @@
 #include "SplashScreen.h"
 #include "SplashClip.h"
 #include "SplashBitmap.h"
+#include "SplashBitmapPool.h"
 #include "SplashState.h"
 
 //------------------------------------------------------------------------
@@ -69,6 +70,7 @@ SplashState::SplashState(int width, int height, bool vectorAntialias, SplashScre
     clip = std::make_unique<SplashClip>(0, 0, width - 0.001, height - 0.001, vectorAntialias);
     softMask = nullptr;
     deleteSoftMask = false;
+    softMaskPool = nullptr;
     inNonIsolatedGroup = false;
     inKnockoutGroup = false;
     fillOverprint = false;
@@ -87,6 +89,8 @@ SplashState::SplashState(int width, int height, bool vectorAntialias, SplashScre
             cp[i] = static_cast<unsigned char>(i);
         }
     }
+    rgbTransferIdentity = true;
+    cmykTransferIdentity = true;
     overprintMask = 0xffffffff;
     overprintAdditive = false;
     next = nullptr;
@@ -123,6 +127,7 @@ SplashState::SplashState(int width, int height, bool vectorAntialias, const Spla
     clip = std::make_unique<SplashClip>(0, 0, width - 0.001, height - 0.001, vectorAntialias);
     softMask = nullptr;
     deleteSoftMask = false;
+    softMaskPool = nullptr;
     inNonIsolatedGroup = false;
     inKnockoutGroup = false;
     fillOverprint = false;
@@ -141,6 +146,8 @@ SplashState::SplashState(int width, int height, bool vectorAntialias, const Spla
             cp[i] = static_cast<unsigned char>(i);
         }
     }
+    rgbTransferIdentity = true;
+    cmykTransferIdentity = true;
     overprintMask = 0xffffffff;
     overprintAdditive = false;
     next = nullptr;
@@ -169,6 +176,7 @@ SplashState::SplashState(const SplashState *state)
     clip = state->clip->copy();
     softMask = state->softMask;
     deleteSoftMask = false;
+    softMaskPool = nullptr;
     inNonIsolatedGroup = state->inNonIsolatedGroup;
     inKnockoutGroup = state->inKnockoutGroup;
     fillOverprint = state->fillOverprint;
@@ -185,6 +193,8 @@ SplashState::SplashState(const SplashState *state)
     for (int cp = 0; cp < SPOT_NCOMPS + 4; cp++) {
         memcpy(deviceNTransfer[cp], state->deviceNTransfer[cp], 256);
     }
+    rgbTransferIdentity = state->rgbTransferIdentity;
+    cmykTransferIdentity = state->cmykTransferIdentity;
     overprintMask = state->overprintMask;
     overprintAdditive = state->overprintAdditive;
     next = nullptr;
@@ -195,8 +205,8 @@ SplashState::~SplashState()
     delete strokePattern;
     delete fillPattern;
     delete screen;
-    if (deleteSoftMask && softMask) {
-        delete softMask;
+    if (deleteSoftMask) {
+        releaseSoftMask();
     }
 }
 
@@ -218,15 +228,35 @@ void SplashState::setLineDash(std::vector<double> &&lineDashA, double lineDashPh
     lineDashPhase = lineDashPhaseA;
 }
 
-void SplashState::setSoftMask(SplashBitmap *softMaskA)
+void SplashState::setSoftMask(SplashBitmap *softMaskA, SplashBitmapPool *softMaskPoolA)
 {
     if (deleteSoftMask) {
-        delete softMask;
+        releaseSoftMask();
     }
     softMask = softMaskA;
+    softMaskPool = softMaskPoolA;
     deleteSoftMask = true;
 }
 
+void SplashState::releaseSoftMask()
+{
+    if (softMaskPool) {
+        softMaskPool->give(softMask);
+    } else {
+        delete softMask;
+    }
+}
+
+static bool isIdentityTransfer(const unsigned char *transfer)
+{
+    for (int i = 0; i < 256; ++i) {
+        if (transfer[i] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void SplashState::setTransfer(unsigned char *red, unsigned char *green, unsigned char *blue, unsigned char *gray)
 {
     for (int i = 0; i < 256; ++i) {
@@ -245,4 +275,6 @@ void SplashState::setTransfer(unsigned char *red, unsigned char *green, unsigned
     memcpy(rgbTransferG, green, 256);
     memcpy(rgbTransferB, blue, 256);
     memcpy(grayTransfer, gray, 256);
+    rgbTransferIdentity = isIdentityTransfer(rgbTransferR) && isIdentityTransfer(rgbTransferG) && isIdentityTransfer(rgbTransferB);
+    cmykTransferIdentity = isIdentityTransfer(cmykTransferC) && isIdentityTransfer(cmykTransferM) && isIdentityTransfer(cmykTransferY) && isIdentityTransfer(cmykTransferK);
 }
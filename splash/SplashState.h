@@ -33,6 +33,7 @@ class SplashPattern;
 class SplashScreen;
 class SplashClip;
 class SplashBitmap;
+class SplashBitmapPool;
 
 //------------------------------------------------------------------------
 // SplashState
@@ -62,8 +63,9 @@ public:
     // Set the line dash pattern.
     void setLineDash(std::vector<double> &&lineDashA, double lineDashPhaseA);
 
-    // Set the soft mask bitmap.
-    void setSoftMask(SplashBitmap *softMaskA);
+    // Set the soft mask bitmap.  It is returned to <softMaskPoolA>, if
+    // not nullptr, instead of being deleted.
+    void setSoftMask(SplashBitmap *softMaskA, SplashBitmapPool *softMaskPoolA = nullptr);
 
     // Set the overprint parametes.
     void setFillOverprint(bool fillOverprintA) { fillOverprint = fillOverprintA; }
@@ -76,6 +78,8 @@ public:
 private:
     explicit SplashState(const SplashState *state);
 
+    void releaseSoftMask();
+
     std::array<double, 6> matrix;
     SplashPattern *strokePattern;
     SplashPattern *fillPattern;
@@ -97,6 +101,7 @@ private:
     std::unique_ptr<SplashClip> clip;
     SplashBitmap *softMask;
     bool deleteSoftMask;
+    SplashBitmapPool *softMaskPool;
     bool inNonIsolatedGroup;
     bool inKnockoutGroup;
     bool fillOverprint;
@@ -106,6 +111,8 @@ private:
     unsigned char grayTransfer[256];
     unsigned char cmykTransferC[256], cmykTransferM[256], cmykTransferY[256], cmykTransferK[256];
     unsigned char deviceNTransfer[SPOT_NCOMPS + 4][256];
+    bool rgbTransferIdentity; // rgbTransferR/G/B are the identity
+    bool cmykTransferIdentity; // cmykTransferC/M/Y/K are the identity
     unsigned int overprintMask;
     bool overprintAdditive;
 
@@ -62,7 +62,7 @@ inline void SplashXPath::transform(const std::array<double, 6> &matrix, double x
 // SplashXPath
 //------------------------------------------------------------------------
 
-SplashXPath::SplashXPath(const SplashPath &path, const std::array<double, 6> &matrix, double flatness, bool closeSubpaths, bool adjustLines, int linePosI)
+SplashXPath::SplashXPath(const SplashPath &path, const std::array<double, 6> &matrix, double flatness, bool closeSubpaths, bool adjustLines, int linePosI, bool exactAdjust)
 {
     SplashPathHint *hint;
     SplashXPathPoint *pts;
@@ -139,7 +139,7 @@ SplashXPath::SplashXPath(const SplashPath &path, const std::array<double, 6> &ma
                     }
                 }
                 adjusts[i].x0 = x0;
-                adjusts[i].x1 = x1 - 0.01;
+                adjusts[i].x1 = exactAdjust ? x1 : x1 - 0.01;
                 adjusts[i].xm = 0.5 * (adjusts[i].x0 + adjusts[i].x1);
                 adjusts[i].firstPt = hint->firstPt;
                 adjusts[i].lastPt = hint->lastPt;
@@ -62,8 +62,10 @@ public:
     // Expands (converts to segments) and flattens (converts curves to
     // lines) <path>.  Transforms all points from user space to device
     // space, via <matrix>.  If <closeSubpaths> is true, closes all open
-    // subpaths.
-    SplashXPath(const SplashPath &path, const std::array<double, 6> &matrix, double flatness, bool closeSubpaths, bool adjustLines = false, int linePosI = 0);
+    // subpaths.  Stroke adjustment moves the far edges of the adjusted
+    // segments just inside their pixels, for the supersampling, unless
+    // <exactAdjust> is true.
+    SplashXPath(const SplashPath &path, const std::array<double, 6> &matrix, double flatness, bool closeSubpaths, bool adjustLines = false, int linePosI = 0, bool exactAdjust = false);
 
     ~SplashXPath();
 
@@ -93,6 +95,7 @@ protected:
     std::unique_ptr<CurveData> curveData;
 
     friend class SplashXPathScanner;
+    friend class SplashXPathCoverageScanner;
     friend class SplashClip;
     friend class Splash;
 };
@@ -0,0 +1,217 @@
+//========================================================================
+//
+// SplashXPathCoverageScanner.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "goo/GooLikely.h"
+#include "SplashMath.h"
+#include "SplashXPathCoverageScanner.h"
+
+//------------------------------------------------------------------------
+// SplashXPathCoverageScanner
+//------------------------------------------------------------------------
+
+SplashXPathCoverageScanner::SplashXPathCoverageScanner(const SplashXPath &xPath, bool eoA, int clipYMin, int clipYMax) //
+    : eo(eoA)
+{
+    // compute the bbox
+    if (xPath.length == 0) {
+        return;
+    }
+    if (clipYMin > clipYMax) {
+        return;
+    }
+
+    double xMaxFP = std::numeric_limits<double>::lowest();
+    double xMinFP = std::numeric_limits<double>::max();
+    double yMaxFP = std::numeric_limits<double>::lowest();
+    double yMinFP = std::numeric_limits<double>::max();
+
+    const double clipYMinFP = clipYMin;
+    const double clipYMaxFP = clipYMax + 1.0;
+
+    for (int i = 0; i < xPath.length; ++i) {
+        const SplashXPathSeg &seg = xPath.segs[i];
+        if (unlikely(std::isnan(seg.x0) || std::isnan(seg.x1) || std::isnan(seg.y0) || std::isnan(seg.y1))) {
+            return;
+        }
+        if (seg.y0 >= clipYMaxFP || seg.y1 < clipYMinFP) {
+            continue;
+        }
+        yMinFP = std::min(yMinFP, seg.y0);
+        yMaxFP = std::max(yMaxFP, seg.y1);
+        xMinFP = std::min({ xMinFP, seg.x0, seg.x1 });
+        xMaxFP = std::max({ xMaxFP, seg.x0, seg.x1 });
+    }
+    if (yMinFP > yMaxFP) {
+        return;
+    }
+
+    xMin = splashFloor(xMinFP);
+    xMax = splashFloor(xMaxFP);
+    yMin = std::max(splashFloor(yMinFP), clipYMin);
+    yMax = std::min(splashFloor(yMaxFP), clipYMax);
+    if (yMin > yMax || xMin > xMax) {
+        // This means the splashFloors overflowed/underflowed
+        xMin = yMin = 1;
+        xMax = yMax = 0;
+        return;
+    }
+
+    // bucket the segments by scanline: count the segments crossing each
+    // scanline, then fill in their indices; horizontal segments don't
+    // cover any area
+    rowStart.assign(yMax - yMin + 2, 0);
+    for (int i = 0; i < xPath.length; ++i) {
+        const SplashXPathSeg &seg = xPath.segs[i];
+        if ((seg.flags & splashXPathHoriz) || seg.y0 >= clipYMaxFP || seg.y1 < clipYMinFP) {
+            continue;
+        }
+        const int y0 = std::max(splashFloor(seg.y0), yMin);
+        const int y1 = std::min(splashFloor(seg.y1), yMax);
+        for (int y = y0; y <= y1; ++y) {
+            ++rowStart[y - yMin + 1];
+        }
+        segs.push_back(seg);
+    }
+    for (size_t i = 1; i < rowStart.size(); ++i) {
+        rowStart[i] += rowStart[i - 1];
+    }
+    rowSegs.resize(rowStart.back());
+    std::vector<int> rowFill(rowStart.begin(), rowStart.end() - 1);
+    for (size_t idx = 0; idx < segs.size(); ++idx) {
+        const int y0 = std::max(splashFloor(segs[idx].y0), yMin);
+        const int y1 = std::min(splashFloor(segs[idx].y1), yMax);
+        for (int y = y0; y <= y1; ++y) {
+            rowSegs[rowFill[y - yMin]++] = idx;
+        }
+    }
+}
+
+SplashXPathCoverageScanner::~SplashXPathCoverageScanner() = default;
+
+// Adds the signed area between <seg>, restricted to scanline <y>, and
+// the right edge of the scanline to areaBuf.  Summing areaBuf from the
+// left then gives the covered area of each pixel.
+void SplashXPathCoverageScanner::accumulateSegment(const SplashXPathSeg &seg, int y)
+{
+    const double ya = std::max(seg.y0, static_cast<double>(y));
+    const double yb = std::min(seg.y1, static_cast<double>(y) + 1);
+    if (ya >= yb) {
+        return;
+    }
+
+    double xa, xb;
+    if (seg.flags & splashXPathVert) {
+        xa = xb = seg.x0;
+    } else {
+        const double segXMin = std::min(seg.x0, seg.x1);
+        const double segXMax = std::max(seg.x0, seg.x1);
+        xa = std::clamp(seg.x0 + (ya - seg.y0) * seg.dxdy, segXMin, segXMax);
+        xb = std::clamp(seg.x0 + (yb - seg.y0) * seg.dxdy, segXMin, segXMax);
+    }
+    const double width = xMax - xMin + 1;
+    xa = std::clamp(xa - xMin, 0.0, width);
+    xb = std::clamp(xb - xMin, 0.0, width);
+
+    const double d = (seg.flags & splashXPathFlipped) ? yb - ya : ya - yb;
+    const double x0 = std::min(xa, xb);
+    const double x1 = std::max(xa, xb);
+    const double x0Floor = std::floor(x0);
+    const double x1Ceil = std::ceil(x1);
+    const int x0i = static_cast<int>(x0Floor);
+    const int x1i = static_cast<int>(x1Ceil);
+    float *a = areaBuf.data();
+
+    if (x1i <= x0i + 1) {
+        // the segment stays within one pixel
+        const double xmf = 0.5 * (xa + xb) - x0Floor;
+        a[x0i] += static_cast<float>(d - d * xmf);
+        a[x0i + 1] += static_cast<float>(d * xmf);
+    } else {
+        const double s = 1 / (x1 - x0);
+        const double x0f = x0 - x0Floor;
+        const double a0 = 0.5 * s * (1 - x0f) * (1 - x0f);
+        const double x1f = x1 - x1Ceil + 1;
+        const double am = 0.5 * s * x1f * x1f;
+        a[x0i] += static_cast<float>(d * a0);
+        if (x1i == x0i + 2) {
+            a[x0i + 1] += static_cast<float>(d * (1 - a0 - am));
+        } else {
+            const double a1 = s * (1.5 - x0f);
+            a[x0i + 1] += static_cast<float>(d * (a1 - a0));
+            for (int xi = x0i + 2; xi < x1i - 1; ++xi) {
+                a[xi] += static_cast<float>(d * s);
+            }
+            const double a2 = a1 + (x1i - x0i - 3) * s;
+            a[x1i - 1] += static_cast<float>(d * (1 - a2 - am));
+        }
+        a[x1i] += static_cast<float>(d * am);
+    }
+}
+
+unsigned char *SplashXPathCoverageScanner::renderCoverageLine(int y, int *x0, int *x1)
+{
+    if (y < yMin || y > yMax || rowStart[y - yMin] == rowStart[y - yMin + 1]) {
+        return nullptr;
+    }
+
+    // the buffers are only allocated here, so that callers can check the
+    // bbox against the clip region before paying for them
+    if (areaBuf.empty()) {
+        areaBuf.resize(xMax - xMin + 3, 0.0f);
+        coverageBuf.resize(xMax - xMin + 1);
+    }
+
+    int cellMin = xMax - xMin + 2;
+    int cellMax = 0;
+    for (int i = rowStart[y - yMin]; i < rowStart[y - yMin + 1]; ++i) {
+        const SplashXPathSeg &seg = segs[rowSegs[i]];
+        accumulateSegment(seg, y);
+        cellMin = std::min(cellMin, std::max(splashFloor(std::min(seg.x0, seg.x1)) - xMin, 0));
+        cellMax = std::max(cellMax, std::min(splashFloor(std::max(seg.x0, seg.x1)) - xMin + 2, xMax - xMin + 2));
+    }
+
+    // integrate the area deltas, clearing areaBuf for the next line
+    int first = -1, last = -1;
+    float acc = 0;
+    for (int i = cellMin; i <= cellMax; ++i) {
+        acc += areaBuf[i];
+        areaBuf[i] = 0;
+        if (i > xMax - xMin) {
+            continue;
+        }
+        float cov = std::fabs(acc);
+        if (eo) {
+            cov = std::fmod(cov, 2.0f);
+            if (cov > 1) {
+                cov = 2 - cov;
+            }
+        } else if (cov > 1) {
+            cov = 1;
+        }
+        const auto c = static_cast<unsigned char>(cov * 255 + 0.5f);
+        coverageBuf[i] = c;
+        if (c) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    if (first < 0) {
+        return nullptr;
+    }
+
+    *x0 = xMin + first;
+    *x1 = xMin + last;
+    return coverageBuf.data() + first;
+}
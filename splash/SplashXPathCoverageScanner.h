@@ -0,0 +1,77 @@
+//========================================================================
+//
+// SplashXPathCoverageScanner.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHXPATHCOVERAGESCANNER_H
+#define SPLASHXPATHCOVERAGESCANNER_H
+
+#include <vector>
+
+#include "SplashXPath.h"
+
+//------------------------------------------------------------------------
+// SplashXPathCoverageScanner
+//
+// Anti-aliasing scanline rasterizer that computes the exact area of each
+// pixel covered by the path, by accumulating the signed area under every
+// segment and integrating it along the scanline (the technique used by
+// font rasterizers).  This gives 256 coverage levels per pixel and works
+// on the unscaled path, unlike the 4x4 supersampling done through
+// SplashXPathScanner::renderAALine.
+//
+// Coverage is derived from the accumulated winding: the nonzero rule
+// clamps its absolute value to 1, the even-odd rule folds it into [0, 1].
+// This matches the fill rules exactly where a pixel isn't crossed by
+// overlapping edges.
+//------------------------------------------------------------------------
+
+class SplashXPathCoverageScanner
+{
+public:
+    // Create a new SplashXPathCoverageScanner object.  <xPath> must be
+    // sorted and must not have been scaled with SplashXPath::aaScale.
+    SplashXPathCoverageScanner(const SplashXPath &xPath, bool eoA, int clipYMin, int clipYMax);
+
+    ~SplashXPathCoverageScanner();
+
+    SplashXPathCoverageScanner(const SplashXPathCoverageScanner &) = delete;
+    SplashXPathCoverageScanner &operator=(const SplashXPathCoverageScanner &) = delete;
+
+    // Return the path's bounding box.
+    void getBBox(int *xMinA, int *yMinA, int *xMaxA, int *yMaxA) const
+    {
+        *xMinA = xMin;
+        *yMinA = yMin;
+        *xMaxA = xMax;
+        *yMaxA = yMax;
+    }
+
+    // Renders the coverage of scanline <y>.  Returns the min and max x
+    // coordinates with non-zero coverage in <x0> and <x1>, and a pointer
+    // to the coverage values (0-255) of [<x0>,<x1>].  The returned buffer
+    // is owned by the scanner and may be modified by the caller until the
+    // next call.  Returns nullptr if the scanline is empty.
+    unsigned char *renderCoverageLine(int y, int *x0, int *x1);
+
+private:
+    void accumulateSegment(const SplashXPathSeg &seg, int y);
+
+    const bool eo;
+    int xMin = 1, yMin = 1, xMax = 0, yMax = 0;
+
+    // the non-horizontal segments, and the indices of the ones crossing
+    // scanline y in rowSegs[rowStart[y - yMin], rowStart[y - yMin + 1])
+    std::vector<SplashXPathSeg> segs;
+    std::vector<int> rowStart;
+    std::vector<int> rowSegs;
+
+    // signed area deltas and coverage values for [xMin, xMax + 2]
+    std::vector<float> areaBuf;
+    std::vector<unsigned char> coverageBuf;
+};
+
+#endif
@@ -0,0 +1,114 @@
+//========================================================================
+//
+// display-list-test.cc
+// Checks that playing back a DisplayList gives the same output as
+// displaying the page directly.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "DisplayListOutputDev.h"
+#include "GlobalParams.h"
+#include "SplashOutputDev.h"
+#include "TextOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "test-pdf-utils.h"
+
+static std::vector<unsigned char> bitmapPixels(SplashOutputDev *out)
+{
+    SplashBitmap *bitmap = out->getBitmap();
+    std::vector<unsigned char> pixels;
+    for (int y = 0; y < bitmap->getHeight(); ++y) {
+        const unsigned char *row = bitmap->getDataPtr() + y * bitmap->getRowSize();
+        pixels.insert(pixels.end(), row, row + 3 * bitmap->getWidth());
+    }
+    return pixels;
+}
+
+static std::vector<unsigned char> renderPage(PDFDoc *doc, const DisplayList *list, double dpi)
+{
+    SplashColor paperColor = { 0xff, 0xff, 0xff };
+    SplashOutputDev out(splashModeRGB8, 4, paperColor);
+    out.setVectorAntialias(true);
+    out.startDoc(doc);
+    if (list) {
+        list->display(&out, dpi, dpi, 0, false, false, false);
+    } else {
+        doc->displayPage(&out, 1, dpi, dpi, 0, false, false, false);
+    }
+    return bitmapPixels(&out);
+}
+
+static std::string extractText(PDFDoc *doc, const DisplayList *list)
+{
+    TextOutputDev out(nullptr, false, 0, false, false);
+    if (list) {
+        list->display(&out, 72, 72, 0, false, false, false);
+    } else {
+        doc->displayPage(&out, 1, 72, 72, 0, false, false, false);
+    }
+    return out.getText(std::nullopt).toStr();
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    // fills, a dashed stroke, a clip, transparency, Type 3 text (a cached
+    // d1 glyph and a colored d0 one) and images with a soft mask and an
+    // explicit mask
+    const std::string content = "q 1 0 0 rg 10 10 100 50 re f Q\n"
+                                "q 0 0 1 RG 4 w [6 3] 0 d 20 80 m 180 120 l S Q\n"
+                                "q /G1 gs 0 0.6 0 rg 50 50 80 80 re f Q\n"
+                                "q 30 150 40 40 re W n 0.5 g 0 140 200 60 re f Q\n"
+                                "BT /F1 40 Tf 1 0 0 1 20 20 Tm 0.2 g (AB) Tj 0 40 Td 2 Tc (BA) Tj ET\n"
+                                "q 60 0 0 60 120 120 cm /Im1 Do Q\n"
+                                "q 40 0 0 40 10 100 cm /Im2 Do Q\n";
+    auto doc = openTestPage(200, 200, "<< /Font << /F1 5 0 R >> /ExtGState << /G1 << /ca 0.5 >> >> /XObject << /Im1 8 0 R /Im2 10 0 R >> >>", content,
+                            { "<< /Type /Font /Subtype /Type3 /FontBBox [0 0 1000 1000] /FontMatrix [0.001 0 0 0.001 0 0] /CharProcs << /A 6 0 R /B 7 0 R >> "
+                              "/Encoding << /Type /Encoding /Differences [65 /A /B] >> /FirstChar 65 /LastChar 66 /Widths [1000 1000] /Resources << >> >>",
+                              testStreamObject("", "1000 0 0 0 1000 1000 d1 100 0 m 500 1000 l 900 0 l h f"), testStreamObject("", "1000 0 d0 1 0 0 rg 100 100 800 800 re f"),
+                              testStreamObject("/Type /XObject /Subtype /Image /Width 2 /Height 2 /ColorSpace /DeviceRGB /BitsPerComponent 8 /Filter /ASCIIHexDecode /SMask 9 0 R", "FF000000FF000000FFFFFF00>"),
+                              testStreamObject("/Type /XObject /Subtype /Image /Width 2 /Height 2 /ColorSpace /DeviceGray /BitsPerComponent 8 /Filter /ASCIIHexDecode", "FF804000>"),
+                              testStreamObject("/Type /XObject /Subtype /Image /Width 2 /Height 2 /ColorSpace /DeviceRGB /BitsPerComponent 8 /Filter /ASCIIHexDecode /Mask 11 0 R", "00FFFFFF00FFFFFF00808080>"),
+                              testStreamObject("/Type /XObject /Subtype /Image /Width 2 /Height 2 /ImageMask true /BitsPerComponent 1 /Filter /ASCIIHexDecode", "4080>") });
+    if (!doc->isOk()) {
+        fprintf(stderr, "FAIL: cannot open the test document\n");
+        return 1;
+    }
+
+    DisplayListOutputDev recorder;
+    doc->displayPage(&recorder, 1, 72, 72, 0, false, false, false);
+    const std::unique_ptr<DisplayList> list = recorder.takeDisplayList();
+    check(list && list->getLength() > 0, "page recorded");
+    if (!list) {
+        return 1;
+    }
+
+    check(renderPage(doc.get(), list.get(), 72) == renderPage(doc.get(), nullptr, 72), "playback at the resolution of the recording");
+
+    // the transform to another resolution may move a few edges by rounding
+    const std::vector<unsigned char> direct = renderPage(doc.get(), nullptr, 150);
+    const std::vector<unsigned char> played = renderPage(doc.get(), list.get(), 150);
+    check(direct.size() == played.size(), "playback size at another resolution");
+    if (direct.size() == played.size()) {
+        int maxDiff = 0;
+        for (size_t i = 0; i < direct.size(); ++i) {
+            maxDiff = std::max(maxDiff, std::abs(direct[i] - played[i]));
+        }
+        check(maxDiff <= 8, "playback at another resolution");
+    }
+
+    const std::string text = extractText(doc.get(), nullptr);
+    check(text.find("AB") != std::string::npos, "Type 3 text extracted");
+    check(extractText(doc.get(), list.get()) == text, "Type 3 text extracted from the playback");
+
+    return testExitCode("display-list-test");
+}
@@ -0,0 +1,124 @@
+//========================================================================
+//
+// function-batch-test.cc
+// Checks that Function::transformBatch gives the results of transform,
+// bit for bit, for the sampled, exponential and stitching functions that
+// have batches of their own, including for inputs out of their domains
+// and NaN.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+#include "GlobalParams.h"
+#include "test-pdf-utils.h"
+
+struct FunctionCase
+{
+    const char *name;
+    std::vector<std::string> objects; // the function is object 2
+};
+
+// 8-bit samples of <nOutputs> outputs, <nSamples> of them.
+static std::string samples(int nSamples, int nOutputs)
+{
+    std::string data;
+    for (int i = 0; i < nSamples * nOutputs; ++i) {
+        data.push_back(static_cast<char>((i * 97 + 13) % 256));
+    }
+    return data;
+}
+
+static const std::string exponential = "<< /FunctionType 2 /Domain [0 1] /C0 [0 0.2 1] /C1 [1 0.7 0] /N 2.2 >>";
+
+static const FunctionCase functionCases[] = {
+    { "sampled", { testStreamObject("/FunctionType 0 /Domain [0 1] /Range [0 1 0 1 0 1] /Size [7] /BitsPerSample 8", samples(7, 3)) } },
+    { "sampled with Encode and Decode", { testStreamObject("/FunctionType 0 /Domain [-2 3] /Range [-1 1 0 0.5] /Size [9] /BitsPerSample 8 /Encode [8 1] /Decode [1 -1 -0.5 1]", samples(9, 2)) } },
+    { "sampled with one sample", { testStreamObject("/FunctionType 0 /Domain [0 1] /Range [0 1 0 1] /Size [1] /BitsPerSample 8", samples(1, 2)) } },
+    { "linear exponential", { "<< /FunctionType 2 /Domain [-1 2] /C0 [0.1 0.9] /C1 [0.8 0.3] /N 1 >>" } },
+    { "exponential", { exponential } },
+    { "exponential with Range", { "<< /FunctionType 2 /Domain [0 4] /Range [0 1 -1 0.5] /C0 [0 -2] /C1 [0.4 1] /N 0.5 >>" } },
+    { "stitching",
+      { "<< /FunctionType 3 /Domain [-1 2] /Bounds [0 0.5] /Encode [0 1 1 0 0 1] /Functions [ " + exponential + " 3 0 R << /FunctionType 2 /Domain [0 1] /C0 [1 1 1] /C1 [0 0 0] /N 1 >> ] >>",
+        testStreamObject("/FunctionType 0 /Domain [0 1] /Range [0 1 0 1 0 1] /Size [5] /BitsPerSample 8", samples(5, 3)) } },
+    { "nested stitching", { "<< /FunctionType 3 /Domain [0 1] /Bounds [0.25] /Encode [1 0 0 1] /Functions [ 3 0 R " + exponential + " ] >>", "<< /FunctionType 3 /Domain [0 1] /Bounds [0.6] /Encode [0 1 0 1] /Functions [ " + exponential + " " + exponential + " ] >>" } },
+};
+
+// Inputs through and beyond the domain, on and off the sample points,
+// with the domain ends, infinities and NaN.
+static std::vector<double> testInputs(double x0, double x1)
+{
+    std::vector<double> inputs;
+    for (int i = -200; i <= 1200; ++i) {
+        inputs.push_back(x0 + (x1 - x0) * i / 1000.0);
+        inputs.push_back(x0 + (x1 - x0) * (i + 0.37) / 1000.0);
+    }
+    for (double x : { x0, x1, std::nextafter(x0, x1), std::nextafter(x1, x0), -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN() }) {
+        inputs.insert(inputs.begin() + 100, x);
+        inputs.push_back(x);
+    }
+    return inputs;
+}
+
+static void checkBatch(const FunctionCase &testCase)
+{
+    std::vector<std::string> objects = { "<< /Type /Catalog >>" };
+    objects.insert(objects.end(), testCase.objects.begin(), testCase.objects.end());
+    TestPdfDoc doc = openTestPdf(objects);
+    Object funcObj = doc->getXRef()->fetch(2, 0);
+    const std::unique_ptr<Function> func = Function::parse(&funcObj);
+    if (!func || !func->isOk()) {
+        fprintf(stderr, "%s: not parsed\n", testCase.name);
+        check(false, "function parsed");
+        return;
+    }
+
+    const int n = func->getOutputSize();
+    const std::vector<double> inputs = testInputs(func->getDomainMin(0), func->getDomainMax(0));
+    std::vector<double> expected(inputs.size() * n);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        func->transform(&inputs[i], &expected[i * n]);
+    }
+
+    // the whole batch, and batches of sizes around the chunks
+    bool same = true;
+    for (int batchSize : { static_cast<int>(inputs.size()), 1, 3, 63, 64, 65, 130 }) {
+        std::vector<double> out(inputs.size() * n);
+        for (size_t start = 0; start < inputs.size(); start += batchSize) {
+            const int count = static_cast<int>(std::min(inputs.size() - start, static_cast<size_t>(batchSize)));
+            func->transformBatch(&inputs[start], &out[start * n], count);
+        }
+        if (memcmp(out.data(), expected.data(), out.size() * sizeof(double)) != 0) {
+            for (size_t i = 0; i < out.size(); ++i) {
+                if (memcmp(&out[i], &expected[i], sizeof(double)) != 0) {
+                    fprintf(stderr, "%s, batches of %d: %g gives %g, not %g\n", testCase.name, batchSize, inputs[i / n], out[i], expected[i]);
+                    break;
+                }
+            }
+            same = false;
+        }
+    }
+    check(same, "batches match transform");
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    for (const FunctionCase &testCase : functionCases) {
+        checkBatch(testCase);
+    }
+
+    return testExitCode("function-batch-test");
+}
@@ -0,0 +1,215 @@
+//========================================================================
+//
+// icc-lookup-table-test.cc
+// Checks GfxColorTransform::doLookupTransform against the LCMS transform
+// it samples: exact for one input channel, for the tables not asked for
+// and for the cached single colors, and within a few steps for the
+// interpolated RGB and CMYK ones.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <lcms2.h>
+
+#include "GfxState.h"
+#include "GlobalParams.h"
+#include "test-utils.h"
+
+// Largest errors allowed for the interpolated tables, in 8-bit steps:
+// for colors inside the output gamut, and for those clipped to it, where
+// the table smooths the clipping over a grid cell.
+static constexpr int maxLookupError = 4;
+static constexpr int maxClippedLookupError = 32;
+static constexpr double maxMeanLookupError = 0.5;
+
+struct LookupError
+{
+    int max = 0;
+    double mean = 0;
+};
+
+// Transforms <in> directly and through the table; the table is built by
+// the first call, which is larger than the grid.
+static LookupError compareLookup(GfxColorTransform *transform, const std::vector<unsigned char> &in, int nIn, int nOut)
+{
+    const unsigned int nPixels = in.size() / nIn;
+    std::vector<unsigned char> direct(nPixels * nOut), lookup(nPixels * nOut);
+    transform->doTransform(const_cast<unsigned char *>(in.data()), direct.data(), nPixels);
+    transform->doLookupTransform(in.data(), lookup.data(), nPixels);
+    transform->doLookupTransform(in.data(), lookup.data(), nPixels);
+
+    LookupError error;
+    long sum = 0;
+    for (size_t i = 0; i < direct.size(); ++i) {
+        const int diff = std::abs(direct[i] - lookup[i]);
+        error.max = std::max(error.max, diff);
+        sum += diff;
+    }
+    error.mean = static_cast<double>(sum) / direct.size();
+    return error;
+}
+
+// Every <step>th value of each of the <nIn> channels, including 255.
+static std::vector<unsigned char> gridPixels(int nIn, int step)
+{
+    std::vector<int> values;
+    for (int v = 0; v < 255; v += step) {
+        values.push_back(v);
+    }
+    values.push_back(255);
+
+    std::vector<unsigned char> pixels;
+    std::vector<size_t> idx(nIn, 0);
+    while (true) {
+        for (int c = 0; c < nIn; ++c) {
+            pixels.push_back(values[idx[c]]);
+        }
+        int c = nIn - 1;
+        while (c >= 0 && ++idx[c] == values.size()) {
+            idx[c--] = 0;
+        }
+        if (c < 0) {
+            return pixels;
+        }
+    }
+}
+
+// Pseudo-random pixels, which fall between the grid nodes.
+static std::vector<unsigned char> randomPixels(int nIn, unsigned int nPixels)
+{
+    std::vector<unsigned char> pixels(nPixels * nIn);
+    unsigned int seed = 12345;
+    for (unsigned char &p : pixels) {
+        seed = seed * 1103515245 + 12345;
+        p = static_cast<unsigned char>(seed >> 16);
+    }
+    return pixels;
+}
+
+// Whether transforming the colors of <in> one at a time, each several
+// times and from several threads at once, gives the LCMS results.
+static bool singleColorsExact(GfxColorTransform *transform, const std::vector<unsigned char> &in, int nIn, int nOut)
+{
+    const unsigned int nPixels = in.size() / nIn;
+    std::vector<unsigned char> direct(nPixels * nOut);
+    transform->doTransform(const_cast<unsigned char *>(in.data()), direct.data(), nPixels);
+
+    constexpr int nThreads = 4;
+    bool exact[nThreads];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&, t] {
+            exact[t] = true;
+            unsigned char out[4];
+            for (int pass = 0; pass < 3; ++pass) {
+                for (unsigned int i = 0; i < nPixels; ++i) {
+                    transform->doLookupTransform(in.data() + i * nIn, out, 1);
+                    exact[t] = exact[t] && std::equal(out, out + nOut, direct.data() + i * nOut);
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return std::all_of(exact, exact + nThreads, [](bool e) { return e; });
+}
+
+static std::unique_ptr<GfxColorTransform> makeTransform(cmsHPROFILE in, cmsUInt32Number inFormat, cmsHPROFILE out, cmsUInt32Number outFormat, unsigned int inPixelType, unsigned int outPixelType)
+{
+    cmsHTRANSFORM transform = cmsCreateTransform(in, inFormat, out, outFormat, INTENT_RELATIVE_COLORIMETRIC, 0);
+    if (!transform) {
+        return nullptr;
+    }
+    return std::make_unique<GfxColorTransform>(transform, INTENT_RELATIVE_COLORIMETRIC, inPixelType, outPixelType);
+}
+
+static void checkLookup(GfxColorTransform *transform, const std::vector<unsigned char> &in, int nIn, int nOut, int maxError, const char *name)
+{
+    if (!transform) {
+        check(false, name);
+        return;
+    }
+    const LookupError error = compareLookup(transform, in, nIn, nOut);
+    if (error.max > maxError || error.mean > maxMeanLookupError) {
+        fprintf(stderr, "%s: max error %d, mean %.3f\n", name, error.max, error.mean);
+    }
+    check(error.max <= maxError && error.mean <= maxMeanLookupError, name);
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    // an RGB space inside sRGB, and a wider one with a D50 white
+    const cmsCIExyY d65 = { 0.3127, 0.3290, 1 };
+    const cmsCIExyYTRIPLE narrowPrimaries = { { 0.60, 0.34, 1 }, { 0.31, 0.57, 1 }, { 0.16, 0.08, 1 } };
+    const cmsCIExyYTRIPLE widePrimaries = { { 0.64, 0.33, 1 }, { 0.21, 0.71, 1 }, { 0.15, 0.06, 1 } };
+    cmsToneCurve *gamma18 = cmsBuildGamma(nullptr, 1.8);
+    cmsToneCurve *rgbCurves[3] = { gamma18, gamma18, gamma18 };
+    cmsHPROFILE rgbProfile = cmsCreateRGBProfile(&d65, &narrowPrimaries, rgbCurves);
+    cmsHPROFILE wideRGBProfile = cmsCreateRGBProfile(cmsD50_xyY(), &widePrimaries, rgbCurves);
+    cmsHPROFILE grayProfile = cmsCreateGrayProfile(cmsD50_xyY(), gamma18);
+    cmsHPROFILE srgbProfile = cmsCreate_sRGBProfile();
+    // dot gain like curves
+    cmsToneCurve *cmykCurves[4] = { cmsBuildGamma(nullptr, 1.2), cmsBuildGamma(nullptr, 1.4), cmsBuildGamma(nullptr, 1.6), cmsBuildGamma(nullptr, 1.8) };
+    cmsHPROFILE cmykLink = cmsCreateLinearizationDeviceLink(cmsSigCmykData, cmykCurves);
+
+    // the direct table is exact, and used without asking for tables
+    {
+        auto gray = makeTransform(grayProfile, TYPE_GRAY_8, srgbProfile, TYPE_RGB_8, PT_GRAY, PT_RGB);
+        check(gray && compareLookup(gray.get(), gridPixels(1, 1), 1, 3).max == 0, "gray table is exact");
+    }
+
+    // the interpolated tables are only used if asked for
+    {
+        auto rgb = makeTransform(rgbProfile, TYPE_RGB_8, srgbProfile, TYPE_RGB_8, PT_RGB, PT_RGB);
+        check(rgb && compareLookup(rgb.get(), randomPixels(3, 100000), 3, 3).max == 0, "no RGB table by default");
+        auto cmyk = makeTransform(cmykLink, TYPE_CMYK_8, nullptr, TYPE_CMYK_8, PT_CMYK, PT_CMYK);
+        check(cmyk && compareLookup(cmyk.get(), randomPixels(4, 100000), 4, 4).max == 0, "no CMYK table by default");
+    }
+
+    // single colors are cached, including more colors than the cache holds
+    {
+        auto rgb = makeTransform(rgbProfile, TYPE_RGB_8, srgbProfile, TYPE_RGB_8, PT_RGB, PT_RGB);
+        check(rgb && singleColorsExact(rgb.get(), randomPixels(3, 3000), 3, 3), "cached RGB colors are exact");
+        auto cmyk = makeTransform(cmykLink, TYPE_CMYK_8, nullptr, TYPE_CMYK_8, PT_CMYK, PT_CMYK);
+        check(cmyk && singleColorsExact(cmyk.get(), randomPixels(4, 500), 4, 4), "cached CMYK colors are exact");
+    }
+
+    globalParams->setICCLookupTables(true);
+    {
+        auto rgb = makeTransform(rgbProfile, TYPE_RGB_8, srgbProfile, TYPE_RGB_8, PT_RGB, PT_RGB);
+        checkLookup(rgb.get(), gridPixels(3, 3), 3, 3, maxLookupError, "RGB table on a grid");
+        checkLookup(rgb.get(), randomPixels(3, 300000), 3, 3, maxLookupError, "RGB table on random pixels");
+        auto wideRGB = makeTransform(wideRGBProfile, TYPE_RGB_8, srgbProfile, TYPE_RGB_8, PT_RGB, PT_RGB);
+        checkLookup(wideRGB.get(), gridPixels(3, 3), 3, 3, maxClippedLookupError, "clipped RGB table on a grid");
+        checkLookup(wideRGB.get(), randomPixels(3, 300000), 3, 3, maxClippedLookupError, "clipped RGB table on random pixels");
+        auto gray = makeTransform(grayProfile, TYPE_GRAY_8, srgbProfile, TYPE_RGB_8, PT_GRAY, PT_RGB);
+        check(gray && compareLookup(gray.get(), gridPixels(1, 1), 1, 3).max == 0, "gray table is still exact");
+        auto cmyk = makeTransform(cmykLink, TYPE_CMYK_8, nullptr, TYPE_CMYK_8, PT_CMYK, PT_CMYK);
+        checkLookup(cmyk.get(), gridPixels(4, 7), 4, 4, maxLookupError, "CMYK table on a grid");
+        checkLookup(cmyk.get(), randomPixels(4, 300000), 4, 4, maxLookupError, "CMYK table on random pixels");
+    }
+
+    cmsCloseProfile(cmykLink);
+    for (cmsToneCurve *curve : cmykCurves) {
+        cmsFreeToneCurve(curve);
+    }
+    cmsCloseProfile(srgbProfile);
+    cmsCloseProfile(grayProfile);
+    cmsCloseProfile(wideRGBProfile);
+    cmsCloseProfile(rgbProfile);
+    cmsFreeToneCurve(gamma18);
+
+    return testExitCode("icc-lookup-table-test");
+}
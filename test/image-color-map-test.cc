@@ -0,0 +1,170 @@
+//========================================================================
+//
+// image-color-map-test.cc
+// Checks the line converters of GfxImageColorMap against converting the
+// pixels one at a time, for Indexed and Separation images, images with
+// fewer than 8 bits per component, and images with Decode arrays.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GfxState.h"
+#include "GlobalParams.h"
+#include "splash/SplashTypes.h"
+#include "test-pdf-utils.h"
+
+struct ColorMapCase
+{
+    const char *name;
+    std::string colorSpace;
+    int bits;
+    std::string decode; // empty for the default
+    // largest difference from the pixel by pixel conversion: the line
+    // converters of DeviceRGB compute gray with other weights, those of
+    // DeviceCMYK truncate RGB instead of rounding it, and the maps of
+    // several components with a Decode array round the pixels to bytes
+    int tolerance;
+};
+
+static const ColorMapCase colorMapCases[] = {
+    { "DeviceRGB", "/DeviceRGB", 8, "", 2 },
+    { "DeviceRGB with Decode", "/DeviceRGB", 8, "[1 0 0.2 0.8 0 1]", 2 },
+    { "4-bit DeviceCMYK", "/DeviceCMYK", 4, "", 1 },
+    { "2-bit DeviceCMYK with Decode", "/DeviceCMYK", 2, "[1 0 0 1 0 0.5 0.25 1]", 2 },
+    { "4-bit DeviceGray with Decode", "/DeviceGray", 4, "[1 0]", 0 },
+    { "1-bit DeviceGray", "/DeviceGray", 1, "", 0 },
+    { "Lab", "[/Lab << /WhitePoint [0.9505 1 1.089] /Range [-100 100 -100 100] >>]", 8, "", 0 },
+    { "Indexed", "[/Indexed /DeviceRGB 3 <ff000000ff000000ff808080>]", 8, "", 0 },
+    { "2-bit Indexed", "[/Indexed /DeviceCMYK 3 <ff00000000ff00000000ff00000000ff>]", 2, "", 0 },
+    { "4-bit Indexed with Decode", "[/Indexed /DeviceRGB 1 <000000ffffff>]", 4, "[0 3]", 0 },
+    { "Separation", "[/Separation /Spot /DeviceCMYK << /FunctionType 2 /Domain [0 1] /C0 [0 0 0 0] /C1 [0.1 0.9 0.4 0.05] /N 1 >>]", 8, "", 0 },
+    { "4-bit Separation with Decode", "[/Separation /Spot /DeviceRGB << /FunctionType 2 /Domain [0 1] /C0 [1 1 1] /C1 [0 0.5 0.2] /N 2 >>]", 4, "[1 0]", 0 },
+};
+
+// Pixels of <nComps> components taking all the values of <bits> bits.
+static std::vector<unsigned char> testPixels(int nComps, int bits, int nPixels)
+{
+    const int maxPixel = (1 << std::min(bits, 8)) - 1;
+    std::vector<unsigned char> pixels(static_cast<size_t>(nPixels) * nComps);
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        // every value of the first component, then random ones
+        pixels[i] = static_cast<unsigned char>(i < static_cast<size_t>(maxPixel + 1) * nComps ? i / nComps : (seed >> 16) % (maxPixel + 1));
+    }
+    return pixels;
+}
+
+static int maxDiff(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b)
+{
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+static void checkColorMap(const ColorMapCase &testCase)
+{
+    std::vector<std::string> objects = { "<< /Type /Catalog >>", testCase.colorSpace };
+    if (!testCase.decode.empty()) {
+        objects.push_back(testCase.decode);
+    }
+    TestPdfDoc doc = openTestPdf(objects);
+    Object csObj = doc->getXRef()->fetch(2, 0);
+    Object decodeObj = testCase.decode.empty() ? Object::null() : doc->getXRef()->fetch(3, 0);
+    // the device color spaces are looked up in the state
+    const PDFRectangle box(0, 0, 100, 100);
+    GfxState state(72, 72, &box, 0, true);
+    std::unique_ptr<GfxColorSpace> colorSpace = GfxColorSpace::parse(nullptr, &csObj, nullptr, &state);
+    if (!colorSpace) {
+        fprintf(stderr, "%s: color space not parsed\n", testCase.name);
+        check(false, "color space parsed");
+        return;
+    }
+    GfxImageColorMap colorMap(testCase.bits, &decodeObj, std::move(colorSpace));
+    check(colorMap.isOk(), "color map set up");
+    if (!colorMap.isOk()) {
+        return;
+    }
+
+    constexpr int nPixels = 1000;
+    const int nComps = colorMap.getNumPixelComps();
+    const std::vector<unsigned char> pixels = testPixels(nComps, testCase.bits, nPixels);
+
+    // one pixel at a time
+    std::vector<unsigned char> gray, rgb, cmyk, deviceN;
+    std::vector<unsigned int> rgbPacked;
+    for (int i = 0; i < nPixels; ++i) {
+        const unsigned char *pixel = &pixels[static_cast<size_t>(i) * nComps];
+        GfxGray g;
+        colorMap.getGray(pixel, &g);
+        gray.push_back(colToByte(g));
+        GfxRGB c;
+        colorMap.getRGB(pixel, &c);
+        rgb.insert(rgb.end(), { colToByte(c.r), colToByte(c.g), colToByte(c.b) });
+        rgbPacked.push_back((colToByte(c.r) << 16) | (colToByte(c.g) << 8) | colToByte(c.b));
+        GfxCMYK k;
+        colorMap.getCMYK(pixel, &k);
+        cmyk.insert(cmyk.end(), { colToByte(k.c), colToByte(k.m), colToByte(k.y), colToByte(k.k) });
+        GfxColor n;
+        colorMap.getDeviceN(pixel, &n);
+        for (int j = 0; j < SPOT_NCOMPS + 4; ++j) {
+            deviceN.push_back(colToByte(n.c[j]));
+        }
+    }
+
+    // a line at a time; the converters may change their input
+    std::vector<unsigned char> in;
+    std::vector<unsigned char> grayLine(nPixels), rgbLine(3 * nPixels), rgbxLine(4 * nPixels), cmykLine(4 * nPixels), deviceNLine((SPOT_NCOMPS + 4) * nPixels);
+    std::vector<unsigned int> rgbPackedLine(nPixels);
+    in = pixels;
+    colorMap.getGrayLine(in.data(), grayLine.data(), nPixels);
+    in = pixels;
+    colorMap.getRGBLine(in.data(), rgbLine.data(), nPixels);
+    in = pixels;
+    colorMap.getRGBLine(in.data(), rgbPackedLine.data(), nPixels);
+    in = pixels;
+    colorMap.getRGBXLine(in.data(), rgbxLine.data(), nPixels);
+    in = pixels;
+    colorMap.getCMYKLine(in.data(), cmykLine.data(), nPixels);
+    in = pixels;
+    colorMap.getDeviceNLine(in.data(), deviceNLine.data(), nPixels);
+
+    std::vector<unsigned char> rgbFromRGBX, rgbFromPacked;
+    bool opaque = true;
+    for (int i = 0; i < nPixels; ++i) {
+        rgbFromRGBX.insert(rgbFromRGBX.end(), &rgbxLine[4 * i], &rgbxLine[4 * i + 3]);
+        opaque = opaque && rgbxLine[4 * i + 3] == 255;
+        const unsigned int p = rgbPackedLine[i];
+        rgbFromPacked.insert(rgbFromPacked.end(), { static_cast<unsigned char>(p >> 16), static_cast<unsigned char>(p >> 8), static_cast<unsigned char>(p) });
+    }
+
+    const int diffs[] = { maxDiff(gray, grayLine), maxDiff(rgb, rgbLine), maxDiff(rgb, rgbFromPacked), maxDiff(rgb, rgbFromRGBX), maxDiff(cmyk, cmykLine), maxDiff(deviceN, deviceNLine) };
+    const int diff = *std::max_element(std::begin(diffs), std::end(diffs));
+    if (diff > testCase.tolerance || !opaque) {
+        fprintf(stderr, "%s: max diff gray %d, RGB %d, packed RGB %d, RGBX %d, CMYK %d, DeviceN %d\n", testCase.name, diffs[0], diffs[1], diffs[2], diffs[3], diffs[4], diffs[5]);
+    }
+    check(diff <= testCase.tolerance, "line converters match the pixel by pixel ones");
+    check(opaque, "RGBX lines are opaque");
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    for (const ColorMapCase &testCase : colorMapCases) {
+        checkColorMap(testCase);
+    }
+
+    return testExitCode("image-color-map-test");
+}
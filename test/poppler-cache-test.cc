@@ -0,0 +1,102 @@
+//========================================================================
+//
+// poppler-cache-test.cc
+// Checks the eviction order, cost budget and counters of PopplerCache.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+
+#include "PopplerCache.h"
+#include "test-utils.h"
+
+static bool holds(PopplerCache<int, int> &cache, int key)
+{
+    const int *item = cache.lookup(key);
+    return item && *item == key * 10;
+}
+
+int main()
+{
+    // least recently used items go first
+    {
+        PopplerCache<int, int> cache(3);
+        for (int key = 1; key <= 3; ++key) {
+            cache.put(key, std::make_unique<int>(key * 10));
+        }
+        check(holds(cache, 1), "lookup of the oldest item");
+        cache.put(4, std::make_unique<int>(40));
+        check(cache.size() == 3, "size stays at the maximum cost");
+        check(holds(cache, 1), "recently used item kept");
+        check(!cache.lookup(2), "least recently used item evicted");
+        check(holds(cache, 3) && holds(cache, 4), "other items kept");
+        check(cache.getEvictions() == 1, "one eviction");
+        check(cache.getHits() == 4 && cache.getMisses() == 1, "hit and miss counters");
+    }
+
+    // putting an existing key replaces the item and refreshes it
+    {
+        PopplerCache<int, int> cache(2);
+        cache.put(1, std::make_unique<int>(1));
+        cache.put(2, std::make_unique<int>(20));
+        cache.put(1, std::make_unique<int>(10));
+        check(cache.size() == 2 && cache.getTotalCost() == 2, "replacing keeps the size");
+        cache.put(3, std::make_unique<int>(30));
+        check(holds(cache, 1) && !cache.lookup(2), "replaced item refreshed");
+    }
+
+    // cost budget
+    {
+        PopplerCache<int, int> cache(100);
+        cache.put(1, std::make_unique<int>(10), 40);
+        cache.put(2, std::make_unique<int>(20), 40);
+        check(cache.getTotalCost() == 80, "total cost");
+        cache.put(3, std::make_unique<int>(30), 30);
+        check(cache.size() == 2 && !cache.lookup(1), "oldest item evicted for the budget");
+        check(cache.getTotalCost() == 70, "total cost after eviction");
+
+        // an item above the budget evicts everything else but itself stays
+        cache.put(4, std::make_unique<int>(40), 500);
+        check(cache.size() == 1 && holds(cache, 4), "item above the budget kept");
+        check(cache.getTotalCost() == 500, "total cost of the item above the budget");
+        cache.put(5, std::make_unique<int>(50), 10);
+        check(cache.size() == 1 && holds(cache, 5) && !cache.lookup(4), "item above the budget evicted by the next put");
+    }
+
+    // shrinking and growing at runtime
+    {
+        PopplerCache<int, int> cache(8);
+        for (int key = 1; key <= 8; ++key) {
+            cache.put(key, std::make_unique<int>(key * 10));
+        }
+        check(holds(cache, 2), "lookup before shrinking");
+        cache.setMaxCost(3);
+        check(cache.getMaxCost() == 3 && cache.size() == 3, "setMaxCost trims");
+        check(holds(cache, 2) && holds(cache, 7) && holds(cache, 8), "setMaxCost keeps the most recently used items");
+        cache.setMaxCost(0);
+        check(cache.size() == 1, "setMaxCost(0) keeps the most recently used item");
+        cache.setMaxCost(16);
+        for (int key = 1; key <= 16; ++key) {
+            cache.put(key, std::make_unique<int>(key * 10));
+        }
+        check(cache.size() == 16 && holds(cache, 1), "grown cache holds more items");
+    }
+
+    // remove and clear
+    {
+        PopplerCache<int, int> cache(4);
+        cache.put(1, std::make_unique<int>(10), 2);
+        cache.put(2, std::make_unique<int>(20));
+        cache.remove(1);
+        cache.remove(3);
+        check(cache.size() == 1 && cache.getTotalCost() == 1 && !cache.lookup(1), "remove");
+        cache.clear();
+        check(cache.size() == 0 && cache.getTotalCost() == 0 && !cache.lookup(2), "clear");
+    }
+
+    return testExitCode("poppler-cache-test");
+}
@@ -0,0 +1,150 @@
+//========================================================================
+//
+// postscript-function-test.cc
+// Checks that compiled PostScript functions give the same results as the
+// interpreter, including the calls falling back to it, and that tables
+// are only used for functions they follow closely at the points checked.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+#include "GlobalParams.h"
+#include "test-pdf-utils.h"
+
+struct PSFunctionCase
+{
+    const char *name;
+    std::string domain;
+    std::string range;
+    std::string code;
+    bool compiled;
+};
+
+// Functions of two inputs, which never get a table.
+static const PSFunctionCase psFunctionCases[] = {
+    { "roll, index and copy", "[-2 2 -2 2]", "[-100 100 -100 100]", "{ 2 copy 3 1 roll 1 index add exch 2 index mul 4 1 roll pop pop 2 -1 roll dup 3 copy pop 5 -2 roll add add exch pop }", true },
+    { "nested ifelse", "[0 1 0 1]", "[0 10 0 10]", "{ 2 copy gt { exch pop 0.5 gt { 1 } { 2 } ifelse } { pop 0.25 lt { 3 } { 4 dup 2 idiv add } ifelse } ifelse dup 0.5 mul }", true },
+    { "ifelse in a known branch", "[0 1 0 1]", "[0 10 0 10]", "{ true { 2 copy lt { pop } { exch pop } ifelse } { pop } ifelse dup 3 mul }", true },
+    { "int and real promotion", "[-3 3 -3 3]", "[-100000 100000 -100000 100000]", "{ 100 mul cvi exch 100 mul cvi 2 copy mul 3 1 roll 7 mod add neg abs exch 1 add 2 div 3 cvr add }", true },
+    { "int overflow", "[-1 1 -1 1]", "[-10000000000 10000000000 -10000000000 10000000000]", "{ 2147483647 mul cvi exch 2 add cvi mul dup }", true },
+    { "idiv and mod by zero", "[-2 2 -2 2]", "[-100 100 -100 100]", "{ cvi exch cvi exch 2 copy idiv 3 1 roll mod }", true },
+    { "branches of different types", "[0 1 0 1]", "[0 10 0 10]", "{ gt { 1 } { 2.5 } ifelse dup }", false },
+};
+
+static std::unique_ptr<Function> parseFunction(const std::string &domain, const std::string &range, const std::string &code)
+{
+    TestPdfDoc doc = openTestPdf({ "<< /Type /Catalog >>", testStreamObject("/FunctionType 4 /Domain " + domain + " /Range " + range, code) });
+    Object funcObj = doc->getXRef()->fetch(2, 0);
+    return Function::parse(&funcObj);
+}
+
+static PostScriptFunction *asPostScript(const std::unique_ptr<Function> &func)
+{
+    if (!func || func->getType() != Function::Type::PostScript) {
+        return nullptr;
+    }
+    return static_cast<PostScriptFunction *>(func.get());
+}
+
+int main()
+{
+    // the overflow and division by zero cases make the interpreter complain
+    globalParams = std::make_unique<GlobalParams>();
+    globalParams->setErrQuiet(true);
+
+    // the compiled code gives the interpreter's results, bit for bit, on
+    // a grid of inputs going through zero, and on inputs off the grid
+    for (const PSFunctionCase &testCase : psFunctionCases) {
+        const auto func = parseFunction(testCase.domain, testCase.range, testCase.code);
+        PostScriptFunction *psFunc = asPostScript(func);
+        if (!psFunc || !psFunc->isOk()) {
+            fprintf(stderr, "%s: not parsed\n", testCase.name);
+            check(false, "function parsed");
+            continue;
+        }
+        if (psFunc->isCompiled() != testCase.compiled) {
+            fprintf(stderr, "%s: compiled %d\n", testCase.name, psFunc->isCompiled());
+        }
+        check(psFunc->isCompiled() == testCase.compiled, "functions compiled when expected");
+        check(!psFunc->hasLookupTable(), "no table for two inputs");
+
+        const double x0 = func->getDomainMin(0), x1 = func->getDomainMax(0);
+        const double y0 = func->getDomainMin(1), y1 = func->getDomainMax(1);
+        bool same = true;
+        for (int i = 0; i <= 40; ++i) {
+            for (int j = 0; j <= 40; ++j) {
+                for (double offset : { 0.0, 0.013 }) {
+                    const double in[2] = { std::min(x0 + (x1 - x0) * i / 40 + offset, x1), std::min(y0 + (y1 - y0) * j / 40 + offset, y1) };
+                    double compiled[2], interpreted[2];
+                    func->transform(in, compiled);
+                    psFunc->interpret(in, interpreted);
+                    if (compiled[0] != interpreted[0] || compiled[1] != interpreted[1]) {
+                        if (same) {
+                            fprintf(stderr, "%s: (%g, %g) gives %g %g, interpreted %g %g\n", testCase.name, in[0], in[1], compiled[0], compiled[1], interpreted[0], interpreted[1]);
+                        }
+                        same = false;
+                    }
+                }
+            }
+        }
+        check(same, "compiled functions match the interpreter");
+    }
+
+    // smooth one-input functions get a table, which stays close to them
+    {
+        const auto func = parseFunction("[0 1]", "[-1 1 0 1]", "{ dup 360 mul sin exch dup mul }");
+        PostScriptFunction *psFunc = asPostScript(func);
+        check(psFunc && psFunc->hasLookupTable(), "table for smooth functions");
+        double maxError = 0;
+        for (int i = 0; psFunc && i <= 100000; ++i) {
+            const double in = i / 100000.0;
+            double tabulated[2], interpreted[2];
+            func->transform(&in, tabulated);
+            psFunc->interpret(&in, interpreted);
+            maxError = std::max({ maxError, fabs(tabulated[0] - interpreted[0]) / 2, fabs(tabulated[1] - interpreted[1]) });
+        }
+        check(maxError <= 1e-4, "table close to smooth functions");
+    }
+
+    // steps, and bumps narrower than a table interval over one of the
+    // eighths of an interval checked, here 801/8192, leave the function
+    // without a table
+    {
+        const char *codes[] = { "{ 0.3 gt { 1 } { 0 } ifelse }", "{ 0.0977783203125 sub abs 0.000030517578125 lt { 1 } { 0 } ifelse }" };
+        const double points[] = { 0.3000001, 0.0977783203125 };
+        for (int i = 0; i < 2; ++i) {
+            const auto func = parseFunction("[0 1]", "[0 1]", codes[i]);
+            PostScriptFunction *psFunc = asPostScript(func);
+            check(psFunc && psFunc->isCompiled() && !psFunc->hasLookupTable(), "no table for discontinuous functions");
+            double out;
+            func->transform(&points[i], &out);
+            check(out == 1, "discontinuities kept");
+        }
+    }
+
+    // the same bump between two of the points checked, centered on
+    // 801.5/8192, isn't seen: the function gets a table, which loses it
+    {
+        const auto func = parseFunction("[0 1]", "[0 1]", "{ 0.09783935546875 sub abs 0.000030517578125 lt { 1 } { 0 } ifelse }");
+        PostScriptFunction *psFunc = asPostScript(func);
+        check(psFunc && psFunc->hasLookupTable(), "table for bumps between the points checked");
+        const double point = 0.09783935546875;
+        double tabulated, interpreted;
+        func->transform(&point, &tabulated);
+        psFunc->interpret(&point, &interpreted);
+        check(interpreted == 1 && tabulated == 0, "bumps between the points checked lost");
+    }
+
+    return testExitCode("postscript-function-test");
+}
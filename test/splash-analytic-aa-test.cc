@@ -0,0 +1,140 @@
+//========================================================================
+//
+// splash-analytic-aa-test.cc
+// Checks the coverage analytic anti-aliasing (pdftoppm -aaAnalytic) gives
+// simple fills, and that it also applies to Type 3 glyphs and tiling
+// patterns, which Splash draws into bitmaps of their own.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "test-pdf-utils.h"
+
+static std::vector<unsigned char> render(PDFDoc *doc, bool analytic)
+{
+    SplashColor paperColor = { 0xff, 0xff, 0xff };
+    SplashOutputDev out(splashModeRGB8, 4, paperColor);
+    out.setVectorAntialias(true);
+    out.setAnalyticAntialias(analytic);
+    out.startDoc(doc);
+    doc->displayPage(&out, 1, 72, 72, 0, false, false, false);
+    SplashBitmap *bitmap = out.getBitmap();
+    std::vector<unsigned char> pixels;
+    for (int y = 0; y < bitmap->getHeight(); ++y) {
+        const unsigned char *row = bitmap->getDataPtr() + y * bitmap->getRowSize();
+        pixels.insert(pixels.end(), row, row + 3 * bitmap->getWidth());
+    }
+    return pixels;
+}
+
+// The pages of the fill checks are 200 x 200 pixels at 72 dpi.
+static constexpr int pageSize = 200;
+
+static std::vector<unsigned char> renderFill(const std::string &content, bool analytic)
+{
+    auto doc = openTestPage(pageSize, pageSize, "<< >>", content);
+    check(doc->isOk(), "fill document");
+    return render(doc.get(), analytic);
+}
+
+// Red component of the pixel at (<x>, <y>), counted from the top left.
+static int red(const std::vector<unsigned char> &pixels, int x, int y)
+{
+    return pixels[3 * (static_cast<size_t>(y) * pageSize + x)];
+}
+
+// Analytic coverage differs from supersampling along the edges only; a
+// plain path fill already differs by up to ~90 there
+static void checkAnalytic(PDFDoc *doc, const char *what)
+{
+    const std::vector<unsigned char> supersampled = render(doc, false);
+    const std::vector<unsigned char> analytic = render(doc, true);
+    int differences = 0;
+    int maxDiff = 0;
+    for (size_t i = 0; i < supersampled.size(); ++i) {
+        const int diff = std::abs(supersampled[i] - analytic[i]);
+        differences += diff != 0;
+        maxDiff = std::max(maxDiff, diff);
+    }
+    if (differences == 0 || maxDiff > 128) {
+        fprintf(stderr, "%s: %d differences, max %d\n", what, differences, maxDiff);
+    }
+    check(differences != 0 && maxDiff <= 128, what);
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    // a black square on half pixel edges, from (10.5, 10.5) to (30.5, 30.5)
+    // on the page, covers half of its edge pixels and a quarter of its
+    // corner pixels, rows 169 to 189 from the top; the point in the middle
+    // of its left side keeps stroke adjustment from snapping it to pixels
+    {
+        // the coverage goes through the anti-aliasing gamma of 1.5
+        const int halfCovered = 255 - static_cast<int>(std::lround(std::pow(0.5, 1.5) * 255));
+        const int quarterCovered = 255 - static_cast<int>(std::lround(std::pow(0.25, 1.5) * 255));
+        const std::vector<unsigned char> pixels = renderFill("0 g 10.5 10.5 m 30.5 10.5 l 30.5 30.5 l 10.5 30.5 l 10.5 20 l h f", true);
+        const auto near = [](int value, int expected) { return std::abs(value - expected) <= 1; };
+        bool exact = true;
+        for (int i = 1; i < 20; ++i) {
+            exact = exact && near(red(pixels, 10, 169 + i), halfCovered) && near(red(pixels, 30, 169 + i), halfCovered);
+            exact = exact && near(red(pixels, 10 + i, 169), halfCovered) && near(red(pixels, 10 + i, 189), halfCovered);
+            exact = exact && red(pixels, 10 + i, 179) == 0 && red(pixels, 9, 169 + i) == 255 && red(pixels, 31, 169 + i) == 255;
+        }
+        exact = exact && near(red(pixels, 10, 169), quarterCovered) && near(red(pixels, 30, 189), quarterCovered);
+        if (!exact) {
+            fprintf(stderr, "half pixel square: edge %d, corner %d, inside %d\n", red(pixels, 10, 179), red(pixels, 10, 169), red(pixels, 20, 179));
+        }
+        check(exact, "half covered edge pixels");
+    }
+
+    // two overlapping squares drawn the same way round: the nonzero rule
+    // fills their overlap, the even-odd one leaves it empty
+    {
+        const std::string squares = "0 g 20 20 60 60 re 50 50 60 60 re ";
+        const std::vector<unsigned char> nonzero = renderFill(squares + "f", true);
+        const std::vector<unsigned char> evenOdd = renderFill(squares + "f*", true);
+        // (65, 65) is in the overlap, (30, 30) and (100, 100) in one square only
+        check(red(nonzero, 65, pageSize - 65) == 0 && red(evenOdd, 65, pageSize - 65) == 255, "overlap filled by nonzero only");
+        check(red(nonzero, 30, pageSize - 30) == 0 && red(evenOdd, 30, pageSize - 30) == 0, "first square filled by both rules");
+        check(red(nonzero, 100, pageSize - 100) == 0 && red(evenOdd, 100, pageSize - 100) == 0, "second square filled by both rules");
+    }
+
+    // rectangles on pixel edges, and those stroke adjustment moves there,
+    // fully cover their pixels or not at all, like with supersampling
+    {
+        const std::string content = "0 g 20 20 50 30 re f 20.3 80.2 50 29.6 re f";
+        check(renderFill(content, true) == renderFill(content, false), "pixel aligned fills match supersampling");
+    }
+
+    // the glyph is an uncolored (d1) slanted triangle, so it goes through
+    // the Type 3 glyph cache
+    const std::string glyph = "1000 0 0 0 1000 1000 d1 100 100 m 900 330 l 370 910 l h f";
+    auto type3Doc = openTestPage(200, 200, "<< /Font << /F1 5 0 R >> >>", "BT /F1 180 Tf 10 10 Td (A) Tj ET",
+                                 { "<< /Type /Font /Subtype /Type3 /FontBBox [0 0 1000 1000] /FontMatrix [0.001 0 0 0.001 0 0] /CharProcs << /g 6 0 R >> "
+                                   "/Encoding << /Type /Encoding /Differences [65 /g] >> /FirstChar 65 /LastChar 65 /Widths [1000] >>",
+                                   testStreamObject("", glyph) });
+    check(type3Doc->isOk(), "Type 3 document");
+    checkAnalytic(type3Doc.get(), "Type 3 glyph");
+
+    const std::string cell = "0 0 1 rg 5 5 m 35 12 l 20 37 l h f";
+    auto patternDoc = openTestPage(200, 200, "<< /Pattern << /P1 5 0 R >> >>", "/Pattern cs /P1 scn 0 0 200 200 re f",
+                                   { testStreamObject("/PatternType 1 /PaintType 1 /TilingType 1 /BBox [0 0 40 40] /XStep 40 /YStep 40 /Resources << >>", cell) });
+    check(patternDoc->isOk(), "pattern document");
+    checkAnalytic(patternDoc.get(), "tiling pattern");
+
+    return testExitCode("splash-analytic-aa-test");
+}
@@ -0,0 +1,191 @@
+//========================================================================
+//
+// splash-band-renderer-test.cc
+// Checks that SplashBandRenderer draws the same pixels as displaying the
+// page in one go, and that exceptions thrown by its callbacks reach the
+// caller.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "SplashBandRenderer.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "test-pdf-utils.h"
+
+static constexpr double dpi = 150;
+static constexpr int nThreads = 4;
+
+static std::unique_ptr<SplashOutputDev> makeOutputDev(PDFDoc *doc)
+{
+    SplashColor paperColor = { 0xff, 0xff, 0xff };
+    auto out = std::make_unique<SplashOutputDev>(splashModeRGB8, 4, paperColor);
+    out->setVectorAntialias(true);
+    out->startDoc(doc);
+    return out;
+}
+
+static std::vector<unsigned char> bitmapPixels(SplashBitmap *bitmap)
+{
+    std::vector<unsigned char> pixels;
+    for (int y = 0; y < bitmap->getHeight(); ++y) {
+        const unsigned char *row = bitmap->getDataPtr() + y * bitmap->getRowSize();
+        pixels.insert(pixels.end(), row, row + 3 * bitmap->getWidth());
+    }
+    return pixels;
+}
+
+static int maxDiff(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b)
+{
+    if (a.size() != b.size()) {
+        return 256;
+    }
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+// Number of rows of <rowBytes> bytes in which <a> and <b> differ by more
+// than <tolerance>.
+static int differingRows(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b, size_t rowBytes, int tolerance)
+{
+    if (a.size() != b.size()) {
+        return a.size() / rowBytes;
+    }
+    int rows = 0;
+    for (size_t row = 0; row < a.size(); row += rowBytes) {
+        for (size_t i = row; i < row + rowBytes; ++i) {
+            if (std::abs(a[i] - b[i]) > tolerance) {
+                ++rows;
+                break;
+            }
+        }
+    }
+    return rows;
+}
+
+static std::vector<unsigned char> renderDirect(PDFDoc *doc)
+{
+    const std::unique_ptr<SplashOutputDev> out = makeOutputDev(doc);
+    doc->displayPage(out.get(), 1, dpi, dpi, 0, false, false, false);
+    return bitmapPixels(out->getBitmap());
+}
+
+static std::vector<unsigned char> renderThreads(PDFDoc *doc)
+{
+    SplashBandRenderer renderer(nThreads, [doc] { return makeOutputDev(doc); });
+    const std::unique_ptr<SplashOutputDev> out = makeOutputDev(doc);
+    renderer.displayPageSlice(out.get(), doc, 1, dpi, dpi, 0, false, false, false, -1, -1, -1, -1);
+    return bitmapPixels(out->getBitmap());
+}
+
+static std::vector<unsigned char> renderBands(PDFDoc *doc, int bandHeight)
+{
+    SplashBandRenderer renderer(nThreads, [doc] { return makeOutputDev(doc); });
+    std::vector<unsigned char> pixels;
+    int nextY = 0;
+    const bool ok = renderer.displayPageSliceBands(doc, 1, dpi, dpi, 0, false, false, false, -1, -1, -1, -1, bandHeight, [&](SplashBitmap *band, int y) {
+        check(y == nextY, "bands handed out from top to bottom");
+        const std::vector<unsigned char> bandPixels = bitmapPixels(band);
+        pixels.insert(pixels.end(), bandPixels.begin(), bandPixels.end());
+        nextY = y + band->getHeight();
+        return true;
+    });
+    check(ok, "banded rendering not stopped");
+    return pixels;
+}
+
+// The bands and threads draw the page within <tolerance>, except that the
+// bands may be off in up to <bandEdgeRows> rows.
+static void checkPage(PDFDoc *doc, int tolerance, int bandEdgeRows, const char *name)
+{
+    int w, h;
+    SplashBandRenderer::getPageSliceSize(doc, 1, dpi, dpi, 0, false, -1, -1, -1, -1, &w, &h);
+    const std::vector<unsigned char> direct = renderDirect(doc);
+    const int threadsDiff = maxDiff(direct, renderThreads(doc));
+    const int bandsRows = differingRows(direct, renderBands(doc, 37), 3 * w, tolerance);
+    if (threadsDiff > tolerance || bandsRows > bandEdgeRows) {
+        fprintf(stderr, "%s: max diff %d with threads, %d rows off with bands\n", name, threadsDiff, bandsRows);
+    }
+    check(threadsDiff <= tolerance, name);
+    check(bandsRows <= bandEdgeRows, name);
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    // the transform from the recording may move a few anti-aliased edges
+    // by rounding
+    auto plainDoc = openTestPage(200, 200, "<< /ExtGState << /G1 << /ca 0.5 >> >> >>",
+                                 "q 1 0 0 rg 10 10 100 50 re f Q\n"
+                                 "q 0 0 1 RG 4 w [6 3] 0 d 20 80 m 180 120 l S Q\n"
+                                 "q /G1 gs 0 0.6 0 rg 50 50 80 80 re f Q\n"
+                                 "q 30 150 40 40 re W n 0.5 g 0 140 200 60 re f Q\n");
+    check(plainDoc->isOk(), "open the page without shadings");
+    checkPage(plainDoc.get(), 8, 0, "page without shadings");
+
+    // shadings and tiling patterns are drawn from the page, so they match
+    // exactly, but the bands are drawn as slices of the page, translated
+    // by a whole number of rows, which may round a clip edge falling on a
+    // pixel boundary (the bottom of the shading, on row 375) the other way
+    auto shadingDoc = openTestPage(200, 200, "<< /Shading << /Sh1 5 0 R >> /Pattern << /P1 6 0 R /P2 7 0 R >> >>",
+                                   "q 20 20 160 60 re W n /Sh1 sh Q\n"
+                                   "q /Pattern cs /P1 scn 20 100 160 40 re f Q\n"
+                                   "q /Pattern cs /P2 scn 20 150 160 40 re f Q\n"
+                                   "0 0 1 rg 90 10 20 180 re f\n",
+                                   { "<< /ShadingType 2 /ColorSpace /DeviceRGB /Coords [20 0 180 0] /Function << /FunctionType 2 /Domain [0 1] /C0 [1 0 0] /C1 [0 0 1] /N 1 >> >>",
+                                     "<< /PatternType 2 /Shading << /ShadingType 3 /ColorSpace /DeviceRGB /Coords [100 120 0 100 120 80] /Function << /FunctionType 2 /Domain [0 1] /C0 [1 1 0] /C1 [0 1 0] /N 1 >> >> >>",
+                                     testStreamObject("/PatternType 1 /PaintType 1 /TilingType 1 /BBox [0 0 10 10] /XStep 10 /YStep 10 /Resources << >>", "1 0 0 rg 0 0 5 5 re f 0 0 1 rg 5 5 5 5 re f") });
+    check(shadingDoc->isOk(), "open the page with shadings");
+    checkPage(shadingDoc.get(), 0, 1, "page with shadings");
+
+    // an exception thrown from a band callback or by the factory stops the
+    // rendering and reaches the caller
+    bool thrown = false;
+    try {
+        SplashBandRenderer renderer(nThreads, [&] { return makeOutputDev(plainDoc.get()); });
+        renderer.displayPageSliceBands(plainDoc.get(), 1, dpi, dpi, 0, false, false, false, -1, -1, -1, -1, 16, [](SplashBitmap * /*band*/, int y) {
+            if (y > 0) {
+                throw std::runtime_error("band");
+            }
+            return true;
+        });
+    } catch (const std::runtime_error &e) {
+        thrown = strcmp(e.what(), "band") == 0;
+    }
+    check(thrown, "band callback exception passed to the caller");
+
+    thrown = false;
+    try {
+        std::atomic<int> made = 0;
+        SplashBandRenderer renderer(nThreads, [&] {
+            if (++made > 1) {
+                throw std::runtime_error("factory");
+            }
+            return makeOutputDev(plainDoc.get());
+        });
+        const std::unique_ptr<SplashOutputDev> out = makeOutputDev(plainDoc.get());
+        renderer.displayPageSlice(out.get(), plainDoc.get(), 1, dpi, dpi, 0, false, false, false, -1, -1, -1, -1);
+    } catch (const std::runtime_error &e) {
+        thrown = strcmp(e.what(), "factory") == 0;
+    }
+    check(thrown, "factory exception passed to the caller");
+
+    return testExitCode("splash-band-renderer-test");
+}
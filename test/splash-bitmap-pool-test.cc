@@ -0,0 +1,130 @@
+//========================================================================
+//
+// splash-bitmap-pool-test.cc
+// Checks that SplashBitmapPool reuses the bitmaps given back to it and
+// keeps within its budget, and that a page with a transparency group and
+// a soft mask, drawn in pooled bitmaps, gets the expected pixels.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashBitmapPool.h"
+#include "test-pdf-utils.h"
+
+static void checkPool()
+{
+    SplashBitmapPool pool(1024 * 1024);
+
+    // 100 x 100 RGB bitmaps with alpha, of 40000 bytes
+    SplashBitmap *a = pool.take(100, 100, 1, splashModeRGB8, true);
+    SplashBitmap *b = pool.take(100, 100, 1, splashModeRGB8, true);
+    const size_t bitmapSize = 100 * 100 * 4;
+    check(a->getDataPtr() && a->getAlphaPtr() && a != b, "new bitmaps");
+    pool.give(a);
+    pool.give(b);
+    check(pool.getSize() == 2 * bitmapSize, "bitmaps pooled");
+
+    // the bitmaps given come back for the same size and mode only
+    const auto isAOrB = [&](SplashBitmap *first, SplashBitmap *second) { return (first == a && second == b) || (first == b && second == a); };
+    SplashBitmap *reused = pool.take(100, 100, 1, splashModeRGB8, true);
+    check(reused == a || reused == b, "bitmap reused");
+    SplashBitmap *other = pool.take(100, 100, 1, splashModeMono8, true);
+    check(other != a && other != b && pool.getSize() == bitmapSize, "bitmaps reused for their mode only");
+    check(isAOrB(reused, pool.take(100, 100, 1, splashModeRGB8, true)), "both bitmaps reused");
+    check(pool.getSize() == 0, "pool emptied");
+
+    // c, given first, is dropped to fit two bitmaps in the budget, and no
+    // bitmap is kept without budget
+    SplashBitmap *c = pool.take(100, 100, 1, splashModeRGB8, true);
+    pool.give(c);
+    pool.give(a);
+    pool.give(b);
+    pool.setMaxSize(2 * bitmapSize + bitmapSize / 2);
+    check(pool.getSize() == 2 * bitmapSize, "pool trimmed to its budget");
+    reused = pool.take(100, 100, 1, splashModeRGB8, true);
+    check(isAOrB(reused, pool.take(100, 100, 1, splashModeRGB8, true)), "most recently given bitmaps kept");
+    check(pool.getSize() == 0, "pool emptied again");
+    pool.give(a);
+    pool.setMaxSize(0);
+    check(pool.getSize() == 0, "no bitmaps kept without budget");
+    pool.give(b);
+    check(pool.getSize() == 0, "no bitmaps pooled without budget");
+    delete other;
+}
+
+// Red left half, under a knockout group of a blue square and a cyan
+// corner painted at half opacity; then a green stripe through a soft
+// mask, white on the left half only.
+static const char *groupPage = "1 0 0 rg 0 0 100 200 re f\n"
+                               "q /Half gs /Group Do Q\n"
+                               "q /Masked gs 0 1 0 rg 0 20 200 20 re f Q\n";
+
+static std::vector<unsigned char> renderGroupPage(SplashOutputDev *out, PDFDoc *doc)
+{
+    doc->displayPage(out, 1, 72, 72, 0, false, false, false);
+    SplashBitmap *bitmap = out->getBitmap();
+    std::vector<unsigned char> pixels;
+    for (int y = 0; y < bitmap->getHeight(); ++y) {
+        const unsigned char *row = bitmap->getDataPtr() + y * bitmap->getRowSize();
+        pixels.insert(pixels.end(), row, row + 3 * bitmap->getWidth());
+    }
+    return pixels;
+}
+
+// Whether the pixel at (<x>, <y>) on the 200 x 200 page is (<r>, <g>, <b>),
+// within one level.
+static bool pixelIs(const std::vector<unsigned char> &pixels, int x, int y, int r, int g, int b)
+{
+    const unsigned char *p = &pixels[3 * ((200 - 1 - y) * 200 + x)];
+    if (std::abs(p[0] - r) > 1 || std::abs(p[1] - g) > 1 || std::abs(p[2] - b) > 1) {
+        fprintf(stderr, "pixel (%d, %d) is %d %d %d, not %d %d %d\n", x, y, p[0], p[1], p[2], r, g, b);
+        return false;
+    }
+    return true;
+}
+
+static void checkGroupPage()
+{
+    TestPdfDoc doc = openTestPage(200, 200, "<< /ExtGState << /Half 5 0 R /Masked 6 0 R >> /XObject << /Group 7 0 R >> >>", groupPage,
+                                  { "<< /Type /ExtGState /ca 0.5 >>", "<< /Type /ExtGState /SMask << /Type /Mask /S /Luminosity /G 8 0 R >> >>",
+                                    testStreamObject("/Type /XObject /Subtype /Form /BBox [0 0 200 200] /Group << /S /Transparency /I false /K true >>", "0 0 1 rg 50 50 100 100 re f 0 1 1 rg 100 50 50 50 re f"),
+                                    testStreamObject("/Type /XObject /Subtype /Form /BBox [0 0 200 200] /Group << /S /Transparency /CS /DeviceGray >>", "1 g 0 0 100 200 re f") });
+    check(doc->isOk(), "group document");
+
+    SplashColor paperColor = { 0xff, 0xff, 0xff };
+    SplashOutputDev out(splashModeRGB8, 4, paperColor);
+    out.startDoc(doc.get());
+    // the second time, the group and mask bitmaps come from the pool, with
+    // the pixels of the first page
+    const std::vector<unsigned char> first = renderGroupPage(&out, doc.get());
+    const std::vector<unsigned char> second = renderGroupPage(&out, doc.get());
+    check(first == second, "same pixels from pooled bitmaps");
+
+    check(pixelIs(first, 25, 175, 255, 0, 0), "red outside the group");
+    check(pixelIs(first, 75, 100, 128, 0, 128), "blue group over red");
+    check(pixelIs(first, 125, 125, 128, 128, 255), "blue group over white");
+    check(pixelIs(first, 125, 75, 128, 255, 255), "cyan knocking out blue");
+    check(pixelIs(first, 50, 30, 0, 255, 0), "stripe inside the mask");
+    check(pixelIs(first, 150, 30, 255, 255, 255), "stripe outside the mask");
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    checkPool();
+    checkGroupPage();
+
+    return testExitCode("splash-bitmap-pool-test");
+}
@@ -0,0 +1,205 @@
+//========================================================================
+//
+// splash-ft-face-cache-test.cc
+// Checks that documents embedding the same font program share one
+// SplashFTFace, and that SplashFTFaceCache frees the faces over its
+// budget once they aren't used anymore.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashFontFile.h"
+#include "splash/SplashFTFaceCache.h"
+#include "splash/SplashGlyphCache.h"
+#include "test-pdf-utils.h"
+
+static void putU16(std::string *s, int v)
+{
+    s->push_back(static_cast<char>((v >> 8) & 0xff));
+    s->push_back(static_cast<char>(v & 0xff));
+}
+
+static void putU32(std::string *s, unsigned int v)
+{
+    putU16(s, static_cast<int>(v >> 16));
+    putU16(s, static_cast<int>(v & 0xffff));
+}
+
+// A TrueType font of two glyphs: .notdef, empty, and a <size> unit square
+// for 'A'.
+static std::string trueTypeFont(int size)
+{
+    std::string head;
+    putU32(&head, 0x00010000); // version
+    putU32(&head, 0x00010000); // fontRevision
+    putU32(&head, 0); // checkSumAdjustment
+    putU32(&head, 0x5f0f3cf5); // magicNumber
+    putU16(&head, 0x000b); // flags
+    putU16(&head, 1000); // unitsPerEm
+    head.append(16, '\0'); // created, modified
+    for (int v : { 0, 0, 1000, 1000, 0, 8, 2, 0, 0 }) { // bbox, macStyle, lowestRecPPEM, fontDirectionHint, indexToLocFormat, glyphDataFormat
+        putU16(&head, v);
+    }
+
+    std::string hhea;
+    putU32(&hhea, 0x00010000);
+    for (int v : { 1000, 0, 0, 1000, 0, 0, 1000, 1, 0, 0, 0, 0, 0, 0, 0, 2 }) { // ..., numberOfHMetrics
+        putU16(&hhea, v);
+    }
+
+    std::string maxp;
+    putU32(&maxp, 0x00010000);
+    for (int v : { 2, 4, 1, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0 }) { // numGlyphs, maxPoints, maxContours, ...
+        putU16(&maxp, v);
+    }
+
+    std::string hmtx;
+    for (int v : { 1000, 0, 1000, 0 }) {
+        putU16(&hmtx, v);
+    }
+
+    // one contour through (0, 0), (size, 0), (size, size), (0, size)
+    std::string glyf;
+    for (int v : { 1, 0, 0, size, size, 3, 0 }) { // numberOfContours, bbox, endPtsOfContours, instructionLength
+        putU16(&glyf, v);
+    }
+    glyf.append(4, '\1'); // on curve points, 16-bit deltas
+    for (int v : { 0, size, 0, -size, 0, 0, size, 0 }) {
+        putU16(&glyf, v);
+    }
+
+    std::string loca;
+    for (int v : { 0, 0, static_cast<int>(glyf.size() / 2) }) {
+        putU16(&loca, v);
+    }
+
+    // format 4 subtable mapping U+0041 to glyph 1
+    std::string cmap;
+    for (int v : { 0, 1, 3, 1 }) {
+        putU16(&cmap, v);
+    }
+    putU32(&cmap, 12);
+    for (int v : { 4, 32, 0, 4, 4, 1, 0, 0x41, 0xffff, 0, 0x41, 0xffff, 1 - 0x41, 1, 0, 0 }) {
+        putU16(&cmap, v);
+    }
+
+    std::string post;
+    putU32(&post, 0x00030000);
+    post.append(28, '\0');
+
+    const std::pair<const char *, std::string *> tables[] = { { "cmap", &cmap }, { "glyf", &glyf }, { "head", &head }, { "hhea", &hhea }, { "hmtx", &hmtx }, { "loca", &loca }, { "maxp", &maxp }, { "post", &post } };
+    const int nTables = std::size(tables);
+    std::string font;
+    putU32(&font, 0x00010000);
+    for (int v : { nTables, 128, 3, nTables * 16 - 128 }) {
+        putU16(&font, v);
+    }
+    unsigned int offset = 12 + 16 * nTables;
+    for (const auto &[tag, data] : tables) {
+        font.append(tag, 4);
+        putU32(&font, 0); // checksum
+        putU32(&font, offset);
+        putU32(&font, static_cast<unsigned int>(data->size()));
+        offset += (data->size() + 3) & ~3;
+    }
+    for (const auto &table : tables) {
+        font += *table.second;
+        font.append(((table.second->size() + 3) & ~3) - table.second->size(), '\0');
+    }
+    return font;
+}
+
+static std::shared_ptr<SplashFTFace> getFace(const std::string &font)
+{
+    return SplashFTFaceCache::getFace(std::make_unique<SplashFontSrc>(std::vector<unsigned char>(font.begin(), font.end())), 0);
+}
+
+// A page showing "AAA" in a font embedding <font>.
+static TestPdfDoc openFontPage(const std::string &font)
+{
+    return openTestPage(200, 200, "<< /Font << /F1 5 0 R >> >>", "BT /F1 40 Tf 20 80 Td (AAA) Tj ET\n",
+                        { "<< /Type /Font /Subtype /TrueType /BaseFont /Square /FirstChar 65 /LastChar 65 /Widths [1000] /Encoding /WinAnsiEncoding /FontDescriptor 6 0 R >>",
+                          "<< /Type /FontDescriptor /FontName /Square /Flags 32 /FontBBox [0 0 1000 1000] /ItalicAngle 0 /Ascent 1000 /Descent 0 /CapHeight 1000 /StemV 80 /FontFile2 7 0 R >>", testStreamObject("", font) });
+}
+
+static std::unique_ptr<SplashOutputDev> renderFontPage(PDFDoc *doc)
+{
+    SplashColor paperColor = { 0xff, 0xff, 0xff };
+    auto out = std::make_unique<SplashOutputDev>(splashModeRGB8, 4, paperColor);
+    out->startDoc(doc);
+    doc->displayPage(out.get(), 1, 72, 72, 0, false, false, false);
+    return out;
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    const std::string font = trueTypeFont(800);
+    const std::string otherFonts[] = { trueTypeFont(600), trueTypeFont(400), trueTypeFont(200) };
+
+    // two copies of a font program give the same face, another one a face
+    // of its own
+    {
+        const size_t nFaces = SplashFTFaceCache::getStats().faces;
+        const std::shared_ptr<SplashFTFace> face = getFace(font);
+        check(face && face->face, "face loaded");
+        const std::shared_ptr<SplashFTFace> same = getFace(font);
+        check(same == face, "same font program, same face");
+        const std::shared_ptr<SplashFTFace> other = getFace(otherFonts[0]);
+        check(other && other != face && other->id != face->id, "other font program, other face");
+        check(SplashFTFaceCache::getStats().faces == nFaces + 2, "one face per font program");
+    }
+
+    // two documents embedding the font share its face, and so the glyphs
+    // drawn from it
+    {
+        TestPdfDoc doc1 = openFontPage(font);
+        TestPdfDoc doc2 = openFontPage(font);
+        check(doc1->isOk() && doc2->isOk(), "font documents");
+        const size_t nFaces = SplashFTFaceCache::getStats().faces;
+        const SplashGlyphCache::Stats glyphs1 = SplashGlyphCache::getStats();
+        const std::unique_ptr<SplashOutputDev> out1 = renderFontPage(doc1.get());
+        const SplashGlyphCache::Stats glyphs2 = SplashGlyphCache::getStats();
+        const std::unique_ptr<SplashOutputDev> out2 = renderFontPage(doc2.get());
+        const SplashGlyphCache::Stats glyphs3 = SplashGlyphCache::getStats();
+        check(SplashFTFaceCache::getStats().faces == nFaces, "documents use the cached face");
+        check(glyphs2.misses > glyphs1.misses && glyphs3.misses == glyphs2.misses && glyphs3.hits > glyphs2.hits, "documents share the cached glyphs");
+        const unsigned char *pixel = out2->getBitmap()->getDataPtr() + (200 - 100) * out2->getBitmap()->getRowSize() + 3 * 40;
+        check(pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 0, "glyphs drawn");
+    }
+
+    // the budget holds one face: the unused faces are dropped when another
+    // face is loaded, and the face in use once its last user is gone
+    const size_t faceSize = getFace(font)->getSize();
+    SplashFTFaceCache::setMaxSize(faceSize + faceSize / 2);
+    check(SplashFTFaceCache::getStats().faces == 1, "unused faces dropped for a smaller budget");
+    {
+        std::shared_ptr<SplashFTFace> face = getFace(otherFonts[1]);
+        const unsigned long long id = face->id;
+        check(SplashFTFaceCache::getStats().faces == 1, "least recently used face dropped");
+        std::shared_ptr<SplashFTFace> face2 = getFace(otherFonts[2]);
+        check(SplashFTFaceCache::getStats().faces == 2, "faces in use kept over the budget");
+        check(getFace(otherFonts[1])->id == id, "face in use found again");
+        face.reset();
+        const SplashFTFaceCache::Stats stats = SplashFTFaceCache::getStats();
+        check(stats.faces == 1 && stats.size == face2->getSize(), "face freed with its last user");
+        face2.reset();
+        check(SplashFTFaceCache::getStats().faces == 1, "unused face kept within the budget");
+        check(getFace(otherFonts[1])->id != id, "freed face loaded again");
+    }
+    SplashFTFaceCache::setMaxSize(0);
+    check(SplashFTFaceCache::getStats().faces == 0 && SplashFTFaceCache::getStats().size == 0, "no faces kept without budget");
+
+    return testExitCode("splash-ft-face-cache-test");
+}
@@ -0,0 +1,98 @@
+//========================================================================
+//
+// splash-glyph-cache-test.cc
+// Checks the hit and miss counts of SplashGlyphCache, that it drops the
+// least recently used glyphs past its memory budget, and that a dropped
+// glyph stays valid while a glyph bitmap holds it.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "splash/SplashGlyphBitmap.h"
+#include "splash/SplashGlyphCache.h"
+#include "test-utils.h"
+
+// Anti-aliased glyphs of 64 x 64 pixels, filled with a value of their own.
+static constexpr int glyphSize = 64;
+
+static SplashGlyphCacheKey glyphKey(unsigned long long fontID, int glyph)
+{
+    return { fontID, { 10, 0, 0, 10 }, glyph, 0, 0, 0, true };
+}
+
+static unsigned char glyphValue(int glyph)
+{
+    return static_cast<unsigned char>(glyph * 37 + 1);
+}
+
+static std::shared_ptr<const SplashGlyphCache::Glyph> insertGlyph(unsigned long long fontID, int glyph)
+{
+    std::vector<unsigned char> data(glyphSize * glyphSize, glyphValue(glyph));
+    const SplashGlyphBitmap bitmap { 1, 2, glyphSize, glyphSize, true, data.data(), false, nullptr };
+    return SplashGlyphCache::insert(glyphKey(fontID, glyph), bitmap);
+}
+
+// Whether <bitmap> holds the pixels of <glyph>.
+static bool holdsGlyph(const SplashGlyphBitmap &bitmap, int glyph)
+{
+    return bitmap.w == glyphSize && bitmap.h == glyphSize && std::all_of(bitmap.data, bitmap.data + glyphSize * glyphSize, [glyph](unsigned char v) { return v == glyphValue(glyph); });
+}
+
+int main()
+{
+    check(SplashGlyphCache::getMaxSize() == 16 * 1024 * 1024, "16 MB budget by default");
+    const unsigned long long fontID = SplashGlyphCache::newFontID();
+    check(SplashGlyphCache::newFontID() != fontID, "new font IDs");
+
+    // a miss, then a hit on the copy of the bitmap
+    {
+        const SplashGlyphCache::Stats before = SplashGlyphCache::getStats();
+        check(!SplashGlyphCache::lookup(glyphKey(fontID, 0)), "missing glyph");
+        const auto inserted = insertGlyph(fontID, 0);
+        const auto found = SplashGlyphCache::lookup(glyphKey(fontID, 0));
+        check(found == inserted && found->x == 1 && found->y == 2 && found->aa, "cached glyph");
+        check(!SplashGlyphCache::lookup(glyphKey(fontID + 1, 0)), "glyphs cached by font");
+        const SplashGlyphCache::Stats after = SplashGlyphCache::getStats();
+        check(after.hits - before.hits == 1 && after.misses - before.misses == 2, "hit and miss counts");
+        check(after.glyphs == before.glyphs + 1, "glyph count");
+    }
+
+    // the first glyph is held, as SplashFont::getGlyph returns it, while
+    // twice the budget of glyphs goes through the cache
+    SplashGlyphBitmap held;
+    {
+        auto glyph = SplashGlyphCache::lookup(glyphKey(fontID, 0));
+        held = { glyph->x, glyph->y, glyph->w, glyph->h, glyph->aa, glyph->data.get(), false, nullptr };
+        held.dataOwner = std::move(glyph);
+    }
+    const int nGlyphs = static_cast<int>(2 * SplashGlyphCache::getMaxSize() / (glyphSize * glyphSize));
+    for (int i = 1; i <= nGlyphs; ++i) {
+        insertGlyph(fontID, i);
+    }
+    const SplashGlyphCache::Stats full = SplashGlyphCache::getStats();
+    if (full.size > SplashGlyphCache::getMaxSize()) {
+        fprintf(stderr, "%zu bytes cached\n", full.size);
+    }
+    check(full.size <= SplashGlyphCache::getMaxSize() && full.size > SplashGlyphCache::getMaxSize() / 2, "cache within its budget");
+    check(full.glyphs < static_cast<size_t>(nGlyphs) / 2, "glyphs dropped");
+    check(!SplashGlyphCache::lookup(glyphKey(fontID, 0)), "least recently used glyph dropped");
+    check(SplashGlyphCache::lookup(glyphKey(fontID, nGlyphs)) != nullptr, "last glyph kept");
+    check(holdsGlyph(held, 0), "dropped glyph still valid");
+
+    // a smaller budget drops glyphs at once, and no budget disables the cache
+    SplashGlyphCache::setMaxSize(1024 * 1024);
+    check(SplashGlyphCache::getStats().size <= 1024 * 1024, "cache trimmed to a smaller budget");
+    SplashGlyphCache::setMaxSize(0);
+    check(SplashGlyphCache::getStats().glyphs == 0, "cache emptied");
+    const auto uncached = insertGlyph(fontID, 1);
+    check(uncached && !SplashGlyphCache::lookup(glyphKey(fontID, 1)), "no cache without budget");
+
+    return testExitCode("splash-glyph-cache-test");
+}
@@ -0,0 +1,285 @@
+//========================================================================
+//
+// splash-image-scaler-test.cc
+// Checks the Splash image scalers against a plain implementation of the
+// Bresenham box filter, replication and bilinear scalers they replaced,
+// and the Lanczos downscaler against the box filter.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "splash/Splash.h"
+#include "splash/SplashBitmap.h"
+#include "test-utils.h"
+
+// Components per pixel of the color modes tested.
+static int modeComps(SplashColorMode mode)
+{
+    switch (mode) {
+    case splashModeMono8:
+        return 1;
+    case splashModeRGB8:
+    case splashModeBGR8:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+// An image of <width> x <height> pixels of <nComps> components.
+struct TestImage
+{
+    int width, height, nComps;
+    std::vector<unsigned char> pixels;
+    int nextRow = 0;
+
+    unsigned char at(int x, int y, int c) const { return pixels[(static_cast<size_t>(y) * width + x) * nComps + c]; }
+};
+
+static bool imageSource(void *data, SplashColorPtr colorLine, unsigned char * /*alphaLine*/)
+{
+    auto *image = static_cast<TestImage *>(data);
+    std::copy_n(image->pixels.begin() + static_cast<size_t>(image->nextRow) * image->width * image->nComps, image->width * image->nComps, colorLine);
+    ++image->nextRow;
+    return true;
+}
+
+static TestImage makeImage(int width, int height, int nComps, bool smooth)
+{
+    TestImage image { width, height, nComps, std::vector<unsigned char>(static_cast<size_t>(width) * height * nComps) };
+    unsigned int seed = 12345;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < nComps; ++c) {
+                seed = seed * 1103515245 + 12345;
+                image.pixels[(static_cast<size_t>(y) * width + x) * nComps + c] = smooth ? static_cast<unsigned char>(x * 128 / width + y * 64 / height + 20 * c) : static_cast<unsigned char>(seed >> 16);
+            }
+        }
+    }
+    return image;
+}
+
+//------------------------------------------------------------------------
+// reference scalers, computing each destination pixel on its own the way
+// the scalers did before they were split into row kernels
+//------------------------------------------------------------------------
+
+// Source pixels [first, first + count) of each destination pixel along an
+// axis scaled down from <srcSize> to <scaledSize>, with the scale
+// Bresenham.
+static void bresenhamDown(int srcSize, int scaledSize, std::vector<int> &first, std::vector<int> &count)
+{
+    const int p = srcSize / scaledSize, q = srcSize % scaledSize;
+    int t = 0, pos = 0;
+    for (int i = 0; i < scaledSize; ++i) {
+        int step = p;
+        if ((t += q) >= scaledSize) {
+            t -= scaledSize;
+            step = p + 1;
+        }
+        first.push_back(pos);
+        count.push_back(step);
+        pos += step;
+    }
+}
+
+// Source pixel of each destination pixel along an axis scaled up from
+// <srcSize> to <scaledSize>, with the scale Bresenham.
+static std::vector<int> bresenhamUp(int srcSize, int scaledSize)
+{
+    const int p = scaledSize / srcSize, q = scaledSize % srcSize;
+    std::vector<int> src;
+    int t = 0;
+    for (int i = 0; i < srcSize; ++i) {
+        int step = p;
+        if ((t += q) >= srcSize) {
+            t -= srcSize;
+            step = p + 1;
+        }
+        src.insert(src.end(), step, i);
+    }
+    return src;
+}
+
+static std::vector<unsigned char> referenceBox(const TestImage &image, int scaledWidth, int scaledHeight)
+{
+    std::vector<int> xFirst, xCount, yFirst, yCount;
+    std::vector<int> xSrc, ySrc;
+    if (scaledWidth < image.width) {
+        bresenhamDown(image.width, scaledWidth, xFirst, xCount);
+    } else {
+        xSrc = bresenhamUp(image.width, scaledWidth);
+    }
+    if (scaledHeight < image.height) {
+        bresenhamDown(image.height, scaledHeight, yFirst, yCount);
+    } else {
+        ySrc = bresenhamUp(image.height, scaledHeight);
+    }
+
+    std::vector<unsigned char> out;
+    for (int y = 0; y < scaledHeight; ++y) {
+        const int y0 = ySrc.empty() ? yFirst[y] : ySrc[y];
+        const int ny = ySrc.empty() ? yCount[y] : 1;
+        for (int x = 0; x < scaledWidth; ++x) {
+            const int x0 = xSrc.empty() ? xFirst[x] : xSrc[x];
+            const int nx = xSrc.empty() ? xCount[x] : 1;
+            const unsigned int d = (1 << 23) / (nx * ny);
+            for (int c = 0; c < image.nComps; ++c) {
+                unsigned int sum = 0;
+                for (int j = 0; j < ny; ++j) {
+                    for (int i = 0; i < nx; ++i) {
+                        sum += image.at(x0 + i, y0 + j, c);
+                    }
+                }
+                out.push_back(static_cast<unsigned char>((sum * d) >> 23));
+            }
+        }
+    }
+    return out;
+}
+
+static std::vector<unsigned char> referenceBilinear(const TestImage &image, int scaledWidth, int scaledHeight)
+{
+    // expand the rows first, the last source pixel and row being repeated
+    const auto expandRow = [&](int y) {
+        std::vector<unsigned char> row;
+        const double xStep = static_cast<double>(image.width) / scaledWidth;
+        double xSrc = 0;
+        for (int x = 0; x < scaledWidth; ++x, xSrc += xStep) {
+            double xInt;
+            const double xFrac = modf(xSrc, &xInt);
+            const int p = static_cast<int>(xInt);
+            for (int c = 0; c < image.nComps; ++c) {
+                row.push_back(static_cast<unsigned char>(image.at(p, y, c) * (1.0 - xFrac) + image.at(std::min(p + 1, image.width - 1), y, c) * xFrac));
+            }
+        }
+        return row;
+    };
+
+    std::vector<unsigned char> out;
+    const double yStep = static_cast<double>(image.height) / scaledHeight;
+    double ySrc = 0;
+    for (int y = 0; y < scaledHeight; ++y, ySrc += yStep) {
+        double yInt;
+        const double yFrac = modf(ySrc, &yInt);
+        const int p = static_cast<int>(yInt);
+        const std::vector<unsigned char> row1 = expandRow(p);
+        const std::vector<unsigned char> row2 = expandRow(std::min(p + 1, image.height - 1));
+        for (size_t i = 0; i < row1.size(); ++i) {
+            out.push_back(static_cast<unsigned char>(row1[i] * (1.0 - yFrac) + row2[i] * yFrac));
+        }
+    }
+    return out;
+}
+
+//------------------------------------------------------------------------
+
+// Draw <image> scaled to <scaledWidth> x <scaledHeight> into a bitmap of
+// that size in <mode>, and return its pixels in the component order of
+// the image.
+static std::vector<unsigned char> drawScaled(TestImage image, SplashColorMode mode, int scaledWidth, int scaledHeight, bool interpolate, bool lanczos)
+{
+    SplashBitmap bitmap(scaledWidth, scaledHeight, 1, mode, false);
+    Splash splash(&bitmap, false);
+    splash.setLanczosDownscaling(lanczos);
+    // the image covers the pixels its corners are in, so [0, n - 1] maps
+    // to n pixels
+    const std::array<double, 6> mat = { static_cast<double>(scaledWidth - 1), 0, 0, static_cast<double>(scaledHeight - 1), 0, 0 };
+    image.nextRow = 0;
+    if (splash.drawImage(imageSource, nullptr, &image, mode, false, image.width, image.height, mat, interpolate) != SplashError::NoError) {
+        return {};
+    }
+
+    const bool bgr = mode == splashModeBGR8 || mode == splashModeXBGR8;
+    const int bitmapComps = modeComps(mode);
+    std::vector<unsigned char> pixels;
+    for (int y = 0; y < scaledHeight; ++y) {
+        const unsigned char *p = bitmap.getDataPtr() + static_cast<ptrdiff_t>(y) * bitmap.getRowSize();
+        for (int x = 0; x < scaledWidth; ++x, p += bitmapComps) {
+            for (int c = 0; c < image.nComps; ++c) {
+                pixels.push_back(bgr && c < 3 ? p[2 - c] : p[c]);
+            }
+        }
+    }
+    return pixels;
+}
+
+static int maxDiff(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b)
+{
+    if (a.size() != b.size()) {
+        return 256;
+    }
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+int main()
+{
+    struct Scale
+    {
+        int srcWidth, srcHeight, scaledWidth, scaledHeight;
+        bool interpolate;
+    };
+    // box filter both ways, by odd and large factors; box filter and
+    // replication; replication both ways; bilinear interpolation
+    const Scale scales[] = { { 37, 29, 11, 7, false }, { 200, 150, 7, 5, false }, { 37, 29, 80, 13, false }, { 37, 29, 11, 70, false }, { 37, 29, 160, 120, false }, { 37, 29, 50, 40, false }, { 37, 29, 74, 58, true } };
+    const SplashColorMode modes[] = { splashModeMono8, splashModeRGB8, splashModeBGR8, splashModeXBGR8, splashModeCMYK8 };
+
+    for (SplashColorMode mode : modes) {
+        // XBGR8 images have an unused fourth component
+        const int nComps = mode == splashModeXBGR8 ? 3 : modeComps(mode);
+        for (const Scale &scale : scales) {
+            TestImage image = makeImage(scale.srcWidth, scale.srcHeight, modeComps(mode), false);
+            std::vector<unsigned char> expected;
+            const bool bilinear = scale.scaledWidth >= scale.srcWidth && scale.scaledHeight >= scale.srcHeight && (scale.interpolate || (scale.scaledWidth / scale.srcWidth < 4 && scale.scaledHeight / scale.srcHeight < 4));
+            expected = bilinear ? referenceBilinear(image, scale.scaledWidth, scale.scaledHeight) : referenceBox(image, scale.scaledWidth, scale.scaledHeight);
+            std::vector<unsigned char> drawn = drawScaled(image, mode, scale.scaledWidth, scale.scaledHeight, scale.interpolate, false);
+            if (nComps != image.nComps) {
+                // drop the fourth component
+                std::vector<unsigned char> expected3, drawn3;
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    if (i % image.nComps < 3) {
+                        expected3.push_back(expected[i]);
+                        drawn3.push_back(i < drawn.size() ? drawn[i] : 0);
+                    }
+                }
+                expected.swap(expected3);
+                drawn.swap(drawn3);
+            }
+            if (drawn != expected) {
+                fprintf(stderr, "mode %d, %dx%d to %dx%d: max diff %d\n", static_cast<int>(mode), scale.srcWidth, scale.srcHeight, scale.scaledWidth, scale.scaledHeight, maxDiff(drawn, expected));
+            }
+            check(drawn == expected, "scaler matches the reference");
+        }
+    }
+
+    // the Lanczos filter keeps flat colors, stays close to the box filter
+    // on smooth images and only applies to images scaled down both ways
+    for (SplashColorMode mode : { splashModeMono8, splashModeRGB8, splashModeCMYK8 }) {
+        const int nComps = modeComps(mode);
+        TestImage flat { 90, 70, nComps, std::vector<unsigned char>(90 * 70 * nComps, 77) };
+        check(drawScaled(flat, mode, 23, 17, false, true) == std::vector<unsigned char>(23 * 17 * nComps, 77), "Lanczos keeps flat colors");
+
+        const TestImage smooth = makeImage(90, 70, nComps, true);
+        const int smoothDiff = maxDiff(drawScaled(smooth, mode, 23, 17, false, true), drawScaled(smooth, mode, 23, 17, false, false));
+        check(smoothDiff <= 4, "Lanczos close to the box filter on smooth images");
+
+        const TestImage noise = makeImage(90, 70, nComps, false);
+        check(drawScaled(noise, mode, 23, 17, false, true) != drawScaled(noise, mode, 23, 17, false, false), "Lanczos used for downscaling");
+        check(drawScaled(noise, mode, 200, 17, false, true) == drawScaled(noise, mode, 200, 17, false, false), "Lanczos not used for upscaling");
+    }
+
+    return testExitCode("splash-image-scaler-test");
+}
@@ -0,0 +1,109 @@
+//========================================================================
+//
+// splash-shading-ramp-test.cc
+// Checks that axial and radial shadings drawn from sampled color ramps
+// stay within one level of the shading functions evaluated at each
+// pixel, including for ramps kept from an earlier fill or page.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "test-pdf-utils.h"
+
+static constexpr double dpi = 150;
+
+static std::unique_ptr<SplashOutputDev> makeOutputDev(PDFDoc *doc, bool shadingRamps)
+{
+    SplashColor paperColor = { 0xff, 0xff, 0xff };
+    auto out = std::make_unique<SplashOutputDev>(splashModeRGB8, 4, paperColor);
+    out->setShadingRamps(shadingRamps);
+    out->startDoc(doc);
+    return out;
+}
+
+static std::vector<unsigned char> bitmapPixels(SplashBitmap *bitmap)
+{
+    std::vector<unsigned char> pixels;
+    for (int y = 0; y < bitmap->getHeight(); ++y) {
+        const unsigned char *row = bitmap->getDataPtr() + y * bitmap->getRowSize();
+        pixels.insert(pixels.end(), row, row + 3 * bitmap->getWidth());
+    }
+    return pixels;
+}
+
+static int maxDiff(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b)
+{
+    if (a.size() != b.size()) {
+        return 256;
+    }
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+static void checkShadings(const char *name, const char *content, const std::vector<std::string> &shadings)
+{
+    std::string resources = "<< /Shading <<";
+    for (size_t i = 0; i < shadings.size(); ++i) {
+        resources += " /Sh" + std::to_string(i + 1) + " " + std::to_string(i + 5) + " 0 R";
+    }
+    resources += " >> >>";
+    auto doc = openTestPage(200, 200, resources, content, shadings);
+    if (!doc->isOk()) {
+        check(false, name);
+        return;
+    }
+
+    const std::unique_ptr<SplashOutputDev> direct = makeOutputDev(doc.get(), false);
+    doc->displayPage(direct.get(), 1, dpi, dpi, 0, false, false, false);
+    const std::vector<unsigned char> expected = bitmapPixels(direct->getBitmap());
+
+    // the second time, the ramps come from the cache
+    const std::unique_ptr<SplashOutputDev> ramps = makeOutputDev(doc.get(), true);
+    for (int pass = 0; pass < 2; ++pass) {
+        doc->displayPage(ramps.get(), 1, dpi, dpi, 0, false, false, false);
+        const int diff = maxDiff(expected, bitmapPixels(ramps->getBitmap()));
+        if (diff > 1) {
+            fprintf(stderr, "%s, pass %d: max diff %d\n", name, pass, diff);
+        }
+        check(diff <= 1, name);
+    }
+}
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    // a linear function, extended at both ends, and the same shading
+    // filled again, smaller, from the finer ramp
+    checkShadings("axial shading", "q 10 10 180 80 re W n /Sh1 sh Q q 0.25 0 0 0.25 20 120 cm 0 0 200 200 re W n /Sh1 sh Q\n",
+                  { "<< /ShadingType 2 /ColorSpace /DeviceRGB /Coords [40 0 160 30] /Extend [true true] /Function << /FunctionType 2 /Domain [0 1] /C0 [1 0 0] /C1 [0 0.5 1] /N 1 >> >>" });
+
+    // stitched exponential functions over a reversed domain; the functions
+    // are continuous and of bounded slope, as the ramp interpolates
+    // linearly between samples about a pixel apart
+    checkShadings("stitched axial shading", "q 10 10 180 180 re W n /Sh1 sh Q\n",
+                  { "<< /ShadingType 2 /ColorSpace /DeviceRGB /Coords [10 10 190 190] /Domain [1 0] /Function << /FunctionType 3 /Domain [0 1] /Bounds [0.3] /Encode [0 1 1 0] /Functions [ "
+                    "<< /FunctionType 2 /Domain [0 1] /C0 [0 0 0] /C1 [1 1 0] /N 2.2 >> << /FunctionType 2 /Domain [0 1] /C0 [1 0 1] /C1 [1 1 0] /N 3 >> ] >> >>" });
+
+    // concentric and eccentric circles, with and without extension
+    checkShadings("radial shadings", "q 10 10 180 85 re W n /Sh1 sh Q q 10 105 180 85 re W n /Sh2 sh Q\n",
+                  { "<< /ShadingType 3 /ColorSpace /DeviceRGB /Coords [100 50 0 100 50 60] /Function << /FunctionType 2 /Domain [0 1] /C0 [1 1 0] /C1 [0 0.3 0] /N 1.5 >> >>",
+                    "<< /ShadingType 3 /ColorSpace /DeviceGray /Coords [60 140 5 110 150 70] /Extend [true true] /Function << /FunctionType 2 /Domain [0 1] /C0 [0] /C1 [1] /N 1 >> >>" });
+
+    return testExitCode("splash-shading-ramp-test");
+}
@@ -0,0 +1,50 @@
+//========================================================================
+//
+// test-pdf-utils.h
+// Helpers for the tests that read the PDF files they build in memory.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef TEST_PDF_UTILS_H
+#define TEST_PDF_UTILS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "test-utils.h"
+
+// A document read from memory, owning the buffer its stream reads from.
+struct TestPdfDoc
+{
+    std::vector<char> data;
+    std::unique_ptr<PDFDoc> doc;
+
+    PDFDoc *get() const { return doc.get(); }
+    PDFDoc *operator->() const { return doc.get(); }
+};
+
+inline TestPdfDoc openTestPdf(const std::vector<std::string> &objects)
+{
+    TestPdfDoc testDoc;
+    testDoc.data = buildTestPdf(objects);
+    testDoc.doc = std::make_unique<PDFDoc>(std::make_unique<MemStream>(testDoc.data.data(), 0, testDoc.data.size(), Object::null()));
+    return testDoc;
+}
+
+// A one page document showing <content> on a <width> x <height> page
+// with the resources <resources>; <extraObjects> are numbered from 5.
+inline TestPdfDoc openTestPage(int width, int height, const std::string &resources, const std::string &content, const std::vector<std::string> &extraObjects = {})
+{
+    std::vector<std::string> objects = { "<< /Type /Catalog /Pages 2 0 R >>", "<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+                                         "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " + std::to_string(width) + " " + std::to_string(height) + "] /Resources " + resources + " /Contents 4 0 R >>",
+                                         testStreamObject("", content) };
+    objects.insert(objects.end(), extraObjects.begin(), extraObjects.end());
+    return openTestPdf(objects);
+}
+
+#endif
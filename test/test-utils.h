@@ -0,0 +1,68 @@
+//========================================================================
+//
+// test-utils.h
+// Checks shared by the self-contained tests, and the PDF files they build
+// in memory.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Number of checks failed so far.
+inline int testFailures = 0;
+
+// Reports <what> if <ok> is false.
+inline void check(bool ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        ++testFailures;
+    }
+}
+
+// Exit status of the test <name>, which passed if no check failed.
+inline int testExitCode(const char *name)
+{
+    if (testFailures) {
+        return 1;
+    }
+    printf("%s: OK\n", name);
+    return 0;
+}
+
+// Returns the body of a stream object holding <data>, <dict> being the
+// stream dictionary entries without /Length.
+inline std::string testStreamObject(const std::string &dict, const std::string &data)
+{
+    return "<< " + dict + " /Length " + std::to_string(data.size()) + " >>\nstream\n" + data + "\nendstream";
+}
+
+// Builds a PDF file from the bodies of objects 1..n, object 1 being the
+// catalog.
+inline std::vector<char> buildTestPdf(const std::vector<std::string> &objects)
+{
+    std::string pdf = "%PDF-1.7\n";
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        offsets.push_back(pdf.size());
+        pdf += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+    const size_t xrefOffset = pdf.size();
+    pdf += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (size_t offset : offsets) {
+        char entry[21];
+        snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+        pdf += entry;
+    }
+    pdf += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" + std::to_string(xrefOffset) + "\n%%EOF\n";
+    return { pdf.begin(), pdf.end() };
+}
+
+#endif
@@ -0,0 +1,57 @@
+//========================================================================
+//
+// xref-object-cache-test.cc
+// Checks that objects returned by the XRef object cache can be modified
+// without changing what later fetches return.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+
+#include "GlobalParams.h"
+#include "Object.h"
+#include "Array.h"
+#include "Dict.h"
+#include "XRef.h"
+#include "test-pdf-utils.h"
+
+int main()
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    auto doc = openTestPdf({ "<< /Type /Catalog /Pages 2 0 R >>", "<< /Type /Pages /Kids [] /Count 0 >>", "<< /Key 1 /Nested << /Inner 2 >> >>", "[1 2 [3 4]]" });
+    if (!doc->isOk()) {
+        fprintf(stderr, "FAIL: cannot open the test document\n");
+        return 1;
+    }
+    XRef *xref = doc->getXRef();
+    xref->setObjectCacheSize(16);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        Object dict = xref->fetch({ .num = 3, .gen = 0 });
+        check(dict.isDict() && dict.dictLookup("Key").isInt() && dict.dictLookup("Key").getInt() == 1, "dict value");
+        check(dict.dictLookup("Nested").dictLookup("Inner").isInt(), "nested dict value");
+        check(dict.dictLookup("Added").isNull(), "dict unchanged by earlier in place changes");
+        dict.dictSet("Key", Object(42));
+        dict.dictAdd("Added", Object(true));
+        Object nested = dict.dictLookup("Nested");
+        nested.dictSet("Inner", Object(7));
+
+        Object array = xref->fetch({ .num = 4, .gen = 0 });
+        check(array.isArray() && array.arrayGetLength() == 3, "array length");
+        check(array.arrayGet(0).isInt() && array.arrayGet(0).getInt() == 1, "array unchanged by earlier in place changes");
+        array.arrayAdd(Object(5));
+        array.getArray()->remove(0);
+    }
+
+    Object dict = xref->fetch({ .num = 3, .gen = 0 });
+    check(dict.dictLookup("Nested").dictLookup("Inner").getInt() == 2, "nested dict unchanged by earlier in place changes");
+
+    check(xref->getObjectCacheMisses() == 2, "two misses");
+    check(xref->getObjectCacheHits() == 3, "three hits");
+
+    return testExitCode("xref-object-cache-test");
+}
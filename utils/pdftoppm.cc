@@ -55,28 +55,27 @@
 #include <cmath>
 #include "parseargs.h"
 #include "goo/GooString.h"
+#include "goo/gfile.h"
+#include "goo/ImgWriter.h"
 #include "GlobalParams.h"
 #include "PDFDoc.h"
 #include "PDFDocFactory.h"
 #include "splash/SplashBitmap.h"
 #include "splash/Splash.h"
 #include "splash/SplashErrorCodes.h"
+#include "SplashBandRenderer.h"
 #include "SplashOutputDev.h"
 #include "Win32Console.h"
 #include "numberofcharacters.h"
 #include "sanitychecks.h"
 
-// Uncomment to build pdftoppm with pthreads
-// You may also have to change the buildsystem to
-// link pdftoppm to pthread library
-// This is here for developer testing not user ready
-// #define UTILS_USE_PTHREADS 1
-
-#ifdef UTILS_USE_PTHREADS
-#    include <cerrno>
-#    include <pthread.h>
-#    include <deque>
-#endif // UTILS_USE_PTHREADS
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #if USE_CMS
 #    include <lcms2.h>
@@ -129,16 +128,19 @@ static char enableFreeTypeStr[16] = "";
 static bool enableFreeType = true;
 static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
+static char analyticAntialiasStr[16] = "";
 static bool fontAntialias = true;
 static bool vectorAntialias = true;
+static bool analyticAntialias = false;
+static bool lanczos = false;
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
 static char TiffCompressionStr[16] = "";
 static char thinLineModeStr[8] = "";
 static SplashThinLineMode thinLineMode = splashThinLineDefault;
-#ifdef UTILS_USE_PTHREADS
 static int numberOfJobs = 1;
-#endif // UTILS_USE_PTHREADS
+static int numberOfPageJobs = 1;
+static int bandHeight = 0;
 static bool quiet = false;
 static bool progress = false;
 static bool printVersion = false;
@@ -191,16 +193,18 @@ static const ArgDesc argDesc[] = { { .arg = "-f", .kind = argInt, .val = &firstP
 #endif
                                    { .arg = "-freetype", .kind = argString, .val = enableFreeTypeStr, .size = sizeof(enableFreeTypeStr), .usage = "enable FreeType font rasterizer: yes, no" },
                                    { .arg = "-thinlinemode", .kind = argString, .val = thinLineModeStr, .size = sizeof(thinLineModeStr), .usage = "set thin line mode: none, solid, shape. Default: none" },
+                                   { .arg = "-lanczos", .kind = argFlag, .val = &lanczos, .size = 0, .usage = "scale images down with a Lanczos filter" },
 
                                    { .arg = "-aa", .kind = argString, .val = antialiasStr, .size = sizeof(antialiasStr), .usage = "enable font anti-aliasing: yes, no" },
                                    { .arg = "-aaVector", .kind = argString, .val = vectorAntialiasStr, .size = sizeof(vectorAntialiasStr), .usage = "enable vector anti-aliasing: yes, no" },
+                                   { .arg = "-aaAnalytic", .kind = argString, .val = analyticAntialiasStr, .size = sizeof(analyticAntialiasStr), .usage = "use exact area coverage for vector anti-aliasing: yes, no" },
 
                                    { .arg = "-opw", .kind = argString, .val = ownerPassword, .size = sizeof(ownerPassword), .usage = "owner password (for encrypted files)" },
                                    { .arg = "-upw", .kind = argString, .val = userPassword, .size = sizeof(userPassword), .usage = "user password (for encrypted files)" },
 
-#ifdef UTILS_USE_PTHREADS
-                                   { "-j", argInt, &numberOfJobs, 0, "number of jobs to run concurrently" },
-#endif // UTILS_USE_PTHREADS
+                                   { .arg = "-j", .kind = argInt, .val = &numberOfJobs, .size = 0, .usage = "number of pages to render concurrently" },
+                                   { .arg = "-page-jobs", .kind = argInt, .val = &numberOfPageJobs, .size = 0, .usage = "number of threads rendering each page" },
+                                   { .arg = "-band-height", .kind = argInt, .val = &bandHeight, .size = 0, .usage = "render and write each page in bands of this many rows" },
 
                                    { .arg = "-q", .kind = argFlag, .val = &quiet, .size = 0, .usage = "don't print any messages or errors" },
                                    { .arg = "-progress", .kind = argFlag, .val = &progress, .size = 0, .usage = "print progress info" },
@@ -279,7 +283,65 @@ static bool parseJpegOptions()
 
 static auto annotDisplayDecideCbk = [](Annot * /*annot*/, void * /*user_data*/) { return !hideAnnotations; };
 
-static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x, int y, int w, int h, double pg_w, double pg_h, char *ppmFile)
+// Renders the page in bands of bandHeight rows and writes each one as soon
+// as it is drawn, so that the bitmap of the whole page is never held in
+// memory.
+static void savePageSliceBands(PDFDoc *doc, SplashBandRenderer *bandRenderer, int pg, int x, int y, int w, int h, double x_res, double y_res, SplashBitmap::WriteImgParams *params, char *ppmFile)
+{
+    FILE *f;
+    if (ppmFile != nullptr) {
+        if (!(f = openFile(ppmFile, "wb"))) {
+            fprintf(stderr, "Could not write image to %s; exiting\n", ppmFile);
+            exit(EXIT_FAILURE);
+        }
+    } else {
+#if defined(_WIN32) || defined(__CYGWIN__)
+        _setmode(fileno(stdout), O_BINARY);
+#endif
+        f = stdout;
+    }
+
+    int width, height;
+    SplashBandRenderer::getPageSliceSize(doc, pg, x_res, y_res, 0, !useCropBox, x, y, w, h, &width, &height);
+
+    const bool pnm = !png && !jpeg && !jpegcmyk && !tiff;
+    const SplashImageFileFormat format = png ? splashFormatPng : jpeg ? splashFormatJpeg : jpegcmyk ? splashFormatJpegCMYK : splashFormatTiff;
+    std::unique_ptr<ImgWriter> writer;
+    SplashColorMode imageWriterFormat = splashModeRGB8;
+    bool ok = true;
+
+    // the writer is set up with the mode of the first band
+    const auto writeBand = [&](SplashBitmap *band, int bandY) {
+        if (bandY == 0) {
+            if (pnm) {
+                ok = SplashBitmap::writePNMHeader(f, band->getMode(), width, height) == SplashError::NoError;
+            } else {
+                writer = SplashBitmap::createImgWriter(format, band->getMode(), params, &imageWriterFormat);
+                ok = writer && writer->init(f, width, height, x_res, y_res);
+            }
+        }
+        if (ok) {
+            ok = (pnm ? band->writePNMRows(f) : band->writeImgRows(writer.get(), imageWriterFormat)) == SplashError::NoError;
+        }
+        return ok;
+    };
+    if (!bandRenderer->displayPageSliceBands(doc, pg, x_res, y_res, 0, !useCropBox, false, false, x, y, w, h, bandHeight, writeBand, nullptr, nullptr, annotDisplayDecideCbk, nullptr)) {
+        ok = false;
+    }
+    if (ok && writer && !writer->close()) {
+        ok = false;
+    }
+
+    if (ppmFile != nullptr) {
+        fclose(f);
+        if (!ok) {
+            fprintf(stderr, "Could not write image to %s; exiting\n", ppmFile);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, SplashBandRenderer *bandRenderer, int pg, int x, int y, int w, int h, double pg_w, double pg_h, double x_res, double y_res, char *ppmFile)
 {
     if (w == 0) {
         w = static_cast<int>(ceil(pg_w));
@@ -289,9 +351,6 @@ static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x
     }
     w = (x + w > pg_w ? static_cast<int>(ceil(pg_w - x)) : w);
     h = (y + h > pg_h ? static_cast<int>(ceil(pg_h - y)) : h);
-    doc->displayPageSlice(splashOut, pg, x_resolution, y_resolution, 0, !useCropBox, false, false, x, y, w, h, nullptr, nullptr, annotDisplayDecideCbk, nullptr);
-
-    SplashBitmap *bitmap = splashOut->getBitmap();
 
     SplashBitmap::WriteImgParams params;
     params.jpegQuality = jpegQuality;
@@ -299,17 +358,26 @@ static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x
     params.jpegOptimize = jpegOptimize;
     params.tiffCompression = TiffCompressionStr;
 
+    if (bandHeight > 0) {
+        savePageSliceBands(doc, bandRenderer, pg, x, y, w, h, x_res, y_res, &params, ppmFile);
+        return;
+    }
+
+    bandRenderer->displayPageSlice(splashOut, doc, pg, x_res, y_res, 0, !useCropBox, false, false, x, y, w, h, nullptr, nullptr, annotDisplayDecideCbk, nullptr);
+
+    SplashBitmap *bitmap = splashOut->getBitmap();
+
     if (ppmFile != nullptr) {
         SplashError e;
 
         if (png) {
-            e = bitmap->writeImgFile(splashFormatPng, ppmFile, x_resolution, y_resolution);
+            e = bitmap->writeImgFile(splashFormatPng, ppmFile, x_res, y_res);
         } else if (jpeg) {
-            e = bitmap->writeImgFile(splashFormatJpeg, ppmFile, x_resolution, y_resolution, &params);
+            e = bitmap->writeImgFile(splashFormatJpeg, ppmFile, x_res, y_res, &params);
         } else if (jpegcmyk) {
-            e = bitmap->writeImgFile(splashFormatJpegCMYK, ppmFile, x_resolution, y_resolution, &params);
+            e = bitmap->writeImgFile(splashFormatJpegCMYK, ppmFile, x_res, y_res, &params);
         } else if (tiff) {
-            e = bitmap->writeImgFile(splashFormatTiff, ppmFile, x_resolution, y_resolution, &params);
+            e = bitmap->writeImgFile(splashFormatTiff, ppmFile, x_res, y_res, &params);
         } else {
             e = bitmap->writePNMFile(ppmFile);
         }
@@ -323,91 +391,92 @@ static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x
 #endif
 
         if (png) {
-            bitmap->writeImgFile(splashFormatPng, stdout, x_resolution, y_resolution);
+            bitmap->writeImgFile(splashFormatPng, stdout, x_res, y_res);
         } else if (jpeg) {
-            bitmap->writeImgFile(splashFormatJpeg, stdout, x_resolution, y_resolution, &params);
+            bitmap->writeImgFile(splashFormatJpeg, stdout, x_res, y_res, &params);
         } else if (tiff) {
-            bitmap->writeImgFile(splashFormatTiff, stdout, x_resolution, y_resolution, &params);
+            bitmap->writeImgFile(splashFormatTiff, stdout, x_res, y_res, &params);
         } else {
             bitmap->writePNMFile(stdout);
         }
     }
-
-    if (progress) {
-        fprintf(stderr, "%d %d %s\n", pg, lastPage, ppmFile != nullptr ? ppmFile : "");
-    }
 }
 
-#ifdef UTILS_USE_PTHREADS
-
 struct PageJob
 {
-    PDFDoc *doc;
     int pg;
 
     double pg_w, pg_h;
-    SplashColor *paperColor;
+    double x_res, y_res;
+
+    std::unique_ptr<char[]> ppmFile;
 
-    char *ppmFile;
+    bool done = false;
 };
 
-static std::deque<PageJob> pageJobQueue;
-static pthread_mutex_t pageJobMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<PageJob> pageJobs;
+static std::atomic<size_t> nextPageJob = 0;
+static size_t nextProgressJob = 0;
+static std::mutex progressMutex;
 
-static void processPageJobs()
+static std::unique_ptr<SplashOutputDev> createSplashOutputDev(PDFDoc *doc, SplashColor paperColor)
 {
-    while (true) {
-        // pop the next job or exit if queue is empty
-        pthread_mutex_lock(&pageJobMutex);
-
-        if (pageJobQueue.empty()) {
-            pthread_mutex_unlock(&pageJobMutex);
-            return;
-        }
-
-        PageJob pageJob = pageJobQueue.front();
-        pageJobQueue.pop_front();
-
-        pthread_mutex_unlock(&pageJobMutex);
-
-        // process the job
-        SplashOutputDev *splashOut = new SplashOutputDev(mono                              ? splashModeMono1
-                                                                 : gray                    ? splashModeMono8
-                                                                 : (jpegcmyk || overprint) ? splashModeDeviceN8
-                                                                                           : splashModeRGB8,
-                                                         4, false, *pageJob.paperColor, true, thinLineMode, splashOverprintPreview);
-        splashOut->setFontAntialias(fontAntialias);
-        splashOut->setVectorAntialias(vectorAntialias);
-        splashOut->setEnableFreeType(enableFreeType);
-#    if USE_CMS
-        splashOut->setDisplayProfile(displayprofile);
-        splashOut->setDefaultGrayProfile(defaultgrayprofile);
-        splashOut->setDefaultRGBProfile(defaultrgbprofile);
-        splashOut->setDefaultCMYKProfile(defaultcmykprofile);
-#    endif
-        splashOut->startDoc(pageJob.doc);
-
-        savePageSlice(pageJob.doc, splashOut, pageJob.pg, param_x, param_y, param_w, param_h, pageJob.pg_w, pageJob.pg_h, pageJob.ppmFile);
-
-        delete splashOut;
-        delete[] pageJob.ppmFile;
+    auto splashOut = std::make_unique<SplashOutputDev>(mono ? splashModeMono1 : gray ? splashModeMono8 : (jpegcmyk || overprint) ? splashModeDeviceN8 : splashModeRGB8, 4, paperColor, true, thinLineMode, splashOverprintPreview);
+
+    splashOut->setFontAntialias(fontAntialias);
+    splashOut->setVectorAntialias(vectorAntialias);
+    splashOut->setAnalyticAntialias(analyticAntialias);
+    splashOut->setLanczosImageDownscaling(lanczos);
+    splashOut->setEnableFreeType(enableFreeType);
+#if USE_CMS
+    splashOut->setDisplayProfile(displayprofile);
+    splashOut->setDefaultGrayProfile(defaultgrayprofile);
+    splashOut->setDefaultRGBProfile(defaultrgbprofile);
+    splashOut->setDefaultCMYKProfile(defaultcmykprofile);
+#endif
+    splashOut->startDoc(doc);
+
+    return splashOut;
+}
+
+// Progress is printed in page order, whatever order the workers finish in
+static void finishPageJob(size_t i)
+{
+    if (!progress) {
+        return;
+    }
+
+    const std::scoped_lock lock(progressMutex);
+    pageJobs[i].done = true;
+    while (nextProgressJob < pageJobs.size() && pageJobs[nextProgressJob].done) {
+        const PageJob &pageJob = pageJobs[nextProgressJob];
+        fprintf(stderr, "%d %d %s\n", pageJob.pg, lastPage, pageJob.ppmFile ? pageJob.ppmFile.get() : "");
+        ++nextProgressJob;
     }
 }
 
-#endif // UTILS_USE_PTHREADS
+// Renders queued pages until there are none left. Every worker has its
+// own PDFDoc and SplashOutputDev, so nothing but the queue is shared.
+static void processPageJobs(PDFDoc *doc, SplashColor paperColor)
+{
+    std::unique_ptr<SplashOutputDev> splashOut = createSplashOutputDev(doc, paperColor);
+    SplashBandRenderer bandRenderer(numberOfPageJobs, [doc, paperColor] { return createSplashOutputDev(doc, paperColor); });
+
+    size_t i;
+    while ((i = nextPageJob++) < pageJobs.size()) {
+        const PageJob &pageJob = pageJobs[i];
+        savePageSlice(doc, splashOut.get(), &bandRenderer, pageJob.pg, param_x, param_y, param_w, param_h, pageJob.pg_w, pageJob.pg_h, pageJob.x_res, pageJob.y_res, pageJob.ppmFile.get());
+        finishPageJob(i);
+    }
+}
 
 int main(int argc, char *argv[])
 {
     GooString *fileName = nullptr;
     char *ppmRoot = nullptr;
-    char *ppmFile;
+    std::unique_ptr<char[]> ppmFile;
     std::optional<GooString> ownerPW, userPW;
     SplashColor paperColor;
-#ifndef UTILS_USE_PTHREADS
-    SplashOutputDev *splashOut;
-#else
-    pthread_t *jobs;
-#endif // UTILS_USE_PTHREADS
     bool ok;
     int pg, pg_num_len;
     double pg_w, pg_h;
@@ -455,6 +524,11 @@ int main(int argc, char *argv[])
             fprintf(stderr, "Bad '-aaVector' value on command line\n");
         }
     }
+    if (analyticAntialiasStr[0]) {
+        if (!GlobalParams::parseYesNo2(analyticAntialiasStr, &analyticAntialias)) {
+            fprintf(stderr, "Bad '-aaAnalytic' value on command line\n");
+        }
+    }
 
     if (!jpegOpt.empty()) {
         if (!jpeg) {
@@ -499,6 +573,7 @@ int main(int argc, char *argv[])
         fileName = new GooString("fd://0");
     }
     std::unique_ptr<PDFDoc> doc(PDFDocFactory().createPDFDoc(*fileName, ownerPW, userPW));
+    const std::string docFileName = fileName->toStr();
     delete fileName;
     if (!doc->isOk()) {
         return 1;
@@ -594,23 +669,6 @@ int main(int argc, char *argv[])
     }
 #endif
 
-#ifndef UTILS_USE_PTHREADS
-
-    splashOut = new SplashOutputDev(mono ? splashModeMono1 : gray ? splashModeMono8 : (jpegcmyk || overprint) ? splashModeDeviceN8 : splashModeRGB8, 4, paperColor, true, thinLineMode, splashOverprintPreview);
-
-    splashOut->setFontAntialias(fontAntialias);
-    splashOut->setVectorAntialias(vectorAntialias);
-    splashOut->setEnableFreeType(enableFreeType);
-#    if USE_CMS
-    splashOut->setDisplayProfile(displayprofile);
-    splashOut->setDefaultGrayProfile(defaultgrayprofile);
-    splashOut->setDefaultRGBProfile(defaultrgbprofile);
-    splashOut->setDefaultCMYKProfile(defaultcmykprofile);
-#    endif
-    splashOut->startDoc(doc.get());
-
-#endif // UTILS_USE_PTHREADS
-
     if (sz != 0) {
         param_w = param_h = sz;
     }
@@ -679,61 +737,49 @@ int main(int argc, char *argv[])
         if (ppmRoot != nullptr) {
             const char *ext = png ? "png" : (jpeg || jpegcmyk) ? "jpg" : tiff ? "tif" : mono ? "pbm" : gray ? "pgm" : "ppm";
             if (singleFile && !forceNum) {
-                ppmFile = new char[strlen(ppmRoot) + 1 + strlen(ext) + 1];
-                sprintf(ppmFile, "%s.%s", ppmRoot, ext);
+                ppmFile = std::make_unique<char[]>(strlen(ppmRoot) + 1 + strlen(ext) + 1);
+                sprintf(ppmFile.get(), "%s.%s", ppmRoot, ext);
             } else {
-                ppmFile = new char[strlen(ppmRoot) + 1 + pg_num_len + 1 + strlen(ext) + 1];
-                sprintf(ppmFile, "%s%s%0*d.%s", ppmRoot, sep, pg_num_len, pg, ext);
+                ppmFile = std::make_unique<char[]>(strlen(ppmRoot) + 1 + pg_num_len + 1 + strlen(ext) + 1);
+                sprintf(ppmFile.get(), "%s%s%0*d.%s", ppmRoot, sep, pg_num_len, pg, ext);
             }
         } else {
             ppmFile = nullptr;
         }
-#ifndef UTILS_USE_PTHREADS
-        // process job in main thread
-        savePageSlice(doc.get(), splashOut, pg, param_x, param_y, param_w, param_h, pg_w, pg_h, ppmFile);
-
-        delete[] ppmFile;
-#else
-
-        // queue job for worker threads
-        PageJob pageJob = { .doc = doc.get(),
-                            .pg = pg,
-
-                            .pg_w = pg_w,
-                            .pg_h = pg_h,
 
-                            .paperColor = &paperColor,
-
-                            .ppmFile = ppmFile };
-
-        pageJobQueue.push_back(pageJob);
-
-#endif // UTILS_USE_PTHREADS
+        pageJobs.push_back(PageJob { .pg = pg, .pg_w = pg_w, .pg_h = pg_h, .x_res = x_resolution, .y_res = y_resolution, .ppmFile = std::move(ppmFile) });
     }
-#ifndef UTILS_USE_PTHREADS
-    delete splashOut;
-#else
 
-    // spawn worker threads and wait on them
-    jobs = (pthread_t *)malloc(numberOfJobs * sizeof(pthread_t));
-
-    for (int i = 0; i < numberOfJobs; ++i) {
-        if (pthread_create(&jobs[i], NULL, (void *(*)(void *))processPageJobs, NULL) != 0) {
-            fprintf(stderr, "pthread_create() failed with errno: %d\n", errno);
-            exit(EXIT_FAILURE);
+    // Pages written to stdout have to come out one after the other, and a
+    // document read from stdin can't be opened again for the other workers
+    if (numberOfJobs > 1 && (ppmRoot == nullptr || docFileName == "fd://0")) {
+        if (!quiet) {
+            fprintf(stderr, "Warning: -j needs a PDF file and an output file prefix, rendering one page at a time.\n");
         }
+        numberOfJobs = 1;
     }
+    numberOfJobs = std::clamp(numberOfJobs, 1, std::max(static_cast<int>(pageJobs.size()), 1));
 
-    for (int i = 0; i < numberOfJobs; ++i) {
-        if (pthread_join(jobs[i], NULL) != 0) {
-            fprintf(stderr, "pthread_join() failed with errno: %d\n", errno);
-            exit(EXIT_FAILURE);
+    // The first worker runs on the main thread and renders from doc,
+    // the others get their own copy of the document
+    std::vector<std::unique_ptr<PDFDoc>> workerDocs;
+    for (int i = 1; i < numberOfJobs; ++i) {
+        std::unique_ptr<PDFDoc> workerDoc(PDFDocFactory().createPDFDoc(GooString(docFileName), ownerPW, userPW));
+        if (!workerDoc->isOk()) {
+            return 1;
         }
+        workerDocs.push_back(std::move(workerDoc));
     }
 
-    free(jobs);
-
-#endif // UTILS_USE_PTHREADS
+    std::vector<std::thread> workers;
+    workers.reserve(workerDocs.size());
+    for (const std::unique_ptr<PDFDoc> &workerDoc : workerDocs) {
+        workers.emplace_back(processPageJobs, workerDoc.get(), paperColor);
+    }
+    processPageJobs(doc.get(), paperColor);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
 
     return 0;
 }